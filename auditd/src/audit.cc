@@ -449,35 +449,55 @@ bool Audit::add_to_filleventqueue(const uint32_t event_id,
     //       in the correct fields.. if not we should add an
     //       event to the audit trail saying it is one in an illegal
     //       format (or missing fields)
-    bool res;
-    Event* new_event = new Event(event_id, payload, length);
-    cb_mutex_enter(&producer_consumer_lock);
-    if (filleventqueue->size() < max_audit_queue) {
-        filleventqueue->push(new_event);
-        cb_cond_broadcast(&events_arrived);
-        res = true;
-    } else {
+    if (eventqueue.size() >= max_audit_queue ||
+        !eventqueue.push(event_id, payload, length)) {
         logger->log(EXTENSION_LOG_WARNING, NULL,
                     "Audit: Dropping audit event %u: %s",
-                    new_event->id, new_event->payload.c_str());
+                    event_id, std::string(payload, length).c_str());
         dropped_events++;
-        delete new_event;
-        res = false;
+        return false;
     }
-    cb_mutex_exit(&producer_consumer_lock);
-    return res;
+    notify_consumer();
+    return true;
 }
 
 
 bool Audit::add_reconfigure_event(const char* configfile, const void *cookie) {
-    ConfigureEvent* new_event = new ConfigureEvent(configfile, cookie);
-    cb_mutex_enter(&producer_consumer_lock);
-    filleventqueue->push(new_event);
-    cb_cond_broadcast(&events_arrived);
-    cb_mutex_exit(&producer_consumer_lock);
+    std::unique_ptr<Event> new_event(new ConfigureEvent(configfile, cookie));
+    if (!eventqueue.push(new_event)) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Audit: Failed to queue reconfigure event: queue full");
+        return false;
+    }
+    notify_consumer();
     return true;
 }
 
+void Audit::notify_consumer(void) {
+    // Pairs with the fence in consume_events(); either the consumer sees
+    // the new event before it starts waiting, or we see that it is waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_waiting.load()) {
+        cb_mutex_enter(&producer_consumer_lock);
+        cb_cond_broadcast(&events_arrived);
+        cb_mutex_exit(&producer_consumer_lock);
+    }
+}
+
+void Audit::process_events(void) {
+    uint32_t id;
+    std::unique_ptr<Event> event;
+    while (eventqueue.pop(id, process_buffer, event)) {
+        const bool success = event ? event->process(*this)
+                                   : Event::process(*this, id, process_buffer);
+        if (!success) {
+            dropped_events++;
+        }
+        event.reset();
+    }
+    auditfile.maybe_flush();
+}
+
 
 void Audit::clear_events_map(void) {
     typedef std::map<uint32_t, EventDescriptor*>::iterator it_type;
@@ -489,15 +509,10 @@ void Audit::clear_events_map(void) {
 
 
 void Audit::clear_events_queues(void) {
-    while(!processeventqueue->empty()) {
-        Event *event = processeventqueue->front();
-        processeventqueue->pop();
-        delete event;
-    }
-    while(!filleventqueue->empty()) {
-        Event *event = filleventqueue->front();
-        filleventqueue->pop();
-        delete event;
+    uint32_t id;
+    std::unique_ptr<Event> event;
+    while (eventqueue.pop(id, process_buffer, event)) {
+        event.reset();
     }
 }
 
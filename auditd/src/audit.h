@@ -20,7 +20,6 @@
 #include <inttypes.h>
 #include <map>
 #include <memory>
-#include <queue>
 #include <atomic>
 
 #include <cJSON.h>
@@ -30,25 +29,25 @@
 #include "auditfile.h"
 #include "auditd.h"
 #include "eventdescriptor.h"
-
-class Event;
+#include "eventqueue.h"
 
 class Audit {
 public:
     AuditConfig config;
     std::map<uint32_t,EventDescriptor*> events;
 
-    // We maintain two Event queues. At any one time one will be used to accept
-    // new events, and the other will be processed. The two queues are swapped
-    // periodically.
-    std::unique_ptr<std::queue<Event*>> processeventqueue;
-    std::unique_ptr<std::queue<Event*>> filleventqueue;
+    // The events added by the front end threads, waiting to be processed
+    // by the consumer thread. The producers don't take any locks to add
+    // events to the queue; producer_consumer_lock and events_arrived are
+    // only used to wake up the consumer thread when it's waiting for events
+    // (consumer_waiting).
+    EventQueue eventqueue;
 
     bool terminate_audit_daemon;
     std::string configfile;
     cb_thread_t consumer_tid;
     std::atomic_bool consumer_thread_running;
-    cb_cond_t processeventqueue_empty;
+    std::atomic_bool consumer_waiting;
     cb_cond_t events_arrived;
     cb_mutex_t producer_consumer_lock;
     static EXTENSION_LOGGER_DESCRIPTOR *logger;
@@ -59,20 +58,17 @@ public:
     std::atomic<uint32_t> dropped_events;
 
     Audit()
-        : processeventqueue(new std::queue<Event*>()),
-          filleventqueue(new std::queue<Event*>()),
+        : eventqueue(max_audit_queue + max_audit_queue_headroom),
           terminate_audit_daemon(false),
-          dropped_events(0),
-          max_audit_queue(50000) {
+          dropped_events(0) {
         consumer_thread_running.store(false);
-        cb_cond_initialize(&processeventqueue_empty);
+        consumer_waiting.store(false);
         cb_cond_initialize(&events_arrived);
         cb_mutex_initialize(&producer_consumer_lock);
     }
 
     ~Audit(void) {
         clean_up();
-        cb_cond_destroy(&processeventqueue_empty);
         cb_cond_destroy(&events_arrived);
         cb_mutex_destroy(&producer_consumer_lock);
     }
@@ -91,6 +87,12 @@ public:
     }
 
     bool add_reconfigure_event(const char *configfile, const void *cookie);
+
+    /**
+     * Process all of the events in the event queue. Must only be called
+     * from the consumer thread.
+     */
+    void process_events(void);
     bool create_audit_event(uint32_t event_id, cJSON *payload);
     bool terminate_consumer_thread(void);
     void clear_events_map(void);
@@ -112,13 +114,28 @@ public:
 
 protected:
     void notify_event_state_changed(uint32_t id, bool enabled) const;
+
+    /**
+     * Wake up the consumer thread if it's waiting for events to arrive
+     * (called after adding an event to the event queue)
+     */
+    void notify_consumer(void);
     struct {
         mutable std::mutex mutex;
         std::vector<cb::audit::EventStateListener> clients;
     } event_state_listener;
 
 private:
-    size_t max_audit_queue;
+    /// The number of audit events which may be queued before we start
+    /// dropping them
+    static const size_t max_audit_queue = 50000;
+    /// Extra room in the event queue for the configure events, which
+    /// can't be dropped
+    static const size_t max_audit_queue_headroom = 1024;
+
+    /// Buffer for the payload of the event being processed (recycled
+    /// through the event queue)
+    std::string process_buffer;
 };
 
 #endif
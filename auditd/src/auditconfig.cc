@@ -78,6 +78,8 @@ AuditConfig::AuditConfig(const cJSON *json) : AuditConfig() {
     set_rotate_interval(getObject(json, "rotate_interval", cJSON_Number));
     set_auditd_enabled(getObject(json, "auditd_enabled", -1));
     set_buffered(cJSON_GetObjectItem(const_cast<cJSON*>(json), "buffered"));
+    set_flush_interval(
+            cJSON_GetObjectItem(const_cast<cJSON*>(json), "flush_interval"));
     set_log_directory(getObject(json, "log_path", cJSON_String));
     set_descriptors_path(getObject(json, "descriptors_path", cJSON_String));
     set_sync(getObject(json, "sync", cJSON_Array));
@@ -94,6 +96,7 @@ AuditConfig::AuditConfig(const cJSON *json) : AuditConfig() {
     tags["rotate_interval"] = 1;
     tags["auditd_enabled"] = 1;
     tags["buffered"] = 1;
+    tags["flush_interval"] = 1;
     tags["log_path"] = 1;
     tags["descriptors_path"] = 1;
     tags["sync"] = 1;
@@ -163,6 +166,20 @@ bool AuditConfig::is_buffered(void) const {
     return buffered;
 }
 
+void AuditConfig::set_flush_interval(uint32_t interval) {
+    if (interval > max_flush_interval) {
+        std::stringstream ss;
+        ss << "error: flush interval " << interval
+           << " is too big. Legal range is [0, " << max_flush_interval << "]";
+        throw ss.str();
+    }
+    flush_interval = interval;
+}
+
+uint32_t AuditConfig::get_flush_interval(void) const {
+    return flush_interval;
+}
+
 void AuditConfig::set_log_directory(const std::string &directory) {
     std::lock_guard<std::mutex> guard(log_path_mutex);
     /* Sanitize path */
@@ -296,6 +313,24 @@ void AuditConfig::set_buffered(cJSON *obj) {
     }
 }
 
+void AuditConfig::set_flush_interval(cJSON *obj) {
+    if (obj) {
+        if (obj->type != cJSON_Number) {
+            std::stringstream ss;
+            ss << "Incorrect type (" << obj->type
+               << ") for \"flush_interval\". Should be number";
+            throw ss.str();
+        }
+        if (obj->valueint < 0) {
+            std::stringstream ss;
+            ss << "error: flush interval " << obj->valueint
+               << " can't be negative";
+            throw ss.str();
+        }
+        set_flush_interval(static_cast<uint32_t>(obj->valueint));
+    }
+}
+
 void AuditConfig::set_log_directory(cJSON *obj) {
     set_log_directory(obj->valuestring);
 }
@@ -369,6 +404,7 @@ unique_cJSON_ptr AuditConfig::to_json() const {
     cJSON_AddNumberToObject(root, "rotate_size", get_rotate_size());
     cJSON_AddNumberToObject(root, "rotate_interval", get_rotate_interval());
     cJSON_AddBoolToObject(root, "buffered", is_buffered());
+    cJSON_AddNumberToObject(root, "flush_interval", get_flush_interval());
     cJSON_AddStringToObject(root, "log_path", get_log_directory().c_str());
     cJSON_AddStringToObject(root, "descriptors_path", get_descriptors_path().c_str());
     cJSON_AddBoolToObject(root, "filtering_enabled", is_filtering_enabled());
@@ -402,6 +438,7 @@ void AuditConfig::initialize_config(const cJSON* json) {
     rotate_interval = other.rotate_interval;
     rotate_size = other.rotate_size;
     buffered = other.buffered;
+    flush_interval = other.flush_interval;
     filtering_enabled = other.filtering_enabled;
     {
         std::lock_guard<std::mutex> guard(log_path_mutex);
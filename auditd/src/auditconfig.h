@@ -35,6 +35,7 @@ public:
         rotate_interval(900),
         rotate_size(20 * 1024 * 1024),
         buffered(true),
+        flush_interval(0),
         filtering_enabled(false),
         version(0),
         uuid(""),
@@ -68,6 +69,14 @@ public:
     uint32_t get_rotate_interval(void) const;
     void set_buffered(bool enable);
     bool is_buffered(void) const;
+
+    /**
+     * Set the number of milliseconds buffered events may stay in memory
+     * before they're written to the audit trail. 0 writes them at the end
+     * of each batch of events processed by the audit daemon.
+     */
+    void set_flush_interval(uint32_t interval);
+    uint32_t get_flush_interval(void) const;
     void set_log_directory(const std::string &directory);
     std::string get_log_directory(void) const;
     void set_descriptors_path(const std::string &directory);
@@ -102,6 +111,9 @@ public:
         return max_rotate_file_size;
     }
 
+    /// The longest flush interval (in milliseconds) allowed
+    static const uint32_t max_flush_interval = 60 * 1000;
+
     /**
      * Create a JSON representation of the audit configuration. This is
      * the same JSON representation that the constructor would accept.
@@ -114,6 +126,7 @@ protected:
     void set_rotate_interval(cJSON *obj);
     void set_auditd_enabled(cJSON *obj);
     void set_buffered(cJSON *obj);
+    void set_flush_interval(cJSON *obj);
     void set_log_directory(cJSON *obj);
     void set_descriptors_path(cJSON *obj);
     void set_version(cJSON *obj);
@@ -132,6 +145,7 @@ protected:
     Couchbase::RelaxedAtomic<uint32_t> rotate_interval;
     Couchbase::RelaxedAtomic<size_t> rotate_size;
     Couchbase::RelaxedAtomic<bool> buffered;
+    Couchbase::RelaxedAtomic<uint32_t> flush_interval;
     Couchbase::RelaxedAtomic<bool> filtering_enabled;
     Couchbase::RelaxedAtomic<uint32_t> version;
 
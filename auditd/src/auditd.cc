@@ -45,35 +45,39 @@ static void consume_events(void* arg) {
 
     cb_mutex_enter(&audit.producer_consumer_lock);
     while (!audit.terminate_audit_daemon) {
-        if (audit.filleventqueue->empty()) {
-            cb_cond_timedwait(&audit.events_arrived,
-                              &audit.producer_consumer_lock,
-                              audit.auditfile.get_seconds_to_rotation() * 1000);
-            if (audit.filleventqueue->empty()) {
+        if (audit.eventqueue.empty()) {
+            // Tell the producers to wake us up, and check the queue again
+            // in case an event was added before they could see the flag
+            audit.consumer_waiting.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (audit.eventqueue.empty()) {
+                const uint32_t timeout = std::min(
+                        audit.auditfile.get_seconds_to_rotation() * 1000,
+                        audit.auditfile.get_milliseconds_to_flush());
+                cb_cond_timedwait(&audit.events_arrived,
+                                  &audit.producer_consumer_lock,
+                                  timeout);
+            }
+            audit.consumer_waiting.store(false);
+            if (audit.eventqueue.empty()) {
                 // We timed out, so just rotate the files
                 audit.auditfile.maybe_rotate_files();
             }
         }
         /* now have producer_consumer lock!
-         * event(s) have arrived or shutdown requested
+         * event(s) have arrived, buffered events should be flushed
+         * or shutdown requested
          */
-        swap(audit.processeventqueue, audit.filleventqueue);
         cb_mutex_exit(&audit.producer_consumer_lock);
         // Now outside of the producer_consumer_lock
-
-        while (!audit.processeventqueue->empty()) {
-            Event* event = audit.processeventqueue->front();
-            if (!event->process(audit)) {
-                audit.dropped_events++;
-            }
-            audit.processeventqueue->pop();
-            delete event;
-        }
-        audit.auditfile.flush();
+        audit.process_events();
         cb_mutex_enter(&audit.producer_consumer_lock);
     }
     cb_mutex_exit(&audit.producer_consumer_lock);
 
+    // Process the events added before we were told to terminate
+    audit.process_events();
+
     // close the auditfile
     audit.auditfile.close();
 }
@@ -225,6 +229,22 @@ void process_auditd_stats(Audit* handle,
     add_stats("dropped_events", (uint16_t)strlen("dropped_events"),
               num_of_dropped_events.str().c_str(),
               (uint32_t)num_of_dropped_events.str().length(), cookie);
+
+    auto add_stat = [add_stats, cookie](const char* key, uint64_t value) {
+        const auto val = std::to_string(value);
+        add_stats(key, (uint16_t)strlen(key),
+                  val.data(), (uint32_t)val.size(), cookie);
+    };
+    add_stat("queue_depth", handle->eventqueue.size());
+
+    // The writes of buffered events to the audit trail (the auditfile
+    // is only modified by the consumer thread, but the counters are atomic)
+    const auto& auditfile = handle->auditfile;
+    const uint64_t writes = auditfile.get_write_count();
+    add_stat("writes", writes);
+    add_stat("write_latency_avg_us",
+             writes == 0 ? 0 : auditfile.get_write_time() / writes);
+    add_stat("write_latency_max_us", auditfile.get_max_write_time());
 }
 
 namespace cb {
@@ -102,6 +102,8 @@ bool AuditFile::open(void) {
         log_error(AuditErrorCode::FILE_OPEN_ERROR, open_file_name.c_str());
         return false;
     }
+    // The events are buffered in write_buffer
+    setvbuf(file, nullptr, _IONBF, 0);
     current_size = 0;
     open_time = auditd_time();
     return true;
@@ -110,6 +112,9 @@ bool AuditFile::open(void) {
 
 void AuditFile::close_and_rotate_log(void) {
     cb_assert(file != NULL);
+    if (!write_buffer_to_file()) {
+        log_error(AuditErrorCode::WRITING_TO_DISK_ERROR, strerror(errno));
+    }
     fclose(file);
     file = NULL;
     if (current_size == 0) {
@@ -251,12 +256,14 @@ bool AuditFile::write_event_to_disk(cJSON *output) {
     char *content = cJSON_PrintUnformatted(output);
     bool ret = true;
     if (content) {
-        current_size += fprintf(file, "%s\n", content);
-        if (ferror(file)) {
-            log_error(AuditErrorCode::WRITING_TO_DISK_ERROR, strerror(errno));
-            ret = false;
-            close_and_rotate_log();
-        } else if (!buffered) {
+        if (write_buffer.empty()) {
+            first_buffered = std::chrono::steady_clock::now();
+        }
+        const auto before = write_buffer.size();
+        write_buffer.append(content);
+        write_buffer.push_back('\n');
+        current_size += write_buffer.size() - before;
+        if (!buffered || write_buffer.size() >= max_write_buffer_size) {
             ret = flush();
         }
         cJSON_Free(content);
@@ -296,11 +303,49 @@ void AuditFile::reconfigure(const AuditConfig &config) {
     set_log_directory(config.get_log_directory());
     max_log_size = config.get_rotate_size();
     buffered = config.is_buffered();
+    flush_interval = config.get_flush_interval();
+}
+
+bool AuditFile::write_buffer_to_file(void) {
+    if (write_buffer.empty()) {
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t nw = fwrite(write_buffer.data(), 1, write_buffer.size(), file);
+    const bool ret = nw == write_buffer.size();
+    write_buffer.clear();
+    const uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    write_count++;
+    write_time.fetch_add(usec);
+    max_write_time.setIfGreater(usec);
+    return ret;
+}
+
+bool AuditFile::maybe_flush(void) {
+    if (get_milliseconds_to_flush() == 0) {
+        return flush();
+    }
+    return true;
+}
+
+uint32_t AuditFile::get_milliseconds_to_flush(void) const {
+    if (write_buffer.empty()) {
+        return UINT32_MAX;
+    }
+    const auto buffered_for =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - first_buffered);
+    if (buffered_for.count() >= flush_interval) {
+        return 0;
+    }
+    return flush_interval - uint32_t(buffered_for.count());
 }
 
 bool AuditFile::flush(void) {
     if (is_open()) {
-        if (fflush(file) != 0) {
+        if (!write_buffer_to_file() || fflush(file) != 0) {
             log_error(AuditErrorCode::WRITING_TO_DISK_ERROR,
                       strerror(errno));
             close_and_rotate_log();
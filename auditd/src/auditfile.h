@@ -17,6 +17,7 @@
 #ifndef AUDITFILE_H
 #define AUDITFILE_H
 
+#include <chrono>
 #include <cstdio>
 #include <inttypes.h>
 #include <string>
@@ -25,6 +26,15 @@
 #include "auditconfig.h"
 #include "auditd.h"
 
+#include <relaxed_atomic.h>
+
+/**
+ * The audit trail currently being written to.
+ *
+ * The events are formatted into an in-memory buffer which is written to
+ * the file with a single write when it is flushed (and the file itself
+ * is unbuffered), so a batch of events costs a single system call.
+ */
 class AuditFile {
 public:
 
@@ -34,7 +44,11 @@ public:
         current_size(0),
         max_log_size(20 * 1024 * 1024),
         rotate_interval(900),
-        buffered(true)
+        buffered(true),
+        flush_interval(0),
+        write_count(0),
+        write_time(0),
+        max_write_time(0)
     {
     }
 
@@ -90,7 +104,9 @@ public:
     void cleanup_old_logfile(const std::string& log_path);
 
     /**
-     * Write a json formatted object to the disk
+     * Write a json formatted object to the audit trail. The event is
+     * buffered in memory unless the file is configured to be unbuffered
+     * (or the buffer is full).
      *
      * @param output the data to write
      * @return true if success, false otherwise
@@ -123,6 +139,33 @@ public:
      */
     bool flush(void);
 
+    /**
+     * Flush the buffers to the disk if the oldest buffered event has been
+     * buffered for the configured flush interval.
+     */
+    bool maybe_flush(void);
+
+    /**
+     * get the number of milliseconds until the buffered events should be
+     * flushed (UINT32_MAX if there isn't any buffered events)
+     */
+    uint32_t get_milliseconds_to_flush(void) const;
+
+    /// The number of writes of buffered events to the file
+    uint64_t get_write_count(void) const {
+        return write_count;
+    }
+
+    /// The total time (in microseconds) spent writing to the file
+    uint64_t get_write_time(void) const {
+        return write_time;
+    }
+
+    /// The longest time (in microseconds) spent in a single write
+    uint64_t get_max_write_time(void) const {
+        return max_write_time;
+    }
+
     /**
      * get the number of seconds for the next log rotation
      */
@@ -141,6 +184,7 @@ private:
     void close_and_rotate_log(void);
     void set_log_directory(const std::string &new_directory);
     bool is_timestamp_format_correct(std::string& str);
+    bool write_buffer_to_file(void);
 
     static time_t auditd_time();
 
@@ -152,6 +196,19 @@ private:
     size_t max_log_size;
     uint32_t rotate_interval;
     bool buffered;
+
+    /// Events formatted but not yet written to the file
+    std::string write_buffer;
+    /// The time the oldest event in write_buffer was added
+    std::chrono::steady_clock::time_point first_buffered;
+    /// Milliseconds an event may stay in write_buffer
+    uint32_t flush_interval;
+    /// The size write_buffer may grow to before it must be written
+    static const size_t max_write_buffer_size = 512 * 1024;
+
+    Couchbase::RelaxedAtomic<uint64_t> write_count;
+    Couchbase::RelaxedAtomic<uint64_t> write_time;
+    Couchbase::RelaxedAtomic<uint64_t> max_write_time;
 };
 
 #endif
@@ -54,6 +54,10 @@ bool Event::filterEvent(cJSON* json_payload, const AuditConfig& config) {
 }
 
 bool Event::process(Audit& audit) {
+    return process(audit, id, payload);
+}
+
+bool Event::process(Audit& audit, uint32_t id, const std::string& payload) {
     // Audit is disabled
     if (!audit.config.is_auditd_enabled()) {
         return true;
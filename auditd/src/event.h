@@ -40,6 +40,18 @@ public:
 
     virtual bool process(Audit& audit);
 
+    /**
+     * Process an audit event without creating an Event object for it
+     * (used for the events read from the EventQueue).
+     *
+     * @param audit the audit daemon instance
+     * @param id the id of the event
+     * @param payload the JSON payload of the event
+     * @return true if the event was written to the audit trail (or ignored
+     *         by configuration), false if it was dropped
+     */
+    static bool process(Audit& audit, uint32_t id, const std::string& payload);
+
     /**
      * State whether a given event should be filtered out given the user.
      *
@@ -49,8 +61,9 @@ public:
      *                effective_userid or real_userid
      * @return true if event should be filtered out, else false.
      */
-    bool filterEventByUser(cJSON* json_payload, const AuditConfig& config,
-                           const std::string& userid_type);
+    static bool filterEventByUser(cJSON* json_payload,
+                                  const AuditConfig& config,
+                                  const std::string& userid_type);
 
     /**
      * State whether a given event should be filtered out.
@@ -59,7 +72,7 @@ public:
      * @param config  reference to the audit configuration
      * @return true if event should be filtered out, else false.
      */
-    bool filterEvent(cJSON* eventPayload, const AuditConfig& audit);
+    static bool filterEvent(cJSON* eventPayload, const AuditConfig& audit);
 
     virtual ~Event() {}
 
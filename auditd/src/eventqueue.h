@@ -0,0 +1,196 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "event.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * A bounded multi-producer / single-consumer queue of audit events.
+ *
+ * The front end threads add events to the queue without taking any locks;
+ * each slot in the ring carries a sequence number telling if it is free
+ * for the producer which claimed it (by bumping the tail) or holds an event
+ * ready for the consumer (the audit daemon thread).
+ *
+ * The payload buffers live in the slots and are swapped with the buffer
+ * the consumer passes to pop(), so once the queue is warmed up the
+ * payloads are copied into already allocated buffers instead of allocating
+ * an Event object per audit event.
+ *
+ * Events which need more than an id and a payload (like ConfigureEvent)
+ * are queued as an Event object.
+ */
+class EventQueue {
+public:
+    /**
+     * @param size the requested number of slots in the queue (rounded up
+     *             to the next power of two)
+     */
+    explicit EventQueue(size_t size) : mask(roundUp(size) - 1) {
+        slots.reset(new Slot[mask + 1]);
+        for (size_t ii = 0; ii <= mask; ++ii) {
+            slots[ii].sequence.store(ii, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Add an event to the queue. May be called from any thread.
+     *
+     * @return false if the queue is full
+     */
+    bool push(uint32_t id, const char* payload, size_t length) {
+        Slot* slot = claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->id = id;
+        slot->payload.assign(payload, length);
+        slot->event.reset();
+        publish(*slot);
+        return true;
+    }
+
+    /**
+     * Add an Event object to the queue. May be called from any thread.
+     *
+     * @return false if the queue is full (the event is left in the
+     *         unique_ptr)
+     */
+    bool push(std::unique_ptr<Event>& event) {
+        Slot* slot = claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->id = event->id;
+        slot->payload.clear();
+        slot->event = std::move(event);
+        publish(*slot);
+        return true;
+    }
+
+    /**
+     * Remove the oldest event from the queue. Must only be called from
+     * the consumer thread.
+     *
+     * @param id where to store the id of the event
+     * @param payload swapped with the payload of the event (the buffer
+     *                passed in is recycled for a later event)
+     * @param event where to store the Event object if the event was
+     *              queued as one (reset otherwise)
+     * @return false if the queue is empty
+     */
+    bool pop(uint32_t& id, std::string& payload, std::unique_ptr<Event>& event) {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        id = slot.id;
+        payload.swap(slot.payload);
+        event = std::move(slot.event);
+        // Hand the slot back to the producers for the next lap of the ring
+        slot.sequence.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Is the queue empty (no published events)? Only reliable when
+     * called from the consumer thread.
+     */
+    bool empty() const {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        return slots[pos & mask].sequence.load(std::memory_order_acquire) !=
+               pos + 1;
+    }
+
+    /**
+     * Get the (approximate) number of events in the queue
+     */
+    size_t size() const {
+        const size_t h = head.load(std::memory_order_acquire);
+        const size_t t = tail.load(std::memory_order_acquire);
+        return t > h ? t - h : 0;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+protected:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        uint32_t id = 0;
+        std::string payload;
+        std::unique_ptr<Event> event;
+    };
+
+    static size_t roundUp(size_t size) {
+        size_t ret = 1;
+        while (ret < size) {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+    /**
+     * Reserve the slot at the tail of the queue for the calling producer
+     *
+     * @return the slot, or nullptr if the queue is full
+     */
+    Slot* claim() {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            const size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) -
+                              static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (diff < 0) {
+                // The consumer hasn't released the slot from the previous
+                // lap of the ring yet
+                return nullptr;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Make the claimed slot visible to the consumer
+    void publish(Slot& slot) {
+        const size_t seq = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    // The next position for the producers to claim
+    std::atomic<size_t> tail{0};
+    // The next position for the consumer to read
+    std::atomic<size_t> head{0};
+};
@@ -280,6 +280,36 @@ TEST_F(AuditConfigTest, TestLegalBuffered) {
     EXPECT_NO_THROW(config.initialize_config(json));
 }
 
+// flush_interval
+
+TEST_F(AuditConfigTest, TestNoFlushInterval) {
+    // flush_interval is optional, and events are flushed after each batch
+    // unless specified
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(0u, config.get_flush_interval());
+}
+
+TEST_F(AuditConfigTest, TestFlushIntervalSetGet) {
+    config.set_flush_interval(100);
+    EXPECT_EQ(100u, config.get_flush_interval());
+    EXPECT_THROW(config.set_flush_interval(AuditConfig::max_flush_interval + 1),
+                 std::string);
+}
+
+TEST_F(AuditConfigTest, TestIllegalDatatypeFlushInterval) {
+    cJSON_AddStringToObject(json, "flush_interval", "foobar");
+    EXPECT_THROW(config.initialize_config(json), std::string);
+}
+
+TEST_F(AuditConfigTest, TestLegalFlushInterval) {
+    cJSON_AddNumberToObject(json, "flush_interval", 1000);
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(1000u, config.get_flush_interval());
+
+    cJSON_ReplaceItemInObject(json, "flush_interval", cJSON_CreateNumber(-1));
+    EXPECT_THROW(config.initialize_config(json), std::string);
+}
+
 // log_path
 TEST_F(AuditConfigTest, TestNoLogPath) {
     cJSON *obj = cJSON_DetachItemFromObject(json, "log_path");
@@ -163,6 +163,51 @@ TEST_F(AuditFileTest, TestRollover) {
                 secs == (defaultvalue.get_min_file_rotation_time() - 11));
 }
 
+/**
+ * Test that buffered events aren't written to the file before the flush
+ * interval elapsed (or they're explicitly flushed), and that they're all
+ * written with a single write
+ */
+TEST_F(AuditFileTest, TestFlushInterval) {
+    config.set_flush_interval(AuditConfig::max_flush_interval);
+    AuditFile auditfile;
+    auditfile.reconfigure(config);
+
+    auto filesize = [this]() {
+        FILE* fp = fopen((testdir + "/audit.log").c_str(), "rb");
+        EXPECT_TRUE(fp != nullptr);
+        fseek(fp, 0, SEEK_END);
+        const long size = ftell(fp);
+        fclose(fp);
+        return size;
+    };
+
+    EXPECT_EQ(UINT32_MAX, auditfile.get_milliseconds_to_flush());
+    for (int ii = 0; ii < 10; ++ii) {
+        ASSERT_TRUE(auditfile.ensure_open());
+        ASSERT_TRUE(auditfile.write_event_to_disk(event));
+    }
+    EXPECT_LT(0u, auditfile.get_milliseconds_to_flush());
+    EXPECT_TRUE(auditfile.maybe_flush());
+    EXPECT_EQ(0, filesize());
+    EXPECT_EQ(0u, auditfile.get_write_count());
+
+    EXPECT_TRUE(auditfile.flush());
+    EXPECT_LT(0, filesize());
+    EXPECT_EQ(1u, auditfile.get_write_count());
+    EXPECT_EQ(UINT32_MAX, auditfile.get_milliseconds_to_flush());
+
+    // Unbuffered events are written as they arrive
+    config.set_buffered(false);
+    auditfile.reconfigure(config);
+    const auto size = filesize();
+    ASSERT_TRUE(auditfile.write_event_to_disk(event));
+    EXPECT_LT(size, filesize());
+    EXPECT_EQ(2u, auditfile.get_write_count());
+
+    auditfile.close();
+}
+
 TEST_F(AuditFileTest, TestSuccessfulCrashRecovery) {
     FILE *fp = fopen((testdir + "/audit.log").c_str(), "w");
     EXPECT_TRUE(fp != nullptr);
@@ -0,0 +1,159 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "eventqueue.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EventQueueTest : public ::testing::Test {
+protected:
+    bool push(uint32_t id, const std::string& payload) {
+        return queue.push(id, payload.data(), payload.size());
+    }
+
+    bool pop() {
+        return queue.pop(id, payload, event);
+    }
+
+    EventQueue queue{6};
+    uint32_t id = 0;
+    std::string payload;
+    std::unique_ptr<Event> event;
+};
+
+TEST_F(EventQueueTest, Capacity) {
+    EXPECT_EQ(8u, queue.capacity());
+    EXPECT_EQ(1u, EventQueue(1).capacity());
+    EXPECT_EQ(1024u, EventQueue(1024).capacity());
+}
+
+TEST_F(EventQueueTest, Empty) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0u, queue.size());
+    EXPECT_FALSE(pop());
+}
+
+TEST_F(EventQueueTest, Fifo) {
+    // Go around the ring a few times
+    for (uint32_t ii = 0; ii < 20; ++ii) {
+        EXPECT_TRUE(push(ii, "event" + std::to_string(ii)));
+        EXPECT_TRUE(push(ii + 100, "event" + std::to_string(ii + 100)));
+        EXPECT_FALSE(queue.empty());
+        EXPECT_EQ(2u, queue.size());
+
+        ASSERT_TRUE(pop());
+        EXPECT_EQ(ii, id);
+        EXPECT_EQ("event" + std::to_string(ii), payload);
+        EXPECT_FALSE(event);
+
+        ASSERT_TRUE(pop());
+        EXPECT_EQ(ii + 100, id);
+        EXPECT_EQ("event" + std::to_string(ii + 100), payload);
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST_F(EventQueueTest, Full) {
+    for (uint32_t ii = 0; ii < queue.capacity(); ++ii) {
+        EXPECT_TRUE(push(ii, "event"));
+    }
+    EXPECT_EQ(queue.capacity(), queue.size());
+    EXPECT_FALSE(push(100, "dropped"));
+
+    // Popping an event makes room for one more
+    ASSERT_TRUE(pop());
+    EXPECT_EQ(0u, id);
+    EXPECT_TRUE(push(100, "added"));
+    EXPECT_FALSE(push(101, "dropped"));
+
+    for (uint32_t ii = 1; ii < queue.capacity(); ++ii) {
+        ASSERT_TRUE(pop());
+        EXPECT_EQ(ii, id);
+    }
+    ASSERT_TRUE(pop());
+    EXPECT_EQ(100u, id);
+    EXPECT_EQ("added", payload);
+    EXPECT_FALSE(pop());
+}
+
+TEST_F(EventQueueTest, PayloadBuffersAreRecycled) {
+    const std::string large(1024, 'x');
+    payload.reserve(2048);
+    const auto* buffer = payload.data();
+
+    // The buffer passed to pop() is stored in the slot the event was
+    // read from, and reused when the producer gets back to it
+    ASSERT_TRUE(push(1, large));
+    ASSERT_TRUE(pop());
+    EXPECT_EQ(large, payload);
+    for (size_t ii = 1; ii < queue.capacity(); ++ii) {
+        ASSERT_TRUE(push(1, "small"));
+        ASSERT_TRUE(pop());
+    }
+    ASSERT_TRUE(push(2, large));
+    ASSERT_TRUE(pop());
+    EXPECT_EQ(2u, id);
+    EXPECT_EQ(large, payload);
+    EXPECT_EQ(buffer, payload.data());
+}
+
+TEST(EventQueueMultiProducerTest, AllEventsDelivered) {
+    const uint32_t producers = 4;
+    const uint32_t events = 10000;
+    EventQueue queue(64);
+
+    std::vector<std::thread> threads;
+    for (uint32_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&queue, producer, events]() {
+            for (uint32_t ii = 0; ii < events; ++ii) {
+                const auto payload = std::to_string(ii);
+                while (!queue.push(producer, payload.data(), payload.size())) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Each producer's events must arrive in the order they were added
+    std::vector<uint32_t> next(producers);
+    uint32_t received = 0;
+    uint32_t id;
+    std::string payload;
+    std::unique_ptr<Event> event;
+    while (received < producers * events) {
+        if (!queue.pop(id, payload, event)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ++received;
+        EXPECT_LT(id, producers);
+        if (id < producers) {
+            EXPECT_EQ(std::to_string(next[id]), payload);
+            ++next[id];
+        }
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.empty());
+    for (const auto count : next) {
+        EXPECT_EQ(events, count);
+    }
+}
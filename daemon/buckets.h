@@ -30,6 +30,7 @@
 #include "function_chain.h"
 #include "mcbp_validators.h"
 #include "stats.h"
+#include "timing_histogram.h"
 #include "timings.h"
 #include "topkeys.h"
 #include "task.h"
@@ -0,0 +1,105 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "buffer_pool.h"
+
+#include <platform/make_unique.h>
+
+#include <algorithm>
+
+const size_t BufferPool::MinimumSize;
+const size_t BufferPool::MaximumSize;
+const size_t BufferPool::NumSizeClasses;
+const size_t BufferPool::DefaultMaxCachedBytes;
+
+BufferPool::BufferPool(size_t maxCachedBytes)
+    : maxCachedBytes(maxCachedBytes) {
+}
+
+size_t BufferPool::getSizeClass(size_t size) {
+    size_t sizeClass = 0;
+    size_t classSize = MinimumSize;
+    while (classSize < size && sizeClass < (NumSizeClasses - 1)) {
+        classSize <<= 1;
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+size_t BufferPool::getAllocationSize(size_t size) {
+    if (size > MaximumSize) {
+        return size;
+    }
+    return MinimumSize << getSizeClass(size);
+}
+
+std::unique_ptr<cb::Pipe> BufferPool::tryAllocate(size_t size) {
+    if (size > MaximumSize) {
+        return {};
+    }
+
+    // Try the size class for the requested size, and the one above (we
+    // don't want to hand out a 1MB buffer for a 2k request)
+    const auto sizeClass = getSizeClass(size);
+    const auto last = std::min(sizeClass + 2, NumSizeClasses);
+    for (auto ii = sizeClass; ii < last; ++ii) {
+        auto& list = cache[ii];
+        if (!list.empty()) {
+            auto ret = std::move(list.back());
+            list.pop_back();
+            stats.cachedBytes.fetch_sub(ret->capacity(),
+                                        std::memory_order_relaxed);
+            stats.hits.fetch_add(1, std::memory_order_relaxed);
+            return ret;
+        }
+    }
+
+    return {};
+}
+
+std::unique_ptr<cb::Pipe> BufferPool::allocate(size_t size) {
+    auto ret = tryAllocate(size);
+    if (!ret) {
+        stats.misses.fetch_add(1, std::memory_order_relaxed);
+        ret = std::make_unique<cb::Pipe>(getAllocationSize(size));
+    }
+    return ret;
+}
+
+void BufferPool::release(std::unique_ptr<cb::Pipe> buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    const auto capacity = buffer->capacity();
+    if (capacity < MinimumSize || capacity > MaximumSize ||
+        (stats.cachedBytes.load(std::memory_order_relaxed) + capacity) >
+                maxCachedBytes) {
+        // Not worth caching (or the pool is full); just release it
+        return;
+    }
+
+    // Put it in the largest size class it satisfies (a buffer which grew
+    // to an odd size can still serve the smaller class)
+    auto sizeClass = getSizeClass(capacity);
+    if ((MinimumSize << sizeClass) > capacity) {
+        --sizeClass;
+    }
+
+    buffer->clear();
+    stats.cachedBytes.fetch_add(capacity, std::memory_order_relaxed);
+    cache[sizeClass].emplace_back(std::move(buffer));
+}
@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/pipe.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * The BufferPool is a per-thread cache of network buffers (cb::Pipe) split
+ * into size classes (powers of two from MinimumSize up to MaximumSize).
+ *
+ * Connections borrow their read and write buffers from the pool owned by
+ * their worker thread while they're being served, and return them once
+ * they're empty (see conn_loan_buffers() and conn_return_buffers()). A
+ * buffer which had to grow to fit a large packet is put back in its (larger)
+ * size class and may be reused by the next connection needing a buffer of
+ * that size, instead of reallocating (and copying) the buffer every time.
+ *
+ * Buffers bigger than MaximumSize are never cached, and the number of bytes
+ * cached in the pool is capped to avoid idle threads holding on to a lot of
+ * memory.
+ *
+ * The pool itself isn't thread safe and must only be used by the thread
+ * owning it. The statistics may be read from any thread
+ * (with relaxed memory ordering).
+ */
+class BufferPool {
+public:
+    /// The size of the smallest size class
+    static const size_t MinimumSize = 2048;
+
+    /// The size of the largest size class (bigger buffers isn't cached)
+    static const size_t MaximumSize = 1024 * 1024;
+
+    /// The number of size classes
+    static const size_t NumSizeClasses = 10;
+
+    /// The default limit for the number of bytes cached in the pool
+    static const size_t DefaultMaxCachedBytes = 8 * 1024 * 1024;
+
+    explicit BufferPool(size_t maxCachedBytes = DefaultMaxCachedBytes);
+
+    BufferPool(const BufferPool&) = delete;
+
+    /**
+     * Try to get a cached buffer with a capacity of at least the requested
+     * size
+     *
+     * @param size the minimum capacity of the buffer
+     * @return a buffer from the pool, or nullptr if the pool don't have a
+     *         buffer of the requested size
+     */
+    std::unique_ptr<cb::Pipe> tryAllocate(size_t size);
+
+    /**
+     * Get a buffer with a capacity of at least the requested size
+     *
+     * @param size the minimum capacity of the buffer
+     * @return a buffer from the pool (or a newly allocated one if the pool
+     *         don't have a buffer of the requested size)
+     * @throws std::bad_alloc if we fail to allocate a new buffer
+     */
+    std::unique_ptr<cb::Pipe> allocate(size_t size);
+
+    /**
+     * Return a buffer to the pool. The buffer is cleared and cached in its
+     * size class, or released if the pool is full (or the buffer is too
+     * big to be cached).
+     */
+    void release(std::unique_ptr<cb::Pipe> buffer);
+
+    /**
+     * Get the size of the smallest size class which may hold the
+     * requested number of bytes (or size if bigger than MaximumSize)
+     */
+    static size_t getAllocationSize(size_t size);
+
+    struct Stats {
+        /// The number of allocations served from a cached buffer
+        std::atomic<uint64_t> hits{0};
+        /// The number of allocations which had to allocate a new buffer
+        std::atomic<uint64_t> misses{0};
+        /// The number of bytes currently cached in the pool
+        std::atomic<uint64_t> cachedBytes{0};
+        /**
+         * The number of bytes held by connections (not currently being
+         * served by the thread) which kept their buffers (partial packets
+         * or DCP connections).
+         */
+        std::atomic<uint64_t> idleConnectionBytes{0};
+    };
+
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    /**
+     * A connection left the thread while holding on to buffers with the
+     * provided size.
+     */
+    void addIdleConnectionBytes(size_t bytes) {
+        stats.idleConnectionBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * A connection which held on to buffers with the provided size while
+     * idle is being served by the thread again.
+     */
+    void removeIdleConnectionBytes(size_t bytes) {
+        stats.idleConnectionBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+protected:
+    static size_t getSizeClass(size_t size);
+
+    const size_t maxCachedBytes;
+
+    std::array<std::vector<std::unique_ptr<cb::Pipe>>, NumSizeClasses> cache;
+
+    Stats stats;
+};
@@ -16,6 +16,7 @@
  */
 #include "config.h"
 #include "connections.h"
+#include "io_uring_backend.h"
 #include "mc_time.h"
 #include "memcached.h"
 #include "runtime.h"
@@ -86,10 +87,18 @@ bool McbpConnection::registerEvent() {
     return true;
 }
 
-bool McbpConnection::updateEvent(const short new_flags) {
+bool McbpConnection::updateEvent(short new_flags) {
     struct event_base* base = event.ev_base;
 
-    if (ssl.isEnabled() && ssl.isConnected() && (new_flags & EV_READ)) {
+    if (getIoUringBackend() != nullptr) {
+        // Input arrives through the completions of the multishot recv
+        // operation, so we don't need to be notified by libevent when the
+        // socket is readable.
+        new_flags &= ~EV_READ;
+    }
+
+    if (ssl.isEnabled() && ssl.isConnected() && !ssl.isKernelTlsRx() &&
+        (new_flags & EV_READ)) {
         /*
          * If we want more data and we have SSL, that data might be inside
          * SSL's internal buffers rather than inside the socket buffer. In
@@ -238,6 +247,14 @@ int McbpConnection::sslPreConnection() {
     if (r == 1) {
         ssl.drainBioSendPipe(socketDescriptor);
         ssl.setConnected();
+        if (settings.isSslKernelTls() &&
+            ssl.enableKernelTls(socketDescriptor)) {
+            LOG_DEBUG(this,
+                      "%u: Using kernel TLS offload (rx: %s, tx: %s)",
+                      getId(),
+                      ssl.isKernelTlsRx() ? "true" : "false",
+                      ssl.isKernelTlsTx() ? "true" : "false");
+        }
         auto certResult = ssl.getCertUserName();
         bool disconnect = false;
         switch (certResult.first) {
@@ -305,7 +322,7 @@ int McbpConnection::recv(char* dest, size_t nbytes) {
     }
 
     int res;
-    if (ssl.isEnabled()) {
+    if (ssl.isEnabled() && !ssl.isKernelTlsRx()) {
         ssl.drainBioRecvPipe(socketDescriptor);
 
         if (ssl.hasError()) {
@@ -318,12 +335,21 @@ int McbpConnection::recv(char* dest, size_t nbytes) {
             if (res == -1) {
                 return -1;
             }
+            if (ssl.isKernelTlsRx()) {
+                // The kernel decrypts the rest of the input stream
+                return recv(dest, nbytes);
+            }
         }
 
         /* The SSL negotiation might be complete at this time */
         if (ssl.isConnected()) {
             res = sslRead(dest, nbytes);
         }
+    } else if (auto* backend = getIoUringBackend()) {
+        res = int(backend->recv(*this, dest, nbytes));
+        if (res > 0) {
+            totalRecv += res;
+        }
     } else {
         res = (int)::recv(socketDescriptor, dest, nbytes, 0);
         if (res > 0) {
@@ -336,7 +362,7 @@ int McbpConnection::recv(char* dest, size_t nbytes) {
 
 int McbpConnection::sendmsg(struct msghdr* m) {
     int res = 0;
-    if (ssl.isEnabled()) {
+    if (ssl.isEnabled() && !ssl.isKernelTlsTx()) {
         for (int ii = 0; ii < int(m->msg_iovlen); ++ii) {
             int n = sslWrite(reinterpret_cast<char*>(m->msg_iov[ii].iov_base),
                              m->msg_iov[ii].iov_len);
@@ -352,6 +378,11 @@ int McbpConnection::sendmsg(struct msghdr* m) {
          */
         ssl.drainBioSendPipe(socketDescriptor);
         return res;
+    } else if (auto* backend = getIoUringBackend()) {
+        res = int(backend->sendmsg(*this, m));
+        if (res > 0) {
+            totalSend += res;
+        }
     } else {
         res = int(::sendmsg(socketDescriptor, m, 0));
         if (res > 0) {
@@ -399,7 +430,7 @@ size_t adjust_msghdr(cb::Pipe& pipe, struct msghdr* m, ssize_t nbytes) {
 }
 
 McbpConnection::TransmitResult McbpConnection::transmit() {
-    if (ssl.isEnabled()) {
+    if (ssl.isEnabled() && !ssl.isKernelTlsTx()) {
         // We use OpenSSL to write data into a buffer before we send it
         // over the wire... Lets go ahead and drain that BIO pipe before
         // we may do anything else.
@@ -455,6 +486,11 @@ McbpConnection::TransmitResult McbpConnection::transmit() {
         }
 
         if (res == -1 && is_blocking(error)) {
+            auto* backend = getIoUringBackend();
+            if (backend != nullptr && backend->isSendInFlight(*this)) {
+                // We'll be rescheduled when the send operation completes
+                return TransmitResult::SoftError;
+            }
             if (!updateEvent(EV_WRITE | EV_PERSIST)) {
                 setState(McbpStateMachine::State::closing);
                 return TransmitResult::HardError;
@@ -907,6 +943,26 @@ void McbpConnection::setAgentName(cb::const_char_buffer name) {
     std::copy(name.begin(), name.end(), agentName.begin());
 }
 
+void McbpConnection::updateReadBufferHint(size_t packetSize) {
+    // Don't try to keep room for packets which won't be cached by the pool
+    packetSize = std::min(packetSize, BufferPool::MaximumSize);
+
+    if (packetSize > readBufferHint) {
+        readBufferHint = BufferPool::getAllocationSize(packetSize);
+        smallPacketCount = 0;
+    } else if (readBufferHint > BufferPool::MinimumSize &&
+               packetSize <= readBufferHint / 2) {
+        // Shrink the hint once we've seen a number of packets in a row
+        // which would have fit in the next smaller buffer
+        if (++smallPacketCount == 16) {
+            readBufferHint /= 2;
+            smallPacketCount = 0;
+        }
+    } else {
+        smallPacketCount = 0;
+    }
+}
+
 bool McbpConnection::shouldDelete() {
     return getState() == McbpStateMachine::State ::destroyed;
 }
@@ -987,6 +1043,12 @@ void McbpConnection::close() {
 
     // We don't want any network notifications anymore..
     unregisterEvent();
+    auto* backend = getIoUringBackend();
+    if (backend != nullptr) {
+        // Any operation in flight holds a reference to the connection,
+        // causing us to enter pending close until they're cancelled
+        backend->cancel(*this);
+    }
     safe_close(socketDescriptor);
     socketDescriptor = INVALID_SOCKET;
 
@@ -1050,6 +1112,29 @@ void McbpConnection::setPriority(const Connection::Priority& priority) {
         "Unkown priority: " + std::to_string(int(priority)));
 }
 
+bool McbpConnection::havePendingInputData() {
+    if (!read->empty() || ssl.havePendingInputData()) {
+        return true;
+    }
+
+    auto* backend = getIoUringBackend();
+    return backend != nullptr && backend->havePendingInputData(*this);
+}
+
+IoUringBackend* McbpConnection::getIoUringBackend() const {
+    // SSL connections need to run all of the data through OpenSSL and
+    // use the socket directly
+    if (ssl.isEnabled()) {
+        return nullptr;
+    }
+
+    auto* thr = getThread();
+    if (thr == nullptr) {
+        return nullptr;
+    }
+    return thr->io_uring.get();
+}
+
 bool McbpConnection::selectedBucketIsXattrEnabled() const {
     if (bucketEngine) {
         return settings.isXattrEnabled() &&
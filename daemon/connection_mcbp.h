@@ -20,6 +20,7 @@
 
 #include "config.h"
 
+#include "buffer_pool.h"
 #include "datatype.h"
 #include "dynamic_buffer.h"
 #include "log_macros.h"
@@ -65,6 +66,8 @@
  */
 size_t adjust_msghdr(cb::Pipe& pipe, struct msghdr* m, ssize_t nbytes);
 
+class IoUringBackend;
+
 class McbpConnection : public Connection {
 protected:
     /**
@@ -187,7 +190,7 @@ public:
      *
      * @param mask the new event mask to get notified about
      */
-    bool updateEvent(const short new_flags);
+    bool updateEvent(short new_flags);
 
     /**
      * Reapply the event mask (in case of a timeout we might want to do
@@ -509,9 +512,15 @@ public:
     /**
      * Do we have any pending input data on this connection?
      */
-    bool havePendingInputData() {
-        return (!read->empty() || ssl.havePendingInputData());
-    }
+    bool havePendingInputData();
+
+    /**
+     * Get the io_uring backend to use for network IO for this connection
+     *
+     * @return the backend for the thread serving the connection, or
+     *         nullptr if the connection should use the socket directly
+     */
+    IoUringBackend* getIoUringBackend() const;
 
     /**
      * Try to find RBAC user from the client ssl cert
@@ -536,6 +545,30 @@ public:
     /** Write buffer */
     std::unique_ptr<cb::Pipe> write;
 
+    /**
+     * Get the size of the read buffer the connection should borrow from
+     * the threads buffer pool when it is being served. The size adapts to
+     * the size of the packets recently received on the connection so that
+     * a connection storing large values gets a buffer big enough to hold
+     * the entire packet up front (instead of growing, and copying, the
+     * buffer for every packet).
+     */
+    size_t getReadBufferHint() const {
+        return readBufferHint;
+    }
+
+    /**
+     * Update the read buffer hint with the size of a packet received on
+     * the connection.
+     */
+    void updateReadBufferHint(size_t packetSize);
+
+    /**
+     * The number of bytes held in buffers by the connection the last time
+     * it left the worker thread (see conn_return_buffers())
+     */
+    size_t idleBufferBytes = 0;
+
     Cookie& getCookieObject() {
         return *cookies.front();
     }
@@ -627,6 +660,12 @@ protected:
     /** Is Tracing enabled for this connection? */
     bool tracingEnabled = false;
 
+    /// The size of the read buffer to borrow from the buffer pool
+    size_t readBufferHint = BufferPool::MinimumSize;
+
+    /// The number of packets in a row which would fit in half the hint
+    uint8_t smallPacketCount = 0;
+
     /** The maximum requests we can process in a worker thread timeslice */
     int max_reqs_per_event =
             settings.getRequestsPerEventNotification(EventPriority::Default);
@@ -47,10 +47,10 @@ enum class BufferLoan {
 /** Function prototypes ******************************************************/
 
 static BufferLoan loan_single_buffer(McbpConnection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     BufferPool& pool,
+                                     size_t size,
                                      std::unique_ptr<cb::Pipe>& conn_buf);
-static void maybe_return_single_buffer(McbpConnection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+static void maybe_return_single_buffer(BufferPool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf);
 static void conn_destructor(Connection *c);
 static Connection *allocate_connection(SOCKET sfd,
@@ -257,6 +257,10 @@ void conn_close(McbpConnection& connection) {
     }
     thread->pending_io = list_remove(thread->pending_io, &connection);
 
+    if (thread->io_uring) {
+        thread->io_uring->remove(connection);
+    }
+
     connection.read->clear();
     connection.write->clear();
     /* Return any buffers back to the thread; before we disassociate the
@@ -321,8 +325,12 @@ void conn_loan_buffers(Connection *connection) {
         return;
     }
 
+    auto& pool = c->getThread()->bufferPool;
+    pool.removeIdleConnectionBytes(c->idleBufferBytes);
+    c->idleBufferBytes = 0;
+
     auto* ts = get_thread_stats(c);
-    switch (loan_single_buffer(*c, c->getThread()->read, c->read)) {
+    switch (loan_single_buffer(*c, pool, c->getReadBufferHint(), c->read)) {
     case BufferLoan::Existing:
         ts->rbufs_existing++;
         break;
@@ -334,7 +342,7 @@ void conn_loan_buffers(Connection *connection) {
         break;
     }
 
-    switch (loan_single_buffer(*c, c->getThread()->write, c->write)) {
+    switch (loan_single_buffer(*c, pool, DATA_BUFFER_SIZE, c->write)) {
     case BufferLoan::Existing:
         ts->wbufs_existing++;
         break;
@@ -360,13 +368,25 @@ void conn_return_buffers(Connection *connection) {
         return;
     }
 
-    if (c->isDCP()) {
-        // DCP work differently - let them keep their buffers once allocated.
-        return;
+    auto& pool = thread->bufferPool;
+    // DCP work differently - let them keep their buffers once allocated.
+    if (!c->isDCP()) {
+        maybe_return_single_buffer(pool, c->read);
+        maybe_return_single_buffer(pool, c->write);
     }
 
-    maybe_return_single_buffer(*c, thread->read, c->read);
-    maybe_return_single_buffer(*c, thread->write, c->write);
+    // Keep track of the memory the connection holds on to while it isn't
+    // being served by the thread
+    size_t held = 0;
+    if (c->read) {
+        held += c->read->capacity();
+    }
+    if (c->write) {
+        held += c->write->capacity();
+    }
+    pool.removeIdleConnectionBytes(c->idleBufferBytes);
+    pool.addIdleConnectionBytes(held);
+    c->idleBufferBytes = held;
 }
 
 /** Internal functions *******************************************************/
@@ -449,26 +469,28 @@ static void release_connection(Connection *c) {
 
 /**
  * If the connection doesn't already have a populated conn_buff, ensure that
- * it does by either loaning out the threads, or allocating a new one if
- * necessary.
+ * it does by either borrowing one from the threads buffer pool, or
+ * allocating a new one if necessary.
  */
 static BufferLoan loan_single_buffer(McbpConnection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     BufferPool& pool,
+                                     size_t size,
                                      std::unique_ptr<cb::Pipe>& conn_buf) {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf) {
         return BufferLoan::Existing;
     }
 
-    // If the thread has a buffer, let's loan that to the connection
-    if (thread_buf) {
-        thread_buf.swap(conn_buf);
+    // If the pool has a buffer of the requested size, let's loan that
+    // to the connection
+    conn_buf = pool.tryAllocate(size);
+    if (conn_buf) {
         return BufferLoan::Loaned;
     }
 
     // Need to allocate a new buffer
     try {
-        conn_buf = std::make_unique<cb::Pipe>(DATA_BUFFER_SIZE);
+        conn_buf = pool.allocate(size);
     } catch (const std::bad_alloc&) {
         // Unable to alloc a buffer for the thread. Not much we can do here
         // other than terminate the current connection.
@@ -485,17 +507,12 @@ static BufferLoan loan_single_buffer(McbpConnection& c,
     return BufferLoan::Allocated;
 }
 
-static void maybe_return_single_buffer(McbpConnection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+static void maybe_return_single_buffer(BufferPool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf) {
     if (conn_buf && conn_buf->empty()) {
-        // Buffer clean, dispose of it
-        if (thread_buf) {
-            // Already got a thread buffer.. release this one
-            conn_buf.reset();
-        } else {
-            conn_buf.swap(thread_buf);
-        }
+        // Buffer clean, give it back to the pool (which may cache it for
+        // the next connection needing a buffer of that size)
+        pool.release(std::move(conn_buf));
     }
 }
 
@@ -0,0 +1,260 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "hdr_timing_histogram.h"
+
+#include <cJSON.h>
+#include <cJSON_utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+const unsigned int HdrBucketLayout::SubBucketBits;
+const uint64_t HdrBucketLayout::SubBuckets;
+const unsigned int HdrBucketLayout::MaxBits;
+const size_t HdrBucketLayout::NumBuckets;
+
+size_t HdrBucketLayout::getIndex(uint64_t value) {
+    if (value < SubBuckets) {
+        return size_t(value);
+    }
+    if (value >= (uint64_t(1) << MaxBits)) {
+        return NumBuckets - 1;
+    }
+
+    // Locate the most significant bit
+    unsigned int msb = 63 - __builtin_clzll(value);
+    const unsigned int shift = msb - SubBucketBits;
+    return size_t((shift + 1) * SubBuckets + ((value >> shift) - SubBuckets));
+}
+
+uint64_t HdrBucketLayout::getLowestValue(size_t index) {
+    if (index < SubBuckets) {
+        return index;
+    }
+    const auto shift = (index / SubBuckets) - 1;
+    return ((index % SubBuckets) + SubBuckets) << shift;
+}
+
+uint64_t HdrBucketLayout::getHighestValue(size_t index) {
+    if (index == NumBuckets - 1) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return getLowestValue(index + 1) - 1;
+}
+
+HdrTimingHistogram::HdrTimingHistogram()
+    : counts(HdrBucketLayout::NumBuckets) {
+}
+
+void HdrTimingHistogram::add(std::chrono::nanoseconds duration,
+                             uint64_t count) {
+    addBucket(HdrBucketLayout::getIndex(duration.count()), count);
+}
+
+HdrTimingHistogram& HdrTimingHistogram::operator+=(
+        const HdrTimingHistogram& other) {
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        counts[ii] += other.counts[ii];
+    }
+    total += other.total;
+    return *this;
+}
+
+std::chrono::nanoseconds HdrTimingHistogram::getValueAtPercentile(
+        double percentile) const {
+    if (total == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    auto limit = uint64_t(std::ceil(total * percentile / 100.0));
+    if (limit == 0) {
+        limit = 1;
+    }
+
+    uint64_t count = 0;
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        count += counts[ii];
+        if (count >= limit) {
+            return std::chrono::nanoseconds(
+                    HdrBucketLayout::getHighestValue(ii));
+        }
+    }
+
+    return std::chrono::nanoseconds(
+            HdrBucketLayout::getHighestValue(counts.size() - 1));
+}
+
+/**
+ * The bins used by TimingHistogram (and the "old" mctimings format)
+ */
+struct LegacyBins {
+    void add(uint64_t value, uint64_t count) {
+        const uint64_t us = value / 1000;
+        const uint64_t ms = us / 1000;
+        const uint64_t hs = ms / 500;
+
+        if (us == 0) {
+            ns += count;
+        } else if (us < 1000) {
+            usec[us / 10] += count;
+        } else if (ms < 50) {
+            msec[ms] += count;
+        } else if (hs < 10) {
+            halfsec[hs] += count;
+        } else {
+            const uint64_t sec = ms / 1000;
+            if (sec < 10) {
+                wayout[0] += count;
+            } else if (sec < 20) {
+                wayout[1] += count;
+            } else if (sec < 40) {
+                wayout[2] += count;
+            } else if (sec < 80) {
+                wayout[3] += count;
+            } else {
+                wayout[4] += count;
+            }
+        }
+    }
+
+    uint64_t ns = 0;
+    std::array<uint64_t, 100> usec{};
+    std::array<uint64_t, 50> msec{};
+    std::array<uint64_t, 10> halfsec{};
+    std::array<uint64_t, 5> wayout{};
+};
+
+static cJSON* create_array(const uint64_t* begin, const uint64_t* end) {
+    cJSON* array = cJSON_CreateArray();
+    for (auto* it = begin; it != end; ++it) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(double(*it)));
+    }
+    return array;
+}
+
+std::string HdrTimingHistogram::to_string() const {
+    unique_cJSON_ptr json(cJSON_CreateObject());
+    cJSON* root = json.get();
+    if (root == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    // Map the log-linear buckets into the old bins (by using the lowest
+    // value in the bucket)
+    LegacyBins legacy;
+    cJSON* buckets = cJSON_CreateArray();
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        if (counts[ii] == 0) {
+            continue;
+        }
+        const auto lowest = HdrBucketLayout::getLowestValue(ii);
+        legacy.add(lowest, counts[ii]);
+
+        cJSON* pair = cJSON_CreateArray();
+        cJSON_AddItemToArray(pair, cJSON_CreateNumber(double(lowest)));
+        cJSON_AddItemToArray(pair, cJSON_CreateNumber(double(counts[ii])));
+        cJSON_AddItemToArray(buckets, pair);
+    }
+
+    cJSON_AddNumberToObject(root, "ns", double(legacy.ns));
+    cJSON_AddItemToObject(
+            root,
+            "us",
+            create_array(legacy.usec.data(),
+                         legacy.usec.data() + legacy.usec.size()));
+    // element 0 isn't used
+    cJSON_AddItemToObject(
+            root,
+            "ms",
+            create_array(legacy.msec.data() + 1,
+                         legacy.msec.data() + legacy.msec.size()));
+    cJSON_AddItemToObject(
+            root,
+            "500ms",
+            create_array(legacy.halfsec.data(),
+                         legacy.halfsec.data() + legacy.halfsec.size()));
+    cJSON_AddNumberToObject(root, "5s-9s", double(legacy.wayout[0]));
+    cJSON_AddNumberToObject(root, "10s-19s", double(legacy.wayout[1]));
+    cJSON_AddNumberToObject(root, "20s-39s", double(legacy.wayout[2]));
+    cJSON_AddNumberToObject(root, "40s-79s", double(legacy.wayout[3]));
+    cJSON_AddNumberToObject(root, "80s-inf", double(legacy.wayout[4]));
+    uint64_t wayout = 0;
+    for (const auto& wo : legacy.wayout) {
+        wayout += wo;
+    }
+    // for backwards compatibility, add the old wayouts
+    cJSON_AddNumberToObject(root, "wayout", double(wayout));
+
+    cJSON* hdr = cJSON_CreateObject();
+    cJSON_AddStringToObject(hdr, "unit", "ns");
+    cJSON_AddNumberToObject(
+            hdr, "sub_bucket_bits", HdrBucketLayout::SubBucketBits);
+    cJSON_AddNumberToObject(hdr, "total", double(total));
+    cJSON* percentiles = cJSON_CreateObject();
+    for (const auto& p : {std::make_pair("50", 50.0),
+                          std::make_pair("90", 90.0),
+                          std::make_pair("99", 99.0),
+                          std::make_pair("99.9", 99.9),
+                          std::make_pair("99.99", 99.99)}) {
+        cJSON_AddNumberToObject(percentiles,
+                                p.first,
+                                double(getValueAtPercentile(p.second).count()));
+    }
+    cJSON_AddItemToObject(hdr, "percentiles", percentiles);
+    cJSON_AddItemToObject(hdr, "buckets", buckets);
+    cJSON_AddItemToObject(root, "hdr", hdr);
+
+    char* ptr = cJSON_PrintUnformatted(root);
+    std::string ret(ptr);
+    cJSON_Free(ptr);
+
+    return ret;
+}
+
+AtomicHdrTimingHistogram::AtomicHdrTimingHistogram() {
+    reset();
+}
+
+void AtomicHdrTimingHistogram::addTo(HdrTimingHistogram& histogram) const {
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        const auto count = counts[ii].load(std::memory_order_relaxed);
+        if (count != 0) {
+            histogram.addBucket(ii, count);
+        }
+    }
+}
+
+void AtomicHdrTimingHistogram::copyFrom(
+        const AtomicHdrTimingHistogram& other) {
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        counts[ii].store(other.counts[ii].load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    }
+    total.store(other.getTotal(), std::memory_order_relaxed);
+    totalDuration.store(other.getTotalDuration(), std::memory_order_relaxed);
+}
+
+void AtomicHdrTimingHistogram::reset() {
+    for (auto& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    totalDuration.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Describes the layout of the log-linear ("HDR style") buckets used by
+ * HdrTimingHistogram and AtomicHdrTimingHistogram.
+ *
+ * Durations are recorded in nanoseconds. Values below SubBuckets get a
+ * bucket each, and every power of two above that is split into SubBuckets
+ * equally sized buckets. The width of a bucket is thus at most 1/32 of
+ * the values it holds (~3% relative error) across the entire range, which
+ * gives accurate high percentiles (p99.9, p99.99) for both sub-microsecond
+ * and multi-second operations. Values of MaxBits bits or more are recorded
+ * in the last bucket.
+ */
+struct HdrBucketLayout {
+    static const unsigned int SubBucketBits = 5;
+    static const uint64_t SubBuckets = uint64_t(1) << SubBucketBits;
+    /// 2^40 ns is ~18 minutes
+    static const unsigned int MaxBits = 40;
+    static const size_t NumBuckets = (MaxBits - SubBucketBits + 1) * SubBuckets;
+
+    /// Get the index of the bucket the value (in ns) belongs to
+    static size_t getIndex(uint64_t value);
+
+    /// Get the lowest value (in ns) recorded in the bucket
+    static uint64_t getLowestValue(size_t index);
+
+    /// Get the highest value (in ns) recorded in the bucket
+    static uint64_t getHighestValue(size_t index);
+};
+
+/**
+ * A (non thread safe) log-linear histogram of durations. This is the
+ * format the per-thread shards are merged into when the timings are
+ * requested.
+ */
+class HdrTimingHistogram {
+public:
+    HdrTimingHistogram();
+
+    void add(std::chrono::nanoseconds duration, uint64_t count = 1);
+
+    /// Add the count for the bucket with the given index
+    void addBucket(size_t index, uint64_t count) {
+        counts[index] += count;
+        total += count;
+    }
+
+    HdrTimingHistogram& operator+=(const HdrTimingHistogram& other);
+
+    uint64_t getTotal() const {
+        return total;
+    }
+
+    uint64_t getCount(size_t index) const {
+        return counts[index];
+    }
+
+    /**
+     * Get the (highest) value in the bucket containing the requested
+     * percentile, or 0 if the histogram is empty
+     *
+     * @param percentile the percentile to look up (0 - 100)
+     */
+    std::chrono::nanoseconds getValueAtPercentile(double percentile) const;
+
+    /**
+     * Generate the JSON representation of the histogram. For backwards
+     * compatibility it contains the "ns", "us", "ms", "500ms", ... keys
+     * used by TimingHistogram (with the counts mapped into those bins),
+     * in addition to the "hdr" object holding the non-zero log-linear
+     * buckets as [lowest value in ns, count] pairs and a set of
+     * precomputed percentiles.
+     */
+    std::string to_string() const;
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+};
+
+/**
+ * A log-linear histogram which may be updated concurrently (lock free)
+ * by multiple threads. Each worker thread records into its own instance
+ * (see Timings) so that the counters normally aren't shared between
+ * threads.
+ */
+class AtomicHdrTimingHistogram {
+public:
+    AtomicHdrTimingHistogram();
+
+    void add(std::chrono::nanoseconds duration) {
+        counts[HdrBucketLayout::getIndex(duration.count())].fetch_add(
+                1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        totalDuration.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+
+    /// Merge the current counts into the provided histogram
+    void addTo(HdrTimingHistogram& histogram) const;
+
+    /// Set the counts to the values in the provided histogram
+    void copyFrom(const AtomicHdrTimingHistogram& other);
+
+    void reset();
+
+    /// The number of durations recorded
+    uint64_t getTotal() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    /// The sum of all of the durations recorded (in ns)
+    uint64_t getTotalDuration() const {
+        return totalDuration.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint32_t>, HdrBucketLayout::NumBuckets> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> totalDuration;
+};
@@ -0,0 +1,470 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "io_uring_backend.h"
+
+#include "connections.h"
+#include "memcached.h"
+
+#include <platform/strerror.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/// The number of entries in the submission queue
+static const unsigned int RingEntries = 256;
+
+/// The number of buffers in the provided buffer ring (must be a power of 2)
+static const unsigned int NumBuffers = 256;
+
+/// The size of each of the buffers in the provided buffer ring
+static const size_t BufferSize = 16 * 1024;
+
+/// The maximum number of buffers a connection may hold before its recv is
+/// cancelled, so that a single connection can't starve the others
+static const unsigned int MaxBuffersPerConnection = NumBuffers / 8;
+
+/// The buffer group id used for the provided buffer ring
+static const int BufferGroup = 0;
+
+IoUringBackend::IoUringBackend(LIBEVENT_THREAD& thr)
+    : thread(thr), ring(new io_uring) {
+    int ret = io_uring_queue_init(RingEntries, ring.get(), 0);
+    if (ret < 0) {
+        throw std::system_error(-ret,
+                                std::system_category(),
+                                "IoUringBackend: io_uring_queue_init");
+    }
+
+    eventfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventfd == -1) {
+        auto error = errno;
+        io_uring_queue_exit(ring.get());
+        throw std::system_error(
+                error, std::system_category(), "IoUringBackend: eventfd");
+    }
+
+    ret = io_uring_register_eventfd(ring.get(), eventfd);
+    if (ret < 0) {
+        ::close(eventfd);
+        io_uring_queue_exit(ring.get());
+        throw std::system_error(-ret,
+                                std::system_category(),
+                                "IoUringBackend: io_uring_register_eventfd");
+    }
+
+    bufferRing = io_uring_setup_buf_ring(
+            ring.get(), NumBuffers, BufferGroup, 0, &ret);
+    if (bufferRing == nullptr) {
+        ::close(eventfd);
+        io_uring_queue_exit(ring.get());
+        throw std::system_error(-ret,
+                                std::system_category(),
+                                "IoUringBackend: io_uring_setup_buf_ring");
+    }
+
+    bufferMemory.resize(NumBuffers * BufferSize);
+    for (unsigned int ii = 0; ii < NumBuffers; ++ii) {
+        io_uring_buf_ring_add(bufferRing,
+                              bufferMemory.data() + ii * BufferSize,
+                              BufferSize,
+                              uint16_t(ii),
+                              io_uring_buf_ring_mask(NumBuffers),
+                              int(ii));
+    }
+    io_uring_buf_ring_advance(bufferRing, NumBuffers);
+    buffersAvailable = NumBuffers;
+}
+
+IoUringBackend::~IoUringBackend() {
+    io_uring_free_buf_ring(ring.get(), bufferRing, NumBuffers, BufferGroup);
+    io_uring_queue_exit(ring.get());
+    ::close(eventfd);
+}
+
+bool IoUringBackend::isSupported() {
+    struct io_uring probe;
+    if (io_uring_queue_init(2, &probe, 0) < 0) {
+        return false;
+    }
+    int ret;
+    auto* buffers = io_uring_setup_buf_ring(&probe, 2, BufferGroup, 0, &ret);
+    if (buffers != nullptr) {
+        io_uring_free_buf_ring(&probe, buffers, 2, BufferGroup);
+    }
+    io_uring_queue_exit(&probe);
+    return buffers != nullptr;
+}
+
+uint64_t IoUringBackend::encode(McbpConnection& c, Operation op) const {
+    // Connection objects are at least 8 byte aligned so we may use the
+    // lower bits to tag the operation
+    return reinterpret_cast<uint64_t>(&c) | uint64_t(op);
+}
+
+struct io_uring_sqe* IoUringBackend::getSqe() {
+    auto* sqe = io_uring_get_sqe(ring.get());
+    if (sqe == nullptr) {
+        // The submission queue is full; flush it and try again
+        submit();
+        sqe = io_uring_get_sqe(ring.get());
+        if (sqe == nullptr) {
+            throw std::runtime_error(
+                    "IoUringBackend::getSqe: submission queue is full");
+        }
+    }
+    ++pending;
+    ++numOperations;
+    return sqe;
+}
+
+void IoUringBackend::armRecv(McbpConnection& c, ConnectionState& state) {
+    auto* sqe = getSqe();
+    io_uring_prep_recv_multishot(sqe, c.getSocketDescriptor(), nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BufferGroup;
+    io_uring_sqe_set_data64(sqe, encode(c, Operation::Recv));
+    state.recvArmed = true;
+    state.recvCancelled = false;
+    c.incrementRefcount();
+}
+
+void IoUringBackend::rearmWaitingConnections() {
+    while (buffersAvailable > 0 && !waitingForBuffers.empty()) {
+        auto* c = waitingForBuffers.front();
+        waitingForBuffers.pop_front();
+        auto iter = connections.find(c);
+        if (iter == connections.end() || !iter->second.waitingForBuffers) {
+            continue;
+        }
+        auto& state = iter->second;
+        state.waitingForBuffers = false;
+        if (!state.recvArmed && !state.closing) {
+            armRecv(*c, state);
+        }
+    }
+}
+
+void IoUringBackend::recycleBuffer(uint16_t bid) {
+    io_uring_buf_ring_add(bufferRing,
+                          bufferMemory.data() + size_t(bid) * BufferSize,
+                          BufferSize,
+                          bid,
+                          io_uring_buf_ring_mask(NumBuffers),
+                          0);
+    io_uring_buf_ring_advance(bufferRing, 1);
+    ++buffersAvailable;
+}
+
+ssize_t IoUringBackend::recv(McbpConnection& c, char* dest, size_t nbytes) {
+    auto& state = connections[&c];
+
+    size_t copied = 0;
+    while (copied < nbytes && !state.input.empty()) {
+        auto& chunk = state.input.front();
+        const auto n = std::min(size_t(chunk.length), nbytes - copied);
+        std::memcpy(dest + copied,
+                    bufferMemory.data() + size_t(chunk.bid) * BufferSize +
+                            chunk.offset,
+                    n);
+        copied += n;
+        chunk.offset += uint32_t(n);
+        chunk.length -= uint32_t(n);
+        if (chunk.length == 0) {
+            recycleBuffer(chunk.bid);
+            state.input.pop_front();
+        }
+    }
+
+    if (copied > 0) {
+        return ssize_t(copied);
+    }
+
+    // Errors and EOF are reported after all of the data received before
+    // them is consumed
+    if (state.recvError != 0) {
+        errno = state.recvError;
+        state.recvError = 0;
+        return -1;
+    }
+
+    if (state.eof) {
+        return 0;
+    }
+
+    if (!state.recvArmed && !state.closing && !state.waitingForBuffers) {
+        if (buffersAvailable > 0) {
+            armRecv(c, state);
+        } else {
+            // Rearming now would only fail with ENOBUFS again; wait for
+            // the other connections to return some of the buffers
+            state.waitingForBuffers = true;
+            waitingForBuffers.push_back(&c);
+        }
+    }
+
+    set_ewouldblock();
+    return -1;
+}
+
+bool IoUringBackend::havePendingInputData(const McbpConnection& c) const {
+    auto iter = connections.find(const_cast<McbpConnection*>(&c));
+    if (iter == connections.end()) {
+        return false;
+    }
+    return !iter->second.input.empty() || iter->second.eof ||
+           iter->second.recvError != 0;
+}
+
+ssize_t IoUringBackend::sendmsg(McbpConnection& c, struct msghdr* m) {
+    auto& state = connections[&c];
+    if (state.sendCompleted) {
+        state.sendCompleted = false;
+        if (state.sendResult < 0) {
+            errno = -state.sendResult;
+            return -1;
+        }
+        return state.sendResult;
+    }
+
+    if (!state.sendInFlight) {
+        auto* sqe = getSqe();
+        io_uring_prep_sendmsg(sqe, c.getSocketDescriptor(), m, MSG_NOSIGNAL);
+        io_uring_sqe_set_data64(sqe, encode(c, Operation::Send));
+        state.sendInFlight = true;
+        c.incrementRefcount();
+    }
+
+    set_ewouldblock();
+    return -1;
+}
+
+bool IoUringBackend::isSendInFlight(const McbpConnection& c) const {
+    auto iter = connections.find(const_cast<McbpConnection*>(&c));
+    return iter != connections.end() && iter->second.sendInFlight;
+}
+
+void IoUringBackend::cancel(McbpConnection& c) {
+    auto iter = connections.find(&c);
+    if (iter == connections.end()) {
+        return;
+    }
+
+    auto& state = iter->second;
+    state.closing = true;
+    state.waitingForBuffers = false;
+    if (state.recvArmed && !state.recvCancelled) {
+        auto* sqe = getSqe();
+        io_uring_prep_cancel64(sqe, encode(c, Operation::Recv), 0);
+        io_uring_sqe_set_data64(sqe, encode(c, Operation::Cancel));
+    }
+    if (state.sendInFlight) {
+        auto* sqe = getSqe();
+        io_uring_prep_cancel64(sqe, encode(c, Operation::Send), 0);
+        io_uring_sqe_set_data64(sqe, encode(c, Operation::Cancel));
+    }
+
+    // The caller is about to close the socket. Make sure that the kernel
+    // sees all of the operations referring to the socket before the
+    // descriptor may be reused by another connection.
+    submit();
+}
+
+void IoUringBackend::remove(McbpConnection& c) {
+    auto iter = connections.find(&c);
+    if (iter == connections.end()) {
+        return;
+    }
+
+    auto& state = iter->second;
+    if (state.recvArmed || state.sendInFlight) {
+        throw std::logic_error(
+                "IoUringBackend::remove: connection has operations in "
+                "flight");
+    }
+
+    for (const auto& chunk : state.input) {
+        recycleBuffer(chunk.bid);
+    }
+    connections.erase(iter);
+    waitingForBuffers.erase(std::remove(waitingForBuffers.begin(),
+                                        waitingForBuffers.end(),
+                                        &c),
+                            waitingForBuffers.end());
+}
+
+void IoUringBackend::submit() {
+    rearmWaitingConnections();
+    if (pending == 0) {
+        return;
+    }
+
+    int ret;
+    do {
+        ret = io_uring_submit(ring.get());
+    } while (ret == -EINTR);
+
+    if (ret < 0) {
+        LOG_WARNING(nullptr,
+                    "IoUringBackend::submit: io_uring_submit failed on "
+                    "worker thread %u: %s",
+                    thread.index,
+                    cb_strerror(-ret).c_str());
+        return;
+    }
+    pending = 0;
+    ++numSubmits;
+}
+
+void IoUringBackend::processCompletions() {
+    // Drain the notification counter so that we'll get notified about
+    // new completions
+    uint64_t value;
+    while (::read(eventfd, &value, sizeof(value)) == sizeof(value)) {
+        // empty
+    }
+
+    // Reap all of the completions before running any connections (as
+    // running a connection may queue new operations)
+    std::vector<std::pair<McbpConnection*, short>> ready;
+    struct io_uring_cqe* cqe;
+    unsigned int head;
+    unsigned int count = 0;
+    io_uring_for_each_cqe(ring.get(), head, cqe) {
+        ++count;
+        const auto data = io_uring_cqe_get_data64(cqe);
+        const auto op = Operation(data & 0x7);
+        if (op == Operation::Cancel) {
+            continue;
+        }
+
+        auto* c = reinterpret_cast<McbpConnection*>(data & ~uint64_t(0x7));
+        auto& state = connections[c];
+        short which = 0;
+
+        if (op == Operation::Recv) {
+            which = EV_READ;
+            if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+                const auto bid =
+                        uint16_t(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                state.input.push_back({bid, 0, uint32_t(cqe->res)});
+                --buffersAvailable;
+            } else if (cqe->res == 0) {
+                state.eof = true;
+            } else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+                // Running out of buffers terminates the multishot recv,
+                // and it is rearmed once the connection drained its input
+                // and there are buffers available again
+                state.recvError = -cqe->res;
+            }
+
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                state.recvArmed = false;
+                c->decrementRefcount();
+            } else if (state.input.size() >= MaxBuffersPerConnection &&
+                       !state.recvCancelled && !state.closing) {
+                // Stop receiving until the connection consumed its input;
+                // it is rearmed by recv() once the input is drained
+                auto* sqe = getSqe();
+                io_uring_prep_cancel64(sqe, encode(*c, Operation::Recv), 0);
+                io_uring_sqe_set_data64(sqe, encode(*c, Operation::Cancel));
+                state.recvCancelled = true;
+            }
+        } else {
+            which = EV_WRITE;
+            state.sendInFlight = false;
+            state.sendCompleted = true;
+            state.sendResult = cqe->res;
+            c->decrementRefcount();
+        }
+
+        auto iter = std::find_if(
+                ready.begin(),
+                ready.end(),
+                [c](const std::pair<McbpConnection*, short>& entry) {
+                    return entry.first == c;
+                });
+        if (iter == ready.end()) {
+            ready.emplace_back(c, which);
+        } else {
+            iter->second |= which;
+        }
+    }
+    io_uring_cq_advance(ring.get(), count);
+
+    for (auto& entry : ready) {
+        auto* c = entry.first;
+        if (c->isRegisteredInLibevent() || c->isSocketClosed()) {
+            // We're running it now, so it doesn't need to be run again
+            // from the pending io list
+            thread.pending_io = list_remove(thread.pending_io, c);
+            run_event_loop(c, entry.second);
+        }
+        // Connections blocked in the engine (ewouldblock) are rescheduled
+        // through notify_io_complete (which may already have put them on
+        // the pending io list), and pick up the received data at that time
+    }
+}
+
+#else
+
+IoUringBackend::IoUringBackend(LIBEVENT_THREAD& thr) : thread(thr) {
+    throw std::runtime_error(
+            "IoUringBackend: memcached is built without io_uring support");
+}
+
+IoUringBackend::~IoUringBackend() = default;
+
+bool IoUringBackend::isSupported() {
+    return false;
+}
+
+ssize_t IoUringBackend::recv(McbpConnection&, char*, size_t) {
+    throw std::logic_error("IoUringBackend::recv: not supported");
+}
+
+bool IoUringBackend::havePendingInputData(const McbpConnection&) const {
+    return false;
+}
+
+ssize_t IoUringBackend::sendmsg(McbpConnection&, struct msghdr*) {
+    throw std::logic_error("IoUringBackend::sendmsg: not supported");
+}
+
+bool IoUringBackend::isSendInFlight(const McbpConnection&) const {
+    return false;
+}
+
+void IoUringBackend::cancel(McbpConnection&) {
+}
+
+void IoUringBackend::remove(McbpConnection&) {
+}
+
+void IoUringBackend::submit() {
+}
+
+void IoUringBackend::processCompletions() {
+}
+
+#endif
@@ -0,0 +1,247 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "config.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class McbpConnection;
+struct LIBEVENT_THREAD;
+struct io_uring;
+struct io_uring_buf_ring;
+struct msghdr;
+
+/**
+ * The IoUringBackend performs the network IO for the (plain) connections
+ * served by a single worker thread by using io_uring instead of doing a
+ * recv / sendmsg syscall every time libevent reports the socket as
+ * readable / writable.
+ *
+ * The state machine for the connections is kept intact; the backend only
+ * replaces McbpConnection::recv() and McbpConnection::sendmsg():
+ *
+ *   * Input is received through a multishot recv operation into a pool
+ *     of buffers registered with the kernel (a provided buffer ring).
+ *     McbpConnection::recv() copies the received data out of the pool
+ *     buffers into the connections input pipe, and returns EWOULDBLOCK
+ *     when there isn't any data available (just like the socket would).
+ *     The pool is shared by all of the connections, so a connection may
+ *     only hold a limited number of the buffers before its recv is
+ *     cancelled (until it has consumed its input). A connection which
+ *     runs out of input while the pool is empty waits for buffers to be
+ *     returned before its recv is rearmed.
+ *
+ *   * Output is sent by queueing a sendmsg operation with the msghdr
+ *     owned by the connection. The connection leaves the state machine
+ *     (like it would for EWOULDBLOCK) and is scheduled again once the
+ *     completion arrives, at which point McbpConnection::sendmsg()
+ *     returns the result of the operation.
+ *
+ * Operations aren't submitted to the kernel as they're queued, but in
+ * batches at the end of every iteration of the worker threads event loop
+ * (see submit()). The ring notifies the worker thread about completions
+ * through an eventfd registered in libevent, causing processCompletions()
+ * to run the event loop for all of the connections with completed
+ * operations.
+ *
+ * Every operation in flight holds a reference to the connection so that
+ * the connection object stays around (in the pending_close state) until
+ * the kernel is done with the memory owned by the connection.
+ *
+ * The backend is only available when built with liburing, and all
+ * methods must be called from the worker thread owning the backend (with
+ * the thread mutex held).
+ */
+class IoUringBackend {
+public:
+    /**
+     * Create a new backend for the provided thread
+     *
+     * @param thread the thread owning the backend
+     * @throws std::system_error if we fail to set up the ring (for instance
+     *                           if the kernel doesn't support io_uring)
+     * @throws std::runtime_error if built without io_uring support
+     */
+    explicit IoUringBackend(LIBEVENT_THREAD& thread);
+
+    ~IoUringBackend();
+
+    /**
+     * Is io_uring support compiled into this binary, and does the kernel
+     * support the features the backend needs (a ring with a provided
+     * buffer ring)?
+     */
+    static bool isSupported();
+
+    /**
+     * Get the file descriptor the backend use to notify about completed
+     * operations (it should be monitored for EV_READ in libevent)
+     */
+    int getNotificationFd() const {
+        return eventfd;
+    }
+
+    /**
+     * Receive data for the connection. The semantics is the same as for
+     * ::recv on a non-blocking socket (returns -1 and EWOULDBLOCK if
+     * there isn't any data available)
+     *
+     * @param c the connection to receive data for
+     * @param dest where to store the data
+     * @param nbytes the size of dest
+     * @return the number of bytes received, 0 on EOF and -1 on error
+     */
+    ssize_t recv(McbpConnection& c, char* dest, size_t nbytes);
+
+    /**
+     * Do we have received data for the connection which isn't consumed
+     * yet?
+     */
+    bool havePendingInputData(const McbpConnection& c) const;
+
+    /**
+     * Send the data in the message header for the connection. If no send
+     * operation is outstanding for the connection one is queued and -1
+     * with EWOULDBLOCK is returned. The connection is rescheduled once
+     * the operation completes, and the next call to sendmsg return the
+     * result of the operation.
+     *
+     * The message header (and the IO vector it points to) must stay
+     * unchanged until the completion is returned.
+     *
+     * @param c the connection to send data for
+     * @param m the message header containing the data to send
+     * @return the number of bytes sent, or -1 on error
+     */
+    ssize_t sendmsg(McbpConnection& c, struct msghdr* m);
+
+    /**
+     * Is there a send operation in flight for the connection?
+     */
+    bool isSendInFlight(const McbpConnection& c) const;
+
+    /**
+     * The connection is about to close its socket; cancel all outstanding
+     * operations for the connection and submit them to the kernel before
+     * the socket may be reused.
+     */
+    void cancel(McbpConnection& c);
+
+    /**
+     * Release all resources held for the connection (must only be called
+     * when there isn't any operations in flight for the connection)
+     */
+    void remove(McbpConnection& c);
+
+    /**
+     * Submit all queued operations to the kernel (called at the end of
+     * every iteration of the event loop)
+     */
+    void submit();
+
+    /**
+     * Reap all of the completed operations and run the event loop for
+     * the connections they belong to.
+     */
+    void processCompletions();
+
+    /// The number of operations we've queued
+    uint64_t getNumOperations() const {
+        return numOperations;
+    }
+
+    /// The number of io_uring_enter syscalls used to submit them
+    uint64_t getNumSubmits() const {
+        return numSubmits;
+    }
+
+protected:
+    /// The type of operation stored in the lower bits of the user data
+    enum class Operation : uint64_t { Recv = 1, Send = 2, Cancel = 3 };
+
+    /// A chunk of received (and not yet consumed) data in a pool buffer
+    struct Chunk {
+        uint16_t bid;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    /// The per-connection state tracked by the backend
+    struct ConnectionState {
+        /// Received data not yet consumed by the connection
+        std::deque<Chunk> input;
+        /// Is the multishot recv currently armed?
+        bool recvArmed = false;
+        /// Have we cancelled the recv as the connection holds too many
+        /// buffers?
+        bool recvCancelled = false;
+        /// Is the connection waiting for buffers to be able to rearm?
+        bool waitingForBuffers = false;
+        /// Have we received EOF from the socket
+        bool eof = false;
+        /// The last (unreported) error from the recv operation
+        int recvError = 0;
+        /// Is there a send operation in flight?
+        bool sendInFlight = false;
+        /// Do we have a send result which isn't returned yet?
+        bool sendCompleted = false;
+        /// The result of the last send operation
+        int sendResult = 0;
+        /// The connection is closing; don't rearm any operations
+        bool closing = false;
+    };
+
+    struct io_uring_sqe* getSqe();
+    void armRecv(McbpConnection& c, ConnectionState& state);
+    void rearmWaitingConnections();
+    void recycleBuffer(uint16_t bid);
+    uint64_t encode(McbpConnection& c, Operation op) const;
+
+    /// The thread owning the backend
+    LIBEVENT_THREAD& thread;
+
+    /// The ring used to submit / reap operations
+    std::unique_ptr<io_uring> ring;
+
+    /// The event fd registered with the ring for completion notifications
+    int eventfd = -1;
+
+    /// The ring of buffers provided to the kernel for multishot recv
+    io_uring_buf_ring* bufferRing = nullptr;
+
+    /// The memory backing the buffers in the buffer ring
+    std::vector<uint8_t> bufferMemory;
+
+    /// The number of buffers currently in the buffer ring
+    unsigned int buffersAvailable = 0;
+
+    /// Connections waiting for buffers to be returned to the ring
+    std::deque<McbpConnection*> waitingForBuffers;
+
+    /// The number of operations queued since the last submit
+    unsigned int pending = 0;
+
+    std::unordered_map<McbpConnection*, ConnectionState> connections;
+
+    uint64_t numOperations = 0;
+    uint64_t numSubmits = 0;
+};
@@ -822,6 +822,42 @@ void mcbp_execute_packet(Cookie& cookie) {
     }
 }
 
+/**
+ * Make sure that the input buffer for the connection is big enough to hold
+ * the entire packet.
+ *
+ * If the buffer is too small we'll move the data over to a buffer of the
+ * right size from the threads buffer pool (rather than reallocating the
+ * buffer) so that the buffer may be reused by the next connection receiving
+ * a packet of that size.
+ */
+static void grow_read_buffer(McbpConnection& c, size_t needed) {
+    auto* ts = get_thread_stats(&c);
+    if (c.read->capacity() >= needed) {
+        if (needed > DATA_BUFFER_SIZE) {
+            // The buffer we got from the pool was big enough to hold the
+            // entire packet, so we avoided growing the default sized
+            // buffer (and copying what we've received so far)
+            ts->rbuf_copy_avoided_bytes += c.read->rsize();
+        }
+        // We might need to move the data to the beginning of the buffer
+        c.read->ensureCapacity(needed - c.read->rsize());
+        return;
+    }
+
+    auto& pool = c.getThread()->bufferPool;
+    auto buffer = pool.allocate(needed);
+    auto input = c.read->rdata();
+    buffer->produce([&input](cb::byte_buffer dest) -> ssize_t {
+        std::copy(input.begin(), input.end(), dest.begin());
+        return input.size();
+    });
+    c.read->clear();
+    c.read.swap(buffer);
+    pool.release(std::move(buffer));
+    ts->rbufs_grown++;
+}
+
 void try_read_mcbp_command(McbpConnection& c) {
     auto input = c.read->rdata();
     if (input.size() < sizeof(cb::mcbp::Request)) {
@@ -888,18 +924,18 @@ void try_read_mcbp_command(McbpConnection& c) {
         return;
     }
 
+    const size_t needed = sizeof(cb::mcbp::Request) + header.getBodylen();
+    c.updateReadBufferHint(needed);
+
     if (c.isPacketAvailable()) {
         // we've got the entire packet spooled up, just go execute
         cookie.setPacket(Cookie::PacketContent::Full,
-                         cb::const_byte_buffer{input.data(),
-                                               sizeof(cb::mcbp::Request) +
-                                                       header.getBodylen()});
+                         cb::const_byte_buffer{input.data(), needed});
         c.setState(McbpStateMachine::State::execute);
     } else {
         // we need to allocate more memory!!
         try {
-            size_t needed = sizeof(cb::mcbp::Request) + header.getBodylen();
-            c.read->ensureCapacity(needed - c.read->rsize());
+            grow_read_buffer(c, needed);
             // ensureCapacity may have reallocated the buffer.. make sure
             // that the packet in the cookie points to the correct address
             cookie.setPacket(Cookie::PacketContent::Header,
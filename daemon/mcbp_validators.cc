@@ -841,8 +841,16 @@ static protocol_binary_response_status stat_validator(const Cookie& cookie)
 
     if (req->message.header.request.magic != PROTOCOL_BINARY_REQ ||
         req->message.header.request.extlen != 0 || klen != blen ||
-        req->message.header.request.cas != 0 ||
-        req->message.header.request.datatype != PROTOCOL_BINARY_RAW_BYTES) {
+        req->message.header.request.cas != 0) {
+        return PROTOCOL_BINARY_RESPONSE_EINVAL;
+    }
+
+    // The JSON datatype requests all of the stats as a single JSON
+    // document (a snapshot) instead of one packet per stat
+    const auto datatype = req->message.header.request.datatype;
+    if (datatype != PROTOCOL_BINARY_RAW_BYTES &&
+        (datatype != PROTOCOL_BINARY_DATATYPE_JSON ||
+         !cookie.getConnection().isJsonEnabled())) {
         return PROTOCOL_BINARY_RESPONSE_EINVAL;
     }
 
@@ -24,6 +24,7 @@
 #include <memcached/extension.h>
 #include <JSON_checker.h>
 
+#include "buffer_pool.h"
 #include "dynamic_buffer.h"
 #include "executorpool.h"
 #include "log_macros.h"
@@ -92,6 +93,8 @@ private:
     std::queue<std::unique_ptr<ConnectionQueueItem> > connections;
 };
 
+class IoUringBackend;
+
 struct LIBEVENT_THREAD {
     /**
      * Destructor.
@@ -133,11 +136,11 @@ struct LIBEVENT_THREAD {
     /// Type of IO this thread processes
     ThreadType type = ThreadType::GENERAL;
 
-    /// Shared read buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> read;
-
-    /// Shared write buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> write;
+    /**
+     * Pool of network buffers the connections serviced by this thread
+     * borrow their read and write buffers from.
+     */
+    BufferPool bufferPool;
 
     /**
      * Shared sub-document operation for all connections serviced by this
@@ -161,6 +164,16 @@ struct LIBEVENT_THREAD {
      * when they need to validate a JSON document
      */
     JSON_checker::Validator validator;
+
+    /**
+     * The io_uring backend used for network IO for the connections
+     * serviced by this thread (only set when the network_backend setting
+     * is set to io_uring and the platform supports it)
+     */
+    std::unique_ptr<IoUringBackend> io_uring;
+
+    /// listen event for completions from the io_uring backend
+    struct event io_uring_event = {};
 };
 
 #define LOCK_THREAD(t) t->mutex.lock();
@@ -205,6 +218,12 @@ void thread_init(int nthreads, struct event_base *main_base,
 void threads_shutdown();
 void threads_cleanup();
 
+/*
+ * Get the network backend the worker threads use. This may differ from the
+ * one in the settings if we had to fall back to libevent.
+ */
+NetworkBackend get_network_backend();
+
 void dispatch_conn_new(SOCKET sfd, int parent_port);
 
 /* Lock wrappers for cache functions that are called from main loop. */
@@ -271,6 +290,15 @@ void notify_thread_bucket_deletion(LIBEVENT_THREAD& me);
 
 void threads_notify_bucket_deletion();
 void threads_complete_bucket_deletion();
+
+/**
+ * Get the aggregated statistics for the buffer pools owned by the worker
+ * threads.
+ */
+void threads_buffer_pool_stats(uint64_t& hits,
+                               uint64_t& misses,
+                               uint64_t& cachedBytes,
+                               uint64_t& idleConnectionBytes);
 void threads_initiate_bucket_deletion();
 
 // This should probably go in a network-helper file..
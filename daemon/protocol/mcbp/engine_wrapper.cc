@@ -146,6 +146,46 @@ cb::EngineErrorCasPair bucket_store_if(Cookie& cookie,
     return ret;
 }
 
+cb::EngineErrorCasPair bucket_splice(Cookie& cookie,
+                                     const DocKey& key,
+                                     uint16_t vbucket,
+                                     uint64_t cas,
+                                     size_t offset,
+                                     size_t length,
+                                     cb::const_char_buffer data,
+                                     protocol_binary_datatype_t datatype,
+                                     rel_time_t exptime,
+                                     mutation_descr_t& mut_info) {
+    auto& c = cookie.getConnection();
+    auto* engine = c.getBucketEngine();
+    if (engine->splice == nullptr) {
+        return {cb::engine_errc::not_supported, 0};
+    }
+
+    TRACE_SCOPE(get_server_api(), &cookie, cb::tracing::TraceCode::STORE);
+    auto ret = engine->splice(c.getBucketEngineAsV0(),
+                              &cookie,
+                              key,
+                              vbucket,
+                              cas,
+                              offset,
+                              length,
+                              data,
+                              datatype,
+                              exptime,
+                              mut_info);
+    if (ret.status == cb::engine_errc::success) {
+        cb::audit::document::add(cookie,
+                                 cb::audit::document::Operation::Modify);
+    } else if (ret.status == cb::engine_errc::disconnect) {
+        LOG_INFO(&c,
+                 "%u: %s bucket_splice return ENGINE_DISCONNECT",
+                 c.getId(),
+                 c.getDescription().c_str());
+    }
+    return ret;
+}
+
 ENGINE_ERROR_CODE bucket_remove(Cookie& cookie,
                                 const DocKey& key,
                                 uint64_t& cas,
@@ -62,6 +62,22 @@ cb::EngineErrorCasPair bucket_store_if(
         cb::StoreIfPredicate predicate,
         DocumentState document_state = DocumentState::Alive);
 
+/**
+ * Replace a byte range of the value of an existing document (see
+ * ENGINE_HANDLE_V1::splice). Returns not_supported if the bucket doesn't
+ * implement splice.
+ */
+cb::EngineErrorCasPair bucket_splice(Cookie& cookie,
+                                     const DocKey& key,
+                                     uint16_t vbucket,
+                                     uint64_t cas,
+                                     size_t offset,
+                                     size_t length,
+                                     cb::const_char_buffer data,
+                                     protocol_binary_datatype_t datatype,
+                                     rel_time_t exptime,
+                                     mutation_descr_t& mut_info);
+
 ENGINE_ERROR_CODE bucket_remove(Cookie& cookie,
                                 const DocKey& key,
                                 uint64_t& cas,
@@ -25,6 +25,8 @@
 #include <daemon/mc_time.h>
 #include <daemon/mcbp.h>
 #include <daemon/runtime.h>
+#include <daemon/stats_snapshot.h>
+#include <logger/logger.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <mcbp/protocol/header.h>
 #include <memcached/audit_interface.h>
@@ -241,6 +243,20 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
                  add_stat_callback,
                  "wbufs_existing",
                  thread_stats.wbufs_existing);
+        add_stat(cookie, add_stat_callback, "rbufs_grown",
+                 thread_stats.rbufs_grown);
+        add_stat(cookie, add_stat_callback, "rbuf_copy_avoided_bytes",
+                 thread_stats.rbuf_copy_avoided_bytes);
+
+        uint64_t pool_hits, pool_misses, pool_cached, pool_idle_conn;
+        threads_buffer_pool_stats(
+                pool_hits, pool_misses, pool_cached, pool_idle_conn);
+        add_stat(cookie, add_stat_callback, "buffer_pool_hits", pool_hits);
+        add_stat(cookie, add_stat_callback, "buffer_pool_misses", pool_misses);
+        add_stat(cookie, add_stat_callback, "buffer_pool_cached_bytes",
+                 pool_cached);
+        add_stat(cookie, add_stat_callback, "buffer_pool_idle_conn_bytes",
+                 pool_idle_conn);
         add_stat(cookie, add_stat_callback, "iovused_high_watermark",
                  thread_stats.iovused_high_watermark);
         add_stat(cookie, add_stat_callback, "msgused_high_watermark",
@@ -395,6 +411,10 @@ static void process_stat_settings(ADD_STAT add_stat_callback, Cookie& cookie) {
             settings.isXattrEnabled());
     add_stat(cookie, add_stat_callback, "privilege_debug",
              settings.isPrivilegeDebug());
+    add_stat(cookie, add_stat_callback, "ssl_kernel_tls",
+             settings.isSslKernelTls());
+    add_stat(cookie, add_stat_callback, "topkeys_sample_rate",
+             std::to_string(settings.getTopkeysSampleRate()).c_str());
 
     add_stat(cookie, add_stat_callback, "saslauthd_socketpath",
              cb::sasl::saslauthd::get_socketpath().c_str());
@@ -403,6 +423,10 @@ static void process_stat_settings(ADD_STAT add_stat_callback, Cookie& cookie) {
              add_stat_callback,
              "collections_prototype",
              settings.isCollectionsPrototypeEnabled());
+    add_stat(cookie,
+             add_stat_callback,
+             "network_backend",
+             to_string(get_network_backend()).c_str());
 }
 
 static void append_bin_stats(const char* key,
@@ -430,6 +454,14 @@ static void append_bin_stats(const char* key,
                     builder.getFrame()->getBodylen());
 }
 
+/**
+ * Did the client ask for the stats as a single JSON document (by sending
+ * the request with the JSON datatype)?
+ */
+static bool is_snapshot_request(const Cookie& cookie) {
+    return cookie.getHeader().getDatatype() == PROTOCOL_BINARY_DATATYPE_JSON;
+}
+
 static void append_stats(const char* key,
                          const uint16_t klen,
                          const char* val,
@@ -439,6 +471,11 @@ static void append_stats(const char* key,
 
     auto& cookie = *const_cast<Cookie*>(
             reinterpret_cast<const Cookie*>(void_cookie.get()));
+    if (klen != 0 && is_snapshot_request(cookie)) {
+        cb::stats::addToSnapshot(
+                cookie.getDynamicBuffer(), {key, klen}, {val, vlen});
+        return;
+    }
     needed = vlen + klen + sizeof(protocol_binary_response_header);
     if (!cookie.growDynamicBuffer(needed)) {
         return;
@@ -574,6 +611,26 @@ static ENGINE_ERROR_CODE stat_audit_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats logger</code> used to get statistics from
+ * the (async) file logger.
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_logger_executor(const std::string& arg,
+                                              Cookie& cookie) {
+    if (arg.empty()) {
+        const auto stats = cb::logger::getStats();
+        add_stat(cookie, append_stats, "queued", stats.queued);
+        add_stat(cookie, append_stats, "written", stats.written);
+        add_stat(cookie, append_stats, "dropped", stats.dropped);
+        return ENGINE_SUCCESS;
+    } else {
+        return ENGINE_EINVAL;
+    }
+}
+
 /**
  * Handler for the <code>stats bucket details</code> used to get information
  * of the buckets (type, state, #clients etc)
@@ -808,6 +865,29 @@ static ENGINE_ERROR_CODE stat_tracing_executor(const std::string& arg,
     }
 }
 
+/**
+ * Terminate the JSON document built for a snapshot request, and fill in
+ * the header of the response carrying it (in the space reserved in front
+ * of it).
+ */
+static ENGINE_ERROR_CODE finish_snapshot(Cookie& cookie) {
+    auto& dbuf = cookie.getDynamicBuffer();
+    if (!cb::stats::endSnapshot(dbuf)) {
+        return ENGINE_ENOMEM;
+    }
+
+    auto* response = reinterpret_cast<cb::mcbp::Response*>(dbuf.getRoot());
+    *response = {};
+    response->setMagic(cb::mcbp::Magic::ClientResponse);
+    response->setOpcode(cb::mcbp::ClientOpcode::Stat);
+    response->setDatatype(cb::mcbp::Datatype::JSON);
+    response->setStatus(uint16_t(cb::mcbp::Status::Success));
+    response->setBodylen(
+            uint32_t(dbuf.getOffset() - sizeof(cb::mcbp::Response)));
+    response->setOpaque(cookie.getHeader().getOpaque());
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE StatsCommandContext::step() {
     struct stat_handler {
         /**
@@ -829,6 +909,7 @@ ENGINE_ERROR_CODE StatsCommandContext::step() {
             {"worker_thread_info", {false, stat_sched_executor}},
             {"settings", {false, stat_settings_executor}},
             {"audit", {true, stat_audit_executor}},
+            {"logger", {true, stat_logger_executor}},
             {"bucket_details", {true, stat_bucket_details_executor}},
             {"aggregate", {false, stat_aggregate_executor}},
             {"connections", {false, stat_connections_executor}},
@@ -840,6 +921,21 @@ ENGINE_ERROR_CODE StatsCommandContext::step() {
 
     ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
 
+    const bool snapshot = is_snapshot_request(cookie);
+    if (snapshot) {
+        // Start over if we're called again after returning EWOULDBLOCK,
+        // and leave room for the header of the response carrying the
+        // document
+        cookie.getDynamicBuffer().clear();
+        if (!cookie.growDynamicBuffer(sizeof(cb::mcbp::Response))) {
+            return ENGINE_ENOMEM;
+        }
+        cookie.getDynamicBuffer().moveOffset(sizeof(cb::mcbp::Response));
+        if (!cb::stats::startSnapshot(cookie.getDynamicBuffer())) {
+            return ENGINE_ENOMEM;
+        }
+    }
+
     if (key.empty()) {
         /* request all statistics */
         ret = bucket_get_stats(cookie, {}, append_stats);
@@ -881,6 +977,10 @@ ENGINE_ERROR_CODE StatsCommandContext::step() {
         }
     }
 
+    if (ret == ENGINE_SUCCESS && snapshot) {
+        ret = finish_snapshot(cookie);
+    }
+
     if (ret == ENGINE_SUCCESS) {
         append_stats(nullptr, 0, nullptr, 0, static_cast<void*>(&cookie));
 
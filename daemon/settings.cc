@@ -235,6 +235,80 @@ static void handle_tracing_enabled(Settings& s, cJSON* obj) {
     }
 }
 
+/**
+ * Handle the "ssl_kernel_tls" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_kernel_tls(Settings& s, cJSON* obj) {
+    if (obj->type == cJSON_True) {
+        s.setSslKernelTls(true);
+    } else if (obj->type == cJSON_False) {
+        s.setSslKernelTls(false);
+    } else {
+        throw std::invalid_argument(
+                "\"ssl_kernel_tls\" must be a boolean value");
+    }
+}
+
+/**
+ * Handle the "topkeys_sample_rate" tag in the settings
+ *
+ *  The value must be a positive integer value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_topkeys_sample_rate(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number) {
+        throw std::invalid_argument(
+                "\"topkeys_sample_rate\" must be an integer");
+    }
+    if (obj->valueint < 1) {
+        throw std::invalid_argument(
+                "\"topkeys_sample_rate\" must be a positive integer");
+    }
+    s.setTopkeysSampleRate(uint32_t(obj->valueint));
+}
+
+std::string to_string(NetworkBackend backend) {
+    switch (backend) {
+    case NetworkBackend::Libevent:
+        return "libevent";
+    case NetworkBackend::IoUring:
+        return "io_uring";
+    }
+    throw std::invalid_argument("to_string(NetworkBackend): Unknown value " +
+                                std::to_string(int(backend)));
+}
+
+/**
+ * Handle the "network_backend" tag in the settings
+ *
+ *  The value must be one of the strings "libevent" or "io_uring"
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_network_backend(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_String) {
+        throw std::invalid_argument("\"network_backend\" must be a string");
+    }
+
+    const std::string value(obj->valuestring);
+    if (value == "libevent") {
+        s.setNetworkBackend(NetworkBackend::Libevent);
+    } else if (value == "io_uring") {
+        s.setNetworkBackend(NetworkBackend::IoUring);
+    } else {
+        throw std::invalid_argument(
+                "\"network_backend\" must be \"libevent\" or \"io_uring\"");
+    }
+}
+
 /**
  * Handle "default_reqs_per_event", "reqs_per_event_high_priority",
  * "reqs_per_event_med_priority" and "reqs_per_event_low_priority" tag in
@@ -685,7 +759,10 @@ void Settings::reconfigure(const unique_cJSON_ptr& json) {
             {"collections_prototype", handle_collections_prototype},
             {"opcode_attributes_override", handle_opcode_attributes_override},
             {"topkeys_enabled", handle_topkeys_enabled},
-            {"tracing_enabled", handle_tracing_enabled}};
+            {"tracing_enabled", handle_tracing_enabled},
+            {"network_backend", handle_network_backend},
+            {"ssl_kernel_tls", handle_ssl_kernel_tls},
+            {"topkeys_sample_rate", handle_topkeys_sample_rate}};
 
     cJSON* obj = json->child;
     while (obj != nullptr) {
@@ -772,6 +849,12 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                 "topkeys_size can't be changed dynamically");
         }
     }
+    if (other.has.network_backend) {
+        if (other.network_backend != network_backend) {
+            throw std::invalid_argument(
+                    "network_backend can't be changed dynamically");
+        }
+    }
     if (other.has.sasl_mechanisms) {
         if (other.sasl_mechanisms != sasl_mechanisms) {
             throw std::invalid_argument(
@@ -985,6 +1068,15 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.ssl_kernel_tls) {
+        if (other.ssl_kernel_tls != ssl_kernel_tls) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "%s kernel TLS offload for new SSL connections",
+                  other.ssl_kernel_tls.load() ? "Enable" : "Disable");
+            setSslKernelTls(other.ssl_kernel_tls.load());
+        }
+    }
+
     if (other.has.collections_prototype) {
         if (other.collections_prototype != collections_prototype) {
             logit(EXTENSION_LOG_NOTICE,
@@ -1139,6 +1231,16 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
         setTopkeysEnabled(other.isTopkeysEnabled());
     }
+
+    if (other.has.topkeys_sample_rate) {
+        if (other.getTopkeysSampleRate() != getTopkeysSampleRate()) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change topkeys sample rate from %u to %u",
+                  getTopkeysSampleRate(),
+                  other.getTopkeysSampleRate());
+            setTopkeysSampleRate(other.getTopkeysSampleRate());
+        }
+    }
 }
 
 void Settings::logit(EXTENSION_LOG_LEVEL level, const char* fmt, ...) {
@@ -44,6 +44,19 @@ enum class EventPriority {
     Default
 };
 
+/**
+ * The backend the worker threads use to perform network IO for the
+ * connections they serve.
+ */
+enum class NetworkBackend {
+    /// Readiness notifications from libevent, one syscall per read / write
+    Libevent,
+    /// Completion based IO through io_uring (Linux only)
+    IoUring
+};
+
+std::string to_string(NetworkBackend backend);
+
 /* When adding a setting, be sure to update process_stat_settings */
 /**
  * Globally accessible settings as derived from the commandline / JSON config
@@ -723,6 +736,21 @@ public:
         notify_changed("topkeys_enabled");
     }
 
+    uint32_t getTopkeysSampleRate() const {
+        return topkeys_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the rate topkeys samples the operations with (1 means that every
+     * operation is recorded, N means that 1 of every N operations is
+     * recorded)
+     */
+    void setTopkeysSampleRate(uint32_t rate) {
+        Settings::topkeys_sample_rate.store(rate, std::memory_order_relaxed);
+        has.topkeys_sample_rate = true;
+        notify_changed("topkeys_sample_rate");
+    }
+
     bool isTracingEnabled() const {
         return tracing_enabled.load(std::memory_order_acquire);
     }
@@ -733,6 +761,39 @@ public:
         notify_changed("tracing_enabled");
     }
 
+    bool isSslKernelTls() const {
+        return ssl_kernel_tls.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Should we try to offload the TLS record layer to the kernel (kTLS)
+     * once the SSL handshake completes (only affects new connections)
+     */
+    void setSslKernelTls(bool enabled) {
+        Settings::ssl_kernel_tls.store(enabled, std::memory_order_release);
+        has.ssl_kernel_tls = true;
+        notify_changed("ssl_kernel_tls");
+    }
+
+    /**
+     * Get the network backend the worker threads should use
+     */
+    NetworkBackend getNetworkBackend() const {
+        return network_backend;
+    }
+
+    /**
+     * Set the network backend the worker threads should use (only
+     * used during startup)
+     *
+     * @param backend the new backend to use
+     */
+    void setNetworkBackend(NetworkBackend backend) {
+        Settings::network_backend = backend;
+        has.network_backend = true;
+        notify_changed("network_backend");
+    }
+
 protected:
 
     /**
@@ -894,11 +955,26 @@ protected:
      */
     std::atomic_bool topkeys_enabled{false};
 
+    /**
+     * Record 1 of every N operations in topkeys
+     */
+    std::atomic<uint32_t> topkeys_sample_rate{1};
+
     /**
      * Is tracing enabled or not
      */
     std::atomic_bool tracing_enabled{true};
 
+    /**
+     * Should SSL connections try to use kernel TLS offload
+     */
+    std::atomic_bool ssl_kernel_tls{false};
+
+    /**
+     * The backend used by the worker threads for network IO
+     */
+    NetworkBackend network_backend{NetworkBackend::Libevent};
+
 public:
     /**
      * Flags for each of the above config options, indicating if they were
@@ -940,6 +1016,9 @@ public:
         bool opcode_attributes_override;
         bool topkeys_enabled;
         bool tracing_enabled;
+        bool network_backend;
+        bool ssl_kernel_tls;
+        bool topkeys_sample_rate;
     } has;
 
 protected:
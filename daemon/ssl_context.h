@@ -144,6 +144,36 @@ public:
 
     bool havePendingInputData();
 
+    /**
+     * Try to offload the TLS record layer for the (connected) stream to
+     * the kernel (kTLS) by installing the session keys on the socket.
+     *
+     * This is only possible for TLS 1.2 with AES-GCM, and each direction
+     * is only moved to the kernel if OpenSSL don't have any buffered data
+     * for that direction (as we wouldn't know the record sequence number
+     * to use). Once moved to the kernel, the data for that direction must
+     * be read (or written) directly from (or to) the socket instead of
+     * through read() / write().
+     *
+     * @param sfd the socket the stream is connected to
+     * @return true if at least one direction was moved to the kernel
+     */
+    bool enableKernelTls(SOCKET sfd);
+
+    /**
+     * Is the kernel decrypting the data received on the socket?
+     */
+    bool isKernelTlsRx() const {
+        return kernelTlsRx;
+    }
+
+    /**
+     * Is the kernel encrypting the data sent on the socket?
+     */
+    bool isKernelTlsTx() const {
+        return kernelTlsTx;
+    }
+
     std::pair<cb::x509::Status, std::string> getCertUserName();
     /**
      * Get a JSON description of this object.. caller must call cJSON_Delete()
@@ -153,6 +183,20 @@ public:
 protected:
     bool drainInputSocketBuf();
 
+    /**
+     * Install the keys for the provided direction in the kernel
+     *
+     * @param sfd the socket to install the keys on
+     * @param tx true for the send direction, false for receive
+     * @param key the key to use
+     * @param salt the implicit part of the nonce (4 bytes)
+     * @return true on success
+     */
+    bool installKernelTlsKeys(SOCKET sfd,
+                              bool tx,
+                              const std::vector<uint8_t>& key,
+                              const uint8_t* salt);
+
     bool enabled = false;
     bool connected = false;
     bool error = false;
@@ -160,6 +204,8 @@ protected:
     BIO* network = nullptr;
     SSL_CTX* ctx = nullptr;
     SSL* client = nullptr;
+    bool kernelTlsRx = false;
+    bool kernelTlsTx = false;
 
     // The pipe used to buffer data between the socket and the SSL library
     // (data being read)
@@ -19,6 +19,22 @@
 #include "memcached.h"
 #include "runtime.h"
 
+#ifdef HAVE_KTLS
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/kdf.h>
+#include <array>
+#include <cstring>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+
 SslContext::~SslContext() {
     if (enabled) {
         disable();
@@ -242,6 +258,156 @@ void SslContext::drainBioSendPipe(SOCKET sfd) {
     //   * The socket buffer is full
 }
 
+#ifdef HAVE_KTLS
+/**
+ * Populate the kernel crypto info for an AES-GCM cipher and install it on
+ * the socket.
+ */
+template <typename T>
+static bool set_kernel_crypto_info(SOCKET sfd,
+                                   bool tx,
+                                   uint16_t cipher_type,
+                                   const std::vector<uint8_t>& key,
+                                   const uint8_t* salt) {
+    // Both sides have sent exactly one record protected by the negotiated
+    // keys during the handshake (the Finished message), so the next
+    // record use sequence number 1. OpenSSL use the sequence number as the
+    // explicit part of the nonce so we'll do the same.
+    const std::array<uint8_t, 8> seqno = {{0, 0, 0, 0, 0, 0, 0, 1}};
+
+    T info;
+    memset(&info, 0, sizeof(info));
+    info.info.version = TLS_1_2_VERSION;
+    info.info.cipher_type = cipher_type;
+    if (key.size() != sizeof(info.key)) {
+        return false;
+    }
+    memcpy(info.key, key.data(), sizeof(info.key));
+    memcpy(info.salt, salt, sizeof(info.salt));
+    memcpy(info.iv, seqno.data(), sizeof(info.iv));
+    memcpy(info.rec_seq, seqno.data(), sizeof(info.rec_seq));
+
+    const auto ret =
+            setsockopt(sfd, SOL_TLS, tx ? TLS_TX : TLS_RX, &info, sizeof(info));
+    OPENSSL_cleanse(&info, sizeof(info));
+    return ret == 0;
+}
+
+bool SslContext::installKernelTlsKeys(SOCKET sfd,
+                                      bool tx,
+                                      const std::vector<uint8_t>& key,
+                                      const uint8_t* salt) {
+    if (key.size() == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+        return set_kernel_crypto_info<tls12_crypto_info_aes_gcm_128>(
+                sfd, tx, TLS_CIPHER_AES_GCM_128, key, salt);
+    }
+#ifdef TLS_CIPHER_AES_GCM_256
+    if (key.size() == TLS_CIPHER_AES_GCM_256_KEY_SIZE) {
+        return set_kernel_crypto_info<tls12_crypto_info_aes_gcm_256>(
+                sfd, tx, TLS_CIPHER_AES_GCM_256, key, salt);
+    }
+#endif
+    return false;
+}
+#endif
+
+bool SslContext::enableKernelTls(SOCKET sfd) {
+#ifdef HAVE_KTLS
+    if (!connected || error || SSL_version(client) != TLS1_2_VERSION) {
+        return false;
+    }
+
+    size_t keylen;
+    switch (SSL_CIPHER_get_cipher_nid(SSL_get_current_cipher(client))) {
+    case NID_aes_128_gcm:
+        keylen = 16;
+        break;
+#ifdef TLS_CIPHER_AES_GCM_256
+    case NID_aes_256_gcm:
+        keylen = 32;
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    // We can't move a direction to the kernel if OpenSSL (or we) still
+    // hold data for it, as we don't know which records it belong to.
+    const bool rx = inputPipe.empty() && BIO_ctrl_pending(application) == 0 &&
+                    SSL_pending(client) == 0;
+    const bool tx = outputPipe.empty() && BIO_ctrl_pending(network) == 0;
+    if (!rx && !tx) {
+        return false;
+    }
+
+    // Derive the key block (RFC 5246 section 6.3). For AEAD ciphers it
+    // contains the client and server write keys followed by the client
+    // and server implicit nonce (salt).
+    std::vector<uint8_t> master(SSL_MAX_MASTER_KEY_LENGTH);
+    master.resize(SSL_SESSION_get_master_key(
+            SSL_get_session(client), master.data(), master.size()));
+    std::array<uint8_t, SSL3_RANDOM_SIZE> clientRandom;
+    std::array<uint8_t, SSL3_RANDOM_SIZE> serverRandom;
+    SSL_get_client_random(client, clientRandom.data(), clientRandom.size());
+    SSL_get_server_random(client, serverRandom.data(), serverRandom.size());
+
+    const std::string label{"key expansion"};
+    const auto* labelData =
+            reinterpret_cast<const unsigned char*>(label.data());
+    std::vector<uint8_t> keyBlock(2 * keylen + 2 * 4);
+    size_t keyBlockSize = keyBlock.size();
+    auto* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+    const bool derived =
+            pctx != nullptr && EVP_PKEY_derive_init(pctx) > 0 &&
+            EVP_PKEY_CTX_set_tls1_prf_md(
+                    pctx,
+                    SSL_CIPHER_get_handshake_digest(
+                            SSL_get_current_cipher(client))) > 0 &&
+            EVP_PKEY_CTX_set1_tls1_prf_secret(
+                    pctx, master.data(), int(master.size())) > 0 &&
+            EVP_PKEY_CTX_add1_tls1_prf_seed(
+                    pctx, labelData, int(label.size())) > 0 &&
+            EVP_PKEY_CTX_add1_tls1_prf_seed(
+                    pctx, serverRandom.data(), int(serverRandom.size())) > 0 &&
+            EVP_PKEY_CTX_add1_tls1_prf_seed(
+                    pctx, clientRandom.data(), int(clientRandom.size())) > 0 &&
+            EVP_PKEY_derive(pctx, keyBlock.data(), &keyBlockSize) > 0;
+    EVP_PKEY_CTX_free(pctx);
+    OPENSSL_cleanse(master.data(), master.size());
+
+    if (!derived || keyBlockSize != keyBlock.size()) {
+        OPENSSL_cleanse(keyBlock.data(), keyBlock.size());
+        return false;
+    }
+
+    if (setsockopt(sfd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0) {
+        std::vector<uint8_t> clientKey(keyBlock.begin(),
+                                       keyBlock.begin() + keylen);
+        std::vector<uint8_t> serverKey(keyBlock.begin() + keylen,
+                                       keyBlock.begin() + 2 * keylen);
+        const auto* clientSalt = keyBlock.data() + 2 * keylen;
+        const auto* serverSalt = clientSalt + 4;
+
+        if (rx) {
+            kernelTlsRx =
+                    installKernelTlsKeys(sfd, false, clientKey, clientSalt);
+        }
+        if (tx) {
+            kernelTlsTx =
+                    installKernelTlsKeys(sfd, true, serverKey, serverSalt);
+        }
+        OPENSSL_cleanse(clientKey.data(), clientKey.size());
+        OPENSSL_cleanse(serverKey.data(), serverKey.size());
+    }
+    OPENSSL_cleanse(keyBlock.data(), keyBlock.size());
+
+    return kernelTlsRx || kernelTlsTx;
+#else
+    (void)sfd;
+    return false;
+#endif
+}
+
 void SslContext::dumpCipherList(uint32_t id) const {
     LOG_DEBUG(NULL, "%u: Using SSL ciphers:", id);
     int ii = 0;
@@ -256,9 +422,14 @@ cJSON* SslContext::toJSON() const {
     cJSON_AddBoolToObject(obj, "enabled", enabled);
     if (enabled) {
         cJSON_AddBoolToObject(obj, "connected", connected);
+        if (connected) {
+            cJSON_AddStringToObject(obj, "protocol", SSL_get_version(client));
+        }
         cJSON_AddBoolToObject(obj, "error", error);
         cJSON_AddNumberToObject(obj, "total_recv", totalRecv);
         cJSON_AddNumberToObject(obj, "total_send", totalSend);
+        cJSON_AddBoolToObject(obj, "ktls_rx", kernelTlsRx);
+        cJSON_AddBoolToObject(obj, "ktls_tx", kernelTlsTx);
     }
 
     return obj;
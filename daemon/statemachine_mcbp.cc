@@ -296,7 +296,10 @@ bool conn_new_cmd(McbpConnection& connection) {
         connection.shrinkBuffers();
         if (connection.read->rsize() >= sizeof(cb::mcbp::Header)) {
             connection.setState(McbpStateMachine::State::parse_cmd);
-        } else if (connection.isSslEnabled()) {
+        } else if (connection.isSslEnabled() ||
+                   connection.getIoUringBackend() != nullptr) {
+            // Data may already be buffered in SSL / io_uring (and we won't
+            // get notified by libevent about it)
             connection.setState(McbpStateMachine::State::read_packet_header);
         } else {
             connection.setState(McbpStateMachine::State::waiting);
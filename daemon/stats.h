@@ -66,6 +66,8 @@ struct thread_stats {
         wbufs_allocated = 0;
         wbufs_loaned = 0;
         wbufs_existing = 0;
+        rbufs_grown = 0;
+        rbuf_copy_avoided_bytes = 0;
 
         iovused_high_watermark = 0;
         msgused_high_watermark = 0;
@@ -108,6 +110,8 @@ struct thread_stats {
         wbufs_allocated += other.wbufs_allocated;
         wbufs_loaned += other.wbufs_loaned;
         wbufs_existing += other.wbufs_existing;
+        rbufs_grown += other.rbufs_grown;
+        rbuf_copy_avoided_bytes += other.rbuf_copy_avoided_bytes;
 
         iovused_high_watermark.setIfGreater(other.iovused_high_watermark);
         msgused_high_watermark.setIfGreater(other.msgused_high_watermark);
@@ -179,6 +183,12 @@ struct thread_stats {
     /* # of write buffers which already existed (with partial data) on the
         connection (and hence didn't need to be allocated). */
     Couchbase::RelaxedAtomic<uint64_t> wbufs_existing;
+    /* # of read buffers which had to be replaced with a bigger buffer from
+       the buffer pool to fit the packet. */
+    Couchbase::RelaxedAtomic<uint64_t> rbufs_grown;
+    /* # of bytes we didn't have to copy into a bigger read buffer as the
+       buffer borrowed from the pool was big enough for the packet. */
+    Couchbase::RelaxedAtomic<uint64_t> rbuf_copy_avoided_bytes;
 
     /* Highest value iovsize has got to */
     Couchbase::RelaxedAtomic<int> iovused_high_watermark;
@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "config.h"
+
+#include "stats_snapshot.h"
+
+#include "dynamic_buffer.h"
+
+#include <cstring>
+
+namespace cb {
+namespace stats {
+
+/**
+ * Is the value an integer we may add to the document as a JSON number
+ * (optional minus sign, no leading zeros and within the range of a signed
+ * 64 bit integer so that clients may parse it as one)?
+ */
+static bool isInteger(cb::const_char_buffer value) {
+    const bool negative = value.len > 0 && value.buf[0] == '-';
+    const char* digits = value.buf + (negative ? 1 : 0);
+    const size_t ndigits = value.len - (negative ? 1 : 0);
+    if (ndigits == 0 || ndigits > 19 || (digits[0] == '0' && ndigits > 1)) {
+        return false;
+    }
+    for (size_t ii = 0; ii < ndigits; ++ii) {
+        if (digits[ii] < '0' || digits[ii] > '9') {
+            return false;
+        }
+    }
+    if (ndigits == 19) {
+        // Same number of digits, so they compare like the numbers
+        const char* limit =
+                negative ? "9223372036854775808" : "9223372036854775807";
+        return std::memcmp(digits, limit, 19) <= 0;
+    }
+    return true;
+}
+
+static bool isBoolean(cb::const_char_buffer value) {
+    return (value.len == 4 && std::memcmp(value.buf, "true", 4) == 0) ||
+           (value.len == 5 && std::memcmp(value.buf, "false", 5) == 0);
+}
+
+/**
+ * Write the string as a (quoted) JSON string. The destination must have
+ * room for the worst case of 6 bytes per character plus the quotes.
+ *
+ * @return the number of bytes written
+ */
+static size_t writeString(char* dest, cb::const_char_buffer str) {
+    static const char hex[] = "0123456789abcdef";
+    char* ptr = dest;
+    *ptr++ = '"';
+    for (size_t ii = 0; ii < str.len; ++ii) {
+        const auto c = static_cast<unsigned char>(str.buf[ii]);
+        switch (c) {
+        case '"':
+        case '\\':
+            *ptr++ = '\\';
+            *ptr++ = char(c);
+            break;
+        case '\n':
+            *ptr++ = '\\';
+            *ptr++ = 'n';
+            break;
+        case '\r':
+            *ptr++ = '\\';
+            *ptr++ = 'r';
+            break;
+        case '\t':
+            *ptr++ = '\\';
+            *ptr++ = 't';
+            break;
+        default:
+            if (c < 0x20) {
+                *ptr++ = '\\';
+                *ptr++ = 'u';
+                *ptr++ = '0';
+                *ptr++ = '0';
+                *ptr++ = hex[c >> 4];
+                *ptr++ = hex[c & 0xf];
+            } else {
+                *ptr++ = char(c);
+            }
+        }
+    }
+    *ptr++ = '"';
+    return ptr - dest;
+}
+
+bool startSnapshot(DynamicBuffer& buffer) {
+    if (!buffer.grow(1)) {
+        return false;
+    }
+    *buffer.getCurrent() = '{';
+    buffer.moveOffset(1);
+    return true;
+}
+
+bool addToSnapshot(DynamicBuffer& buffer,
+                   cb::const_char_buffer key,
+                   cb::const_char_buffer value) {
+    // separator, quoted key, colon and quoted value (at worst every
+    // character needs a 6 byte escape sequence)
+    if (!buffer.grow(1 + (key.len + value.len) * 6 + 5)) {
+        return false;
+    }
+
+    char* const start = buffer.getCurrent();
+    char* ptr = start;
+    // The previous member's value ends with a quote, digit or letter, so
+    // the only way to find the brace is if this is the first member
+    if (*(ptr - 1) != '{') {
+        *ptr++ = ',';
+    }
+    ptr += writeString(ptr, key);
+    *ptr++ = ':';
+    if (isInteger(value) || isBoolean(value)) {
+        std::memcpy(ptr, value.buf, value.len);
+        ptr += value.len;
+    } else {
+        ptr += writeString(ptr, value);
+    }
+    buffer.moveOffset(ptr - start);
+    return true;
+}
+
+bool endSnapshot(DynamicBuffer& buffer) {
+    if (!buffer.grow(1)) {
+        return false;
+    }
+    *buffer.getCurrent() = '}';
+    buffer.moveOffset(1);
+    return true;
+}
+
+} // namespace stats
+} // namespace cb
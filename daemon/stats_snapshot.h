@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+class DynamicBuffer;
+
+/**
+ * Helpers for building the response to a stats request in "snapshot" mode
+ * (the client sent the STAT command with the JSON datatype), where all of
+ * the stats are returned as members of a single JSON object instead of
+ * one response packet per stat.
+ *
+ * The stats are written straight into the buffer holding the response, so
+ * building the snapshot doesn't require any allocations beyond growing
+ * that buffer.
+ */
+namespace cb {
+namespace stats {
+
+/**
+ * Start the JSON object in the buffer (after the data already in it)
+ *
+ * @return false if we failed to grow the buffer
+ */
+bool startSnapshot(DynamicBuffer& buffer);
+
+/**
+ * Add a stat to the JSON object started with startSnapshot(). Integers and
+ * the values "true" and "false" are added as JSON numbers and booleans,
+ * everything else as strings.
+ *
+ * @return false if we failed to grow the buffer
+ */
+bool addToSnapshot(DynamicBuffer& buffer,
+                   cb::const_char_buffer key,
+                   cb::const_char_buffer value);
+
+/**
+ * Terminate the JSON object started with startSnapshot()
+ *
+ * @return false if we failed to grow the buffer
+ */
+bool endSnapshot(DynamicBuffer& buffer);
+
+} // namespace stats
+} // namespace cb
@@ -26,6 +26,7 @@
 #include "subdocument_context.h"
 #include "subdocument_traits.h"
 #include "subdocument_validators.h"
+#include "timing_histogram.h"
 #include "timings.h"
 #include "topkeys.h"
 #include "utilities/protocol2text.h"
@@ -580,12 +581,25 @@ static protocol_binary_response_status
 subdoc_operate_one_path(SubdocCmdContext& context, SubdocCmdContext::OperationSpec& spec,
                         const cb::const_char_buffer& in_doc) {
 
-    // Prepare the specified sub-document command.
     auto& op = context.connection.getThread()->subdoc_op;
+
+    // Lookups don't modify the document, so specs sharing a parent only
+    // need to scan the parent (once located) rather than the whole document
+    auto doc = in_doc;
+    auto path = spec.path;
+    const bool is_vattr =
+            context.getCurrentPhase() == SubdocCmdContext::Phase::XATTR &&
+            spec.path.buf[0] == '$';
+    if (!context.traits.is_mutator && !is_vattr &&
+        context.getOperations().size() > 1) {
+        context.container_index.narrow(op, doc, path);
+    }
+
+    // Prepare the specified sub-document command.
     op.clear();
     op.set_result_buf(&spec.result);
     op.set_code(spec.traits.subdocCommand);
-    op.set_doc(in_doc.buf, in_doc.len);
+    op.set_doc(doc.buf, doc.len);
 
     if (spec.flags & SUBDOC_FLAG_EXPAND_MACROS) {
         auto padded_macro = context.get_padded_macro(spec.value);
@@ -594,8 +608,7 @@ subdoc_operate_one_path(SubdocCmdContext& context, SubdocCmdContext::OperationSp
         op.set_value(spec.value.buf, spec.value.len);
     }
 
-    if (context.getCurrentPhase() == SubdocCmdContext::Phase::XATTR &&
-        spec.path.buf[0] == '$') {
+    if (is_vattr) {
         if (spec.path.buf[1] == 'd') {
             // This is a call to the "$document" (the validator stopped all of
             // the other ones), so replace the document with
@@ -609,7 +622,7 @@ subdoc_operate_one_path(SubdocCmdContext& context, SubdocCmdContext::OperationSp
     }
 
     // ... and execute it.
-    const auto subdoc_res = op.op_exec(spec.path.buf, spec.path.len);
+    const auto subdoc_res = op.op_exec(path.buf, path.len);
 
     switch (subdoc_res) {
     case Subdoc::Error::SUCCESS:
@@ -690,6 +703,43 @@ static protocol_binary_response_status subdoc_operate_wholedoc(
     }
 }
 
+/**
+ * Compute the splice the (single) mutation with the given result made to
+ * doc: subjson returns the new document as the unmodified prefix and suffix
+ * of doc, with the new content in between.
+ */
+static SubdocCmdContext::Splice compute_splice(const Subdoc::Result& result,
+                                               cb::const_char_buffer doc) {
+    const auto& segments = result.newdoc();
+    const char* const end = doc.buf + doc.len;
+
+    size_t first = 0;
+    size_t prefix = 0;
+    while (first < segments.size() &&
+           (segments[first].length == 0 ||
+            segments[first].at == doc.buf + prefix)) {
+        prefix += segments[first].length;
+        ++first;
+    }
+
+    size_t last = segments.size();
+    size_t suffix = 0;
+    while (last > first &&
+           (segments[last - 1].length == 0 ||
+            (segments[last - 1].at >= doc.buf + prefix &&
+             segments[last - 1].at + segments[last - 1].length ==
+                     end - suffix))) {
+        suffix += segments[last - 1].length;
+        --last;
+    }
+
+    SubdocCmdContext::Splice splice{prefix, doc.len - prefix - suffix, {}};
+    for (auto ii = first; ii < last; ++ii) {
+        splice.data.append(segments[ii].at, segments[ii].length);
+    }
+    return splice;
+}
+
 /**
  * Run through all of the subdoc operations for the current phase on
  * a single 'document' (either the user document, or a XATTR).
@@ -701,6 +751,9 @@ static protocol_binary_response_status subdoc_operate_wholedoc(
  *                    allocations if we need to change the doc.
  * @param modified set to true upon return if any modifications happened
  *                 to the input document.
+ * @param allow_splice if set (and there's a single mutation) record the
+ *                     modification in {context.splice} rather than building
+ *                     the new document in temp_buffer.
  * @return true if we should continue processing this request,
  *         false if we've sent the error packet and should temrinate
  *               execution for this request
@@ -711,9 +764,11 @@ static bool operate_single_doc(SubdocCmdContext& context,
                                 cb::const_char_buffer& doc,
                                 protocol_binary_datatype_t doc_datatype,
                                 std::unique_ptr<char[]>& temp_buffer,
-                                bool& modified) {
+                                bool& modified,
+                                bool allow_splice = false) {
     modified = false;
     auto& operations = context.getOperations();
+    context.container_index.reset();
 
     // 2. Perform each of the operations on document.
     for (auto op = operations.begin(); op != operations.end(); op++) {
@@ -733,7 +788,12 @@ static bool operate_single_doc(SubdocCmdContext& context,
         }
 
         if (op->status == PROTOCOL_BINARY_RESPONSE_SUCCESS) {
-            if (context.traits.is_mutator) {
+            if (context.traits.is_mutator && allow_splice) {
+                // The only mutation; let the engine apply it to the stored
+                // document instead of building the new document here.
+                modified = true;
+                context.splice = compute_splice(op->result, doc);
+            } else if (context.traits.is_mutator) {
                 modified = true;
 
                 // Determine how much space we now need.
@@ -1091,6 +1151,23 @@ static bool do_xattr_phase(SubdocCmdContext& context) {
     return true;
 }
 
+/**
+ * Can the body phase of the command be applied to the stored document by
+ * the engine (as a splice), rather than by storing a new document? That's
+ * the case for a single path mutation of an existing document, where the
+ * body is the only part of the document modified.
+ */
+static bool can_splice(SubdocCmdContext& context) {
+    const auto& operations = context.getOperations();
+    return context.traits.is_mutator && operations.size() == 1 &&
+           operations.front().traits.scope == CommandScope::SubJSON &&
+           context.getOperations(SubdocCmdContext::Phase::XATTR).empty() &&
+           !context.needs_new_doc && !context.do_delete_doc &&
+           !context.do_macro_expansion &&
+           context.in_document_state == DocumentState::Alive &&
+           context.connection.getBucketEngine()->splice != nullptr;
+}
+
 /**
  * Operate on the user body part of the document as specified by the command
  * context.
@@ -1118,8 +1195,12 @@ static bool do_body_phase(SubdocCmdContext& context) {
     std::unique_ptr<char[]> temp_doc;
     bool modified;
 
-    if (!operate_single_doc(
-                context, document, context.in_datatype, temp_doc, modified)) {
+    if (!operate_single_doc(context,
+                            document,
+                            context.in_datatype,
+                            temp_doc,
+                            modified,
+                            can_splice(context))) {
         return false;
     }
 
@@ -1128,6 +1209,12 @@ static bool do_body_phase(SubdocCmdContext& context) {
         return true;
     }
 
+    if (context.splice) {
+        // {in_doc} is left unchanged; the splice is relative to it.
+        context.splice->offset += xattrsize;
+        return true;
+    }
+
     // There isn't any xattrs associated with the document. We shouldn't
     // reallocate and move things around but just reuse the temporary
     // buffer we've already created.
@@ -1178,6 +1265,27 @@ static bool subdoc_operate(SubdocCmdContext& context) {
     return false;
 }
 
+// Apply the splice recorded by the body phase to {in_doc}, for when the
+// engine turns out not to support splicing.
+static void apply_splice(SubdocCmdContext& context) {
+    const auto& splice = *context.splice;
+    const auto suffix = context.in_doc.len - splice.offset - splice.length;
+    const auto total = splice.offset + splice.data.size() + suffix;
+    std::unique_ptr<char[]> full_document(new char[total]);
+
+    std::memcpy(full_document.get(), context.in_doc.buf, splice.offset);
+    std::memcpy(full_document.get() + splice.offset,
+                splice.data.data(),
+                splice.data.size());
+    std::memcpy(full_document.get() + splice.offset + splice.data.size(),
+                context.in_doc.buf + splice.offset + splice.length,
+                suffix);
+
+    context.temp_doc.swap(full_document);
+    context.in_doc = {context.temp_doc.get(), total};
+    context.splice.reset();
+}
+
 // Update the engine with whatever modifications the subdocument command made
 // to the document.
 // Returns true if the update was successful (and execution should continue),
@@ -1211,7 +1319,7 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
     }
 
     // Allocate a new item of this size.
-    if (context.out_doc == NULL &&
+    if (context.out_doc == NULL && !context.splice &&
         !(context.no_sys_xattrs && context.do_delete_doc)) {
 
         if (ret == ENGINE_SUCCESS) {
@@ -1285,7 +1393,38 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
     uint64_t new_cas;
     mutation_descr_t mdt;
     auto new_op = context.needs_new_doc ? OPERATION_ADD : OPERATION_CAS;
-    if (context.do_delete_doc && context.no_sys_xattrs) {
+    if (context.splice) {
+        // Let the engine apply the change to the document we fetched
+        // (identified by its CAS) instead of storing a complete copy.
+        const auto& splice = *context.splice;
+        context.out_doc_len =
+                context.in_doc.len - splice.length + splice.data.size();
+        new_cas = context.in_cas;
+        if (ret == ENGINE_SUCCESS) {
+            DocKey docKey(reinterpret_cast<const uint8_t*>(key),
+                          keylen,
+                          connection.getDocNamespace());
+            auto r = bucket_splice(cookie,
+                                   docKey,
+                                   vbucket,
+                                   context.in_cas,
+                                   splice.offset,
+                                   splice.length,
+                                   {splice.data.data(), splice.data.size()},
+                                   context.in_datatype,
+                                   expiration,
+                                   mdt);
+            if (r.status == cb::engine_errc::not_supported) {
+                // The bucket can't apply it after all (e.g. it's wrapped by
+                // an engine which doesn't) - store the complete document.
+                apply_splice(context);
+                return subdoc_update(
+                        context, ret, key, keylen, vbucket, expiration);
+            }
+            ret = ENGINE_ERROR_CODE(r.status);
+            new_cas = r.cas;
+        }
+    } else if (context.do_delete_doc && context.no_sys_xattrs) {
         new_cas = context.in_cas;
         DocKey docKey(reinterpret_cast<const uint8_t*>(key),
                       keylen,
@@ -1305,7 +1444,8 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
         // Record the UUID / Seqno if MUTATION_SEQNO feature is enabled so
         // we can include it in the response.
         if (connection.isSupportsMutationExtras()) {
-            if (context.do_delete_doc && context.no_sys_xattrs) {
+            if (context.splice ||
+                (context.do_delete_doc && context.no_sys_xattrs)) {
                 context.vbucket_uuid = mdt.vbucket_uuid;
                 context.sequence_no = mdt.seqno;
             } else {
@@ -0,0 +1,167 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "subdocument_container_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+void SubdocContainerIndex::narrow(Subdoc::Operation& op,
+                                  cb::const_char_buffer& doc,
+                                  cb::const_char_buffer& path) {
+    cb::const_char_buffer parent;
+    cb::const_char_buffer child;
+    if (!splitPath(path, parent, child)) {
+        return;
+    }
+
+    // The lookup within the container doesn't see the parent's components,
+    // so let a full lookup check the length of paths near the limit.
+    if (countComponents(path) + 1 > MaxDepth - DepthMargin) {
+        return;
+    }
+
+    auto iter = std::find_if(
+            entries.begin(), entries.end(), [parent](const Entry& entry) {
+                return entry.path.len == parent.len &&
+                       std::memcmp(entry.path.buf, parent.buf, parent.len) ==
+                               0;
+            });
+
+    cb::const_char_buffer container;
+    if (iter == entries.end()) {
+        container = locate(op, doc, parent);
+        entries.push_back({parent, container});
+    } else {
+        container = iter->container;
+    }
+
+    if (container.len == 0) {
+        return;
+    }
+
+    // Only use the container if it is of the type the last component
+    // expects; otherwise let subjson report the mismatch for the full path
+    const char expected = (child.buf[0] == '[') ? '[' : '{';
+    if (container.buf[0] == expected) {
+        doc = container;
+        path = child;
+    }
+}
+
+cb::const_char_buffer SubdocContainerIndex::locate(
+        Subdoc::Operation& op,
+        cb::const_char_buffer doc,
+        cb::const_char_buffer path) {
+    // The depth of the container in the document
+    const auto depth = countComponents(path);
+
+    // Locate (and index) the ancestors first, so that sibling containers
+    // are found by only scanning their parent
+    narrow(op, doc, path);
+
+    Subdoc::Result result;
+    op.clear();
+    op.set_result_buf(&result);
+    op.set_code(Subdoc::Command::GET);
+    op.set_doc(doc.buf, doc.len);
+    if (op.op_exec(path.buf, path.len) != Subdoc::Error::SUCCESS) {
+        return {};
+    }
+
+    const auto& loc = result.matchloc();
+    if (loc.length == 0 || (loc.at[0] != '{' && loc.at[0] != '[')) {
+        return {};
+    }
+
+    // Lookups within the container don't see the levels above it, so the
+    // container's contents must stay clear of the document depth limit
+    // when its own depth in the document is added.
+    const cb::const_char_buffer container{loc.at, loc.length};
+    if (depth + nestingDepth(container) > MaxDepth - DepthMargin) {
+        return {};
+    }
+    return container;
+}
+
+bool SubdocContainerIndex::splitPath(cb::const_char_buffer path,
+                                     cb::const_char_buffer& parent,
+                                     cb::const_char_buffer& child) {
+    // Find the last component separator which isn't within a quoted
+    // (`...`) key. An escaped backtick (``) toggles the state twice.
+    size_t separator = 0;
+    bool quoted = false;
+    for (size_t ii = 0; ii < path.len; ++ii) {
+        const char ch = path.buf[ii];
+        if (ch == '`') {
+            quoted = !quoted;
+        } else if (!quoted && ii > 0 && (ch == '.' || ch == '[')) {
+            separator = ii;
+        }
+    }
+
+    if (separator == 0) {
+        return false;
+    }
+
+    parent = {path.buf, separator};
+    if (path.buf[separator] == '.') {
+        child = {path.buf + separator + 1, path.len - separator - 1};
+    } else {
+        child = {path.buf + separator, path.len - separator};
+    }
+    return child.len > 0;
+}
+
+size_t SubdocContainerIndex::countComponents(cb::const_char_buffer path) {
+    // Every separator outside of quoted keys starts a new component (see
+    // splitPath())
+    size_t components = path.len > 0 ? 1 : 0;
+    bool quoted = false;
+    for (size_t ii = 0; ii < path.len; ++ii) {
+        const char ch = path.buf[ii];
+        if (ch == '`') {
+            quoted = !quoted;
+        } else if (!quoted && ii > 0 && (ch == '.' || ch == '[')) {
+            ++components;
+        }
+    }
+    return components;
+}
+
+size_t SubdocContainerIndex::nestingDepth(cb::const_char_buffer value) {
+    size_t depth = 0;
+    size_t max = 0;
+    bool string = false;
+    for (size_t ii = 0; ii < value.len; ++ii) {
+        const char ch = value.buf[ii];
+        if (string) {
+            if (ch == '\\') {
+                ++ii;
+            } else if (ch == '"') {
+                string = false;
+            }
+        } else if (ch == '"') {
+            string = true;
+        } else if (ch == '{' || ch == '[') {
+            max = std::max(max, ++depth);
+        } else if ((ch == '}' || ch == ']') && depth > 0) {
+            --depth;
+        }
+    }
+    return max;
+}
@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/sized_buffer.h>
+#include <subdoc/operations.h>
+
+#include <vector>
+
+/**
+ * Index of the containers (objects and arrays) located in a JSON document
+ * while performing the lookups of a subdoc command.
+ *
+ * subjson scans the document from the start for every path it operates on,
+ * so a multi-path lookup of N paths costs N scans of the document. Lookups
+ * of sibling paths (e.g. "user.name" and "user.email") share their parent
+ * container; the index remembers where each such container lives in the
+ * document so that later paths are only looked up within their (already
+ * located) parent instead of the whole document.
+ *
+ * subjson limits the depth of both paths and documents. A lookup within a
+ * container neither sees the components of the container's path nor the
+ * levels above it, so paths and containers near those limits aren't
+ * narrowed; their lookups report PATH_E2BIG / DOC_ETOODEEP exactly as they
+ * do without the index.
+ *
+ * The index refers to memory in the document (and to the paths passed to
+ * narrow()), so it must be reset whenever the document changes.
+ */
+class SubdocContainerIndex {
+public:
+    /// Forget all of the containers located so far.
+    void reset() {
+        entries.clear();
+    }
+
+    /**
+     * Narrow the lookup of path in doc to the container holding the last
+     * component of the path. If the parent container isn't in the index yet
+     * it's located (using op, which is cleared) and added to the index; all
+     * of its ancestors are indexed as well.
+     *
+     * If the parent isn't an object / array of the type expected by the
+     * last component (or doesn't exist), doc and path are left unchanged so
+     * that the lookup reports the same error as it would without the index.
+     *
+     * @param op subjson operation to use to locate containers
+     * @param[in,out] doc the document to look the path up in; updated to the
+     *                parent container
+     * @param[in,out] path the path to look up; updated to the path of the
+     *                last component relative to the parent container
+     */
+    void narrow(Subdoc::Operation& op,
+                cb::const_char_buffer& doc,
+                cb::const_char_buffer& path);
+
+    /// The number of containers (or misses) in the index.
+    size_t size() const {
+        return entries.size();
+    }
+
+    /**
+     * Split a subdoc path into the path of its parent and the path of its
+     * last component relative to the parent; e.g. "a.b[2]" is split into
+     * "a.b" and "[2]", and "a.`b.c`" into "a" and "`b.c`".
+     *
+     * @return false if the path only consists of a single component
+     */
+    static bool splitPath(cb::const_char_buffer path,
+                          cb::const_char_buffer& parent,
+                          cb::const_char_buffer& child);
+
+    /// @return the number of components in a subdoc path
+    static size_t countComponents(cb::const_char_buffer path);
+
+    /**
+     * @return the nesting depth of the JSON value (1 for an object / array
+     *         without any nested containers, 0 for a primitive)
+     */
+    static size_t nestingDepth(cb::const_char_buffer value);
+
+    /**
+     * The maximum depth (in levels, the document root being the first) of
+     * the paths and documents subjson accepts.
+     */
+    static const size_t MaxDepth = 32;
+
+private:
+    /**
+     * Paths and containers reaching within this many levels of MaxDepth are
+     * left to full lookups.
+     */
+    static const size_t DepthMargin = 2;
+
+    /**
+     * Locate the container at path in doc
+     * @return the container, or an empty buffer if path doesn't exist or
+     *         isn't an object / array
+     */
+    cb::const_char_buffer locate(Subdoc::Operation& op,
+                                 cb::const_char_buffer doc,
+                                 cb::const_char_buffer path);
+
+    struct Entry {
+        cb::const_char_buffer path;
+        cb::const_char_buffer container;
+    };
+
+    // A handful of entries per command, so a linear search is fine
+    std::vector<Entry> entries;
+};
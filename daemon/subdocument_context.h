@@ -19,6 +19,7 @@
 
 #include "memcached.h"
 
+#include "subdocument_container_index.h"
 #include "subdocument_traits.h"
 #include "xattr/utils.h"
 
@@ -28,6 +29,7 @@
 #include <platform/compress.h>
 #include <platform/sized_buffer.h>
 
+#include <string>
 #include <unordered_map>
 
 enum class MutationSemantics : uint8_t { Add, Replace, Set };
@@ -162,6 +164,10 @@ public:
     // may hold pointers into the repacked xattr buckets
     std::unique_ptr<uint8_t[]> xattr_buffer;
 
+    // [Lookups only] The containers located so far in the document the
+    // current phase operates on; reset at the start of each phase.
+    SubdocContainerIndex container_index;
+
     // CAS value of the input document. Required to ensure we only store a
     // new document which was derived from the same original input document.
     uint64_t in_cas = 0;
@@ -208,6 +214,20 @@ public:
     // [Mutations only] New item to store into engine.
     cb::unique_item_ptr out_doc;
 
+    // [Mutations only] A change to the document which the engine can apply
+    // to the stored value itself (see bucket_splice()): the bytes
+    // [offset, offset + length) of {in_doc} are replaced with {data}.
+    struct Splice {
+        size_t offset;
+        size_t length;
+        std::string data;
+    };
+
+    // [Mutations only] Set (instead of building the new document in
+    // {temp_doc}) if the body phase made a single change to the document
+    // and the engine supports splicing it into the stored document.
+    boost::optional<Splice> splice;
+
     // Size in bytes of the response value to send back to the client.
     size_t response_val_len = 0;
 
@@ -5,7 +5,9 @@
 #include "config.h"
 #include "memcached.h"
 #include "connections.h"
+#include "io_uring_backend.h"
 
+#include <algorithm>
 #include <atomic>
 #include <stdio.h>
 #include <errno.h>
@@ -65,6 +67,8 @@ static LIBEVENT_THREAD dispatcher_thread;
  */
 static int nthreads;
 static std::vector<LIBEVENT_THREAD> threads;
+/* The network backend the worker threads use (set by thread_init) */
+static NetworkBackend network_backend{NetworkBackend::Libevent};
 std::vector<TimingHistogram> scheduler_info;
 
 /*
@@ -75,6 +79,7 @@ static cb_mutex_t init_lock;
 static cb_cond_t init_cond;
 
 static void thread_libevent_process(evutil_socket_t fd, short which, void *arg);
+static void thread_io_uring_process(evutil_socket_t fd, short which, void* arg);
 
 /*
  * Creates a worker thread.
@@ -187,6 +192,30 @@ static void setup_thread(LIBEVENT_THREAD& me) {
         (event_add(&me.notify_event, 0) == -1)) {
         FATAL_ERROR(EXIT_FAILURE, "Can't monitor libevent notify pipe");
     }
+
+    if (settings.getNetworkBackend() == NetworkBackend::IoUring) {
+        try {
+            me.io_uring = std::make_unique<IoUringBackend>(me);
+        } catch (const std::exception& e) {
+            LOG_WARNING(nullptr,
+                        "Failed to initialize io_uring for worker thread %d,"
+                        " falling back to libevent: %s",
+                        me.index,
+                        e.what());
+            return;
+        }
+
+        /* Listen for completions from io_uring */
+        if ((event_assign(&me.io_uring_event,
+                          me.base,
+                          me.io_uring->getNotificationFd(),
+                          EV_READ | EV_PERSIST,
+                          thread_io_uring_process,
+                          &me) == -1) ||
+            (event_add(&me.io_uring_event, 0) == -1)) {
+            FATAL_ERROR(EXIT_FAILURE, "Can't monitor io_uring event fd");
+        }
+    }
 }
 
 /*
@@ -204,7 +233,17 @@ static void worker_libevent(void *arg) {
     cb_cond_signal(&init_cond);
     cb_mutex_exit(&init_lock);
 
-    event_base_loop(me->base, 0);
+    if (me->io_uring) {
+        // Run one iteration of the event loop at the time so that we can
+        // submit all of the IO operations queued by the connections served
+        // in the iteration with a single system call.
+        while (event_base_loop(me->base, EVLOOP_ONCE) != -1 &&
+               !event_base_got_break(me->base)) {
+            me->io_uring->submit();
+        }
+    } else {
+        event_base_loop(me->base, 0);
+    }
 
     // Event loop exited; cleanup before thread exits.
     ERR_remove_state(0);
@@ -339,6 +378,16 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
     }
 }
 
+/*
+ * Processes the completed operations from io_uring. This is called when
+ * the io_uring backend signals its event fd.
+ */
+static void thread_io_uring_process(evutil_socket_t, short, void* arg) {
+    auto& me = *reinterpret_cast<LIBEVENT_THREAD*>(arg);
+    std::lock_guard<std::mutex> guard(me.mutex);
+    me.io_uring->processCompletions();
+}
+
 extern volatile rel_time_t current_time;
 
 static bool has_cycle(Connection *c) {
@@ -502,6 +551,32 @@ void thread_init(int nthr, struct event_base *main_base,
         setup_thread(threads[ii]);
     }
 
+    /*
+     * All of the worker threads should use the same backend, so if we
+     * failed to set up io_uring for any of them fall back to libevent for
+     * all of them.
+     */
+    if (std::all_of(threads.begin(),
+                    threads.end(),
+                    [](const LIBEVENT_THREAD& thr) {
+                        return bool(thr.io_uring);
+                    })) {
+        network_backend = NetworkBackend::IoUring;
+    } else {
+        if (settings.getNetworkBackend() == NetworkBackend::IoUring) {
+            LOG_WARNING(nullptr,
+                        "Failed to initialize io_uring for all worker "
+                        "threads, using libevent for network IO");
+        }
+        for (auto& thread : threads) {
+            if (thread.io_uring) {
+                event_del(&thread.io_uring_event);
+                thread.io_uring.reset();
+            }
+        }
+        network_backend = NetworkBackend::Libevent;
+    }
+
     /* Create threads after we've done all the libevent setup. */
     for (auto& thread : threads) {
         const std::string name = "mc:worker_" + std::to_string(thread.index);
@@ -517,6 +592,10 @@ void thread_init(int nthr, struct event_base *main_base,
     cb_mutex_exit(&init_lock);
 }
 
+NetworkBackend get_network_backend() {
+    return network_backend;
+}
+
 void threads_shutdown() {
     for (auto& thread : threads) {
         notify_thread(thread);
@@ -526,6 +605,10 @@ void threads_shutdown() {
 
 void threads_cleanup() {
     for (auto& thread : threads) {
+        if (thread.io_uring) {
+            event_del(&thread.io_uring_event);
+            thread.io_uring.reset();
+        }
         event_base_free(thread.base);
     }
 }
@@ -551,6 +634,21 @@ void threads_complete_bucket_deletion() {
     }
 }
 
+void threads_buffer_pool_stats(uint64_t& hits,
+                               uint64_t& misses,
+                               uint64_t& cachedBytes,
+                               uint64_t& idleConnectionBytes) {
+    hits = misses = cachedBytes = idleConnectionBytes = 0;
+    for (auto& thr : threads) {
+        const auto& stats = thr.bufferPool.getStats();
+        hits += stats.hits.load(std::memory_order_relaxed);
+        misses += stats.misses.load(std::memory_order_relaxed);
+        cachedBytes += stats.cachedBytes.load(std::memory_order_relaxed);
+        idleConnectionBytes +=
+                stats.idleConnectionBytes.load(std::memory_order_relaxed);
+    }
+}
+
 void threads_initiate_bucket_deletion() {
     for (auto& thr : threads) {
         std::lock_guard<std::mutex> guard(thr.mutex);
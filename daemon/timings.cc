@@ -17,41 +17,186 @@
 #include "timings.h"
 #include <memcached/protocol_binary.h>
 #include <platform/platform.h>
-#include "timing_histogram.h"
+
+#include <functional>
+#include <thread>
+
+const size_t Timings::NumShards;
+
+/**
+ * Get the index of the shard the calling thread should record into. The
+ * hash of the thread id is mixed (the thread ids are typically addresses
+ * with a lot of common low bits) so that the worker threads spread out
+ * across the shards.
+ */
+static size_t getShardIndex() {
+    uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    id *= 0x9e3779b97f4a7c15ULL;
+    return size_t(id >> 32) % Timings::NumShards;
+}
+
+Timings::OpcodeTimings::OpcodeTimings() {
+    for (auto& shard : shards) {
+        shard.store(nullptr);
+    }
+}
+
+Timings::OpcodeTimings::~OpcodeTimings() {
+    for (auto& shard : shards) {
+        delete shard.load();
+    }
+}
+
+AtomicHdrTimingHistogram& Timings::OpcodeTimings::getShard() {
+    auto& slot = shards[getShardIndex()];
+    auto* shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+        auto* created = new AtomicHdrTimingHistogram;
+        if (slot.compare_exchange_strong(shard, created)) {
+            shard = created;
+        } else {
+            // Someone else beat us to it (shard now holds their instance)
+            delete created;
+        }
+    }
+    return *shard;
+}
+
+cb::sampling::Interval Timings::OpcodeTimings::getInterval() const {
+    cb::sampling::Interval ret;
+    for (const auto& slot : shards) {
+        const auto* shard = slot.load(std::memory_order_acquire);
+        if (shard != nullptr) {
+            ret.count += shard->getTotal();
+            ret.duration_ns += shard->getTotalDuration();
+        }
+    }
+    return ret;
+}
 
 Timings::Timings() {
+    for (auto& t : timings) {
+        t.store(nullptr);
+    }
     reset();
 }
 
+Timings::~Timings() {
+    for (auto& t : timings) {
+        delete t.load();
+    }
+}
+
 Timings& Timings::operator=(const Timings& other) {
-    timings = other.timings;
+    if (this == &other) {
+        return *this;
+    }
+
+    for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
+        const auto* src = other.timings[ii].load(std::memory_order_acquire);
+        auto* dest = timings[ii].load(std::memory_order_acquire);
+        if (src == nullptr) {
+            if (dest != nullptr) {
+                for (auto& shard : dest->shards) {
+                    auto* histogram = shard.load(std::memory_order_acquire);
+                    if (histogram != nullptr) {
+                        histogram->reset();
+                    }
+                }
+            }
+            continue;
+        }
+
+        auto& opcodeTimings = getOpcodeTimings(uint8_t(ii));
+        for (size_t shard = 0; shard < NumShards; ++shard) {
+            const auto* from =
+                    src->shards[shard].load(std::memory_order_acquire);
+            auto* to = opcodeTimings.shards[shard].load(
+                    std::memory_order_acquire);
+            if (from != nullptr) {
+                if (to == nullptr) {
+                    to = new AtomicHdrTimingHistogram;
+                    opcodeTimings.shards[shard].store(
+                            to, std::memory_order_release);
+                }
+                to->copyFrom(*from);
+            } else if (to != nullptr) {
+                to->reset();
+            }
+        }
+    }
+
+    std::lock(lock, other.lock);
+    std::lock_guard<std::mutex> lg1(lock, std::adopt_lock);
+    std::lock_guard<std::mutex> lg2(other.lock, std::adopt_lock);
     interval_latency_lookups = other.interval_latency_lookups;
     interval_latency_mutations = other.interval_latency_mutations;
+    interval_counters = other.interval_counters;
     return *this;
 }
 
 void Timings::reset(void) {
-    for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
-        timings[ii].reset();
+    for (auto& t : timings) {
+        auto* opcodeTimings = t.load(std::memory_order_acquire);
+        if (opcodeTimings != nullptr) {
+            for (auto& shard : opcodeTimings->shards) {
+                auto* histogram = shard.load(std::memory_order_acquire);
+                if (histogram != nullptr) {
+                    histogram->reset();
+                }
+            }
+        }
     }
 
     {
         std::lock_guard<std::mutex> lg(lock);
         interval_latency_lookups.reset();
         interval_latency_mutations.reset();
+        for (auto& interval : interval_counters) {
+            interval.reset();
+        }
+    }
+}
+
+Timings::OpcodeTimings& Timings::getOpcodeTimings(uint8_t opcode) {
+    auto& slot = timings[opcode];
+    auto* ret = slot.load(std::memory_order_acquire);
+    if (ret == nullptr) {
+        auto* created = new OpcodeTimings;
+        if (slot.compare_exchange_strong(ret, created)) {
+            ret = created;
+        } else {
+            delete created;
+        }
     }
+    return *ret;
+}
+
+uint64_t Timings::getTotal(uint8_t opcode) const {
+    const auto* opcodeTimings = timings[opcode].load(std::memory_order_acquire);
+    if (opcodeTimings == nullptr) {
+        return 0;
+    }
+    return opcodeTimings->getInterval().count.load();
 }
 
 void Timings::collect(const uint8_t opcode,
                       const std::chrono::nanoseconds nsec) {
-    timings[opcode].add(nsec);
-    auto& interval = interval_counters[opcode];
-    interval.count++;
-    interval.duration_ns += nsec.count();
+    getOpcodeTimings(opcode).getShard().add(nsec);
 }
 
 std::string Timings::generate(const uint8_t opcode) {
-    return timings[opcode].to_string();
+    HdrTimingHistogram histogram;
+    const auto* opcodeTimings = timings[opcode].load(std::memory_order_acquire);
+    if (opcodeTimings != nullptr) {
+        for (const auto& shard : opcodeTimings->shards) {
+            const auto* h = shard.load(std::memory_order_acquire);
+            if (h != nullptr) {
+                h->addTo(histogram);
+            }
+        }
+    }
+    return histogram.to_string();
 }
 
 static const uint8_t timings_mutations[] = {
@@ -105,7 +250,7 @@ uint64_t Timings::get_aggregated_mutation_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_mutations) {
-        ret += timings[cmd].get_total();
+        ret += getTotal(cmd);
     }
     return ret;
 }
@@ -114,7 +259,7 @@ uint64_t Timings::get_aggregated_retrival_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        ret += timings[cmd].get_total();
+        ret += getTotal(cmd);
     }
     return ret;
 }
@@ -132,19 +277,40 @@ cb::sampling::Interval Timings::get_interval_lookup_latency() {
 void Timings::sample(std::chrono::seconds sample_interval) {
     cb::sampling::Interval interval_lookup, interval_mutation;
 
+    std::lock_guard<std::mutex> lg(lock);
+
+    // The shards are never reset by sampling (that would race with the
+    // threads recording into them), so calculate the delta from the
+    // cumulative counters since the last time we sampled.
+    auto delta = [this](uint8_t op) {
+        cb::sampling::Interval ret;
+        const auto* opcodeTimings = timings[op].load(std::memory_order_acquire);
+        if (opcodeTimings == nullptr) {
+            return ret;
+        }
+        auto current = opcodeTimings->getInterval();
+        auto& previous = interval_counters[op];
+        if (current.count.load() >= previous.count.load() &&
+            current.duration_ns.load() >= previous.duration_ns.load()) {
+            ret.count = current.count.load() - previous.count.load();
+            ret.duration_ns =
+                    current.duration_ns.load() - previous.duration_ns.load();
+        } else {
+            // The timings were reset since the last sample
+            ret = current;
+        }
+        previous = current;
+        return ret;
+    };
+
     for (auto op : timings_mutations) {
-        interval_mutation += interval_counters[op];
-        interval_counters[op].reset();
+        interval_mutation += delta(op);
     }
 
     for (auto op : timings_retrievals) {
-        interval_lookup += interval_counters[op];
-        interval_counters[op].reset();
+        interval_lookup += delta(op);
     }
 
-    {
-        std::lock_guard<std::mutex> lg(lock);
-        interval_latency_lookups.sample(interval_lookup);
-        interval_latency_mutations.sample(interval_mutation);
-    }
+    interval_latency_lookups.sample(interval_lookup);
+    interval_latency_mutations.sample(interval_mutation);
 }
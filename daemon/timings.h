@@ -18,21 +18,32 @@
 
 #include <platform/platform.h>
 #include <array>
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <cstdint>
 
-#include "timing_histogram.h"
+#include "hdr_timing_histogram.h"
 #include "timing_interval.h"
 
 #define MAX_NUM_OPCODES 0x100
 
 /** Records timings for each memcached opcode. Each opcode has a histogram of
  * times.
+ *
+ * To avoid having all of the worker threads contend on the same cache
+ * lines for the hot opcodes, every opcode has a set of histogram shards
+ * and each thread records into "its own" shard. The shards are merged
+ * when the timings are requested (generate()). The shards are allocated
+ * the first time a thread records a timing for an opcode.
  */
 class Timings {
 public:
+    /// The number of histogram shards per opcode
+    static const size_t NumShards = 32;
+
     Timings(void);
+    ~Timings();
     Timings& operator=(const Timings& other);
     Timings(const Timings&) = delete;
 
@@ -47,13 +58,33 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
 private:
+    struct OpcodeTimings {
+        OpcodeTimings();
+        ~OpcodeTimings();
+
+        /// Get the shard for the calling thread (allocate if needed)
+        AtomicHdrTimingHistogram& getShard();
+
+        /// The total number of ops and their duration across all shards
+        cb::sampling::Interval getInterval() const;
+
+        std::array<std::atomic<AtomicHdrTimingHistogram*>, NumShards> shards;
+    };
+
+    /// Get the timings for the opcode (allocate if needed)
+    OpcodeTimings& getOpcodeTimings(uint8_t opcode);
+
+    uint64_t getTotal(uint8_t opcode) const;
+
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
     // contain cb::RingBuffer objects which are not thread safe.
-    std::mutex lock;
+    mutable std::mutex lock;
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    std::array<TimingHistogram, MAX_NUM_OPCODES> timings;
+    std::array<std::atomic<OpcodeTimings*>, MAX_NUM_OPCODES> timings;
+    // The cumulative interval counters for each opcode the last time we
+    // sampled (guarded by lock)
     std::array<cb::sampling::Interval, MAX_NUM_OPCODES> interval_counters;
 };
@@ -24,6 +24,8 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <platform/platform.h>
+#include <functional>
+#include <thread>
 
 #include "topkeys.h"
 
@@ -35,57 +37,59 @@
  * The TopKeys class is split into NUM_SHARDS shards, each which owns
  * 1/NUM_SHARDS of the keyspace. This is to allow some level of
  * concurrent access - each shard has a mutex guarding all access.
- * Other than that the TopKeys class is pretty uninteresting - it
- * simply passes on requests to the correct Shard, and when statistics
- * are requested it aggregates information from each shard.
+ *
+ * Before an operation is passed on to the shard TopKeys decides if it
+ * should be sampled at all. When the sample rate is N (> 1) only 1 of
+ * every N operations performed by a thread is recorded (with a weight
+ * of N). The decision is made by using a counter selected by the
+ * thread id; the counters live in separate cache lines and are only
+ * updated with plain (relaxed) loads and stores, so the operations
+ * which aren't sampled don't touch any shared state. Two threads
+ * hashing to the same counter may occasionally lose an update, which
+ * only makes the sampling slightly less regular.
+ *
+ * When statistics are requested it aggregates information from each
+ * shard.
  *
  * === TopKeys::Shard ===
  *
- * This is where the action happens. Each Shard maintains an ordered
- * list of key names and related statistics, orded by when they were
- * last accessed. There is a fixed number of keys each Shard tracks.
-
- * Given we generally track only a small number of keys per shard (10
- * by default), it's highly likely that any one key access will 'miss'
- * - i.e. not find an existing topkey. Therefore this class is
- * optimized for that case, attempting to minimise memory allocation
- * in steady-state.
+ * This is where the action happens. Each Shard tracks a fixed number
+ * of keys by using the Space-Saving algorithm (Metwally et al. "Efficient
+ * computation of frequent and top-k elements in data streams"):
+ *
+ *  * If the key is already tracked its count is incremented.
+ *  * If there is room for more keys, the key is added with its count
+ *    set to the weight of the operation.
+ *  * Otherwise the key with the lowest count is replaced by the new key,
+ *    which "inherits" the count of the evicted key (plus the weight of
+ *    the operation). The inherited count is recorded as the maximum
+ *    error of the count for the new key.
+ *
+ * This guarantees that every key accessed more than (total / max_keys)
+ * times within the shard is tracked, and that the true count of a
+ * tracked key is in the range [count - error, count]. The statistics
+ * reports the guaranteed count (count - error, which is the number of
+ * accesses seen since the key was tracked) along with the maximum error.
  *
  * Internally Shard consists of a vector of topkey_t, storing the
- * current max_keys top_keys, and a list of topkey_t pointers, used to
- * main the current most -> least recently used ordering:
-
- * max_keys elements. Each element is a tuple of
+ * current max_keys top_keys. Each element is a tuple of
  * {hash(key), key, topkey_stats}:
  *
- *
  *       vector<topkey_t>
  *   +----------+-------------+---------------+
  *   | size_t   | std::string | topkey_item_t |
  *   +----------+-------------+---------------+
- *   | <hash 1> | <key 1>     | stats 1       | <--- Node1
- *   | <hash 2> | <key 2>     | stats 2       | <--- Node2
- *   | <hash 3> | <key 3>     | stats 3       | <--- Node3
+ *   | <hash 1> | <key 1>     | stats 1       |
+ *   | <hash 2> | <key 2>     | stats 2       |
+ *   | <hash 3> | <key 3>     | stats 3       |
  *   . ....                                   .
- *   | <hash N> | <key N>     | stats N       | <--- NodeN
+ *   | <hash N> | <key N>     | stats N       |
  *   +----------------------------------------+
  *
- *   Node3 <---> Node1 <---> ... <---> Node2
- *   ^^^                               ^^^
- *   MRU                               LRU
- *
- *
- * Upon a key 'hit', TopKeys::updateKey() is called. That hashes the
- * key, and finds the Shard responsible for that
- * key. TopKeys::Shard::updateKey() is then called.
- *
- * Shard::updateKey() iterates over the vector, searching for a hash
- * match with an existing element, using the actual key string to
- * validate (in case of a hash collision). If it is found, then the
- * stats are simply updated.  If it is not found, then the
- * least-recently-used element is selected as a 'victim' and it's
- * contents is replaced by the incoming key.  Finally the linked-list
- * is updated to move the updated element to the head of the list.
+ * Given we generally track only a small number of keys per shard (10
+ * by default), searching the vector is cheap. When a key is replaced
+ * the std::string of the evicted key is reused, so in steady state an
+ * update doesn't allocate any memory.
  */
 
 
@@ -93,6 +97,9 @@ TopKeys::TopKeys(int mkeys) {
     for (auto& shard : shards) {
         shard.setMaxKeys(mkeys);
     }
+    for (auto& sampler : samplers) {
+        sampler->store(0, std::memory_order_relaxed);
+    }
 }
 
 TopKeys::~TopKeys() {
@@ -105,6 +112,18 @@ TopKeys::Shard& TopKeys::getShard(size_t key_hash) {
     return shards[key_hash & 0x7];
 }
 
+bool TopKeys::shouldSample(uint32_t rate) {
+    // Mix the hash of the thread id as the ids are typically addresses
+    // with a lot of common low bits
+    uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    id *= 0x9e3779b97f4a7c15ULL;
+    auto& counter = samplers[size_t(id >> 32) % NUM_SAMPLERS];
+
+    const auto value = counter->load(std::memory_order_relaxed) + 1;
+    counter->store(value, std::memory_order_relaxed);
+    return (value % rate) == 0;
+}
+
 TopKeys::Shard::topkey_t*
 TopKeys::Shard::searchForKey(size_t key_hash,
                              const cb::const_char_buffer& key) {
@@ -124,7 +143,8 @@ TopKeys::Shard::searchForKey(size_t key_hash,
 
 bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
                                size_t key_hash,
-                               const rel_time_t ct) {
+                               const rel_time_t ct,
+                               uint32_t weight) {
     try {
         std::lock_guard<std::mutex> lock(mutex);
 
@@ -133,37 +153,36 @@ bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
         if (found_key == NULL) {
             // Key not found.
             if (storage.size() == max_keys) {
-                // Re-use the lowest keys' storage.
-                found_key = list.back();
+                if (max_keys == 0) {
+                    return true;
+                }
+                // Re-use the storage of the key with the lowest count
+                auto victim = std::min_element(
+                        storage.begin(),
+                        storage.end(),
+                        [](const topkey_t& a, const topkey_t& b) {
+                            return a.second.ti_access_count <
+                                   b.second.ti_access_count;
+                        });
+                found_key = &(*victim);
+                const auto count = found_key->second.ti_access_count;
                 found_key->first.hash = key_hash;
                 found_key->first.key.assign(key.buf, key.len);
                 found_key->second = topkey_item_t(ct);
-
-                // Move back element to the front, shuffling down the
-                // rest.
-                list.splice(list.begin(), list, --list.end());
-
+                found_key->second.ti_access_count = count;
+                found_key->second.ti_error = count;
             } else {
                 // add a new element to the storage array.
-
                 storage.emplace_back(
                     std::make_pair(KeyId{key_hash,
                                          std::string(key.buf, key.len)},
                                    topkey_item_t(ct)));
                 found_key = &storage.back();
-
-                // Insert the new item to the front of the list
-                list.push_front(found_key);
             }
-        } else {
-            // Found - shuffle to the front.
-            auto it = std::find(list.begin(), list.end(),
-                                found_key);
-            list.splice(list.begin(), list, it);
         }
 
         // Increment access count.
-        found_key->second.ti_access_count++;
+        found_key->second.ti_access_count += weight;
         return true;
 
     } catch (const std::bad_alloc&) {
@@ -174,7 +193,8 @@ bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
 
 void TopKeys::doUpdateKey(const void* key,
                           size_t nkey,
-                          rel_time_t operation_time) {
+                          rel_time_t operation_time,
+                          uint32_t weight) {
     if (key == nullptr || nkey == 0) {
         throw std::invalid_argument("TopKeys::doUpdateKey: must be specified");
     }
@@ -184,7 +204,8 @@ void TopKeys::doUpdateKey(const void* key,
         std::hash<cb::const_char_buffer > hash_fn;
         const size_t key_hash = hash_fn(key_buf);
 
-        getShard(key_hash).updateKey(key_buf, key_hash, operation_time);
+        getShard(key_hash).updateKey(
+                key_buf, key_hash, operation_time, std::max(weight, 1u));
     } catch (const std::bad_alloc&) {
         // Failed to increment topkeys, continue...
     }
@@ -212,14 +233,15 @@ static void tk_iterfunc(const std::string& key, const topkey_item_t& it,
      * clients may expect separate values we print both.
      */
     rel_time_t created_time = c->current_time - it.ti_ctime;
-    int vlen = snprintf(val_str, sizeof(val_str) - 1, "get_hits=%d,"
+    int vlen = snprintf(val_str, sizeof(val_str) - 1, "get_hits=%" PRIu64 ","
                         "get_misses=0,cmd_set=0,incr_hits=0,incr_misses=0,"
                         "decr_hits=0,decr_misses=0,delete_hits=0,"
                         "delete_misses=0,evictions=0,cas_hits=0,cas_badval=0,"
                         "cas_misses=0,get_replica=0,evict=0,getl=0,unlock=0,"
                         "get_meta=0,set_meta=0,del_meta=0,ctime=%" PRIu32
-                        ",atime=%" PRIu32, it.ti_access_count,
-                        created_time, created_time);
+                        ",atime=%" PRIu32 ",max_error=%" PRIu64,
+                        it.ti_access_count - it.ti_error,
+                        created_time, created_time, it.ti_error);
     if (vlen > 0 && vlen < int(sizeof(val_str) - 1)) {
         c->add_stat(key.c_str(), key.size(), val_str, vlen, c->cookie);
     }
@@ -231,6 +253,7 @@ static void tk_iterfunc(const std::string& key, const topkey_item_t& it,
  * {
  *    "key": "somekey",
  *    "access_count": nnn,
+ *    "max_error": eee,
  *    "ctime": ccc,
  *    "atime": aaa
  * }
@@ -245,7 +268,10 @@ static void tk_jsonfunc(const std::string& key, const topkey_item_t& it,
     cJSON *obj = cJSON_CreateObject();
     cJSON_AddItemToObject(obj, "key", cJSON_CreateString(key.c_str()));
     cJSON_AddItemToObject(obj, "access_count",
-                          cJSON_CreateNumber(it.ti_access_count));
+                          cJSON_CreateNumber(double(it.ti_access_count -
+                                                    it.ti_error)));
+    cJSON_AddItemToObject(obj, "max_error",
+                          cJSON_CreateNumber(double(it.ti_error)));
     cJSON_AddItemToObject(obj, "ctime", cJSON_CreateNumber(c->current_time
                                                            - it.ti_ctime));
     cJSON_AddItemToArray(c->array, obj);
@@ -266,11 +292,13 @@ ENGINE_ERROR_CODE TopKeys::doStats(const void* cookie,
 /**
  * Passing a set of topkeys, and relevant context data will
  * return a cJSON object containing an array of topkeys (with each key
- * appearing as in the example above for tk_jsonfunc):
+ * appearing as in the example above for tk_jsonfunc) and the sample
+ * rate used:
  * {
  *   "topkeys": [
  *      { ... }, ..., { ... }
- *    ]
+ *    ],
+ *   "sample_rate": n
  * }
  */
 ENGINE_ERROR_CODE TopKeys::do_json_stats(cJSON* object,
@@ -284,13 +312,26 @@ ENGINE_ERROR_CODE TopKeys::do_json_stats(cJSON* object,
     }
 
     cJSON_AddItemToObject(object, "topkeys", topkeys);
+    cJSON_AddNumberToObject(
+            object, "sample_rate", settings.getTopkeysSampleRate());
     return ENGINE_SUCCESS;
 }
 
 void TopKeys::Shard::accept_visitor(iterfunc_t visitor_func,
                                     void* visitor_ctx) {
     std::lock_guard<std::mutex> lock(mutex);
-    for (const auto key : list) {
+    std::vector<const topkey_t*> keys;
+    keys.reserve(storage.size());
+    for (const auto& key : storage) {
+        keys.push_back(&key);
+    }
+    std::sort(keys.begin(),
+              keys.end(),
+              [](const topkey_t* a, const topkey_t* b) {
+                  return a->second.ti_access_count >
+                         b->second.ti_access_count;
+              });
+    for (const auto* key : keys) {
         visitor_func(key->first.key, key->second, visitor_ctx);
     }
 }
@@ -19,30 +19,38 @@
 #include "settings.h"
 
 #include <array>
+#include <platform/cacheline_padded.h>
 #include <platform/sized_buffer.h>
 #include <memcached/engine.h>
 #include <cJSON.h>
 
+#include <atomic>
 #include <mutex>
-#include <list>
 #include <string>
 #include <vector>
 
 /*
  * TopKeys
  *
- * Tracks the top N most recently accessed keys. The details are
- * accessible by a stats call, which is used by ns_server to print the
- * top keys list in the GUI.
+ * Tracks the N most frequently accessed keys (the "heavy hitters") by
+ * using the Space-Saving algorithm. The details are accessible by a stats
+ * call, which is used by ns_server to print the top keys list in the GUI.
+ *
+ * To make it cheap enough to leave enabled, TopKeys may be configured to
+ * only record 1 of every N operations (see Settings::getTopkeysSampleRate).
  */
 
 struct topkey_item_t {
     topkey_item_t(rel_time_t create_time)
         : ti_ctime(create_time),
-          ti_access_count(0) { }
+          ti_access_count(0),
+          ti_error(0) { }
 
     rel_time_t ti_ctime; /* Time this item was created */
-    int ti_access_count; /* Int count for number of times key has been accessed */
+    /* (Estimated) number of times key has been accessed */
+    uint64_t ti_access_count;
+    /* The maximum overestimation of ti_access_count */
+    uint64_t ti_error;
 };
 
 /* Class to track the "top" keys in a bucket.
@@ -58,7 +66,10 @@ public:
 
     void updateKey(const void* key, size_t nkey, rel_time_t operation_time) {
         if (settings.isTopkeysEnabled()) {
-            doUpdateKey(key, nkey, operation_time);
+            const uint32_t rate = settings.getTopkeysSampleRate();
+            if (rate <= 1 || shouldSample(rate)) {
+                doUpdateKey(key, nkey, operation_time, rate);
+            }
         }
     }
 
@@ -80,10 +91,12 @@ public:
      *      {
      *          "key": "somekey",
      *          "access_count": nnn,
+     *          "max_error": eee,
      *          "ctime": ccc,
      *          "atime": aaa
      *      }, ..., { ... }
-     *    ]
+     *    ],
+     *   "sample_rate": n
      * }
      */
     ENGINE_ERROR_CODE json_stats(cJSON* object, rel_time_t current_time) {
@@ -95,7 +108,17 @@ public:
     }
 
 protected:
-    void doUpdateKey(const void* key, size_t nkey, rel_time_t operation_time);
+    /**
+     * Should the calling thread record this operation? Each thread
+     * (normally) has its own counter, so this doesn't require any locking
+     * or shared atomic read-modify-write operations.
+     */
+    bool shouldSample(uint32_t rate);
+
+    void doUpdateKey(const void* key,
+                     size_t nkey,
+                     rel_time_t operation_time,
+                     uint32_t weight);
 
     ENGINE_ERROR_CODE doStats(const void* cookie,
                               rel_time_t current_time,
@@ -108,6 +131,9 @@ private:
     // concurrent update (there is one mutex per shard).
     static const int NUM_SHARDS = 8;
 
+    // Number of sampling counters (the threads are spread across them)
+    static const size_t NUM_SAMPLERS = 64;
+
     class Shard;
 
     Shard& getShard(size_t key_hash);
@@ -121,25 +147,25 @@ private:
         void setMaxKeys(int mkeys) {
             max_keys = mkeys;
             storage.reserve(max_keys);
-            // reallocating storage invalidates the LRU list.
-            list.clear();
         }
 
-        // Updates the topkey 'ranking' for the specified key.
-        // If the item does not exist it will be created (with it's creation
-        // time set to operation_time), otherwise the existing item will be
-        // updated.
+        // Records that the key was accessed (weight times). If the key
+        // isn't tracked and the shard is full, the key with the lowest
+        // count is replaced (and the new key inherits its count as the
+        // error of its own count).
         // On success returns true, If insufficient memory to create a
         // new item, returns false.
         bool updateKey(const cb::const_char_buffer& key,
                        size_t key_hash,
-                       rel_time_t operation_time);
+                       rel_time_t operation_time,
+                       uint32_t weight);
 
         typedef void (*iterfunc_t)(const std::string& key,
                                    const topkey_item_t& it,
                                    void *arg);
 
-        /* For each key in this shard, invoke the given callback function.
+        /* For each key in this shard (from the most to the least
+         * frequently accessed), invoke the given callback function.
          */
         void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
 
@@ -153,9 +179,6 @@ private:
         // Pair of the key's string and the statistics related to it.
         typedef std::pair<KeyId, topkey_item_t> topkey_t;
 
-        // An ordered list of topkey_t*, used for LRU.
-        typedef std::list<topkey_t*> key_history_t;
-
         // Vector topket_t, used for actual topke storage.
         typedef std::vector<topkey_t> key_storage_t;
 
@@ -169,14 +192,14 @@ private:
         // mutex to serial access to this shard.
         std::mutex mutex;
 
-        // list of keys, ordered from most-recently used (front) to least recently
-        // used (back).
-        key_history_t list;
-
         // Underlying topkey storage.
         key_storage_t storage;
     };
 
     // array of topkey shards.
     std::array<Shard, NUM_SHARDS> shards;
+
+    // The per-thread counters used to pick the operations to sample
+    std::array<cb::CachelinePadded<std::atomic<uint32_t>>, NUM_SAMPLERS>
+            samplers;
 };
@@ -0,0 +1,163 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the Checkpoint class.
+ */
+
+#include "benchmark_memory_tracker.h"
+#include "checkpoint.h"
+#include "engine_fixture.h"
+
+#include <mock/mock_synchronous_ep_engine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+class CheckpointBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        // Keep all of the items in a single (open) checkpoint
+        varConfig = "chk_max_items=" + std::to_string(MAX_CHECKPOINT_ITEMS);
+        EngineFixture::SetUp(state);
+        engine->getKVBucket()->setVBucketState(0, vbucket_state_active, false);
+    }
+};
+
+/*
+ * Queue items into the open checkpoint of a vbucket. Arg 0 is the number
+ * of items to queue, and arg 1 is the number of distinct keys used (keys
+ * are reused round robin, so the checkpoint de-duplicates the rest).
+ */
+BENCHMARK_DEFINE_F(CheckpointBench, QueueDirty)(benchmark::State& state) {
+    const auto itemCount = state.range(0);
+    const auto keyCount = state.range(1);
+    auto vb = engine->getKVBucket()->getVBucket(vbid);
+
+    std::vector<queued_item> items;
+    for (int64_t ii = 0; ii < itemCount; ++ii) {
+        items.emplace_back(new Item(make_item(
+                vbid, "key" + std::to_string(ii % keyCount), "value")));
+    }
+
+    size_t overhead = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        vb->checkpointManager->clear(*vb, 0);
+        const auto baseOverhead = engine->getEpStats().memOverhead->load();
+        state.ResumeTiming();
+
+        for (auto& qi : items) {
+            vb->checkpointManager->queueDirty(*vb,
+                                              qi,
+                                              GenerateBySeqno::Yes,
+                                              GenerateCas::Yes,
+                                              /*preLinkDocCtx*/ nullptr);
+        }
+
+        state.PauseTiming();
+        overhead = std::max(
+                overhead,
+                size_t(engine->getEpStats().memOverhead->load() -
+                       baseOverhead));
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * itemCount);
+    // Checkpoint memory overhead (queue and key index) per distinct key
+    state.counters["OverheadBytesPerKey"] = overhead / keyCount;
+}
+
+BENCHMARK_REGISTER_F(CheckpointBench, QueueDirty)
+        ->Args({1000, 1000})
+        ->Args({10000, 10000})
+        ->Args({40000, 40000})
+        ->Args({40000, 1000})
+        ->Args({40000, 100});
+
+/*
+ * Queue items into the open checkpoint of a vbucket while arg 0 cursors
+ * concurrently drain the checkpoint (like DCP streams do); every cursor is
+ * polled by its own thread, which only takes the queueLock when something
+ * was published since it last drained its cursor.
+ */
+BENCHMARK_DEFINE_F(CheckpointBench, QueueDirtyWithCursors)
+(benchmark::State& state) {
+    const auto numCursors = state.range(0);
+    const int itemCount = 10000;
+    auto vb = engine->getKVBucket()->getVBucket(vbid);
+    auto& manager = *vb->checkpointManager;
+
+    std::vector<queued_item> items;
+    for (int ii = 0; ii < itemCount; ++ii) {
+        items.emplace_back(new Item(
+                make_item(vbid, "key" + std::to_string(ii), "value")));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> itemsRead{0};
+    std::vector<std::thread> readers;
+    for (int64_t ii = 0; ii < numCursors; ++ii) {
+        const auto name = "cursor-" + std::to_string(ii);
+        manager.registerCursorBySeqno(name, 0, MustSendCheckpointEnd::NO);
+        readers.emplace_back([&manager, &stop, &itemsRead, name]() {
+            std::vector<queued_item> drained;
+            auto version = std::numeric_limits<uint64_t>::max();
+            while (!stop) {
+                const auto current = manager.getPublishedVersion();
+                if (current == version) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                drained.clear();
+                manager.getAllItemsForCursor(name, drained);
+                itemsRead += drained.size();
+                version = current;
+            }
+        });
+    }
+
+    while (state.KeepRunning()) {
+        for (auto& qi : items) {
+            manager.queueDirty(*vb,
+                               qi,
+                               GenerateBySeqno::Yes,
+                               GenerateCas::Yes,
+                               /*preLinkDocCtx*/ nullptr);
+        }
+    }
+
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (int64_t ii = 0; ii < numCursors; ++ii) {
+        manager.removeCursor("cursor-" + std::to_string(ii));
+    }
+
+    state.SetItemsProcessed(state.iterations() * itemCount);
+    state.counters["ItemsRead"] = itemsRead.load();
+}
+
+BENCHMARK_REGISTER_F(CheckpointBench, QueueDirtyWithCursors)
+        ->Arg(0)
+        ->Arg(1)
+        ->Arg(4)
+        ->Arg(16)
+        ->UseRealTime();
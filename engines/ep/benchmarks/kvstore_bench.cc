@@ -0,0 +1,274 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of a backfill (a by-seqno scan of a vBucket) and of flushing
+ * (persisting batches of items) for the different KVStore implementations.
+ */
+
+#include "callbacks.h"
+#include "configuration.h"
+#include "item.h"
+#include "kvstore.h"
+#include "kvstore_config.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <platform/dirutils.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class Backend { Couchstore, RocksDB };
+
+static const char* toString(Backend backend) {
+    switch (backend) {
+    case Backend::Couchstore:
+        return "couchdb";
+    case Backend::RocksDB:
+        return "rocksdb";
+    }
+    return "unknown";
+}
+
+class NoopWriteCallback : public Callback<TransactionContext, mutation_result> {
+public:
+    void callback(TransactionContext&, mutation_result&) override {
+    }
+};
+
+/// Counts the items and bytes returned by the scan
+class CountingScanCallback : public StatusCallback<GetValue> {
+public:
+    void callback(GetValue& gv) override {
+        ++items;
+        bytes += gv.item->getKey().size() + gv.item->getNBytes();
+    }
+
+    size_t items = 0;
+    size_t bytes = 0;
+};
+
+/**
+ * Fixture which populates vBucket 0 of a KVStore with state.range(1)
+ * items of 1KiB, and then updates half of them (so that the by-seqno
+ * index has stale entries, as it would in a running bucket).
+ *
+ * state.range(0) selects the backend.
+ */
+class KVStoreBench : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        const auto backend = Backend(state.range(0));
+        const auto numItems = state.range(1);
+
+        cb::io::rmrf(dbname);
+        Configuration config;
+        config.setDbname(dbname);
+        config.setBackend(toString(backend));
+        kvstoreConfig = std::make_unique<KVStoreConfig>(config, 0 /*shardId*/);
+        kvstore = std::move(KVStoreFactory::create(*kvstoreConfig).rw);
+
+        vbucket_state vbstate(
+                vbucket_state_active, 0, 0, 0, 0, 0, 0, 0, 0, false, "");
+        kvstore->incrementRevision(vbid);
+        kvstore->snapshotVBucket(
+                vbid, vbstate, VBStatePersist::VBSTATE_PERSIST_WITHOUT_COMMIT);
+
+        const std::string value(1024, 'x');
+        int64_t seqno = 1;
+        auto store = [&](int64_t first, int64_t last) {
+            const int64_t batchSize = 1000;
+            for (auto start = first; start < last; start += batchSize) {
+                kvstore->begin({});
+                for (auto ii = start; ii < std::min(start + batchSize, last);
+                     ++ii) {
+                    Item item(makeStoredDocKey("key" + std::to_string(ii)),
+                              0 /*flags*/,
+                              0 /*exptime*/,
+                              value.data(),
+                              value.size(),
+                              PROTOCOL_BINARY_RAW_BYTES,
+                              0 /*cas*/,
+                              seqno++,
+                              vbid);
+                    kvstore->set(item, writeCallback);
+                }
+                kvstore->commit(nullptr /*no collections manifest*/);
+            }
+        };
+        store(0, numItems);
+        store(0, numItems / 2);
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        kvstore.reset();
+        kvstoreConfig.reset();
+        cb::io::rmrf(dbname);
+    }
+
+    const std::string dbname{"kvstore_bench.db"};
+    const uint16_t vbid = 0;
+    NoopWriteCallback writeCallback;
+    std::unique_ptr<KVStoreConfig> kvstoreConfig;
+    std::unique_ptr<KVStore> kvstore;
+};
+
+/*
+ * Scan the whole vBucket, like a DCP backfill of a new replica does;
+ * reports the backfill rate in items and bytes (keys and values) per
+ * second.
+ */
+BENCHMARK_DEFINE_F(KVStoreBench, Backfill)(benchmark::State& state) {
+    state.SetLabel(toString(Backend(state.range(0))));
+    size_t items = 0;
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        auto cb = std::make_shared<CountingScanCallback>();
+        auto cl = std::make_shared<NoLookupCallback>();
+        auto* ctx = kvstore->initScanContext(cb,
+                                             cl,
+                                             vbid,
+                                             0 /*startSeqno*/,
+                                             DocumentFilter::ALL_ITEMS,
+                                             ValueFilter::VALUES_DECOMPRESSED);
+        if (ctx == nullptr) {
+            state.SkipWithError("initScanContext failed");
+            break;
+        }
+        if (kvstore->scan(ctx) != scan_success) {
+            state.SkipWithError("scan failed");
+        }
+        kvstore->destroyScanContext(ctx);
+        items += cb->items;
+        bytes += cb->bytes;
+    }
+    state.SetItemsProcessed(items);
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_REGISTER_F(KVStoreBench, Backfill)
+        ->Args({int(Backend::Couchstore), 10000})
+        ->Args({int(Backend::Couchstore), 100000})
+#ifdef EP_USE_ROCKSDB
+        ->Args({int(Backend::RocksDB), 10000})
+        ->Args({int(Backend::RocksDB), 100000})
+#endif
+        ->Unit(benchmark::kMillisecond);
+
+class NoopDeleteCallback : public Callback<TransactionContext, int> {
+public:
+    void callback(TransactionContext&, int&) override {
+    }
+};
+
+/**
+ * Fixture for an empty vBucket 0 of a KVStore; state.range(0) selects the
+ * backend.
+ */
+class KVStoreFlushBench : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        cb::io::rmrf(dbname);
+        Configuration config;
+        config.setDbname(dbname);
+        config.setBackend(toString(Backend(state.range(0))));
+        kvstoreConfig = std::make_unique<KVStoreConfig>(config, 0 /*shardId*/);
+        kvstore = std::move(KVStoreFactory::create(*kvstoreConfig).rw);
+
+        vbucket_state vbstate(
+                vbucket_state_active, 0, 0, 0, 0, 0, 0, 0, 0, false, "");
+        kvstore->incrementRevision(vbid);
+        kvstore->snapshotVBucket(
+                vbid, vbstate, VBStatePersist::VBSTATE_PERSIST_WITHOUT_COMMIT);
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        kvstore.reset();
+        kvstoreConfig.reset();
+        cb::io::rmrf(dbname);
+    }
+
+    const std::string dbname{"kvstore_flush_bench.db"};
+    const uint16_t vbid = 0;
+    NoopWriteCallback writeCallback;
+    NoopDeleteCallback deleteCallback;
+    std::unique_ptr<KVStoreConfig> kvstoreConfig;
+    std::unique_ptr<KVStore> kvstore;
+};
+
+/*
+ * Persist batches of state.range(1) small (32 byte) items, as the flusher
+ * does for a write-heavy workload, over a fixed key space so that most
+ * writes are updates. One in ten items is a deletion. Reports items
+ * persisted per second; the per-item cost is dominated by marshalling the
+ * batch for the KVStore rather than by the values themselves.
+ */
+BENCHMARK_DEFINE_F(KVStoreFlushBench, Flush)(benchmark::State& state) {
+    state.SetLabel(toString(Backend(state.range(0))));
+    const auto batchSize = state.range(1);
+    const int64_t keySpace = 100000;
+    const std::string value(32, 'x');
+
+    // Build the items up front so the benchmark measures only the KVStore.
+    std::vector<std::unique_ptr<Item>> items;
+    for (int64_t ii = 0; ii < keySpace; ++ii) {
+        const auto key = makeStoredDocKey("key" + std::to_string(ii));
+        if (ii % 10 == 9) {
+            items.push_back(std::make_unique<Item>(
+                    key, 0 /*flags*/, 0 /*exptime*/, value_t{}));
+            items.back()->setDeleted();
+        } else {
+            items.push_back(std::make_unique<Item>(key,
+                                                   0 /*flags*/,
+                                                   0 /*exptime*/,
+                                                   value.data(),
+                                                   value.size()));
+        }
+    }
+
+    int64_t seqno = 1;
+    int64_t next = 0;
+    size_t persisted = 0;
+    while (state.KeepRunning()) {
+        kvstore->begin({});
+        for (int64_t ii = 0; ii < batchSize; ++ii) {
+            auto& item = *items[next];
+            next = (next + 1) % keySpace;
+            item.setBySeqno(seqno++);
+            if (item.isDeleted()) {
+                kvstore->del(item, deleteCallback);
+            } else {
+                kvstore->set(item, writeCallback);
+            }
+        }
+        kvstore->commit(nullptr /*no collections manifest*/);
+        persisted += batchSize;
+    }
+    state.SetItemsProcessed(persisted);
+}
+
+BENCHMARK_REGISTER_F(KVStoreFlushBench, Flush)
+        ->Args({int(Backend::Couchstore), 100})
+        ->Args({int(Backend::Couchstore), 1000})
+#ifdef EP_USE_ROCKSDB
+        ->Args({int(Backend::RocksDB), 100})
+        ->Args({int(Backend::RocksDB), 1000})
+#endif
+        ->Unit(benchmark::kMicrosecond);
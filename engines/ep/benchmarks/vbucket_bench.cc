@@ -28,6 +28,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <vector>
 
 class VBucketBench : public EngineFixture {
 protected:
@@ -77,3 +78,69 @@ BENCHMARK_DEFINE_F(VBucketBench, FlushVBucket)(benchmark::State& state) {
 BENCHMARK_REGISTER_F(VBucketBench, FlushVBucket)
         ->RangeMultiplier(10)
         ->Range(1, 1000000);
+
+/*
+ * Apply replicated mutations (with their seqno and CAS already assigned, as
+ * received from a DCP producer) to a replica vbucket. Arg 0 is the number of
+ * mutations applied per call - 1 applies each mutation with setWithMeta (the
+ * per-mutation path), anything larger applies them with setWithMetaBatch.
+ */
+BENCHMARK_DEFINE_F(VBucketBench, ReplicaSetWithMeta)(benchmark::State& state) {
+    const size_t batchSize = state.range(0);
+    const int itemCount = 10000;
+    auto& kvBucket = *engine->getKVBucket();
+    kvBucket.setVBucketState(vbid, vbucket_state_replica, false);
+    auto vb = kvBucket.getVBucket(vbid);
+    vb->ht.resize(itemCount);
+
+    std::vector<Item> items;
+    for (int ii = 0; ii < itemCount; ++ii) {
+        items.push_back(make_item(vbid, "key" + std::to_string(ii), "value"));
+    }
+
+    int64_t seqno = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        // Start a new snapshot covering the items
+        vb->checkpointManager->clear(*vb, seqno);
+        vb->checkpointManager->updateCurrentSnapshotEnd(seqno + itemCount);
+        for (auto& item : items) {
+            item.setBySeqno(++seqno);
+            item.setCas(seqno);
+        }
+        state.ResumeTiming();
+
+        for (size_t ii = 0; ii < items.size(); ii += batchSize) {
+            if (batchSize == 1) {
+                kvBucket.setWithMeta(items[ii],
+                                     0,
+                                     nullptr,
+                                     cookie,
+                                     {vbucket_state_replica},
+                                     CheckConflicts::No,
+                                     /*allowExisting*/ true,
+                                     GenerateBySeqno::No,
+                                     GenerateCas::No,
+                                     /*emd*/ nullptr,
+                                     /*isReplication*/ true);
+            } else {
+                std::vector<Item*> batch;
+                for (size_t jj = ii;
+                     jj < std::min(ii + batchSize, items.size());
+                     ++jj) {
+                    batch.push_back(&items[jj]);
+                }
+                size_t applied;
+                kvBucket.setWithMetaBatch(
+                        vbid, batch, cookie, {vbucket_state_replica}, applied);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * itemCount);
+}
+
+BENCHMARK_REGISTER_F(VBucketBench, ReplicaSetWithMeta)
+        ->Arg(1)
+        ->Arg(10)
+        ->Arg(100)
+        ->Arg(1000);
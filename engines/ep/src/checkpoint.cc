@@ -89,7 +89,8 @@ Checkpoint::Checkpoint(EPStats& st,
       checkpointState(CHECKPOINT_OPEN),
       numItems(0),
       numMetaItems(0),
-      memOverhead(0),
+      keyIndex(toWrite),
+      metaKeyIndex(toWrite),
       effectiveMemUsage(0) {
     stats.memOverhead->fetch_add(memorySize());
     if (stats.memOverhead->load() >= GIGANTOR) {
@@ -125,13 +126,31 @@ void Checkpoint::setState(checkpoint_state state) {
 void Checkpoint::popBackCheckpointEndItem() {
     if (!toWrite.empty() &&
         toWrite.back()->getOperation() == queue_op::checkpoint_end) {
+        const auto previousSize = memorySize();
         metaKeyIndex.erase(toWrite.back()->getKey());
         toWrite.pop_back();
+        updateMemOverhead(previousSize);
     }
 }
 
 bool Checkpoint::keyExists(const DocKey& key) {
-    return keyIndex.find(key) != keyIndex.end();
+    return keyIndex.find(key) != nullptr;
+}
+
+void Checkpoint::updateMemOverhead(size_t previousSize) {
+    const auto size = memorySize();
+    if (size > previousSize) {
+        stats.memOverhead->fetch_add(size - previousSize);
+        if (stats.memOverhead->load() >= GIGANTOR) {
+            LOG(EXTENSION_LOG_WARNING,
+                "Checkpoint::updateMemOverhead: stats.memOverhead (which is "
+                "%" PRId64 ") is greater than %" PRId64,
+                uint64_t(stats.memOverhead->load()),
+                uint64_t(GIGANTOR));
+        }
+    } else if (size < previousSize) {
+        stats.memOverhead->fetch_sub(previousSize - size);
+    }
 }
 
 queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
@@ -142,7 +161,8 @@ queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
                         ") is not OPEN");
     }
     queue_dirty_t rv;
-    checkpoint_index::iterator it = keyIndex.find(qi->getKey());
+    const auto previousSize = memorySize();
+    auto* it = keyIndex.find(qi->getKey());
     // Check if the item is a meta item
     if (qi->isCheckPointMetaItem()) {
         // empty items act only as a dummy element for the start of the
@@ -153,12 +173,18 @@ queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
         }
         rv = NEW_ITEM;
         toWrite.push_back(qi);
+        if (qi->getKey().size() > 0) {
+            // We add a meta item only once to a checkpoint
+            metaKeyIndex.insert(qi->getKey(),
+                                {(--toWrite.end()).getPosition(),
+                                 qi->getBySeqno()});
+        }
     } else {
         // Check if this checkpoint already had an item for the same key
-        if (it != keyIndex.end()) {
+        if (it != nullptr) {
             rv = EXISTING_ITEM;
-            CheckpointQueue::iterator currPos = it->second.position;
-            const int64_t currMutationId{it->second.mutation_id};
+            auto currPos = toWrite.at(it->position);
+            const int64_t currMutationId{it->mutation_id};
 
             // Given the key already exists, need to check all cursors in this
             // Checkpoint and see if the existing item for this key is to
@@ -176,8 +202,9 @@ queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
                             cursor_item->isCheckPointMetaItem() ? metaKeyIndex
                                                                 : keyIndex;
 
-                    auto cursor_item_idx = index.find(cursor_item->getKey());
-                    if (cursor_item_idx == keyIndex.end()) {
+                    const auto* cursor_item_idx =
+                            index.find(cursor_item->getKey());
+                    if (cursor_item_idx == nullptr) {
                         throw std::logic_error("Checkpoint::queueDirty: Unable "
                                 "to find key with"
                                 " op:" + to_string(cursor_item->getOperation()) +
@@ -192,7 +219,7 @@ queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
                     // decrement if the the existing item is strictly less than
                     // the cursor, as meta-items can share a seqno with
                     // a non-meta item but are logically before them.
-                    int64_t cursor_mutation_id{cursor_item_idx->second.mutation_id};
+                    int64_t cursor_mutation_id{cursor_item_idx->mutation_id};
                     if (cursor_item->isCheckPointMetaItem()) {
                         --cursor_mutation_id;
                     }
@@ -214,43 +241,38 @@ queue_dirty_t Checkpoint::queueDirty(const queued_item &qi,
                 }
             }
 
-            toWrite.push_back(qi);
-            // Remove the existing item for the same key from the list.
-            toWrite.erase(currPos);
+            if (std::next(currPos) == toWrite.end()) {
+                // The existing item is the last one in the queue; replacing
+                // it in place gives the same order as appending the new
+                // item and removing the old one.
+                *currPos = qi;
+            } else {
+                toWrite.push_back(qi);
+                // Point the index to the new item before removing the
+                // existing item for the same key from the queue (the index
+                // reads the key from the queued item).
+                it->position = (--toWrite.end()).getPosition();
+                toWrite.erase(currPos);
+                if (toWrite.needsCompaction()) {
+                    compactQueue(*checkpointManager);
+                }
+            }
+            it->mutation_id = qi->getBySeqno();
         } else {
             ++numItems;
             rv = NEW_ITEM;
-            // Push the new item into the list
+            // Push the new item into the queue
             toWrite.push_back(qi);
-        }
-    }
-
-    if (qi->getKey().size() > 0) {
-        CheckpointQueue::iterator last = toWrite.end();
-        // --last is okay as the list is not empty now.
-        index_entry entry = {--last, qi->getBySeqno()};
-        // Set the index of the key to the new item that is pushed back into
-        // the list.
-        if (qi->isCheckPointMetaItem()) {
-            // We add a meta item only once to a checkpoint
-            metaKeyIndex[qi->getKey()] = entry;
-        } else {
-            keyIndex[qi->getKey()] = entry;
-        }
-        if (rv == NEW_ITEM) {
-            size_t newEntrySize = qi->getKey().size() +
-                                  sizeof(index_entry) + sizeof(queued_item);
-            memOverhead += newEntrySize;
-            stats.memOverhead->fetch_add(newEntrySize);
-            if (stats.memOverhead->load() >= GIGANTOR) {
-                LOG(EXTENSION_LOG_WARNING,
-                    "Checkpoint::queueDirty: stats.memOverhead (which is %" PRId64
-                    ") is greater than %" PRId64, uint64_t(stats.memOverhead->load()),
-                    uint64_t(GIGANTOR));
+            if (qi->getKey().size() > 0) {
+                keyIndex.insert(qi->getKey(),
+                                {(--toWrite.end()).getPosition(),
+                                 qi->getBySeqno()});
             }
         }
     }
 
+    updateMemOverhead(previousSize);
+
     // Notify flusher if in case queued item is a checkpoint meta item or
     // vbpersist state.
     if (qi->getOperation() == queue_op::checkpoint_start ||
@@ -267,9 +289,33 @@ const StoredDocKey Checkpoint::CheckpointStartKey("checkpoint_start", DocNamespa
 const StoredDocKey Checkpoint::CheckpointEndKey("checkpoint_end", DocNamespace::System);
 const StoredDocKey Checkpoint::SetVBucketStateKey("set_vbucket_state", DocNamespace::System);
 
+int64_t Checkpoint::insertAfterCheckpointStart(const queued_item& qi) {
+    // Skip the first two meta items (empty & checkpoint start). They're
+    // moved one position to the left by the insert, so their index entries
+    // must be looked up first (the index reads the key from the queue).
+    auto* dummy = metaKeyIndex.find(Checkpoint::DummyKey);
+    auto* start = metaKeyIndex.find(Checkpoint::CheckpointStartKey);
+    const auto pos = toWrite.insertAfterHead(2, qi);
+    --dummy->position;
+    --start->position;
+    return pos.getPosition();
+}
+
+void Checkpoint::compactQueue(CheckpointManager& checkpointManager) {
+    const auto map = toWrite.compact();
+    keyIndex.updatePositions(map);
+    metaKeyIndex.updatePositions(map);
+    for (auto& cursor : checkpointManager.connCursors) {
+        if ((*(cursor.second.currentCheckpoint)).get() == this) {
+            cursor.second.currentPos =
+                    toWrite.at(map(cursor.second.currentPos.getPosition()));
+        }
+    }
+}
+
 size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
     size_t numNewItems = 0;
-    size_t newEntryMemOverhead = 0;
+    const auto previousSize = memorySize();
 
     LOG(EXTENSION_LOG_INFO,
         "Collapse the checkpoint %" PRIu64 " into the checkpoint %" PRIu64
@@ -278,11 +324,11 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
 
     CheckpointQueue::iterator itr = toWrite.begin();
     uint64_t seqno = pPrevCheckpoint->getMutationIdForKey(Checkpoint::DummyKey, true);
-    metaKeyIndex[Checkpoint::DummyKey].mutation_id = seqno;
+    metaKeyIndex.find(Checkpoint::DummyKey)->mutation_id = seqno;
     (*itr)->setBySeqno(seqno);
 
     seqno = pPrevCheckpoint->getMutationIdForKey(Checkpoint::CheckpointStartKey, true);
-    metaKeyIndex[Checkpoint::CheckpointStartKey].mutation_id = seqno;
+    metaKeyIndex.find(Checkpoint::CheckpointStartKey)->mutation_id = seqno;
     ++itr;
     (*itr)->setBySeqno(seqno);
 
@@ -297,17 +343,14 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
             // checkpoint if the key isn't already present (if it is already
             // present then it must be an older revision and hence we can
             // safely discard it).
-            if (keyIndex.find(key) == keyIndex.end()) {
-                // Skip the first two meta items (empty & checkpoint start).
-                auto pos = std::next(toWrite.begin(), 2);
-                toWrite.insert(pos, *rit);
-                index_entry entry = {
-                        --pos,
-                        static_cast<int64_t>(
-                                pPrevCheckpoint->getMutationIdForKey(key,
-                                                                     false))};
-                keyIndex[key] = entry;
-                newEntryMemOverhead += key.size() + sizeof(index_entry);
+            if (keyIndex.find(key) == nullptr) {
+                const auto pos = insertAfterCheckpointStart(*rit);
+                keyIndex.insert(
+                        key,
+                        {pos,
+                         static_cast<int64_t>(
+                                 pPrevCheckpoint->getMutationIdForKey(
+                                         key, false))});
                 ++numItems;
                 ++numNewItems;
 
@@ -339,14 +382,11 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
         case queue_op::set_vbucket_state:
         case queue_op::system_event:
             // Need to re-insert these into the correct place in the index.
-            if (metaKeyIndex.find(key) == metaKeyIndex.end()) {
-                // Skip the first two meta items (empty & checkpoint start).
-                auto pos = std::next(toWrite.begin(), 2);
-                toWrite.insert(pos, *rit);
+            if (metaKeyIndex.find(key) == nullptr) {
+                const auto pos = insertAfterCheckpointStart(*rit);
                 auto mutationId = static_cast<int64_t>(
                         pPrevCheckpoint->getMutationIdForKey(key, true));
-                metaKeyIndex[key] = {--pos, mutationId};
-                newEntryMemOverhead += key.size() + sizeof(index_entry);
+                metaKeyIndex.insert(key, {pos, mutationId});
                 ++numMetaItems;
                 ++numNewItems;
 
@@ -365,22 +405,17 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
      */
     setSnapshotStartSeqno(getLowSeqno());
 
-    memOverhead += newEntryMemOverhead;
-    stats.memOverhead->fetch_add(newEntryMemOverhead);
-    LOG(EXTENSION_LOG_WARNING,
-        "Checkpoint::mergePrevCheckpoint: stats.memOverhead (which is %" PRId64
-        ") is greater than %" PRId64, uint64_t(stats.memOverhead->load()),
-        uint64_t(GIGANTOR));
+    updateMemOverhead(previousSize);
     return numNewItems;
 }
 
 uint64_t Checkpoint::getMutationIdForKey(const DocKey& key, bool isMeta) {
     uint64_t mid = 0;
-    checkpoint_index& chkIdx = isMeta ? metaKeyIndex : keyIndex;
+    const CheckpointIndex& chkIdx = isMeta ? metaKeyIndex : keyIndex;
 
-    checkpoint_index::iterator it = chkIdx.find(key);
-    if (it != chkIdx.end()) {
-        mid = it->second.mutation_id;
+    const auto* it = chkIdx.find(key);
+    if (it != nullptr) {
+        mid = it->mutation_id;
     } else {
         throw std::invalid_argument("key{" +
                                     std::string(reinterpret_cast<const char*>(key.data())) +
@@ -431,6 +466,8 @@ CheckpointManager::CheckpointManager(EPStats& st,
       lastBySeqno(lastSeqno),
       isCollapsedCheckpoint(false),
       pCursorPreCheckpointId(0),
+      publishedVersion(0),
+      pCursorDrainedVersion(0),
       flusherCB(cb) {
     LockHolder lh(queueLock);
     addNewCheckpoint_UNLOCKED(1, lastSnapStart, lastSnapEnd);
@@ -469,6 +506,7 @@ uint64_t CheckpointManager::getLastClosedCheckpointId() {
 
 void CheckpointManager::setOpenCheckpointId_UNLOCKED(uint64_t id) {
     if (!checkpointList.empty()) {
+        bumpPublishedVersion_UNLOCKED();
         // Update the checkpoint_start item with the new Id.
         const auto ckpt_start = ++(checkpointList.back()->begin());
         (*ckpt_start)->setRevSeqno(id);
@@ -535,6 +573,7 @@ bool CheckpointManager::addNewCheckpoint_UNLOCKED(uint64_t id,
     checkpoint->queueDirty(qi, this);
     ++numItems;
     checkpointList.push_back(std::move(checkpoint));
+    bumpPublishedVersion_UNLOCKED();
 
     if (was_empty) {
         return true;
@@ -599,6 +638,7 @@ bool CheckpointManager::closeOpenCheckpoint_UNLOCKED() {
     checkpointList.back()->queueDirty(qi, this);
     ++numItems;
     checkpointList.back()->setState(CHECKPOINT_CLOSED);
+    bumpPublishedVersion_UNLOCKED();
     return true;
 }
 
@@ -626,6 +666,7 @@ CursorRegResult CheckpointManager::registerCursorBySeqno(
         throw std::logic_error("CheckpointManager::registerCursorBySeqno: "
                         "checkpointList is empty");
     }
+    bumpPublishedVersion_UNLOCKED();
     if (checkpointList.back()->getHighSeqno() < startBySeqno) {
         throw std::invalid_argument("CheckpointManager::registerCursorBySeqno:"
                         " startBySeqno (which is " +
@@ -717,6 +758,7 @@ bool CheckpointManager::registerCursor_UNLOCKED(
         throw std::logic_error("CheckpointManager::registerCursor_UNLOCKED: "
                         "checkpointList is empty");
     }
+    bumpPublishedVersion_UNLOCKED();
 
     bool resetOnCollapse = true;
     if (name.compare(pCursorName) == 0) {
@@ -971,6 +1013,11 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
     }
     unrefCheckpointList.splice(unrefCheckpointList.begin(), checkpointList,
                                checkpointList.begin(), it);
+    if (numCheckpointsRemoved > 0) {
+        // Cursor offsets have moved; a new open checkpoint has already
+        // published itself via addNewCheckpoint_UNLOCKED.
+        bumpPublishedVersion_UNLOCKED();
+    }
 
     // If any cursor on a replica vbucket or downstream active vbucket
     // receiving checkpoints from
@@ -1084,6 +1131,8 @@ void CheckpointManager::collapseClosedCheckpoints(
         }
         collapsedChks.splice(collapsedChks.end(), checkpointList,
                              checkpointList.begin(),  lastClosedChk);
+        // Slow cursors have been repositioned into the collapsed checkpoint.
+        bumpPublishedVersion_UNLOCKED();
     }
 }
 
@@ -1136,7 +1185,35 @@ bool CheckpointManager::queueDirty(
         const GenerateCas generateCas,
         PreLinkDocumentContext* preLinkDocumentContext) {
     LockHolder lh(queueLock);
+    const bool ret = queueDirty_UNLOCKED(
+            lh, vb, qi, generateBySeqno, generateCas, preLinkDocumentContext);
+    bumpPublishedVersion_UNLOCKED();
+    return ret;
+}
+
+bool CheckpointManager::queueDirty(VBucket& vb,
+                                   std::vector<queued_item>& items) {
+    if (items.empty()) {
+        return false;
+    }
+
+    LockHolder lh(queueLock);
+    bool ret = false;
+    for (auto& qi : items) {
+        ret |= queueDirty_UNLOCKED(
+                lh, vb, qi, GenerateBySeqno::No, GenerateCas::No, nullptr);
+    }
+    bumpPublishedVersion_UNLOCKED();
+    return ret;
+}
 
+bool CheckpointManager::queueDirty_UNLOCKED(
+        const LockHolder& lh,
+        VBucket& vb,
+        queued_item& qi,
+        const GenerateBySeqno generateBySeqno,
+        const GenerateCas generateCas,
+        PreLinkDocumentContext* preLinkDocumentContext) {
     bool canCreateNewCheckpoint = false;
     if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
         (checkpointList.size() == checkpointConfig.getMaxCheckpoints() &&
@@ -1222,6 +1299,7 @@ void CheckpointManager::queueSetVBState(VBucket& vb) {
                                             queue_op::set_vbucket_state);
 
     auto result = checkpointList.back()->queueDirty(item, this);
+    bumpPublishedVersion_UNLOCKED();
 
     if (result == NEW_ITEM) {
         ++numItems;
@@ -1237,6 +1315,9 @@ snapshot_range_t CheckpointManager::getAllItemsForCursor(
                                              const std::string& name,
                                              std::vector<queued_item> &items) {
     LockHolder lh(queueLock);
+    // Nothing may be published while we hold the lock, so all items up to
+    // this version are drained below.
+    const auto version = publishedVersion.load(std::memory_order_relaxed);
     snapshot_range_t range;
     cursor_index::iterator it = connCursors.find(name);
     if (it == connCursors.end()) {
@@ -1257,6 +1338,10 @@ snapshot_range_t CheckpointManager::getAllItemsForCursor(
     }
     range.end = (*it->second.currentCheckpoint)->getSnapshotEndSeqno();
 
+    if (name == pCursorName) {
+        pCursorDrainedVersion.store(version, std::memory_order_release);
+    }
+
     LOG(EXTENSION_LOG_DEBUG, "CheckpointManager::getAllItemsForCursor() "
             "cursor:%s range:{%" PRIu64 ", %" PRIu64 "}",
             name.c_str(), range.start, range.end);
@@ -1343,6 +1428,7 @@ void CheckpointManager::clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno)
 }
 
 void CheckpointManager::resetCursors(bool resetPersistenceCursor) {
+    bumpPublishedVersion_UNLOCKED();
     for (auto& cit : connCursors) {
         if (cit.second.name.compare(pCursorName) == 0) {
             if (!resetPersistenceCursor) {
@@ -1475,6 +1561,7 @@ void CheckpointManager::decrCursorFromCheckpointEnd(const std::string &name) {
         (*(it->second.currentPos))->getOperation() ==
         queue_op::checkpoint_end) {
         it->second.decrPos();
+        bumpPublishedVersion_UNLOCKED();
     }
 }
 
@@ -1600,6 +1687,8 @@ void CheckpointManager::checkAndAddNewCheckpoint(uint64_t id,
     if (id == 0) {
         return;
     }
+    bumpPublishedVersion_UNLOCKED();
+
     // If the replica receives a checkpoint start message right after backfill
     // completion, simply set the current open checkpoint id to the one
     // received from the active vbucket.
@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include "callbacks.h"
+#include "checkpoint_queue.h"
 #include "ep_types.h"
 #include "item.h"
 #include "monotonic.h"
@@ -59,18 +60,6 @@ enum checkpoint_state {
 
 const char* to_string(enum checkpoint_state);
 
-// List is used for queueing mutations as vector incurs shift operations for
-// deduplication.
-typedef std::list<queued_item> CheckpointQueue;
-
-/**
- * A checkpoint index entry.
- */
-struct index_entry {
-    CheckpointQueue::iterator position;
-    int64_t mutation_id;
-};
-
 /**
  * Flag indicating that we must send checkpoint end meta item for the cursor
  */
@@ -79,11 +68,6 @@ enum class MustSendCheckpointEnd {
     YES
 };
 
-/**
- * The checkpoint index maps a key to a checkpoint index_entry.
- */
-typedef std::unordered_map<StoredDocKey, index_entry> checkpoint_index;
-
 /**
  * List of pairs containing checkpoint cursor name and corresponding flag
  * indicating whether we must send checkpoint end meta item for the cursor
@@ -506,8 +490,10 @@ public:
      * accounted separately in "ep_kv_size" stat.
      * @return memory overhead of this checkpoint instance.
      */
-    size_t memorySize() {
-        return sizeof(Checkpoint) + memOverhead;
+    size_t memorySize() const {
+        return sizeof(Checkpoint) + toWrite.getMemoryOverhead() +
+               keyIndex.getMemoryOverhead() +
+               metaKeyIndex.getMemoryOverhead();
     }
 
     /**
@@ -556,6 +542,26 @@ public:
     static const StoredDocKey SetVBucketStateKey;
 
 private:
+    /**
+     * Insert an item right after the checkpoint_start item (used when
+     * merging the previous checkpoint into this one)
+     *
+     * @return the position of the inserted item
+     */
+    int64_t insertAfterCheckpointStart(const queued_item& qi);
+
+    /**
+     * Compact the queue of items, updating the indexes and the positions of
+     * the cursors in this checkpoint.
+     */
+    void compactQueue(CheckpointManager& checkpointManager);
+
+    /**
+     * Update the global memory overhead with the change in memorySize()
+     * since it was the provided value
+     */
+    void updateMemOverhead(size_t previousSize);
+
     EPStats                       &stats;
     uint64_t                       checkpointId;
     uint64_t                       snapStartSeqno;
@@ -569,10 +575,9 @@ private:
     size_t numMetaItems;
     std::set<std::string>          cursors; // List of cursors with their unique names.
     CheckpointQueue                toWrite;
-    checkpoint_index               keyIndex;
+    CheckpointIndex                keyIndex;
     /* Index for meta keys like "dummy_key" */
-    checkpoint_index               metaKeyIndex;
-    size_t                         memOverhead;
+    CheckpointIndex                metaKeyIndex;
 
     // The following stat is to contain the memory consumption of all
     // the queued items in the given checkpoint.
@@ -586,6 +591,15 @@ typedef std::pair<uint64_t, bool> CursorRegResult;
 /**
  * Representation of a checkpoint manager that maintains the list of checkpoints
  * for a given vbucket.
+ *
+ * The checkpoint list, the cursors and the items are all guarded by the
+ * queueLock; that includes reading items for a cursor, as de-duplication in
+ * queueDirty (and the queue compaction following it) rewrites the slots
+ * cursors walk and moves every cursor positioned past them. What readers can
+ * do without the lock is check the published version (see
+ * getPublishedVersion()) to find out if there is anything new to read at all,
+ * so the flusher and idle DCP streams polling their cursors don't contend
+ * with the front end threads queueing items.
  */
 class CheckpointManager {
     friend class Checkpoint;
@@ -703,6 +717,17 @@ public:
                     const GenerateCas generateCas,
                     PreLinkDocumentContext* preLinkDocumentContext);
 
+    /**
+     * Queue a batch of items (which already have their seqno and CAS
+     * assigned, e.g. mutations received from a replication stream) to be
+     * written to persistent layer. The queueLock is only acquired once for
+     * the whole batch.
+     * @param vb the vbucket that the items are pushed into.
+     * @param items the items to queue (in seqno order).
+     * @return true if the size of the persistence queue increased.
+     */
+    bool queueDirty(VBucket& vb, std::vector<queued_item>& items);
+
     /*
      * Queue writing of the VBucket's state to persistent layer.
      * @param vb the vbucket that a new item is pushed into.
@@ -855,6 +880,31 @@ public:
         return ++lastBySeqno;
     }
 
+    /**
+     * Get the version of the checkpoints as published to the cursors. The
+     * version is bumped (with release semantics, while holding the
+     * queueLock) by every operation which may make more items available to
+     * a cursor; queueing items, adding / collapsing checkpoints and
+     * (re)positioning cursors.
+     *
+     * A reader which loads the version before draining its cursor with
+     * getAllItemsForCursor() may later compare it with the current version
+     * without taking the queueLock. If it is unchanged nothing was
+     * published for the cursor to read in the meantime.
+     */
+    uint64_t getPublishedVersion() const {
+        return publishedVersion.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Check (without taking the queueLock) if anything was published since
+     * the persistence cursor was last drained by getAllItemsForCursor().
+     */
+    bool hasNewItemsForPersistence() const {
+        return getPublishedVersion() !=
+               pCursorDrainedVersion.load(std::memory_order_acquire);
+    }
+
     void dump() const;
 
     static const std::string pCursorName;
@@ -904,6 +954,13 @@ private:
 
     size_t getNumItemsForCursor_UNLOCKED(const std::string &name) const;
 
+    bool queueDirty_UNLOCKED(const LockHolder& lh,
+                             VBucket& vb,
+                             queued_item& qi,
+                             const GenerateBySeqno generateBySeqno,
+                             const GenerateCas generateCas,
+                             PreLinkDocumentContext* preLinkDocumentContext);
+
     void clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno);
 
     /**
@@ -960,6 +1017,15 @@ private:
      */
     size_t getNumOfMetaItemsFromCursor(const CheckpointCursor &cursor) const;
 
+    /**
+     * Bump the published version (see getPublishedVersion()). Must be called
+     * with the queueLock held by every operation which may make more items
+     * available to a cursor.
+     */
+    void bumpPublishedVersion_UNLOCKED() {
+        publishedVersion.fetch_add(1, std::memory_order_release);
+    }
+
     EPStats                 &stats;
     CheckpointConfig        &checkpointConfig;
     mutable std::mutex       queueLock;
@@ -975,6 +1041,11 @@ private:
     uint64_t                 pCursorPreCheckpointId;
     cursor_index             connCursors;
 
+    // Version bumped every time items are made available to the cursors
+    std::atomic<uint64_t>    publishedVersion;
+    // The published version when the persistence cursor was last drained
+    std::atomic<uint64_t>    pCursorDrainedVersion;
+
     FlusherCallback          flusherCB;
 
     friend std::ostream& operator<<(std::ostream& os, const CheckpointManager& m);
@@ -0,0 +1,243 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "checkpoint_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+const size_t CheckpointQueue::ChunkSize;
+
+void CheckpointQueue::push_back(const queued_item& qi) {
+    if (size_t(tail - chunkBase) == chunks.size() * ChunkSize) {
+        chunks.emplace_back(new Chunk);
+    }
+    slot(tail) = qi;
+    ++tail;
+    ++numItems;
+}
+
+void CheckpointQueue::pop_back() {
+    if (empty()) {
+        throw std::logic_error("CheckpointQueue::pop_back: queue is empty");
+    }
+    erase(--end());
+}
+
+void CheckpointQueue::erase(iterator pos) {
+    auto& item = slot(pos.getPosition());
+    if (!item) {
+        throw std::logic_error(
+                "CheckpointQueue::erase: no item at position " +
+                std::to_string(pos.getPosition()));
+    }
+    item.reset();
+    --numItems;
+
+    // Trim empty slots at either end so that begin() and --end() always
+    // refer to an item
+    while (tail > head && !slot(tail - 1)) {
+        --tail;
+    }
+    while (head < tail && !slot(head)) {
+        ++head;
+    }
+}
+
+CheckpointQueue::iterator CheckpointQueue::insertAfterHead(
+        size_t headSize, const queued_item& qi) {
+    if (size_t(tail - head) < headSize) {
+        throw std::logic_error(
+                "CheckpointQueue::insertAfterHead: queue is too small");
+    }
+
+    if (head == chunkBase) {
+        chunks.emplace_front(new Chunk);
+        chunkBase -= ChunkSize;
+    }
+
+    --head;
+    for (size_t ii = 0; ii < headSize; ++ii) {
+        slot(head + ii) = std::move(slot(head + ii + 1));
+    }
+    slot(head + headSize) = qi;
+    ++numItems;
+
+    return at(head + headSize);
+}
+
+int64_t CheckpointQueue::PositionMap::operator()(int64_t position) const {
+    const auto it =
+            std::lower_bound(positions.begin(), positions.end(), position);
+    return head + (it - positions.begin());
+}
+
+CheckpointQueue::PositionMap CheckpointQueue::compact() {
+    PositionMap map;
+    map.head = head;
+    map.positions.reserve(numItems);
+
+    int64_t to = head;
+    for (int64_t from = head; from < tail; ++from) {
+        auto& item = slot(from);
+        if (item) {
+            map.positions.push_back(from);
+            if (from != to) {
+                slot(to) = item;
+                item.reset();
+            }
+            ++to;
+        }
+    }
+    tail = to;
+
+    // Free the chunks after the last item and before the first one
+    const size_t used = (size_t(tail - chunkBase) + ChunkSize - 1) / ChunkSize;
+    while (chunks.size() > used) {
+        chunks.pop_back();
+    }
+    while (!chunks.empty() && size_t(head - chunkBase) >= ChunkSize) {
+        chunks.pop_front();
+        chunkBase += ChunkSize;
+    }
+
+    return map;
+}
+
+/// Compare the key of the queued item with the provided key
+static bool keyEquals(const queued_item& qi, const DocKey& key) {
+    const auto& itemKey = qi->getKey();
+    return itemKey.size() == key.size() &&
+           itemKey.getDocNamespace() == key.getDocNamespace() &&
+           std::memcmp(itemKey.data(), key.data(), key.size()) == 0;
+}
+
+CheckpointIndex::CheckpointIndex(const CheckpointQueue& queue)
+    : queue(queue) {
+}
+
+size_t CheckpointIndex::lookup(const DocKey& key, uint32_t hash) const {
+    const size_t mask = slots.size() - 1;
+    for (size_t ii = home(hash);; ii = (ii + 1) & mask) {
+        const auto& s = slots[ii];
+        if (!s.used) {
+            return ii;
+        }
+        if (s.hash == hash && keyEquals(*queue.at(s.entry.position), key)) {
+            return ii;
+        }
+    }
+}
+
+CheckpointIndex::Entry* CheckpointIndex::find(const DocKey& key) {
+    return const_cast<Entry*>(
+            static_cast<const CheckpointIndex*>(this)->find(key));
+}
+
+const CheckpointIndex::Entry* CheckpointIndex::find(const DocKey& key) const {
+    if (numEntries == 0) {
+        return nullptr;
+    }
+    const auto& s = slots[lookup(key, key.hash())];
+    if (!s.used) {
+        return nullptr;
+    }
+    return &s.entry;
+}
+
+CheckpointIndex::Entry& CheckpointIndex::insert(const DocKey& key,
+                                                const Entry& entry) {
+    // Keep the load factor below 50% to keep the probe sequences short
+    if ((numEntries + 1) * 2 > slots.size()) {
+        grow();
+    }
+
+    const auto hash = key.hash();
+    auto& s = slots[lookup(key, hash)];
+    if (!s.used) {
+        s.used = true;
+        s.hash = hash;
+        ++numEntries;
+    }
+    s.entry = entry;
+    return s.entry;
+}
+
+void CheckpointIndex::updatePositions(
+        const CheckpointQueue::PositionMap& map) {
+    // The key of an entry isn't needed (its hash is stored), so the entries
+    // can be updated in place without any lookups.
+    for (auto& s : slots) {
+        if (s.used) {
+            s.entry.position = map(s.entry.position);
+        }
+    }
+}
+
+bool CheckpointIndex::erase(const DocKey& key) {
+    if (numEntries == 0) {
+        return false;
+    }
+
+    size_t ii = lookup(key, key.hash());
+    if (!slots[ii].used) {
+        return false;
+    }
+
+    // Backward shift deletion; move any following entries in the probe
+    // sequence which would no longer be reachable into the hole.
+    const size_t mask = slots.size() - 1;
+    for (;;) {
+        slots[ii].used = false;
+        size_t jj = ii;
+        for (;;) {
+            jj = (jj + 1) & mask;
+            if (!slots[jj].used) {
+                --numEntries;
+                return true;
+            }
+            const auto kk = home(slots[jj].hash);
+            // The entry may stay where it is if its home slot is
+            // (cyclically) in the range (ii, jj]
+            const bool reachable = (ii <= jj) ? (ii < kk && kk <= jj)
+                                              : (ii < kk || kk <= jj);
+            if (!reachable) {
+                break;
+            }
+        }
+        slots[ii] = slots[jj];
+        ii = jj;
+    }
+}
+
+void CheckpointIndex::grow() {
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.resize(old.empty() ? 8 : old.size() * 2, Slot{{0, 0}, 0, false});
+
+    const size_t mask = slots.size() - 1;
+    for (const auto& s : old) {
+        if (s.used) {
+            size_t ii = home(s.hash);
+            while (slots[ii].used) {
+                ii = (ii + 1) & mask;
+            }
+            slots[ii] = s;
+        }
+    }
+}
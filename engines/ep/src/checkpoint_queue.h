@@ -0,0 +1,372 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "item.h"
+
+#include <memcached/dockey.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/**
+ * The queue of items in a Checkpoint.
+ *
+ * Items are stored in fixed size chunks of slots which are allocated as
+ * the queue grows (and never moved), so queueing an item normally doesn't
+ * allocate any memory at all (unlike a std::list which needs a node per
+ * item).
+ *
+ * Every slot has a logical position which never changes for the lifetime
+ * of the queue, which means that iterators (and the positions stored in
+ * the CheckpointIndex) stay valid while items are appended. When an item
+ * is removed (de-duplicated) its slot is cleared instead of shifting the
+ * following items, and the iterators skip the empty slots. Once most of the
+ * slots are empty (see needsCompaction()) the owner compacts the queue,
+ * which moves the items together and updates every position with the
+ * returned PositionMap.
+ *
+ * The only operation which moves items is insertAfterHead(), which is used
+ * when merging checkpoints to insert items after the first items in the
+ * queue (the "empty" and "checkpoint_start" items). It grows the queue at
+ * the front and moves the head items one slot to the left, leaving the
+ * positions of all other items untouched.
+ */
+class CheckpointQueue {
+public:
+    /// The number of slots in each chunk
+    static const size_t ChunkSize = 64;
+
+    /// Maps positions from before a compact() to the positions after it
+    class PositionMap {
+    public:
+        /**
+         * @return the new position of the item which was at the given
+         *         position (or, for an empty slot, of the next item)
+         */
+        int64_t operator()(int64_t position) const;
+
+    private:
+        friend class CheckpointQueue;
+
+        int64_t head = 0;
+        /// The previous positions of the items, in order
+        std::vector<int64_t> positions;
+    };
+
+    template <class Queue, class Value>
+    class Iterator : public std::iterator<std::bidirectional_iterator_tag,
+                                          Value> {
+    public:
+        Iterator() = default;
+
+        Iterator(Queue* queue, int64_t position)
+            : queue(queue), position(position) {
+        }
+
+        /// Allow conversion from iterator to const_iterator
+        template <class Q, class V>
+        Iterator(const Iterator<Q, V>& other)
+            : queue(other.getQueue()), position(other.getPosition()) {
+        }
+
+        Value& operator*() const {
+            return queue->slot(position);
+        }
+
+        Value* operator->() const {
+            return &queue->slot(position);
+        }
+
+        Iterator& operator++() {
+            do {
+                ++position;
+            } while (position < queue->tail && !queue->slot(position));
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto ret = *this;
+            ++(*this);
+            return ret;
+        }
+
+        Iterator& operator--() {
+            do {
+                --position;
+            } while (position > queue->head && !queue->slot(position));
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto ret = *this;
+            --(*this);
+            return ret;
+        }
+
+        template <class Q, class V>
+        bool operator==(const Iterator<Q, V>& other) const {
+            return position == other.getPosition() &&
+                   queue == other.getQueue();
+        }
+
+        template <class Q, class V>
+        bool operator!=(const Iterator<Q, V>& other) const {
+            return !(*this == other);
+        }
+
+        Queue* getQueue() const {
+            return queue;
+        }
+
+        /// The logical (stable) position of the item in the queue
+        int64_t getPosition() const {
+            return position;
+        }
+
+    private:
+        Queue* queue = nullptr;
+        int64_t position = 0;
+    };
+
+    using iterator = Iterator<CheckpointQueue, queued_item>;
+    using const_iterator = Iterator<const CheckpointQueue, const queued_item>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    CheckpointQueue() = default;
+    CheckpointQueue(const CheckpointQueue&) = delete;
+    CheckpointQueue& operator=(const CheckpointQueue&) = delete;
+
+    iterator begin() {
+        return {this, head};
+    }
+
+    const_iterator begin() const {
+        return {this, head};
+    }
+
+    iterator end() {
+        return {this, tail};
+    }
+
+    const_iterator end() const {
+        return {this, tail};
+    }
+
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    /// Get an iterator for the item at the given (logical) position
+    iterator at(int64_t position) {
+        return {this, position};
+    }
+
+    const_iterator at(int64_t position) const {
+        return {this, position};
+    }
+
+    bool empty() const {
+        return numItems == 0;
+    }
+
+    /// The number of items in the queue
+    size_t size() const {
+        return numItems;
+    }
+
+    queued_item& back() {
+        return *(--end());
+    }
+
+    /// Append an item to the queue
+    void push_back(const queued_item& qi);
+
+    /// Remove the last item in the queue
+    void pop_back();
+
+    /**
+     * Remove the item at the given position (its slot is cleared; no other
+     * items are moved)
+     */
+    void erase(iterator pos);
+
+    /**
+     * Insert an item after the first headSize items in the queue. The head
+     * items are moved one position to the left, so the caller must update
+     * any positions referring to them (and no iterators may point to them).
+     *
+     * @param headSize the number of items to insert after (they must be
+     *                 stored in consecutive slots)
+     * @param qi the item to insert
+     * @return an iterator to the inserted item
+     */
+    iterator insertAfterHead(size_t headSize, const queued_item& qi);
+
+    /**
+     * @return true if so many slots have been emptied by erase() that the
+     *         queue should be compacted
+     */
+    bool needsCompaction() const {
+        const size_t emptySlots = size_t(tail - head) - numItems;
+        return emptySlots >= ChunkSize && emptySlots > numItems;
+    }
+
+    /**
+     * Move the items together (keeping their order) to remove the empty
+     * slots, freeing any chunks which are no longer used. This changes the
+     * positions of the items; the caller must update all positions (and
+     * iterators) referring to the queue using the returned map.
+     */
+    PositionMap compact();
+
+    /// The memory used by the queue (excluding the items themselves)
+    size_t getMemoryOverhead() const {
+        return chunks.size() * sizeof(Chunk);
+    }
+
+private:
+    struct Chunk {
+        std::array<queued_item, ChunkSize> slots;
+    };
+
+    queued_item& slot(int64_t position) {
+        const auto offset = size_t(position - chunkBase);
+        return chunks[offset / ChunkSize]->slots[offset % ChunkSize];
+    }
+
+    const queued_item& slot(int64_t position) const {
+        const auto offset = size_t(position - chunkBase);
+        return chunks[offset / ChunkSize]->slots[offset % ChunkSize];
+    }
+
+    /// The allocated chunks (in order)
+    std::deque<std::unique_ptr<Chunk>> chunks;
+
+    /// The logical position of the first slot in the first chunk
+    int64_t chunkBase = 0;
+
+    /// The position of the first item (all items are in [head, tail))
+    int64_t head = 0;
+
+    /// The position after the last item
+    int64_t tail = 0;
+
+    /// The number of items in the queue (excluding empty slots)
+    size_t numItems = 0;
+};
+
+/**
+ * An open addressing (linear probing) hash index mapping a key to the
+ * position of its item in a CheckpointQueue (and the mutation id it was
+ * queued with).
+ *
+ * The index doesn't store a copy of the key; the key is read from the item
+ * in the queue when comparing, so every entry is only a couple of words
+ * and inserting a key never allocates memory (except for when the table
+ * grows).
+ *
+ * The position of an entry must always refer to an item with the same key
+ * in the queue, so an entry must be updated (or erased) before the item
+ * it refers to is removed from the queue.
+ */
+class CheckpointIndex {
+public:
+    struct Entry {
+        /// The position of the item in the queue
+        int64_t position;
+        int64_t mutation_id;
+    };
+
+    explicit CheckpointIndex(const CheckpointQueue& queue);
+
+    /**
+     * Look up the key
+     *
+     * @return the entry for the key, or nullptr if the key isn't in the
+     *         index (the pointer is invalidated by the next insert/erase)
+     */
+    Entry* find(const DocKey& key);
+
+    const Entry* find(const DocKey& key) const;
+
+    /**
+     * Insert (or update) the entry for the key
+     *
+     * @return the entry in the index (invalidated by the next
+     *         insert/erase)
+     */
+    Entry& insert(const DocKey& key, const Entry& entry);
+
+    /// Update the position of every entry after the queue was compacted
+    void updatePositions(const CheckpointQueue::PositionMap& map);
+
+    /**
+     * Remove the key from the index
+     *
+     * @return true if the key was in the index
+     */
+    bool erase(const DocKey& key);
+
+    size_t size() const {
+        return numEntries;
+    }
+
+    /// The memory used by the index
+    size_t getMemoryOverhead() const {
+        return slots.capacity() * sizeof(Slot);
+    }
+
+private:
+    struct Slot {
+        Entry entry;
+        uint32_t hash;
+        bool used;
+    };
+
+    /// Get the index of the slot the key is in (or the empty slot it
+    /// should be inserted into)
+    size_t lookup(const DocKey& key, uint32_t hash) const;
+
+    void grow();
+
+    size_t home(uint32_t hash) const {
+        return hash & (slots.size() - 1);
+    }
+
+    const CheckpointQueue& queue;
+    std::vector<Slot> slots;
+    size_t numEntries = 0;
+};
@@ -20,8 +20,13 @@
 #include "collections/manifest.h"
 #include "ep_engine.h"
 #include "kv_bucket.h"
+#include "statwriter.h"
 #include "vbucket.h"
 
+#include <platform/checked_snprintf.h>
+
+#include <map>
+
 Collections::Manager::Manager() {
 }
 
@@ -94,6 +99,43 @@ Collections::Filter Collections::Manager::makeFilter(
     return Collections::Filter(jsonFilter, current.get());
 }
 
+void Collections::Manager::addStats(KVBucket& bucket,
+                                    const void* cookie,
+                                    ADD_STAT add_stat) const {
+    // Replicas hold copies of the same items, so only count active vbuckets.
+    std::map<std::string, Collections::VB::CollectionStatsSnapshot> totals;
+    for (int i = 0; i < bucket.getVBuckets().getSize(); i++) {
+        auto vb = bucket.getVBuckets().getBucket(i);
+        if (vb && vb->getState() == vbucket_state_active) {
+            vb->collectionStats.visit(
+                    [&totals](cb::const_char_buffer collection,
+                              const Collections::VB::CollectionStats& stats) {
+                        totals[cb::to_string(collection)] += stats;
+                    });
+        }
+    }
+
+    const int bsize = 1024;
+    char buffer[bsize];
+    auto addStat = [&](const std::string& collection,
+                       const char* stat,
+                       auto value) {
+        checked_snprintf(buffer, bsize, "%s:%s", collection.c_str(), stat);
+        add_casted_stat(buffer, value, add_stat, cookie);
+    };
+    for (const auto& entry : totals) {
+        const auto& total = entry.second;
+        addStat(entry.first, "items", total.items);
+        addStat(entry.first, "mem_used", total.memUsed);
+        addStat(entry.first, "disk_bytes_written", total.diskBytesWritten);
+        addStat(entry.first, "ops_store", total.opsStore);
+        addStat(entry.first, "ops_delete", total.opsDelete);
+        addStat(entry.first, "ops_get", total.opsGet);
+        addStat(entry.first, "expired", total.expired);
+        addStat(entry.first, "evicted", total.evicted);
+    }
+}
+
 // This method is really to aid development and allow the dumping of the VB
 // collection data to the logs.
 void Collections::Manager::logAll(KVBucket& bucket) const {
@@ -76,6 +76,14 @@ public:
     Collections::Filter makeFilter(uint32_t dcpOpenFlags,
                                    cb::const_byte_buffer jsonExtra) const;
 
+    /**
+     * Add the per-collection counters, summed over the bucket's active
+     * vbuckets, as "<collection>:<stat>".
+     */
+    void addStats(KVBucket& bucket,
+                  const void* cookie,
+                  ADD_STAT add_stat) const;
+
     /**
      * For development, log as much collections stuff as we can
      */
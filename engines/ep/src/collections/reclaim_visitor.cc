@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "collections/reclaim_visitor.h"
+#include "collections/collections_dockey.h"
+#include "collections/collections_types.h"
+
+#include "vbucket.h"
+
+void Collections::ReclaimVisitor::setDeadline(
+        ProcessClock::time_point deadline) {
+    progressTracker.setDeadline(deadline);
+}
+
+void Collections::ReclaimVisitor::setCurrentVBucket(VBucket& vb) {
+    currentVb = &vb;
+    auto rh = vb.lockCollections();
+    deleting = rh.getDeletingCollections();
+    separator = rh.getSeparator();
+}
+
+bool Collections::ReclaimVisitor::visit(const HashTable::HashBucketLock& lh,
+                                        StoredValue& v) {
+    visited_count++;
+
+    if (!v.isTempItem() && !v.isDeleted() && !v.isDirty() &&
+        isLogicallyDeleted(v)) {
+        reclaimed_bytes += v.size();
+        reclaimed_count++;
+        // Releases v.
+        currentVb->ht.unlocked_del(lh, v.getKey());
+    }
+
+    // See if we have done enough work for this chunk. If so
+    // stop visiting (for now).
+    return progressTracker.shouldContinueVisiting(visited_count);
+}
+
+bool Collections::ReclaimVisitor::isLogicallyDeleted(
+        const StoredValue& v) const {
+    if (deleting.empty()) {
+        return false;
+    }
+
+    cb::const_char_buffer collection;
+    switch (v.getKey().getDocNamespace()) {
+    case DocNamespace::DefaultCollection:
+        collection = DefaultCollectionIdentifier;
+        break;
+    case DocNamespace::Collections:
+        collection = Collections::DocKey::make(v.getKey(), separator)
+                             .getCollection();
+        break;
+    case DocNamespace::System:
+        return false;
+    }
+
+    for (const auto& entry : deleting) {
+        if (collection == cb::const_char_buffer{entry.first.data(),
+                                                entry.first.size()}) {
+            return v.getBySeqno() <= entry.second;
+        }
+    }
+    return false;
+}
+
+void Collections::ReclaimVisitor::clearStats() {
+    visited_count = 0;
+    reclaimed_count = 0;
+    reclaimed_bytes = 0;
+}
+
+size_t Collections::ReclaimVisitor::getVisitedCount() const {
+    return visited_count;
+}
+
+size_t Collections::ReclaimVisitor::getReclaimedCount() const {
+    return reclaimed_count;
+}
+
+size_t Collections::ReclaimVisitor::getReclaimedBytes() const {
+    return reclaimed_bytes;
+}
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "hash_table.h"
+#include "progress_tracker.h"
+#include "vb_visitors.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Collections {
+
+/**
+ * Visits the HashTables of a persistent bucket, releasing the StoredValues
+ * of collections which are being deleted.
+ *
+ * Only clean items are released - they are on disk, where the compaction
+ * eraser will find them, and the read paths already treat them as deleted.
+ * Dirty items are left for the flusher (whose callbacks need the
+ * StoredValue to account for the item) and are released by a later pass.
+ */
+class ReclaimVisitor : public VBucketAwareHTVisitor {
+public:
+    // Set the deadline at which point the visitor will pause visiting.
+    void setDeadline(ProcessClock::time_point deadline_);
+
+    // Implementation of HashTableVisitor interface:
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
+
+    void setCurrentVBucket(VBucket& vb) override;
+
+    // Resets any held stats to zero.
+    void clearStats();
+
+    // Returns the number of documents that have been visited.
+    size_t getVisitedCount() const;
+
+    // Returns the number of documents released from memory.
+    size_t getReclaimedCount() const;
+
+    // Returns the memory (StoredValue bytes) released.
+    size_t getReclaimedBytes() const;
+
+private:
+    /// Is v an item of a collection the current vBucket is deleting?
+    bool isLogicallyDeleted(const StoredValue& v) const;
+
+    // The VBucket whose HashTable is being visited.
+    VBucket* currentVb = nullptr;
+
+    /**
+     * The collections the current vBucket is deleting, and its separator.
+     * Copied from the manifest when moving to the vBucket, as the manifest
+     * lock cannot be taken while a hash bucket lock is held.
+     */
+    std::vector<std::pair<std::string, int64_t>> deleting;
+    std::string separator;
+
+    // Estimates how far we have got, and when we should pause.
+    ProgressTracker progressTracker;
+
+    /* Statistics */
+    size_t visited_count = 0;
+    size_t reclaimed_count = 0;
+    size_t reclaimed_bytes = 0;
+};
+
+} // end namespace Collections
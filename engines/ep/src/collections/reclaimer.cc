@@ -0,0 +1,195 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "collections/reclaimer.h"
+#include "collections/reclaim_visitor.h"
+
+#include <phosphor/phosphor.h>
+
+#include "ep_engine.h"
+#include "executorpool.h"
+#include "kv_bucket.h"
+#include "kvstore.h"
+
+#include <algorithm>
+
+Collections::ReclaimerTask::ReclaimerTask(EventuallyPersistentEngine* e,
+                                          EPStats& stats_)
+    : GlobalTask(e,
+                 TaskId::CollectionsReclaimerTask,
+                 // First run after one interval, rather than competing with
+                 // the other tasks started with the bucket.
+                 e->getConfiguration().getCollectionsReclaimerInterval() /
+                         1000.0,
+                 false),
+      stats(stats_),
+      epstore_position(engine->getKVBucket()->startPosition()) {
+}
+
+bool Collections::ReclaimerTask::run() {
+    TRACE_EVENT0("ep-engine/task", "CollectionsReclaimerTask");
+    if (engine->getConfiguration().isCollectionsPrototypeEnabled() &&
+        checkDeletingCollections() > 0) {
+        // Get our pause/resume visitor. If we didn't finish the previous pass,
+        // then resume from where we last were, otherwise create a new visitor
+        // starting from the beginning.
+        if (!prAdapter) {
+            prAdapter = std::make_unique<PauseResumeVBAdapter>(
+                    std::make_unique<ReclaimVisitor>());
+            epstore_position = engine->getKVBucket()->startPosition();
+        }
+
+        // Prepare the underlying visitor.
+        auto& visitor = getReclaimVisitor();
+        const auto start = ProcessClock::now();
+        visitor.setDeadline(start + getChunkDuration());
+        visitor.clearStats();
+
+        // Do it - set off the visitor.
+        epstore_position = engine->getKVBucket()->pauseResumeVisit(
+                *prAdapter, epstore_position);
+        const auto end = ProcessClock::now();
+
+        // Update stats
+        stats.collectionsItemsReclaimed.fetch_add(visitor.getReclaimedCount());
+        stats.collectionsBytesReclaimed.fetch_add(visitor.getReclaimedBytes());
+
+        // Check if the visitor completed a full pass.
+        bool completed = (epstore_position ==
+                          engine->getKVBucket()->endPosition());
+
+        std::stringstream ss;
+        ss << to_string(getDescription()) << " for bucket '"
+           << engine->getName() << "'";
+        if (completed) {
+            ss << " finished pass.";
+        } else {
+            ss << " paused at position " << epstore_position << ".";
+        }
+        std::chrono::microseconds duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                      start);
+        ss << " Took " << duration.count() << " us."
+           << " reclaimed " << visitor.getReclaimedCount() << "/"
+           << visitor.getVisitedCount() << " visited documents, releasing "
+           << visitor.getReclaimedBytes() << " bytes.";
+        LOG(EXTENSION_LOG_DEBUG, "%s", ss.str().c_str());
+
+        // Delete(reset) visitor if it finished.
+        if (completed) {
+            prAdapter.reset();
+        }
+    } else {
+        // Nothing (left) to reclaim, the next deletion starts a new pass.
+        prAdapter.reset();
+    }
+
+    snooze(getSleepTime());
+    if (engine->getEpStats().isShutdown) {
+        return false;
+    }
+    return true;
+}
+
+size_t Collections::ReclaimerTask::checkDeletingCollections() {
+    auto* bucket = engine->getKVBucket();
+    // The compaction eraser is only implemented by couch-kvstore.
+    const bool canCompact =
+            engine->getConfiguration().getBackend() == "couchdb";
+    size_t pending = 0;
+
+    for (auto vbid : bucket->getVBuckets().getBuckets()) {
+        auto vb = bucket->getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+
+        int64_t endSeqno = 0;
+        size_t deleting = 0;
+        {
+            auto collections = vb->lockCollections().getDeletingCollections();
+            deleting = collections.size();
+            for (const auto& collection : collections) {
+                endSeqno = std::max(endSeqno, collection.second);
+            }
+        }
+
+        if (deleting == 0) {
+            compactedEndSeqno.erase(vbid);
+            continue;
+        }
+        pending += deleting;
+
+        // The eraser completes a deletion when it meets the collection's
+        // delete event, so wait until that has been persisted.
+        if (!canCompact || vb->getPersistenceSeqno() < uint64_t(endSeqno) ||
+            compactedEndSeqno[vbid] >= endSeqno) {
+            continue;
+        }
+
+        compaction_ctx c;
+        c.purge_before_ts = 0;
+        c.purge_before_seq = 0;
+        c.drop_deletes = 0;
+        c.db_file_id = vbid;
+        if (bucket->scheduleCompaction(vbid, c, nullptr) ==
+            ENGINE_EWOULDBLOCK) {
+            compactedEndSeqno[vbid] = endSeqno;
+            ++stats.collectionsReclaimCompactions;
+            LOG(EXTENSION_LOG_NOTICE,
+                "collections: vb:%" PRIu16
+                " scheduled compaction to erase collections deleted at or "
+                "below seqno:%" PRId64,
+                vbid,
+                endSeqno);
+        }
+    }
+
+    stats.collectionsPendingDeletes.store(pending);
+    return pending;
+}
+
+void Collections::ReclaimerTask::stop() {
+    if (uid) {
+        ExecutorPool::get()->cancel(uid);
+    }
+}
+
+cb::const_char_buffer Collections::ReclaimerTask::getDescription() {
+    return "Collections Reclaimer";
+}
+
+std::chrono::microseconds Collections::ReclaimerTask::maxExpectedDuration() {
+    // Each chunk is constrained by the chunk duration, but allow the same
+    // headroom as the defragmenter for the ProgressTracker's estimates.
+    return getChunkDuration() * 10;
+}
+
+double Collections::ReclaimerTask::getSleepTime() const {
+    return engine->getConfiguration().getCollectionsReclaimerInterval() /
+           1000.0;
+}
+
+std::chrono::milliseconds Collections::ReclaimerTask::getChunkDuration()
+        const {
+    return std::chrono::milliseconds(
+            engine->getConfiguration().getCollectionsReclaimerChunkDuration());
+}
+
+Collections::ReclaimVisitor& Collections::ReclaimerTask::getReclaimVisitor() {
+    return dynamic_cast<ReclaimVisitor&>(prAdapter->getHTVisitor());
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "globaltask.h"
+#include "kv_bucket_iface.h"
+
+#include <unordered_map>
+
+class EPStats;
+class PauseResumeVBAdapter;
+
+namespace Collections {
+
+class ReclaimVisitor;
+
+/**
+ * Task responsible for reclaiming the resources of dropped collections in a
+ * persistent bucket.
+ *
+ * Dropping a collection is O(1) for the front-end - the collection's end
+ * seqno is recorded in the vBucket manifest, and the front-end and DCP
+ * backfills treat every item of the collection at or below that seqno as
+ * deleted. The items themselves are only removed from disk when compaction
+ * runs the collections eraser, which also completes the deletion. This task
+ * makes sure that happens promptly and that memory is released meanwhile:
+ *
+ * 1. Once a vBucket has persisted the deletion of its collections, a
+ *    compaction of the vBucket is scheduled (couchstore only; the
+ *    compaction rewrites the file so the dropped items are simply not
+ *    copied across).
+ *
+ * 2. While any collection is being deleted, the HashTables are walked in
+ *    chunks of at most collections_reclaimer_chunk_duration ms (like the
+ *    DefragmenterTask) releasing the dropped collections' clean items.
+ */
+class ReclaimerTask : public GlobalTask {
+public:
+    ReclaimerTask(EventuallyPersistentEngine* e, EPStats& stats_);
+
+    bool run() override;
+
+    void stop();
+
+    cb::const_char_buffer getDescription() override;
+
+    std::chrono::microseconds maxExpectedDuration() override;
+
+private:
+    /**
+     * Find the collections being deleted in each vBucket, scheduling a
+     * compaction of the vBuckets which have persisted their deletions.
+     *
+     * @return the number of collections being deleted, over all vBuckets.
+     */
+    size_t checkDeletingCollections();
+
+    /// Duration (in seconds) the reclaimer should sleep between chunks.
+    double getSleepTime() const;
+
+    // Upper limit on how long each chunk can run for, before being paused.
+    std::chrono::milliseconds getChunkDuration() const;
+
+    /// Returns the underlying ReclaimVisitor instance.
+    ReclaimVisitor& getReclaimVisitor();
+
+    /// Reference to EP stats, used to record progress.
+    EPStats& stats;
+
+    /**
+     * The highest collection end seqno a compaction has been scheduled for,
+     * per vBucket, so each deletion only triggers one compaction.
+     */
+    std::unordered_map<uint16_t, int64_t> compactedEndSeqno;
+
+    // Opaque marker indicating how far through the epStore we have visited.
+    KVBucketIface::Position epstore_position;
+
+    /**
+     * Visitor adapter which supports pausing & resuming (records how far
+     * though a VBucket is has got). unique_ptr as we re-create it for each
+     * complete pass.
+     */
+    std::unique_ptr<PauseResumeVBAdapter> prAdapter;
+};
+
+} // end namespace Collections
@@ -252,6 +252,7 @@ void Manifest::completeDeletion(::VBucket& vb,
 
     if (se == SystemEvent::DeleteCollectionHard) {
         map.erase(itr); // wipe out
+        vb.collectionStats.erase(collection);
     }
 
     nDeletingCollections--;
@@ -291,6 +292,7 @@ void Manifest::changeSeparator(::VBucket& vb,
         // Change the separator then queue the event so the new separator
         // is recorded in the serialised manifest
         separator = std::string(newSeparator.data(), newSeparator.size());
+        vb.collectionStats.setSeparator(newSeparator);
 
         // Queue an event so that the manifest is flushed and DCP can
         // replicate the change.
@@ -408,6 +410,21 @@ bool Manifest::isLogicallyDeleted(const container::const_iterator entry,
     return false;
 }
 
+std::vector<std::pair<std::string, int64_t>>
+Manifest::getDeletingCollections() const {
+    std::vector<std::pair<std::string, int64_t>> deleting;
+    if (nDeletingCollections == 0) {
+        return deleting;
+    }
+    for (const auto& entry : map) {
+        if (entry.second->isDeleting()) {
+            deleting.emplace_back(entry.second->getCollectionName(),
+                                  entry.second->getEndSeqno());
+        }
+    }
+    return deleting;
+}
+
 boost::optional<cb::const_char_buffer> Manifest::shouldCompleteDeletion(
         const ::DocKey& key) const {
     // If this is a SystemEvent key then...
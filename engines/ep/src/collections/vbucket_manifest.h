@@ -29,6 +29,7 @@
 
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 class VBucket;
 
@@ -148,6 +149,14 @@ public:
             return manifest.exists(collection);
         }
 
+        /**
+         * @return the name and end seqno of each collection being deleted
+         */
+        std::vector<std::pair<std::string, int64_t>> getDeletingCollections()
+                const {
+            return manifest.getDeletingCollections();
+        }
+
         /**
          * Dump the manifest to std::cerr
          */
@@ -589,6 +598,14 @@ private:
         return map.count(collection) > 0;
     }
 
+    /**
+     * @return the name and end seqno of each collection being deleted. Items
+     *         of such a collection with a seqno up to its end seqno are
+     *         logically deleted.
+     */
+    std::vector<std::pair<std::string, int64_t>> getDeletingCollections()
+            const;
+
     container::const_iterator end() const {
         return map.end();
     }
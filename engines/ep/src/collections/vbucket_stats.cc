@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "collections/vbucket_stats.h"
+#include "collections/collections_dockey.h"
+#include "collections/collections_types.h"
+
+#include <platform/make_unique.h>
+
+#include <mutex>
+
+namespace Collections {
+namespace VB {
+
+CollectionStatsSnapshot& CollectionStatsSnapshot::operator+=(
+        const CollectionStats& s) {
+    items += s.items;
+    memUsed += s.memUsed;
+    diskBytesWritten += s.diskBytesWritten;
+    opsStore += s.opsStore;
+    opsDelete += s.opsDelete;
+    opsGet += s.opsGet;
+    expired += s.expired;
+    evicted += s.evicted;
+    return *this;
+}
+
+StatsMap::StatsMap(ItemCounting counting)
+    : counting(counting), separator(DefaultSeparator) {
+}
+
+template <class Update>
+void StatsMap::apply(const ::DocKey& key, Update update) {
+    switch (key.getDocNamespace()) {
+    case DocNamespace::DefaultCollection:
+        update(defaultCollection);
+        return;
+    case DocNamespace::System:
+        return;
+    case DocNamespace::Collections:
+        break;
+    }
+
+    {
+        std::lock_guard<cb::ReaderLock> rlh(lock.reader());
+        auto itr = map.find(getCollection(key));
+        if (itr != map.end()) {
+            update(itr->second->stats);
+            return;
+        }
+    }
+
+    // First update of this collection; the separator may have changed since
+    // the read lock was released so the key is parsed again.
+    std::lock_guard<cb::WriterLock> wlh(lock.writer());
+    const auto collection = getCollection(key);
+    auto itr = map.find(collection);
+    if (itr == map.end()) {
+        auto entry = std::make_unique<Entry>(collection);
+        cb::const_char_buffer name{entry->name.data(), entry->name.size()};
+        itr = map.emplace(name, std::move(entry)).first;
+    }
+    update(itr->second->stats);
+}
+
+void StatsMap::setSeparator(cb::const_char_buffer newSeparator) {
+    std::lock_guard<cb::WriterLock> wlh(lock.writer());
+    separator.assign(newSeparator.data(), newSeparator.size());
+}
+
+void StatsMap::updateMemory(const ::DocKey& key,
+                            int64_t memDelta,
+                            int64_t itemsDelta) {
+    if (counting != ItemCounting::HashTable) {
+        itemsDelta = 0;
+    }
+    apply(key, [memDelta, itemsDelta](CollectionStats& s) {
+        s.memUsed += memDelta;
+        s.items += itemsDelta;
+    });
+}
+
+void StatsMap::evicted(const ::DocKey& key,
+                       int64_t memDelta,
+                       int64_t itemsDelta) {
+    if (counting != ItemCounting::HashTable) {
+        itemsDelta = 0;
+    }
+    apply(key, [memDelta, itemsDelta](CollectionStats& s) {
+        s.memUsed += memDelta;
+        s.items += itemsDelta;
+        ++s.evicted;
+    });
+}
+
+void StatsMap::stored(const ::DocKey& key) {
+    apply(key, [](CollectionStats& s) { ++s.opsStore; });
+}
+
+void StatsMap::deleted(const ::DocKey& key) {
+    apply(key, [](CollectionStats& s) { ++s.opsDelete; });
+}
+
+void StatsMap::read(const ::DocKey& key) {
+    apply(key, [](CollectionStats& s) { ++s.opsGet; });
+}
+
+void StatsMap::expired(const ::DocKey& key) {
+    apply(key, [](CollectionStats& s) { ++s.expired; });
+}
+
+void StatsMap::flushed(const ::DocKey& key, size_t bytes) {
+    apply(key, [bytes](CollectionStats& s) { s.diskBytesWritten += bytes; });
+}
+
+void StatsMap::persisted(const ::DocKey& key, int64_t itemsDelta) {
+    if (counting != ItemCounting::Disk) {
+        return;
+    }
+    apply(key, [itemsDelta](CollectionStats& s) { s.items += itemsDelta; });
+}
+
+void StatsMap::resetMemory() {
+    defaultCollection.items = 0;
+    defaultCollection.memUsed = 0;
+    std::lock_guard<cb::ReaderLock> rlh(lock.reader());
+    for (auto& entry : map) {
+        entry.second->stats.items = 0;
+        entry.second->stats.memUsed = 0;
+    }
+}
+
+void StatsMap::erase(cb::const_char_buffer collection) {
+    std::lock_guard<cb::WriterLock> wlh(lock.writer());
+    map.erase(collection);
+}
+
+CollectionStatsSnapshot StatsMap::get(cb::const_char_buffer collection) const {
+    CollectionStatsSnapshot snapshot;
+    if (collection == DefaultCollectionIdentifier) {
+        snapshot += defaultCollection;
+        return snapshot;
+    }
+
+    std::lock_guard<cb::ReaderLock> rlh(lock.reader());
+    auto itr = map.find(collection);
+    if (itr != map.end()) {
+        snapshot += itr->second->stats;
+    }
+    return snapshot;
+}
+
+void StatsMap::visit(const Visitor& visitor) const {
+    visitor(DefaultCollectionIdentifier, defaultCollection);
+    std::lock_guard<cb::ReaderLock> rlh(lock.reader());
+    for (const auto& entry : map) {
+        visitor(entry.first, entry.second->stats);
+    }
+}
+
+cb::const_char_buffer StatsMap::getCollection(const ::DocKey& key) const {
+    return Collections::DocKey::make(key, separator).getCollection();
+}
+
+} // end namespace VB
+} // end namespace Collections
@@ -0,0 +1,179 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <memcached/dockey.h>
+#include <platform/rwlock.h>
+#include <platform/sized_buffer.h>
+#include <relaxed_atomic.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Collections {
+namespace VB {
+
+/**
+ * The counters kept for one collection of a vBucket.
+ */
+struct CollectionStats {
+    /// Alive items; see StatsMap::ItemCounting for where they are counted.
+    Couchbase::RelaxedAtomic<int64_t> items{0};
+    /// Memory used by the collection's StoredValues in the HashTable.
+    Couchbase::RelaxedAtomic<int64_t> memUsed{0};
+    /// Bytes of the collection's mutations and deletions flushed to disk.
+    Couchbase::RelaxedAtomic<uint64_t> diskBytesWritten{0};
+    Couchbase::RelaxedAtomic<uint64_t> opsStore{0};
+    Couchbase::RelaxedAtomic<uint64_t> opsDelete{0};
+    Couchbase::RelaxedAtomic<uint64_t> opsGet{0};
+    Couchbase::RelaxedAtomic<uint64_t> expired{0};
+    Couchbase::RelaxedAtomic<uint64_t> evicted{0};
+};
+
+/**
+ * A plain copy of a CollectionStats, for reading and aggregating.
+ */
+struct CollectionStatsSnapshot {
+    CollectionStatsSnapshot& operator+=(const CollectionStats& s);
+
+    int64_t items = 0;
+    int64_t memUsed = 0;
+    uint64_t diskBytesWritten = 0;
+    uint64_t opsStore = 0;
+    uint64_t opsDelete = 0;
+    uint64_t opsGet = 0;
+    uint64_t expired = 0;
+    uint64_t evicted = 0;
+};
+
+/**
+ * Collections::VB::StatsMap holds the per-collection counters of a vBucket,
+ * which are maintained incrementally by the HashTable (items, memory,
+ * evictions), the front-end (ops, expiries) and the flusher (disk bytes), so
+ * that the collections stats can be read without visiting any items.
+ *
+ * The StatsMap is keyed by collection name, which is taken from each key
+ * using the manifest's separator. It does not need the manifest itself, so
+ * it can be updated with a HashTable bucket lock held; its own lock is
+ * always the last to be taken. The separator may only change when the
+ * vBucket has no collections other than the default collection, so a key is
+ * never counted against two different collections.
+ *
+ * Counters of the default collection are kept outside of the map so that
+ * buckets which don't use collections only pay for the atomic updates.
+ */
+class StatsMap {
+public:
+    using Visitor =
+            std::function<void(cb::const_char_buffer, const CollectionStats&)>;
+
+    /// What the items counter of each collection counts.
+    enum class ItemCounting {
+        /// Alive (non-deleted, non-temporary) items in the HashTable, as
+        /// every alive item is resident under value eviction.
+        HashTable,
+        /// Alive items persisted to disk, maintained by the flusher, as under
+        /// full eviction an item may have been ejected from the HashTable.
+        Disk
+    };
+
+    explicit StatsMap(ItemCounting counting = ItemCounting::HashTable);
+
+    /// Set the separator used to find the collection of a key.
+    void setSeparator(cb::const_char_buffer newSeparator);
+
+    /// Account for a StoredValue added to, or changed in, the HashTable.
+    void updateMemory(const ::DocKey& key,
+                      int64_t memDelta,
+                      int64_t itemsDelta);
+
+    /// Account for a StoredValue (or its value) being ejected from memory.
+    void evicted(const ::DocKey& key, int64_t memDelta, int64_t itemsDelta);
+
+    void stored(const ::DocKey& key);
+
+    void deleted(const ::DocKey& key);
+
+    void read(const ::DocKey& key);
+
+    void expired(const ::DocKey& key);
+
+    void flushed(const ::DocKey& key, size_t bytes);
+
+    /**
+     * Account for an alive item being created (+1) or removed (-1) on disk.
+     * Only counted when the items are counted on disk.
+     */
+    void persisted(const ::DocKey& key, int64_t itemsDelta);
+
+    /**
+     * Zero the in-memory counters (items and memory) of every collection,
+     * for when the HashTable is cleared.
+     */
+    void resetMemory();
+
+    /**
+     * Drop the counters of a collection which has been fully deleted from
+     * the vBucket.
+     */
+    void erase(cb::const_char_buffer collection);
+
+    /// @return a copy of a collection's counters (zero if it has none).
+    CollectionStatsSnapshot get(cb::const_char_buffer collection) const;
+
+    /// Call visitor with the counters of every collection which has any.
+    void visit(const Visitor& visitor) const;
+
+private:
+    struct Entry {
+        explicit Entry(cb::const_char_buffer collection)
+            : name(collection.data(), collection.size()) {
+        }
+
+        const std::string name;
+        CollectionStats stats;
+    };
+
+    /**
+     * Apply update to the counters of key's collection, creating them if
+     * this is the collection's first update. System keys are not counted.
+     */
+    template <class Update>
+    void apply(const ::DocKey& key, Update update);
+
+    /// The collection name of a key in the Collections namespace.
+    cb::const_char_buffer getCollection(const ::DocKey& key) const;
+
+    const ItemCounting counting;
+
+    CollectionStats defaultCollection;
+
+    /// Guards the separator and the map (not the counters, which are atomic).
+    mutable cb::RWLock lock;
+    std::string separator;
+
+    /// Keyed by buffers referring to Entry::name.
+    std::unordered_map<cb::const_char_buffer, std::unique_ptr<Entry>> map;
+};
+
+} // end namespace VB
+} // end namespace Collections
@@ -20,12 +20,18 @@
 #include "common.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "kvstore.h"
+#include "token_bucket.h"
 
 #include <platform/histogram.h>
 
+#include <thread>
+
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
-    FileStats& stats, FileOpsInterface& base_ops) {
-    return std::unique_ptr<FileOpsInterface>(new StatsOps(stats, base_ops));
+        FileStats& stats,
+        FileOpsInterface& base_ops,
+        std::shared_ptr<TokenBucket> throttle) {
+    return std::unique_ptr<FileOpsInterface>(
+            new StatsOps(stats, base_ops, std::move(throttle)));
 }
 
 StatsOps::StatFile::StatFile(FileOpsInterface* _orig_ops,
@@ -97,6 +103,7 @@ ssize_t StatsOps::pread(couchstore_error_info_t* errinfo,
         stats.readSeekHisto.add(std::abs(off - sf->last_offs));
     }
     sf->last_offs = off;
+    throttleIO(sz);
     BlockTimer bt(&stats.readTimeHisto);
     ssize_t result = sf->orig_ops->pread(errinfo, sf->orig_handle, buf,
                                          sz, off);
@@ -114,6 +121,7 @@ ssize_t StatsOps::pwrite(couchstore_error_info_t*errinfo,
                          cs_off_t off) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
     stats.writeSizeHisto.add(sz);
+    throttleIO(sz);
     BlockTimer bt(&stats.writeTimeHisto);
     ssize_t result = sf->orig_ops->pwrite(errinfo, sf->orig_handle, buf,
                                           sz, off);
@@ -124,6 +132,18 @@ ssize_t StatsOps::pwrite(couchstore_error_info_t*errinfo,
     return result;
 }
 
+void StatsOps::throttleIO(size_t bytes) {
+    if (!throttle) {
+        return;
+    }
+    const auto wait = throttle->consume(bytes);
+    if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+        stats.throttleWaitHisto.add(wait);
+        stats.totalThrottleWaitUs += wait.count();
+    }
+}
+
 cs_off_t StatsOps::goto_eof(couchstore_error_info_t* errinfo,
                             couch_file_handle h) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
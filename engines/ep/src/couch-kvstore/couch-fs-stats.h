@@ -26,13 +26,20 @@
 #include <platform/histogram.h>
 
 struct FileStats;
+class TokenBucket;
 
 /**
  * Returns an instance of StatsOps from a FileStats reference and
- * a reference to a base FileOps implementation to wrap
+ * a reference to a base FileOps implementation to wrap.
+ *
+ * If a throttle is given, every read and write takes its size in bytes from
+ * it and sleeps for however long the throttle requests, limiting the combined
+ * throughput of all StatsOps sharing that throttle.
  */
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
-    FileStats& stats, FileOpsInterface& base_ops);
+        FileStats& stats,
+        FileOpsInterface& base_ops,
+        std::shared_ptr<TokenBucket> throttle = {});
 
 /**
  * FileOpsInterface implementation which records various statistics
@@ -40,9 +47,11 @@ std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
  */
 class StatsOps : public FileOpsInterface {
 public:
-    StatsOps(FileStats& _stats, FileOpsInterface& ops)
-        : stats(_stats),
-          wrapped_ops(ops) {}
+    StatsOps(FileStats& _stats,
+             FileOpsInterface& ops,
+             std::shared_ptr<TokenBucket> _throttle = {})
+        : stats(_stats), wrapped_ops(ops), throttle(std::move(_throttle)) {
+    }
 
     couch_file_handle constructor(couchstore_error_info_t* errinfo) override ;
     couchstore_error_t open(couchstore_error_info_t* errinfo,
@@ -70,8 +79,12 @@ public:
     void destructor(couch_file_handle handle) override;
 
 protected:
+    /// Wait for the throttle (if any) to allow `bytes` of I/O.
+    void throttleIO(size_t bytes);
+
     FileStats& stats;
     FileOpsInterface& wrapped_ops;
+    std::shared_ptr<TokenBucket> throttle;
 
     struct StatFile : public FileOpsInterface::FHStats {
         StatFile(FileOpsInterface* _orig_ops,
@@ -31,7 +31,8 @@ protected:
      *
      * Each version extends the previous version, thus in memory you have
      * [V0] or
-     * [V0][V1].
+     * [V0][V1] or
+     * [V0][V1][V2][V3].
      */
     class MetaDataV0 {
     public:
@@ -187,22 +188,68 @@ static_assert(sizeof(MetaDataV1) == 2,
 static_assert(sizeof(MetaDataV2) == 1,
               "MetaDataV2 is not the expected size.");
 
+    class MetaDataV3 {
+    public:
+        MetaDataV3()
+            : compression(0)
+              {}
+
+        void initialise(const char* raw) {
+            compression = raw[0];
+        }
+
+        void setCompression(uint8_t compression) {
+            this->compression = compression;
+        }
+
+        uint8_t getCompression() const {
+            return compression;
+        }
+
+        void copyToBuf(char* raw) const {
+            raw[0] = compression;
+        }
+
+    private:
+        /*
+         * V3 is a 1 byte extension recording how ep-engine (rather than
+         * couchstore) compressed the document body. It is only written for
+         * documents which need it, always along with a (zero) V2 byte so the
+         * size cannot be confused with V2.
+         */
+        uint8_t compression;
+    };
+
+static_assert(sizeof(MetaDataV3) == 1,
+              "MetaDataV3 is not the expected size.");
+
 public:
 
     enum class Version {
         V0, // Cas/Exptime/Flags
         V1, // Flex code and datatype
-        V2  // Conflict Resolution Mode - not stored, but can be read
+        V2, // Conflict Resolution Mode - not stored, but can be read
+        V3  // Body compression - only stored for documents compressed by us
         /*
          * !!MetaData Warning!!
          * Sherlock began storing the V2 MetaData.
          * Watson stops storing the V2 MetaData (now storing V1)
          *
-         * Any new MetaData (e.g a V3) we wish to store may cause trouble if it
-         * has the size of V2, code assumes the version from the size.
+         * Any new MetaData we wish to store may cause trouble if it has the
+         * size of V2, code assumes the version from the size. V3 therefore
+         * includes a (zero) V2 byte.
          */
     };
 
+    /*
+     * How the document body was compressed by ep-engine before being
+     * handed to couchstore (stored in V3).
+     */
+    enum class Compression : uint8_t {
+        None = 0,
+        ZstdDictionary = 1 // zstd with a dictionary (see DictionaryCompressor)
+    };
+
     MetaData () {}
 
     /*
@@ -212,10 +259,10 @@ public:
     MetaData(const sized_buf& in)
         : initVersion(Version::V0) {
 
-        // Expect metadata to be V0, V1 or V2.
+        // Expect metadata to be V0, V1, V2 or V3.
         // V2 part is ignored, but valid to find in storage.
         if (in.size < getMetaDataSize(Version::V0)
-            || in.size > getMetaDataSize(Version::V2)) {
+            || in.size > getMetaDataSize(Version::V3)) {
             throw std::invalid_argument("MetaData::MetaData in.size \"" +
                                         std::to_string(in.size) +
                                         "\" is out of range.");
@@ -233,6 +280,11 @@ public:
         }
 
         // Not initialising V2 from 'in' as V2 is ignored.
+
+        if (in.size == getMetaDataSize(Version::V3)) {
+            allMeta.v3.initialise(in.buf + getMetaDataSize(Version::V2));
+            initVersion = Version::V3;
+        }
     }
 
     /*
@@ -240,7 +292,8 @@ public:
      * to a pre-allocated sized_buf ready for passing to couchstore.
      */
     void copyToBuf(sized_buf& out) const {
-        if (out.size != getMetaDataSize(Version::V1)) {
+        if (out.size != getMetaDataSize(Version::V1) &&
+            out.size != getMetaDataSize(Version::V3)) {
             throw std::invalid_argument("MetaData::copyToBuf out.size \"" +
                                         std::to_string(out.size) +
                                         "\" incorrect size.");
@@ -248,6 +301,10 @@ public:
         // Copy the V0/V1 meta data holders to the output buffer
         allMeta.v0.copyToBuf(out.buf);
         allMeta.v1.copyToBuf(out.buf + sizeof(MetaDataV0));
+        if (out.size == getMetaDataSize(Version::V3)) {
+            out.buf[sizeof(MetaDataV0) + sizeof(MetaDataV1)] = 0; // V2
+            allMeta.v3.copyToBuf(out.buf + getMetaDataSize(Version::V2));
+        }
     }
 
     /*
@@ -308,6 +365,14 @@ public:
         return allMeta.v1.getDataType();
     }
 
+    void setCompression(Compression compression) {
+        allMeta.v3.setCompression(static_cast<uint8_t>(compression));
+    }
+
+    Compression getCompression() const {
+        return static_cast<Compression>(allMeta.v3.getCompression());
+    }
+
     Version getVersionInitialisedFrom() const {
         return initVersion;
     }
@@ -323,9 +388,15 @@ public:
                 return sizeof(MetaDataV0) +
                        sizeof(MetaDataV1) +
                        sizeof(MetaDataV2);
+            case Version::V3:
+                return sizeof(MetaDataV0) +
+                       sizeof(MetaDataV1) +
+                       sizeof(MetaDataV2) +
+                       sizeof(MetaDataV3);
         }
 
-        return sizeof(MetaDataV0) + sizeof(MetaDataV1) + sizeof(MetaDataV2);
+        return sizeof(MetaDataV0) + sizeof(MetaDataV1) + sizeof(MetaDataV2) +
+               sizeof(MetaDataV3);
     }
 
 protected:
@@ -335,6 +406,7 @@ protected:
         MetaDataV0 v0;
         MetaDataV1 v1;
         MetaDataV2 v2;
+        MetaDataV3 v3;
 #pragma pack()
     } allMeta;
     Version initVersion;
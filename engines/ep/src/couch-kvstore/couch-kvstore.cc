@@ -30,6 +30,7 @@
 #include <algorithm>
 #include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <list>
@@ -45,6 +46,7 @@
 
 #include "common.h"
 #include "couch-kvstore/couch-kvstore.h"
+#include "dictionary_compressor.h"
 #include "ep_types.h"
 #include "kvstore_config.h"
 #include "statwriter.h"
@@ -69,15 +71,8 @@ extern "C" {
     }
 }
 
-struct kvstats_ctx {
-    kvstats_ctx(bool persistDocNamespace)
-        : persistDocNamespace(persistDocNamespace) {
-    }
-    /// A map of key to bool. If true, the key exists in the VB datafile
-    std::unordered_map<StoredDocKey, bool> keyStats;
-    /// Collections: When enabled this means persisted keys have namespaces
-    bool persistDocNamespace;
-};
+/// Values smaller than this are never compressed by persistence compression.
+static const size_t minCompressibleValueSize = 32;
 
 static std::string getStrError(Db *db) {
     const size_t max_msg_len = 256;
@@ -198,7 +193,8 @@ struct AllKeysCtx {
     uint32_t count;
 };
 
-couchstore_content_meta_flags CouchRequest::getContentMeta(const Item& it) {
+couchstore_content_meta_flags CouchCommitBatch::getContentMeta(
+        const Item& it) {
     couchstore_content_meta_flags rval;
 
     if (mcbp::datatype::is_json(it.getDataType())) {
@@ -215,30 +211,50 @@ couchstore_content_meta_flags CouchRequest::getContentMeta(const Item& it) {
     return rval;
 }
 
-CouchRequest::CouchRequest(const Item& it,
-                           uint64_t rev,
-                           MutationRequestCallback& cb,
-                           bool del,
-                           bool persistDocNamespace)
-    : IORequest(it.getVBucketId(), cb, del, it.getKey()),
-      value(it.getValue()),
-      fileRevNum(rev) {
-    // Collections: TODO: Temporary switch to ensure upgrades don't break.
-    if (persistDocNamespace) {
-        dbDoc.id = {const_cast<char*>(reinterpret_cast<const char*>(
-                            key.getDocNameSpacedData())),
-                    it.getKey().getDocNameSpacedSize()};
+/// Order document ids as couchstore does: bytewise, then shortest first.
+static bool idLess(const sized_buf& a, const sized_buf& b) {
+    const int cmp = std::memcmp(a.buf, b.buf, std::min(a.size, b.size));
+    return cmp < 0 || (cmp == 0 && a.size < b.size);
+}
+
+size_t CouchCommitBatch::appendToArena(const char* data, size_t size) {
+    const size_t offset = arena.size();
+    arena.insert(arena.end(), data, data + size);
+    return offset;
+}
+
+size_t CouchCommitBatch::add(const Item& it,
+                             MutationRequestCallback& cb,
+                             bool del) {
+    entries.emplace_back();
+    Entry& entry = entries.back();
+    entry.vbucketId = it.getVBucketId();
+    entry.deleted = del;
+    if (del) {
+        entry.callback.delCb = cb.delCb;
     } else {
-        dbDoc.id = {const_cast<char*>(key.c_str()), it.getKey().size()};
+        entry.callback.setCb = cb.setCb;
     }
+    entry.start = ProcessClock::now();
+    entry.value = it.getValue();
+    entry.existed = false;
+    entry.valueInArena = false;
+    entry.valueOffset = 0;
 
-    if (it.getNBytes()) {
-        dbDoc.data.buf = const_cast<char *>(value->getData());
-        dbDoc.data.size = it.getNBytes();
+    // Collections: TODO: Temporary switch to ensure upgrades don't break.
+    const auto& key = it.getKey();
+    entry.keySize = key.size();
+    if (persistDocNamespace) {
+        entry.idSize = key.getDocNameSpacedSize();
+        entry.idOffset = appendToArena(
+                reinterpret_cast<const char*>(key.getDocNameSpacedData()),
+                entry.idSize);
     } else {
-        dbDoc.data.buf = NULL;
-        dbDoc.data.size = 0;
+        entry.idSize = key.size();
+        entry.idOffset = appendToArena(key.c_str(), entry.idSize);
     }
+
+    MetaData meta;
     meta.setCas(it.getCas());
     meta.setFlags(it.getFlags());
     if (del) {
@@ -246,25 +262,162 @@ CouchRequest::CouchRequest(const Item& it,
     } else {
         meta.setExptime(it.getExptime());
     }
-
     meta.setDataType(it.getDataType());
 
-    dbDocInfo.db_seq = it.getBySeqno();
+    // Reserve room for the largest format so the metadata can be rewritten
+    // in place (see getMetaData() / compressValue()), but persist V1 unless
+    // the value ends up compressed.
+    entry.metaSize = MetaData::getMetaDataSize(MetaData::Version::V1);
+    entry.metaOffset = appendToArena(
+            meta.prepareAndGetForPersistence(),
+            MetaData::getMetaDataSize(MetaData::Version::V3));
+
+    entry.contentMeta = getContentMeta(it);
+    entry.bySeqno = it.getBySeqno();
+    entry.revSeqno = it.getRevSeqno();
+    entry.valueSize = it.getNBytes();
+
+    return entries.size() - 1;
+}
+
+bool CouchCommitBatch::compressValue(size_t index,
+                                     DictionaryCompressor& compressor) {
+    Entry& entry = entries[index];
+    const cb::const_char_buffer value{entry.value->getData(),
+                                      entry.valueSize};
+
+    // Compress straight into the arena, then give back what wasn't used.
+    const size_t offset = arena.size();
+    arena.resize(offset + DictionaryCompressor::compressBound(value.size()));
+    const size_t size = compressor.compress(value, arena.data() + offset);
+    if (size == 0) {
+        arena.resize(offset);
+        return false;
+    }
+    arena.resize(offset + size);
 
-    // Now allocate space to hold the meta and get it ready for storage
-    dbDocInfo.rev_meta.size = MetaData::getMetaDataSize(MetaData::Version::V1);
-    dbDocInfo.rev_meta.buf = meta.prepareAndGetForPersistence();
+    entry.valueInArena = true;
+    entry.valueOffset = offset;
+    entry.valueSize = size;
+    // couchstore must not snappy the (already compressed) body.
+    entry.contentMeta &= ~COUCH_DOC_IS_COMPRESSED;
 
-    dbDocInfo.rev_seq = it.getRevSeqno();
-    dbDocInfo.size = dbDoc.data.size;
+    sized_buf meta{arena.data() + entry.metaOffset,
+                   MetaData::getMetaDataSize(MetaData::Version::V1)};
+    MetaData metadata(meta);
+    metadata.setCompression(MetaData::Compression::ZstdDictionary);
+    meta.size = MetaData::getMetaDataSize(MetaData::Version::V3);
+    metadata.copyToBuf(meta);
+    entry.metaSize = meta.size;
 
-    if (del) {
-        dbDocInfo.deleted =  1;
-    } else {
-        dbDocInfo.deleted = 0;
+    dictionaryId = DictionaryCompressor::getDictionaryId({arena.data() + offset,
+                                                          size});
+    return true;
+}
+
+void CouchCommitBatch::prepare() {
+    docs.resize(entries.size());
+    docInfos.resize(entries.size());
+    sortedIndex.resize(entries.size());
+
+    for (size_t ii = 0; ii < entries.size(); ++ii) {
+        Entry& entry = entries[ii];
+        const sized_buf id = getId(entry);
+
+        entry.doc.id = id;
+        if (entry.valueInArena) {
+            entry.doc.data.buf = arena.data() + entry.valueOffset;
+            entry.doc.data.size = entry.valueSize;
+        } else if (entry.valueSize) {
+            entry.doc.data.buf = const_cast<char*>(entry.value->getData());
+            entry.doc.data.size = entry.valueSize;
+        } else {
+            entry.doc.data.buf = nullptr;
+            entry.doc.data.size = 0;
+        }
+
+        entry.docInfo = DocInfo();
+        entry.docInfo.id = id;
+        entry.docInfo.db_seq = entry.bySeqno;
+        entry.docInfo.rev_seq = entry.revSeqno;
+        entry.docInfo.rev_meta = {arena.data() + entry.metaOffset,
+                                  entry.metaSize};
+        entry.docInfo.deleted = entry.deleted ? 1 : 0;
+        entry.docInfo.content_meta = entry.contentMeta;
+        entry.docInfo.size = entry.doc.data.size;
+
+        if (entry.deleted && entry.value.get() == nullptr) {
+            docs[ii] = nullptr;
+        } else {
+            docs[ii] = &entry.doc;
+        }
+        docInfos[ii] = &entry.docInfo;
+        sortedIndex[ii] = ii;
+    }
+
+    std::sort(sortedIndex.begin(),
+              sortedIndex.end(),
+              [this](size_t a, size_t b) {
+                  return idLess(getId(entries[a]), getId(entries[b]));
+              });
+    sortedIds.resize(entries.size());
+    for (size_t ii = 0; ii < sortedIndex.size(); ++ii) {
+        sortedIds[ii] = getId(entries[sortedIndex[ii]]);
+    }
+}
+
+void CouchCommitBatch::markExisting(const sized_buf& id) {
+    auto range =
+            std::equal_range(sortedIds.begin(), sortedIds.end(), id, idLess);
+    for (auto it = range.first; it != range.second; ++it) {
+        entries[sortedIndex[it - sortedIds.begin()]].existed = true;
+    }
+}
+
+/**
+ * Replace the vector with an empty one with room for `size` elements, if its
+ * capacity is more than factor times that.
+ */
+template <class T>
+static void shrinkCapacity(std::vector<T>& vec, size_t size, size_t factor) {
+    if (vec.capacity() > size * factor) {
+        std::vector<T> shrunk;
+        shrunk.reserve(size);
+        vec.swap(shrunk);
+    }
+}
+
+void CouchCommitBatch::clear() {
+    recentMaxEntries = std::max(recentMaxEntries, entries.size());
+    recentMaxArena = std::max(recentMaxArena, arena.size());
+
+    entries.clear();
+    arena.clear();
+    docs.clear();
+    docInfos.clear();
+    sortedIndex.clear();
+    sortedIds.clear();
+    dictionaryId = 0;
+
+    if (++clearsSinceShrinkCheck == ShrinkCheckInterval) {
+        shrinkCapacity(entries, recentMaxEntries, ShrinkFactor);
+        shrinkCapacity(arena, recentMaxArena, ShrinkFactor);
+        shrinkCapacity(docs, recentMaxEntries, ShrinkFactor);
+        shrinkCapacity(docInfos, recentMaxEntries, ShrinkFactor);
+        shrinkCapacity(sortedIndex, recentMaxEntries, ShrinkFactor);
+        shrinkCapacity(sortedIds, recentMaxEntries, ShrinkFactor);
+        recentMaxEntries = 0;
+        recentMaxArena = 0;
+        clearsSinceShrinkCheck = 0;
     }
-    dbDocInfo.id = dbDoc.id;
-    dbDocInfo.content_meta = getContentMeta(it);
+}
+
+size_t CouchCommitBatch::getAllocatedSize() const {
+    return entries.capacity() * sizeof(Entry) + arena.capacity() +
+           docs.capacity() * sizeof(Doc*) +
+           docInfos.capacity() * sizeof(DocInfo*) +
+           sortedIndex.capacity() * sizeof(size_t) +
+           sortedIds.capacity() * sizeof(sized_buf);
 }
 
 CouchKVStore::CouchKVStore(KVStoreConfig& config)
@@ -280,6 +433,9 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
       dbname(config.getDBName()),
       dbFileRevMap(dbFileRevMap),
       fileRevMap(fileRevMapSize),
+      pendingReqsQ(config.shouldPersistDocNamespace()),
+      compressValues(config.getValueCompressor() &&
+                     config.getPersistenceCompressionMode() == "zstd"),
       intransaction(false),
       scanCounter(0),
       logger(config.getLogger()),
@@ -287,7 +443,7 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
     createDataDir(dbname);
     statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
     statCollectingFileOpsCompaction = getCouchstoreStatsOps(
-        st.fsStatsCompaction, base_ops);
+            st.fsStatsCompaction, base_ops, config.getCompactionThrottle());
 
     // init db file map with default revision number, 1
     numDbFiles = configuration.getMaxVBuckets();
@@ -299,6 +455,7 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
     cachedFileSize.assign(numDbFiles, Couchbase::RelaxedAtomic<uint64_t>(0));
     cachedSpaceUsed.assign(numDbFiles, Couchbase::RelaxedAtomic<uint64_t>(0));
     cachedVBStates.resize(numDbFiles);
+    persistedDictionary.assign(numDbFiles, 0);
 
     initialize();
 }
@@ -346,6 +503,13 @@ void CouchKVStore::initialize() {
         errorCode = openDB(id, rev, &db, COUCHSTORE_OPEN_FLAG_RDONLY);
         if (errorCode == COUCHSTORE_SUCCESS) {
             readVBState(db, id);
+            auto* compressor = configuration.getValueCompressor().get();
+            if (compressValues && !isReadOnly() &&
+                compressor->getCurrentDictionaryId() == 0) {
+                // Carry on with the dictionary in use before the restart
+                // rather than training a new one.
+                loadDictionary(*db, 0, *compressor, true);
+            }
             /* update stat */
             ++st.numLoadedVb;
             closeDatabaseHandle(db);
@@ -382,6 +546,7 @@ void CouchKVStore::reset(uint16_t vbucketId) {
         cachedDeleteCount[vbucketId] = 0;
         cachedFileSize[vbucketId] = 0;
         cachedSpaceUsed[vbucketId] = 0;
+        persistedDictionary[vbucketId] = 0;
 
         // Unlink the current revision and then increment it to ensure any
         // pending delete doesn't delete us. Note that the expectation is that
@@ -411,17 +576,21 @@ void CouchKVStore::set(const Item& itm,
 
     bool deleteItem = false;
     MutationRequestCallback requestcb;
-    uint64_t fileRev = dbFileRevMap[itm.getVBucketId()];
 
-    // each req will be de-allocated after commit
     requestcb.setCb = &cb;
-    CouchRequest* req =
-            new CouchRequest(itm,
-                             fileRev,
-                             requestcb,
-                             deleteItem,
-                             configuration.shouldPersistDocNamespace());
-    pendingReqsQ.push_back(req);
+    const size_t index = pendingReqsQ.add(itm, requestcb, deleteItem);
+
+    // Values the client already compressed are left alone, as are tiny
+    // ones which cannot win back the zstd frame overhead.
+    if (compressValues && itm.getNBytes() >= minCompressibleValueSize &&
+        !mcbp::datatype::is_snappy(itm.getDataType())) {
+        auto& compressor = *configuration.getValueCompressor();
+        if (compressor.getCurrentDictionaryId() == 0) {
+            compressor.addSample({itm.getData(), itm.getNBytes()});
+        } else {
+            pendingReqsQ.compressValue(index, compressor);
+        }
+    }
 }
 
 GetValue CouchKVStore::get(const DocKey& key, uint16_t vb, bool fetchDelete) {
@@ -577,16 +746,9 @@ void CouchKVStore::del(const Item& itm, Callback<TransactionContext, int>& cb) {
                         "true to perform a delete operation.");
     }
 
-    uint64_t fileRev = dbFileRevMap[itm.getVBucketId()];
     MutationRequestCallback requestcb;
     requestcb.delCb = &cb;
-    CouchRequest* req =
-            new CouchRequest(itm,
-                             fileRev,
-                             requestcb,
-                             true,
-                             configuration.shouldPersistDocNamespace());
-    pendingReqsQ.push_back(req);
+    pendingReqsQ.add(itm, requestcb, true);
 }
 
 void CouchKVStore::delVBucket(uint16_t vbucket, uint64_t fileRev) {
@@ -595,6 +757,7 @@ void CouchKVStore::delVBucket(uint16_t vbucket, uint64_t fileRev) {
                         "read-only object.");
     }
 
+    persistedDictionary[vbucket] = 0;
     unlinkCouchFile(vbucket, fileRev);
 }
 
@@ -666,6 +829,74 @@ static std::string getDBFileName(const std::string &dbname,
            std::to_string(rev);
 }
 
+/// Local document naming the file's current value compression dictionary.
+static const char zstdDictCurrentDoc[] = "_local/zstd_dict";
+
+/// Local document holding the value compression dictionary `dictId`.
+static std::string getDictionaryDocId(uint32_t dictId) {
+    return std::string(zstdDictCurrentDoc) + "/" + std::to_string(dictId);
+}
+
+static couchstore_error_t readLocalDoc(Db& db,
+                                       const std::string& id,
+                                       std::string& out) {
+    LocalDoc* ldoc = nullptr;
+    auto errCode = couchstore_open_local_document(
+            &db, (void*)id.data(), id.size(), &ldoc);
+    if (errCode == COUCHSTORE_SUCCESS) {
+        out.assign(ldoc->json.buf, ldoc->json.size);
+        couchstore_free_local_document(ldoc);
+    }
+    return errCode;
+}
+
+/**
+ * Register the value compression dictionary `dictId` stored in `db` (or,
+ * if dictId is 0, the file's current one) with `compressor`.
+ *
+ * @return the id of the dictionary loaded, or 0 if there was none.
+ */
+static uint32_t loadDictionary(Db& db,
+                               uint32_t dictId,
+                               DictionaryCompressor& compressor,
+                               bool makeCurrent) {
+    std::string body;
+    if (dictId == 0) {
+        if (readLocalDoc(db, zstdDictCurrentDoc, body) != COUCHSTORE_SUCCESS) {
+            return 0;
+        }
+        dictId = uint32_t(std::strtoul(body.c_str(), nullptr, 10));
+        if (dictId == 0) {
+            return 0;
+        }
+    }
+
+    if (readLocalDoc(db, getDictionaryDocId(dictId), body) !=
+        COUCHSTORE_SUCCESS) {
+        return 0;
+    }
+    return compressor.addDictionary({body.data(), body.size()}, makeCurrent);
+}
+
+/**
+ * Decompress a document body written by CouchCommitBatch::compressValue(),
+ * loading its dictionary from `db` if it has not been seen yet.
+ */
+static bool decompressDocBody(Db& db,
+                              DictionaryCompressor* compressor,
+                              const sized_buf& body,
+                              std::string& out) {
+    if (compressor == nullptr) {
+        return false;
+    }
+    const cb::const_char_buffer frame{body.buf, body.size};
+    const uint32_t dictId = DictionaryCompressor::getDictionaryId(frame);
+    if (!compressor->hasDictionary(dictId)) {
+        loadDictionary(db, dictId, *compressor, false);
+    }
+    return compressor->decompress(frame, out);
+}
+
 static int edit_docinfo_hook(DocInfo **info, const sized_buf *item) {
     // Examine the metadata of the doc
     auto documentMetaData = MetaDataFactory::createMetaData((*info)->rev_meta);
@@ -743,19 +974,22 @@ static int edit_docinfo_hook(DocInfo **info, const sized_buf *item) {
 /**
  * Notify the expiry callback that a document has expired
  *
+ * @param db       the database being compacted
  * @param info     document information for the expired item
  * @param metadata metadata of the document
  * @param item     buffer containing data and size
  * @param ctx      context for compaction
  * @param currtime current time
  */
-static int notify_expired_item(DocInfo& info,
+static int notify_expired_item(Db& db,
+                               DocInfo& info,
                                MetaData& metadata,
                                sized_buf item,
                                compaction_ctx& ctx,
                                time_t currtime) {
     cb::char_buffer data;
     cb::compression::Buffer inflated;
+    std::string decompressed;
 
     if (mcbp::datatype::is_xattr(metadata.getDataType())) {
         if (item.buf == nullptr) {
@@ -763,7 +997,20 @@ static int notify_expired_item(DocInfo& info,
             return COUCHSTORE_COMPACT_NEED_BODY;
         }
 
-        if (info.content_meta | COUCH_DOC_IS_COMPRESSED) {
+        if (metadata.getCompression() ==
+            MetaData::Compression::ZstdDictionary) {
+            if (!decompressDocBody(db,
+                                   ctx.config->getValueCompressor().get(),
+                                   item,
+                                   decompressed)) {
+                LOG(EXTENSION_LOG_WARNING,
+                    "time_purge_hook: failed to decompress document with "
+                    "seqno %" PRIu64 " revno: %" PRIu64,
+                    info.db_seq, info.rev_seq);
+                return COUCHSTORE_ERROR_CORRUPT;
+            }
+            data = {&decompressed[0], decompressed.size()};
+        } else if (info.content_meta | COUCH_DOC_IS_COMPRESSED) {
             using namespace cb::compression;
 
             if (!inflate(Algorithm::Snappy, {item.buf, item.size}, inflated)) {
@@ -859,7 +1106,7 @@ static int time_purge_hook(Db* d, DocInfo* info, sized_buf item, void* ctx_p) {
             if (exptime && exptime < currtime) {
                 int ret;
                 try {
-                    ret = notify_expired_item(*info, *metadata, item,
+                    ret = notify_expired_item(*d, *info, *metadata, item,
                                              *ctx, currtime);
                 } catch (const std::bad_alloc&) {
                     LOG(EXTENSION_LOG_WARNING,
@@ -1032,8 +1279,16 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
     // Removing the stale couch file
     unlinkCouchFile(vbid, fileRev);
 
-    st.compactHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
-            ProcessClock::now() - start));
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            ProcessClock::now() - start);
+    st.compactHisto.add(duration);
+    if (duration.count() > 0) {
+        // Compaction reads (roughly) the whole old file and writes the new
+        // one; use that as the I/O volume for the throughput estimate.
+        const uint64_t bytes = hook_ctx->stats.pre.size +
+                               hook_ctx->stats.post.size;
+        st.compactThroughputHisto.add(bytes * 1000000 / duration.count());
+    }
 
     return true;
 }
@@ -1198,11 +1453,30 @@ bool CouchKVStore::getStat(const char* name, size_t& value)  {
     } else if (strcmp("io_compaction_write_bytes", name) == 0) {
         value = st.fsStatsCompaction.totalBytesWritten;
         return true;
+    } else if (strcmp("io_compaction_throttle_wait_us", name) == 0) {
+        value = st.fsStatsCompaction.totalThrottleWaitUs;
+        return true;
     } else if (strcmp("io_bg_fetch_read_count", name) == 0) {
         value = st.getMultiFsReadCount;
         return true;
     }
 
+    // Persistence compression; shared by the RW and RO store.
+    auto* compressor = configuration.getValueCompressor().get();
+    if (compressor == nullptr) {
+        return false;
+    }
+    if (strcmp("io_compression_raw_bytes", name) == 0) {
+        value = compressor->getStats().rawBytes;
+        return true;
+    } else if (strcmp("io_compression_stored_bytes", name) == 0) {
+        value = compressor->getStats().compressedBytes;
+        return true;
+    } else if (strcmp("io_decompress_failures", name) == 0) {
+        value = compressor->getStats().numDecompressFailures;
+        return true;
+    }
+
     return false;
 }
 
@@ -1285,11 +1559,22 @@ ScanContext* CouchKVStore::initScanContext(
         return NULL;
     }
 
+    // Read-ahead hints go to a descriptor of our own; the page cache they
+    // populate is the one couchstore's reads are served from.
+    int readAheadFd = -1;
+#ifdef POSIX_FADV_WILLNEED
+    if (configuration.getScanReadAheadItems() != 0 &&
+        valOptions != ValueFilter::KEYS_ONLY) {
+        readAheadFd =
+                ::open(getDBFileName(dbname, vbid, rev).c_str(), O_RDONLY);
+    }
+#endif
+
     size_t scanId = scanCounter++;
 
     {
         LockHolder lh(scanLock);
-        scans[scanId] = db;
+        scans[scanId] = {db, readAheadFd};
     }
 
     ScanContext* sctx = new ScanContext(cb,
@@ -1319,6 +1604,104 @@ static couchstore_docinfos_options getDocFilter(const DocumentFilter& filter) {
     throw std::runtime_error(err);
 }
 
+/**
+ * State of a single CouchKVStore::scan() call, passed to recordDbDump for
+ * each document.
+ */
+struct CouchScanState {
+    explicit CouchScanState(ScanContext& ctx) : ctx(ctx) {
+    }
+
+    ScanContext& ctx;
+    /// Last seqno of the current read-ahead window; 0 if unbounded.
+    uint64_t windowEnd = 0;
+    /// Set when recordDbDump stopped at the end of the window.
+    bool windowDone = false;
+    /// Documents (and their key+meta+value bytes) read from disk.
+    size_t docsRead = 0;
+    size_t bytesRead = 0;
+};
+
+/// Documents collected for one read-ahead window.
+struct ReadAheadBatch {
+    ReadAheadBatch(size_t maxItems, size_t maxBytes)
+        : maxItems(maxItems), maxBytes(maxBytes) {
+    }
+
+    const size_t maxItems;
+    const size_t maxBytes;
+    size_t items = 0;
+    size_t bytes = 0;
+    uint64_t lastSeqno = 0;
+    /// (file offset, length) of each document body.
+    std::vector<std::pair<cs_off_t, cs_off_t>> extents;
+};
+
+/**
+ * Each document body is stored as a chunk with an 8 byte length+CRC
+ * header, and couchstore prefixes every 4KB block it spans with a marker
+ * byte; make sure the hinted range covers all of it.
+ */
+static cs_off_t getDocExtentLength(size_t size) {
+    return cs_off_t(8 + size + (8 + size) / 4095 + 1);
+}
+
+/// Gap (in bytes) below which the ranges of nearby documents are merged.
+static const cs_off_t readAheadMergeGap = 64 * 1024;
+
+extern "C" {
+    static int recordReadAheadC(Db* db, DocInfo* docinfo, void* ctx) {
+        auto* batch = static_cast<ReadAheadBatch*>(ctx);
+        if (batch->items >= batch->maxItems ||
+            (batch->items != 0 && batch->bytes >= batch->maxBytes)) {
+            return COUCHSTORE_ERROR_CANCEL;
+        }
+        if (docinfo->size != 0) {
+            batch->extents.emplace_back(docinfo->bp,
+                                        getDocExtentLength(docinfo->size));
+        }
+        batch->items++;
+        batch->bytes += docinfo->size;
+        batch->lastSeqno = docinfo->db_seq;
+        return COUCHSTORE_SUCCESS;
+    }
+}
+
+uint64_t CouchKVStore::readAhead(Db* db,
+                                 int fd,
+                                 uint64_t startSeqno,
+                                 couchstore_docinfos_options options) {
+    ReadAheadBatch batch(configuration.getScanReadAheadItems(),
+                         configuration.getScanReadAheadBytes());
+    const auto errorCode = couchstore_changes_since(
+            db, startSeqno, options, recordReadAheadC, &batch);
+    if (errorCode != COUCHSTORE_SUCCESS &&
+        errorCode != COUCHSTORE_ERROR_CANCEL) {
+        // Not fatal - the scan itself will hit (and report) the same error.
+        return 0;
+    }
+
+#ifdef POSIX_FADV_WILLNEED
+    std::sort(batch.extents.begin(), batch.extents.end());
+    auto it = batch.extents.begin();
+    while (it != batch.extents.end()) {
+        cs_off_t offset = it->first;
+        cs_off_t end = it->first + it->second;
+        for (++it; it != batch.extents.end() &&
+                   it->first <= end + readAheadMergeGap;
+             ++it) {
+            end = std::max(end, it->first + it->second);
+        }
+        if (posix_fadvise(fd, offset, end - offset, POSIX_FADV_WILLNEED) ==
+            0) {
+            st.io_scan_readahead_bytes += size_t(end - offset);
+        }
+    }
+#endif
+
+    return (errorCode == COUCHSTORE_ERROR_CANCEL) ? batch.lastSeqno : 0;
+}
+
 scan_error_t CouchKVStore::scan(ScanContext* ctx) {
     if (!ctx) {
         return scan_failed;
@@ -1336,6 +1719,7 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
                        ctx->startSeqno);
 
     Db* db;
+    int readAheadFd;
     {
         LockHolder lh(scanLock);
         auto itr = scans.find(ctx->scanId);
@@ -1343,7 +1727,8 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
             return scan_failed;
         }
 
-        db = itr->second;
+        db = itr->second.db;
+        readAheadFd = itr->second.readAheadFd;
     }
 
     uint64_t start = ctx->startSeqno;
@@ -1351,12 +1736,37 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
         start = ctx->lastReadSeqno + 1;
     }
 
+    const auto options = getDocFilter(ctx->docFilter);
+    const auto scanStart = ProcessClock::now();
+    CouchScanState state(*ctx);
     couchstore_error_t errorCode;
-    errorCode = couchstore_changes_since(db,
-                                         start,
-                                         getDocFilter(ctx->docFilter),
-                                         recordDbDumpC,
-                                         static_cast<void*>(ctx));
+    do {
+        // With read-ahead the scan proceeds in windows of the read-ahead
+        // budget: hint a window's documents, then read them. The budget is
+        // that of a backfill run, so normally the callbacks pause the scan
+        // before the window ends.
+        if (readAheadFd != -1) {
+            state.windowEnd = readAhead(db, readAheadFd, start, options);
+            state.windowDone = false;
+        }
+        errorCode = couchstore_changes_since(db,
+                                             start,
+                                             options,
+                                             recordDbDumpC,
+                                             static_cast<void*>(&state));
+        // Every document up to the window end has been processed, whether
+        // or not it updated lastReadSeqno.
+        start = state.windowEnd + 1;
+    } while (errorCode == COUCHSTORE_ERROR_CANCEL && state.windowDone);
+
+    st.io_scan_docs_read += state.docsRead;
+    st.io_scan_doc_bytes += state.bytesRead;
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            ProcessClock::now() - scanStart);
+    if (state.bytesRead > 0 && duration.count() > 0) {
+        st.scanThroughputHisto.add(uint64_t(state.bytesRead) * 1000000 /
+                                   duration.count());
+    }
 
     TRACE_EVENT_END1(
             "CouchKVStore", "scan", "lastReadSeqno", ctx->lastReadSeqno);
@@ -1384,7 +1794,10 @@ void CouchKVStore::destroyScanContext(ScanContext* ctx) {
     LockHolder lh(scanLock);
     auto itr = scans.find(ctx->scanId);
     if (itr != scans.end()) {
-        closeDatabaseHandle(itr->second);
+        closeDatabaseHandle(itr->second.db);
+        if (itr->second.readAheadFd != -1) {
+            ::close(itr->second.readAheadFd);
+        }
         scans.erase(itr);
     }
     delete ctx;
@@ -1640,6 +2053,7 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
         Doc *doc = nullptr;
         size_t valuelen = 0;
         void* valuePtr = nullptr;
+        std::string decompressed;
         protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
         errCode = couchstore_open_doc_with_docinfo(db, docinfo, &doc,
                                                    DECOMPRESS_DOC_BODIES);
@@ -1658,6 +2072,23 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
             valuelen = doc->data.size;
             valuePtr = doc->data.buf;
 
+            if (metadata->getCompression() ==
+                MetaData::Compression::ZstdDictionary) {
+                if (!decompressDocBody(*db,
+                                       configuration.getValueCompressor().get(),
+                                       doc->data,
+                                       decompressed)) {
+                    logger.log(EXTENSION_LOG_WARNING,
+                               "CouchKVStore::fetchDoc: failed to decompress "
+                               "document, vb:%" PRIu16 ", seqno:%" PRIu64,
+                               vbId, docinfo->db_seq);
+                    couchstore_free_document(doc);
+                    return COUCHSTORE_ERROR_CORRUPT;
+                }
+                valuelen = decompressed.size();
+                valuePtr = &decompressed[0];
+            }
+
             if (metadata->getVersionInitialisedFrom() == MetaData::Version::V0) {
                 // This is a super old version of a couchstore file.
                 // Try to determine if the document is JSON or raw bytes
@@ -1707,15 +2138,23 @@ couchstore_error_t CouchKVStore::fetchDoc(Db* db,
 
 int CouchKVStore::recordDbDump(Db *db, DocInfo *docinfo, void *ctx) {
 
-    ScanContext* sctx = static_cast<ScanContext*>(ctx);
+    auto* state = static_cast<CouchScanState*>(ctx);
+    ScanContext* sctx = &state->ctx;
     auto* cb = sctx->callback.get();
     auto* cl = sctx->lookup.get();
 
     Doc *doc = nullptr;
     sized_buf value{nullptr, 0};
+    std::string decompressed;
     uint64_t byseqno = docinfo->db_seq;
     uint16_t vbucketId = sctx->vbid;
 
+    if (state->windowEnd != 0 && byseqno > state->windowEnd) {
+        // End of the read-ahead window; scan() hints the next one.
+        state->windowDone = true;
+        return COUCHSTORE_ERROR_CANCEL;
+    }
+
     sized_buf key = docinfo->id;
     if (key.size > UINT16_MAX) {
         throw std::invalid_argument("CouchKVStore::recordDbDump: "
@@ -1755,7 +2194,24 @@ int CouchKVStore::recordDbDump(Db *db, DocInfo *docinfo, void *ctx) {
 
         if (errCode == COUCHSTORE_SUCCESS) {
             value = doc->data;
-            if (doc->data.size) {
+            if (doc->data.size && metadata->getCompression() ==
+                                          MetaData::Compression::ZstdDictionary) {
+                // Compressed by us rather than couchstore; always hand it
+                // out decompressed (the datatype stays uncompressed).
+                if (!decompressDocBody(*db,
+                                       sctx->config.getValueCompressor().get(),
+                                       doc->data,
+                                       decompressed)) {
+                    sctx->logger->log(EXTENSION_LOG_WARNING,
+                                      "CouchKVStore::recordDbDump: failed to "
+                                      "decompress document, vb:%" PRIu16
+                                      ", seqno:%" PRIu64,
+                                      vbucketId, byseqno);
+                    couchstore_free_document(doc);
+                    return COUCHSTORE_SUCCESS;
+                }
+                value = {&decompressed[0], decompressed.size()};
+            } else if (doc->data.size) {
                 if ((openOptions & DECOMPRESS_DOC_BODIES) == 0) {
                     // We always store the document bodies compressed on disk,
                     // but now the client _wanted_ to fetch the document
@@ -1806,6 +2262,9 @@ int CouchKVStore::recordDbDump(Db *db, DocInfo *docinfo, void *ctx) {
         it->setDeleted();
     }
 
+    state->docsRead++;
+    state->bytesRead += docinfo->id.size + docinfo->rev_meta.size + value.size;
+
     bool onlyKeys = (sctx->valFilter == ValueFilter::KEYS_ONLY) ? true : false;
     GetValue rv(std::move(it), ENGINE_SUCCESS, -1, onlyKeys);
     cb->callback(rv);
@@ -1830,7 +2289,7 @@ bool CouchKVStore::commit2couchstore(const Item* collectionsManifest) {
 
     // Use the vbucket of the first item or the manifest item
     uint16_t vbucket2flush = pendingCommitCnt
-                                     ? pendingReqsQ[0]->getVBucketId()
+                                     ? pendingReqsQ[0].vbucketId
                                      : collectionsManifest->getVBucketId();
 
     TRACE_EVENT2("CouchKVStore",
@@ -1855,28 +2314,21 @@ bool CouchKVStore::commit2couchstore(const Item* collectionsManifest) {
     // flushing.
     uint64_t fileRev = dbFileRevMap[vbucket2flush];
 
-    std::vector<Doc*> docs(pendingCommitCnt);
-    std::vector<DocInfo*> docinfos(pendingCommitCnt);
-
     for (size_t i = 0; i < pendingCommitCnt; ++i) {
-        CouchRequest *req = pendingReqsQ[i];
-        docs[i] = (Doc *)req->getDbDoc();
-        docinfos[i] = req->getDbDocInfo();
-        if (vbucket2flush != req->getVBucketId()) {
+        if (vbucket2flush != pendingReqsQ[i].vbucketId) {
             throw std::logic_error(
                     "CouchKVStore::commit2couchstore: "
                     "mismatch between vbucket2flush (which is "
                     + std::to_string(vbucket2flush) + ") and pendingReqsQ["
                     + std::to_string(i) + "] (which is "
-                    + std::to_string(req->getVBucketId()) + ")");
+                    + std::to_string(pendingReqsQ[i].vbucketId) + ")");
         }
     }
+    pendingReqsQ.prepare();
 
-    // The docinfo callback needs to know if the DocNamespace feature is on
-    kvstats_ctx kvctx(configuration.shouldPersistDocNamespace());
     // flush all
-    couchstore_error_t errCode = saveDocs(
-            vbucket2flush, fileRev, docs, docinfos, kvctx, collectionsManifest);
+    couchstore_error_t errCode =
+            saveDocs(vbucket2flush, fileRev, pendingReqsQ, collectionsManifest);
 
     if (errCode) {
         success = false;
@@ -1886,12 +2338,9 @@ bool CouchKVStore::commit2couchstore(const Item* collectionsManifest) {
                    vbucket2flush, fileRev);
     }
 
-    commitCallback(pendingReqsQ, kvctx, errCode);
+    commitCallback(pendingReqsQ, errCode);
 
-    // clean up
-    for (size_t i = 0; i < pendingCommitCnt; ++i) {
-        delete pendingReqsQ[i];
-    }
+    // clean up (keeping the batch's capacity for the next commit)
     pendingReqsQ.clear();
     return success;
 }
@@ -1900,16 +2349,11 @@ static int readDocInfos(Db *db, DocInfo *docinfo, void *ctx) {
     if (ctx == nullptr) {
         throw std::invalid_argument("readDocInfos: ctx must be non-NULL");
     }
-    kvstats_ctx* cbCtx = static_cast<kvstats_ctx*>(ctx);
+    auto* batch = static_cast<CouchCommitBatch*>(ctx);
     if(docinfo) {
         // An item exists in the VB DB file.
         if (!docinfo->deleted) {
-            // Collections: TODO: Permanently restore to stored namespace
-            auto itr = cbCtx->keyStats.find(
-                    makeDocKey(docinfo->id, cbCtx->persistDocNamespace));
-            if (itr != cbCtx->keyStats.end()) {
-                itr->second = true;
-            }
+            batch->markExisting(docinfo->id);
         }
     }
     return 0;
@@ -1917,9 +2361,7 @@ static int readDocInfos(Db *db, DocInfo *docinfo, void *ctx) {
 
 couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
                                           uint64_t rev,
-                                          const std::vector<Doc*>& docs,
-                                          std::vector<DocInfo*>& docinfos,
-                                          kvstats_ctx& kvctx,
+                                          CouchCommitBatch& batch,
                                           const Item* collectionsManifest) {
     couchstore_error_t errCode;
     uint64_t fileRev = rev;
@@ -1939,7 +2381,7 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
                    couchstore_strerror(errCode),
                    vbid,
                    fileRev,
-                   uint64_t(docs.size()));
+                   uint64_t(batch.size()));
         return errCode;
     } else {
         vbucket_state* state = getVBucketState(vbid);
@@ -1952,28 +2394,24 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
         uint64_t maxDBSeqno = 0;
 
         // Only do a couchstore_save_documents if there are docs
-        if (docs.size() > 0) {
-            std::vector<sized_buf> ids(docs.size());
-            for (size_t idx = 0; idx < docs.size(); idx++) {
-                ids[idx] = docinfos[idx]->id;
-                maxDBSeqno = std::max(maxDBSeqno, docinfos[idx]->db_seq);
-                DocKey key = makeDocKey(
-                        ids[idx], configuration.shouldPersistDocNamespace());
-                kvctx.keyStats[key] = false;
+        if (!batch.empty()) {
+            for (size_t idx = 0; idx < batch.size(); idx++) {
+                maxDBSeqno = std::max(maxDBSeqno, batch[idx].docInfo.db_seq);
             }
+            auto& ids = batch.getSortedIds();
             couchstore_docinfos_by_id(db.getDb(),
                                       ids.data(),
                                       (unsigned)ids.size(),
                                       0,
                                       readDocInfos,
-                                      &kvctx);
+                                      &batch);
 
             auto cs_begin = ProcessClock::now();
             uint64_t flags = COMPRESS_DOC_BODIES | COUCHSTORE_SEQUENCE_AS_IS;
             errCode = couchstore_save_documents(db.getDb(),
-                                                docs.data(),
-                                                docinfos.data(),
-                                                (unsigned)docs.size(),
+                                                batch.getDocs(),
+                                                batch.getDocInfos(),
+                                                (unsigned)batch.size(),
                                                 flags);
             st.saveDocsHisto.add(
                     std::chrono::duration_cast<std::chrono::microseconds>(
@@ -1985,11 +2423,19 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
                            couchstore_strerror(errCode),
                            couchkvstore_strerrno(db.getDb(), errCode).c_str(),
                            vbid,
-                           uint64_t(docs.size()));
+                           uint64_t(batch.size()));
                 return errCode;
             }
         }
 
+        // Compressed values are unreadable without their dictionary, so it
+        // must be part of the same commit.
+        const uint32_t dictId = batch.getDictionaryId();
+        errCode = saveDictionary(*db.getDb(), vbid, dictId);
+        if (errCode != COUCHSTORE_SUCCESS) {
+            return errCode;
+        }
+
         errCode = saveVBState(db.getDb(), *state);
         if (errCode != COUCHSTORE_SUCCESS) {
             logger.log(EXTENSION_LOG_WARNING,
@@ -2016,8 +2462,11 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
                     couchkvstore_strerrno(db.getDb(), errCode).c_str());
             return errCode;
         }
+        if (dictId != 0) {
+            persistedDictionary[vbid] = dictId;
+        }
 
-        st.batchSize.add(docs.size());
+        st.batchSize.add(batch.size());
 
         // retrieve storage system stats for file fragmentation computation
         couchstore_db_info(db.getDb(), &info);
@@ -2027,7 +2476,7 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
         cachedDocCount[vbid] = info.doc_count;
 
         // Check seqno if we wrote documents
-        if (docs.size() > 0 && maxDBSeqno != info.last_sequence) {
+        if (!batch.empty() && maxDBSeqno != info.last_sequence) {
             logger.log(EXTENSION_LOG_WARNING,
                        "CouchKVStore::saveDocs: Seqno in db header (%" PRIu64 ")"
                        " is not matched with what was persisted (%" PRIu64 ")"
@@ -2039,7 +2488,7 @@ couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
 
     /* update stat */
     if(errCode == COUCHSTORE_SUCCESS) {
-        st.docsCommitted = docs.size();
+        st.docsCommitted = batch.size();
     }
 
     return errCode;
@@ -2058,23 +2507,21 @@ void CouchKVStore::remVBucketFromDbFileMap(uint16_t vbucketId) {
     dbFileRevMap[vbucketId] = 1;
 }
 
-void CouchKVStore::commitCallback(std::vector<CouchRequest *> &committedReqs,
-                                  kvstats_ctx &kvctx,
+void CouchKVStore::commitCallback(CouchCommitBatch& batch,
                                   couchstore_error_t errCode) {
-    size_t commitSize = committedReqs.size();
+    size_t commitSize = batch.size();
 
     for (size_t index = 0; index < commitSize; index++) {
-        size_t dataSize = committedReqs[index]->getNBytes();
-        size_t keySize = committedReqs[index]->getKey().size();
+        auto& committed = batch[index];
+        const size_t writeBytes = committed.getWriteBytes();
         /* update ep stats */
         ++st.io_num_write;
-        st.io_write_bytes += (keySize + dataSize);
+        st.io_write_bytes += writeBytes;
 
-        if (committedReqs[index]->isDelete()) {
+        if (committed.deleted) {
             int rv = getMutationStatus(errCode);
             if (rv != -1) {
-                const auto& key = committedReqs[index]->getKey();
-                if (kvctx.keyStats[key]) {
+                if (committed.existed) {
                     rv = 1; // Deletion is for an existing item on DB file.
                 } else {
                     rv = 0; // Deletion is for a non-existing item on DB file.
@@ -2083,23 +2530,20 @@ void CouchKVStore::commitCallback(std::vector<CouchRequest *> &committedReqs,
             if (errCode) {
                 ++st.numDelFailure;
             } else {
-                st.delTimeHisto.add(committedReqs[index]->getDelta());
+                st.delTimeHisto.add(committed.getDelta());
             }
-            committedReqs[index]->getDelCallback()->callback(*transactionCtx,
-                                                             rv);
+            committed.callback.delCb->callback(*transactionCtx, rv);
         } else {
             int rv = getMutationStatus(errCode);
-            const auto& key = committedReqs[index]->getKey();
-            bool insertion = !kvctx.keyStats[key];
+            bool insertion = !committed.existed;
             if (errCode) {
                 ++st.numSetFailure;
             } else {
-                st.writeTimeHisto.add(committedReqs[index]->getDelta());
-                st.writeSizeHisto.add(dataSize + keySize);
+                st.writeTimeHisto.add(committed.getDelta());
+                st.writeSizeHisto.add(writeBytes);
             }
             mutation_result p(rv, insertion);
-            committedReqs[index]->getSetCallback()->callback(*transactionCtx,
-                                                             p);
+            committed.callback.setCb->callback(*transactionCtx, p);
         }
     }
 }
@@ -2315,6 +2759,47 @@ couchstore_error_t CouchKVStore::saveCollectionsManifest(
     return errCode;
 }
 
+couchstore_error_t CouchKVStore::saveDictionary(Db& db,
+                                                uint16_t vbid,
+                                                uint32_t dictId) {
+    if (dictId == 0 || persistedDictionary[vbid] == dictId) {
+        return COUCHSTORE_SUCCESS;
+    }
+
+    const std::string dict =
+            configuration.getValueCompressor()->getDictionary(dictId);
+    const std::string docId = getDictionaryDocId(dictId);
+    LocalDoc lDoc;
+    lDoc.id.buf = const_cast<char*>(docId.data());
+    lDoc.id.size = docId.size();
+    lDoc.json.buf = const_cast<char*>(dict.data());
+    lDoc.json.size = dict.size();
+    lDoc.deleted = 0;
+
+    couchstore_error_t errCode = couchstore_save_local_document(&db, &lDoc);
+    if (errCode == COUCHSTORE_SUCCESS) {
+        const std::string current = std::to_string(dictId);
+        lDoc.id.buf = const_cast<char*>(zstdDictCurrentDoc);
+        lDoc.id.size = sizeof(zstdDictCurrentDoc) - 1;
+        lDoc.json.buf = const_cast<char*>(current.data());
+        lDoc.json.size = current.size();
+        errCode = couchstore_save_local_document(&db, &lDoc);
+    }
+
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "CouchKVStore::saveDictionary "
+                   "couchstore_save_local_document "
+                   "error:%s [%s], vb:%" PRIu16 ", dict:%" PRIu32,
+                   couchstore_strerror(errCode),
+                   couchkvstore_strerrno(&db, errCode).c_str(),
+                   vbid,
+                   dictId);
+    }
+
+    return errCode;
+}
+
 std::string CouchKVStore::readCollectionsManifest(Db& db) {
     sized_buf id;
     id.buf = const_cast<char*>(Collections::CouchstoreManifest);
@@ -2488,6 +2973,11 @@ DBFileInfo CouchKVStore::getDbFileInfo(uint16_t vbid) {
     return DBFileInfo{info.file_size, info.space_used};
 }
 
+DBFileInfo CouchKVStore::getCachedDbFileInfo(uint16_t vbid) {
+    return DBFileInfo{cachedFileSize[vbid].load(),
+                      cachedSpaceUsed[vbid].load()};
+}
+
 DBFileInfo CouchKVStore::getAggrDbFileInfo() {
     DBFileInfo kvsFileInfo;
     /**
@@ -2537,6 +3027,10 @@ size_t CouchKVStore::getItemCount(uint16_t vbid) {
 
 RollbackResult CouchKVStore::rollback(uint16_t vbid, uint64_t rollbackSeqno,
                                       std::shared_ptr<RollbackCB> cb) {
+    // Rewinding may drop the commit which saved the dictionary; save it
+    // again with the next commit.
+    persistedDictionary[vbid] = 0;
+
     DbHolder db(this);
     DbInfo info;
     uint64_t fileRev = dbFileRevMap[vbid];
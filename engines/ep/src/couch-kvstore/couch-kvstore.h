@@ -42,112 +42,181 @@
 
 #define COUCHSTORE_NO_OPTIONS 0
 
+class DictionaryCompressor;
 class EventuallyPersistentEngine;
 
 /**
- * Class representing a document to be persisted in couchstore.
+ * The documents of one couchstore commit, laid out to avoid per-item heap
+ * allocations on the flusher path.
+ *
+ * Each added item becomes an Entry in a single vector; its key and encoded
+ * metadata are appended to one shared byte arena, and its value is held by
+ * reference (value_t). Both containers are reused across commits (clear()
+ * keeps their capacity), so once a store has seen its largest batch, adding
+ * an item allocates nothing. So that a one-off large batch doesn't pin its
+ * memory for good, clear() periodically releases any capacity far above
+ * what the recent commits have used.
+ *
+ * As the containers may reallocate while items are added, the couchstore
+ * Doc / DocInfo of each entry (which point into the arena and the value)
+ * are only filled in by prepare(), once the batch is complete.
  */
-class CouchRequest : public IORequest
-{
+class CouchCommitBatch {
 public:
+    struct Entry {
+        uint16_t vbucketId;
+        bool deleted;
+        MutationRequestCallback callback;
+        ProcessClock::time_point start;
+        value_t value;
+
+        /// Offset / length of the document id (as stored) in the arena.
+        size_t idOffset;
+        size_t idSize;
+        /// Length of the key excluding any namespace prefix.
+        size_t keySize;
+        /// Offset / length of the rev_meta in the arena.
+        size_t metaOffset;
+        size_t metaSize;
+        couchstore_content_meta_flags contentMeta;
+        /// If set, the value to write is in the arena (see compressValue()).
+        bool valueInArena;
+        size_t valueOffset;
+        uint64_t bySeqno;
+        uint64_t revSeqno;
+        size_t valueSize;
+
+        /// Set by saveDocs() if a live version of the key was already on disk.
+        bool existed;
+
+        /// Filled in by prepare().
+        Doc doc;
+        DocInfo docInfo;
+
+        std::chrono::microseconds getDelta() const {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start);
+        }
+
+        /// Key + value + rev_meta bytes written for this item.
+        size_t getWriteBytes() const {
+            return keySize + metaSize + valueSize;
+        }
+    };
+
+    explicit CouchCommitBatch(bool persistDocNamespace)
+        : persistDocNamespace(persistDocNamespace) {
+    }
+
     /**
-     * Constructor
+     * Add an item to be persisted.
      *
-     * @param it Item instance to be persisted
-     * @param rev vbucket database revision number
+     * @param it Item to be persisted
      * @param cb persistence callback
-     * @param del flag indicating if it is an item deletion or not
-     * @param persistDocNamespace true if we should store the key's namespace
+     * @param del true if this is a deletion
+     * @return index of the new entry
      */
-    CouchRequest(const Item& it,
-                 uint64_t rev,
-                 MutationRequestCallback& cb,
-                 bool del,
-                 bool persistDocNamespace);
-
-    virtual ~CouchRequest() {}
+    size_t add(const Item& it, MutationRequestCallback& cb, bool del);
 
     /**
-     * Get the vbucket id of a document to be persisted
+     * Replace the value of an entry with a copy compressed by `compressor`,
+     * if that is smaller. The rev_meta is extended to V3 to record it.
      *
-     * @return vbucket id of a document
+     * @return true if the value was compressed.
      */
-    uint16_t getVBucketId(void) {
-        return vbucketId;
+    bool compressValue(size_t index, DictionaryCompressor& compressor);
+
+    /// @return id of the dictionary compressed values depend on (0 if none).
+    uint32_t getDictionaryId() const {
+        return dictionaryId;
     }
 
     /**
-     * Get the revision number of the vbucket database file
-     * where the document is persisted
-     *
-     * @return revision number of the corresponding vbucket database file
+     * Point every entry's Doc / DocInfo at its id, metadata and value, and
+     * build the (id-sorted) lookup used by markExisting(). Must be called
+     * after the last add() and before the accessors below.
      */
-    uint64_t getRevNum(void) {
-        return fileRevNum;
+    void prepare();
+
+    /// Doc array for couchstore_save_documents (null for value-less deletes).
+    Doc** getDocs() {
+        return docs.data();
     }
 
-    /**
-     * Get the couchstore Doc instance of a document to be persisted
-     *
-     * @return pointer to the couchstore Doc instance of a document
-     *         or nullptr if the its a deleted item and doesn't have
-     *         a value.
-     */
-    void *getDbDoc(void) {
-        if (deleteItem && value.get() == nullptr) {
-            return nullptr;
-        }
-        return &dbDoc;
+    DocInfo** getDocInfos() {
+        return docInfos.data();
     }
 
-    /**
-     * Get the couchstore DocInfo instance of a document to be persisted
-     *
-     * @return pointer to the couchstore DocInfo instance of a document
-     */
-    DocInfo *getDbDocInfo(void) {
-        return &dbDocInfo;
+    /// Ids of all entries, sorted; for couchstore_docinfos_by_id.
+    std::vector<sized_buf>& getSortedIds() {
+        return sortedIds;
     }
 
+    /// Flag every entry with the given id as already existing on disk.
+    void markExisting(const sized_buf& id);
+
     /**
-     * Get the length of a document body to be persisted
-     *
-     * @return length of a document body
+     * @return a pointer to the arena bytes of an entry's rev_meta. Room is
+     *         reserved for the largest (V3) format.
      */
-    size_t getNBytes() {
-        return dbDocInfo.rev_meta.size + dbDocInfo.size;
+    char* getMetaData(size_t index) {
+        return arena.data() + entries[index].metaOffset;
+    }
+
+    Entry& operator[](size_t index) {
+        return entries[index];
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    bool empty() const {
+        return entries.empty();
     }
 
     /**
-     * Return true if the document to be persisted is for DELETE
-     *
-     * @return true if the document to be persisted is for DELETE
+     * Remove all entries, keeping the allocated capacity for reuse (unless
+     * it is far above the recent high-water mark).
      */
-    bool isDelete() {
-        return deleteItem;
-    };
+    void clear();
 
+    /// @return the bytes allocated by the batch's containers.
+    size_t getAllocatedSize() const;
+
+private:
+    /// Number of commits between checks for capacity to release.
+    static const size_t ShrinkCheckInterval = 64;
     /**
-     * Get the key of a document to be persisted
-     *
-     * @return key of a document to be persisted
+     * Capacity is released if it is more than this many times the
+     * high-water mark of the commits since the last check.
      */
-    const StoredDocKey& getKey(void) const {
-        return key;
-    }
+    static const size_t ShrinkFactor = 4;
 
-protected:
     static couchstore_content_meta_flags getContentMeta(const Item& it);
 
-    value_t value;
+    /// Append `size` bytes to the arena and return the offset written at.
+    size_t appendToArena(const char* data, size_t size);
 
-    MetaData meta;
-    uint64_t fileRevNum;
-    Doc dbDoc;
-    DocInfo dbDocInfo;
-};
+    sized_buf getId(const Entry& entry) {
+        return {arena.data() + entry.idOffset, entry.idSize};
+    }
 
-struct kvstats_ctx;
+    const bool persistDocNamespace;
+    std::vector<Entry> entries;
+    std::vector<char> arena;
+    std::vector<Doc*> docs;
+    std::vector<DocInfo*> docInfos;
+    // Entry indices and ids, both in id order.
+    std::vector<size_t> sortedIndex;
+    std::vector<sized_buf> sortedIds;
+    uint32_t dictionaryId = 0;
+
+    /// High-water marks of the entries / arena since the last shrink check.
+    size_t recentMaxEntries = 0;
+    size_t recentMaxArena = 0;
+    size_t clearsSinceShrinkCheck = 0;
+};
 
 /**
  * KVStore with couchstore as the underlying storage system
@@ -360,6 +429,12 @@ public:
      */
     DBFileInfo getDbFileInfo(uint16_t vbid) override;
 
+    /**
+     * Get the file size and space used of a vbucket as of the last commit
+     * or compaction, without opening the file.
+     */
+    DBFileInfo getCachedDbFileInfo(uint16_t vbid) override;
+
     /**
      * Get the file statistics for the underlying KV store
      *
@@ -485,14 +560,12 @@ protected:
                               FileOpsInterface* ops = nullptr);
 
     /**
-     * save the Documents held in docs to the file associated with vbid/rev
+     * save the Documents held in batch to the file associated with vbid/rev
      *
      * @param vbid the vbucket file to open/write/commit
      * @param rev the revision of the vbucket file to open/write/commit
-     * @param docs vector of Doc* to be written (can be empty)
-     * @param docsinfo vector of DocInfo* to be written (non const due to
-     *        couchstore API). Entry n corresponds to entry n of docs.
-     * @param kvctx a stats context object to update
+     * @param batch the prepared documents to be written (can be empty);
+     *        entries whose key already existed on disk are marked so.
      * @param collectionsManifest a pointer to an item which contains the
      *        manifest update data (can be nullptr)
      *
@@ -500,14 +573,10 @@ protected:
      */
     couchstore_error_t saveDocs(uint16_t vbid,
                                 uint64_t rev,
-                                const std::vector<Doc*>& docs,
-                                std::vector<DocInfo*>& docinfos,
-                                kvstats_ctx& kvctx,
+                                CouchCommitBatch& batch,
                                 const Item* collectionsManifest);
 
-    void commitCallback(std::vector<CouchRequest *> &committedReqs,
-                        kvstats_ctx &kvctx,
-                        couchstore_error_t errCode);
+    void commitCallback(CouchCommitBatch& batch, couchstore_error_t errCode);
     couchstore_error_t saveVBState(Db *db, const vbucket_state &vbState);
 
     /**
@@ -532,6 +601,13 @@ protected:
      */
     std::string readCollectionsManifest(Db& db);
 
+    /**
+     * Save the value compression dictionary `dictId` to the
+     * _local/zstd_dict/<id> document (and record it as the file's current
+     * dictionary in _local/zstd_dict), unless this file already has it.
+     */
+    couchstore_error_t saveDictionary(Db& db, uint16_t vbid, uint32_t dictId);
+
     void setDocsCommitted(uint16_t docs);
     void closeDatabaseHandle(Db *db);
 
@@ -565,6 +641,23 @@ protected:
     /// Copy relevant DbInfo stats to the common FileStats struct
     static FileInfo toFileInfo(const DbInfo& info);
 
+    /**
+     * Hint to the OS the parts of the file a scan is about to read: the
+     * document bodies of (up to the scan read-ahead budget of) the items
+     * from startSeqno onwards are looked up in the by-seqno index, sorted
+     * into file order, coalesced and passed to posix_fadvise(WILLNEED), so
+     * the kernel can fetch them with large sequential reads ahead of
+     * couchstore reading them one by one in seqno order.
+     *
+     * @param fd descriptor of the file backing `db`
+     * @return the last seqno covered, or 0 if the hints reach the end of
+     *         the by-seqno index.
+     */
+    uint64_t readAhead(Db* db,
+                       int fd,
+                       uint64_t startSeqno,
+                       couchstore_docinfos_options options);
+
     const std::string dbname;
 
     /**
@@ -581,7 +674,17 @@ protected:
     std::vector<std::atomic<uint64_t>> fileRevMap;
 
     uint16_t numDbFiles;
-    std::vector<CouchRequest *> pendingReqsQ;
+    CouchCommitBatch pendingReqsQ;
+
+    /// True if values written should be compressed (persistence_compression).
+    const bool compressValues;
+
+    /**
+     * Per-vbucket id of the compression dictionary already saved to the
+     * current file (0 if none / unknown). Only accessed by the flusher.
+     */
+    std::vector<uint32_t> persistedDictionary;
+
     bool intransaction;
     std::unique_ptr<TransactionContext> transactionCtx;
 
@@ -610,7 +713,16 @@ protected:
     AtomicQueue<std::string> pendingFileDeletions;
 
     std::atomic<size_t> scanCounter; //atomic counter for generating scan id
-    std::map<size_t, Db*> scans; //map holding active scans
+    /**
+     * An active scan: its database handle, plus a second read-only
+     * descriptor of the same file which read-ahead hints are issued
+     * against (-1 if read-ahead is disabled or unavailable).
+     */
+    struct ScanFile {
+        Db* db;
+        int readAheadFd;
+    };
+    std::map<size_t, ScanFile> scans; //map holding active scans
     std::mutex scanLock; //lock guarding the scan map
 
     Logger& logger;
@@ -223,6 +223,18 @@ void BackfillManager::bytesForceRead(size_t bytes) {
     }
 }
 
+bool BackfillManager::bytesCheckAndReadBuffer(size_t bytes) {
+    LockHolder lh(lock);
+    if (buffer.bytesRead == 0 || buffer.bytesRead + bytes <= buffer.maxBytes) {
+        buffer.bytesRead += bytes;
+        return true;
+    }
+
+    buffer.full = true;
+    buffer.nextReadSize = bytes;
+    return false;
+}
+
 void BackfillManager::bytesSent(size_t bytes) {
     LockHolder lh(lock);
     if (bytes > buffer.bytesRead) {
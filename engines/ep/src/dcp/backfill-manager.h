@@ -84,6 +84,18 @@ public:
      */
     void bytesForceRead(size_t bytes);
 
+    /**
+     * Checks if the read size can fit into the backfill buffer and reads
+     * only if the read can fit. The scan buffer is not used, as the read is
+     * not made by one of this connection's backfills.
+     *
+     * @param bytes read size
+     *
+     * @return true upon read success
+     *         false if the backfill buffer is full
+     */
+    bool bytesCheckAndReadBuffer(size_t bytes);
+
     void bytesSent(size_t bytes);
 
     // Called by the managerTask to acutally perform backfilling & manage
@@ -101,10 +113,6 @@ protected:
         bool full;
     } buffer;
 
-private:
-
-    void moveToActiveQueue();
-
     std::mutex lock;
     std::list<UniqueDCPBackfillPtr> activeBackfills;
     std::list<std::pair<rel_time_t, UniqueDCPBackfillPtr> > snoozingBackfills;
@@ -114,6 +122,10 @@ private:
     EventuallyPersistentEngine& engine;
     ExTask managerTask;
 
+private:
+
+    void moveToActiveQueue();
+
     //! The scan buffer is for the current stream being backfilled
     struct {
         size_t bytesRead;
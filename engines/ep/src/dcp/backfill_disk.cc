@@ -94,7 +94,7 @@ void CacheCallback::callback(CacheLookup& lookup) {
             if (gv.item->getBySeqno() == lookup.getBySeqno()) {
                 if (stream_->backfillReceived(std::move(gv.item),
                                               BACKFILL_FROM_MEMORY,
-                                              /*force */ false)) {
+                                              BackfillRead::Checked)) {
                     setStatus(ENGINE_KEY_EEXISTS);
                     return;
                 }
@@ -137,7 +137,7 @@ void DiskCallback::callback(GetValue& val) {
 
     if (!stream_->backfillReceived(std::move(val.item),
                                    BACKFILL_FROM_DISK,
-                                   /*force*/ false)) {
+                                   BackfillRead::Checked)) {
         setStatus(ENGINE_ENOMEM); // Pause the backfill
     } else {
         setStatus(ENGINE_SUCCESS);
@@ -0,0 +1,505 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "dcp/backfill_disk_shared.h"
+#include "dcp/dcpconnmap.h"
+#include "dcp/stream.h"
+#include "ep_engine.h"
+#include "kv_bucket.h"
+#include "vbucket.h"
+
+#include <algorithm>
+
+/* Callback to get the items that are found to be in the cache */
+class SharedScanCacheCallback : public StatusCallback<CacheLookup> {
+public:
+    explicit SharedScanCacheCallback(SharedDiskScan& s) : scan(s) {
+    }
+
+    void callback(CacheLookup& lookup) override {
+        setStatus(scan.lookup(lookup));
+    }
+
+private:
+    SharedDiskScan& scan;
+};
+
+/* Callback to get the items that are found to be in the disk */
+class SharedScanDiskCallback : public StatusCallback<GetValue> {
+public:
+    explicit SharedScanDiskCallback(SharedDiskScan& s) : scan(s) {
+    }
+
+    void callback(GetValue& val) override {
+        if (!val.item) {
+            throw std::invalid_argument(
+                    "SharedScanDiskCallback::callback: val is NULL");
+        }
+        setStatus(scan.received(std::move(val.item), BACKFILL_FROM_DISK));
+    }
+
+private:
+    SharedDiskScan& scan;
+};
+
+SharedDiskScan::SharedDiskScan(EventuallyPersistentEngine& e,
+                               uint16_t vbid,
+                               ValueFilter valFilter)
+    : engine(e),
+      vbid(vbid),
+      valFilter(valFilter),
+      scanCtx(nullptr),
+      driver(nullptr),
+      position(0),
+      itemsRead(0),
+      finished(false) {
+}
+
+SharedDiskScan::~SharedDiskScan() {
+    if (scanCtx) {
+        engine.getKVBucket()->getROUnderlying(vbid)->destroyScanContext(
+                scanCtx);
+    }
+}
+
+bool SharedDiskScan::open(std::shared_ptr<SharedScanParticipant> owner) {
+    auto stream = owner->stream.lock();
+    if (!stream) {
+        return false;
+    }
+
+    const uint64_t startSeqno = owner->nextSeqno;
+    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
+    scanCtx = kvstore->initScanContext(
+            std::make_shared<SharedScanDiskCallback>(*this),
+            std::make_shared<SharedScanCacheCallback>(*this),
+            vbid,
+            startSeqno,
+            DocumentFilter::ALL_ITEMS,
+            valFilter);
+    if (!scanCtx) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lh(participantsMutex);
+    position = startSeqno;
+    stream->incrBackfillRemaining(scanCtx->documentCount);
+    stream->markDiskSnapshot(startSeqno, scanCtx->maxSeqno);
+    owner->snapshotEnd = scanCtx->maxSeqno;
+    participants.push_back(owner);
+    return true;
+}
+
+bool SharedDiskScan::attach(std::shared_ptr<SharedScanParticipant> p,
+                            ValueFilter filter,
+                            bool newSnapshot,
+                            uint64_t minEnd) {
+    std::lock_guard<std::mutex> lh(participantsMutex);
+    return attach_UNLOCKED(p, filter, newSnapshot, minEnd);
+}
+
+bool SharedDiskScan::attach_UNLOCKED(std::shared_ptr<SharedScanParticipant> p,
+                                     ValueFilter filter,
+                                     bool newSnapshot,
+                                     uint64_t minEnd) {
+    // An abandoned scan (no participants) is left to be destroyed.
+    if (!scanCtx || finished || countParticipants() == 0 ||
+        filter != valFilter || position > p->nextSeqno) {
+        return false;
+    }
+
+    const uint64_t maxSeqno = scanCtx->maxSeqno;
+    if (newSnapshot) {
+        if (maxSeqno < minEnd) {
+            return false;
+        }
+        auto stream = p->stream.lock();
+        if (!stream) {
+            return false;
+        }
+        // Marked under participantsMutex so that no item can be sent to the
+        // stream ahead of its snapshot marker.
+        // The participant only needs what the scan has still to read. This
+        // is an estimate: items between the scan's position and the
+        // participant's start (and any skipped as logically deleted) are
+        // counted too, but backfillRemaining is zeroed when the backfill
+        // completes.
+        const uint64_t count = scanCtx->documentCount;
+        stream->incrBackfillRemaining(count > itemsRead ? count - itemsRead
+                                                        : 0);
+        stream->markDiskSnapshot(p->nextSeqno, maxSeqno);
+        p->snapshotEnd = maxSeqno;
+    } else if (maxSeqno != p->snapshotEnd) {
+        // Only the snapshot the stream was already sent may be used; a
+        // newer one could be missing versions of documents in its range.
+        return false;
+    }
+
+    participants.push_back(p);
+    return true;
+}
+
+bool SharedDiskScan::moveFrom(SharedDiskScan& from,
+                              std::shared_ptr<SharedScanParticipant> p,
+                              ValueFilter filter) {
+    // Items are only sent with participantsMutex held, so holding both scans'
+    // mutexes the participant can be moved between them atomically.
+    std::lock(participantsMutex, from.participantsMutex);
+    std::lock_guard<std::mutex> lh(participantsMutex, std::adopt_lock);
+    std::lock_guard<std::mutex> fromLh(from.participantsMutex,
+                                       std::adopt_lock);
+    if (!attach_UNLOCKED(p, filter, /*newSnapshot*/ false, 0)) {
+        return false;
+    }
+
+    from.participants.erase(std::remove(from.participants.begin(),
+                                        from.participants.end(),
+                                        p),
+                            from.participants.end());
+    return true;
+}
+
+size_t SharedDiskScan::getNumParticipants() {
+    std::lock_guard<std::mutex> lh(participantsMutex);
+    return countParticipants();
+}
+
+size_t SharedDiskScan::countParticipants() const {
+    return std::count_if(participants.begin(),
+                         participants.end(),
+                         [](const auto& p) { return !p->done; });
+}
+
+scan_error_t SharedDiskScan::run(const SharedScanParticipant& driver) {
+    // Another participant's batch is bounded by its scan buffer, so rather
+    // than snoozing this backfill (for a whole BackfillManager sleep) wait
+    // for it and carry on from where it got to.
+    std::lock_guard<std::mutex> lh(scanMutex);
+
+    {
+        std::lock_guard<std::mutex> plh(participantsMutex);
+        if (finished) {
+            return scan_success;
+        }
+    }
+
+    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
+    this->driver = &driver;
+    scan_error_t error = kvstore->scan(scanCtx);
+    this->driver = nullptr;
+    if (error != scan_again) {
+        std::lock_guard<std::mutex> plh(participantsMutex);
+        finished = true;
+    }
+    return error;
+}
+
+ENGINE_ERROR_CODE SharedDiskScan::lookup(CacheLookup& lookup) {
+    VBucketPtr vb = engine.getKVBucket()->getVBucket(vbid);
+    if (!vb) {
+        return ENGINE_SUCCESS;
+    }
+
+    GetValue gv;
+    {
+        auto collectionsRHandle = vb->lockCollections(lookup.getKey());
+        // Check with collections if this key should be loaded, status EEXISTS
+        // is the only way to inform the scan to not continue with this key.
+        if (collectionsRHandle.isLogicallyDeleted(lookup.getBySeqno())) {
+            return ENGINE_KEY_EEXISTS;
+        }
+
+        gv = vb->getInternal(nullptr,
+                             engine,
+                             0,
+                             /*options*/ NONE,
+                             /*diskFlushAll*/ false,
+                             valFilter == ValueFilter::KEYS_ONLY
+                                     ? VBucket::GetKeyOnly::Yes
+                                     : VBucket::GetKeyOnly::No,
+                             collectionsRHandle);
+    }
+
+    if (gv.getStatus() == ENGINE_SUCCESS &&
+        gv.item->getBySeqno() == lookup.getBySeqno()) {
+        if (deliver(std::move(gv.item), BACKFILL_FROM_MEMORY) ==
+            ENGINE_SUCCESS) {
+            return ENGINE_KEY_EEXISTS;
+        }
+        return ENGINE_ENOMEM; // Pause the backfill
+    }
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE SharedDiskScan::received(std::unique_ptr<Item> item,
+                                           backfill_source_t source) {
+    // MB-26705: Make the backfilled item cold so ideally the consumer would
+    // evict this before any cached item if they get into memory pressure.
+    item->setNRUValue(MAX_NRU_VALUE);
+    return deliver(std::move(item), source);
+}
+
+ENGINE_ERROR_CODE SharedDiskScan::deliver(std::unique_ptr<Item> item,
+                                          backfill_source_t source) {
+    const uint64_t seqno = item->getBySeqno();
+
+    std::lock_guard<std::mutex> lh(participantsMutex);
+    std::vector<std::pair<std::shared_ptr<ActiveStream>,
+                          SharedScanParticipant*>>
+            targets;
+    for (auto it = participants.begin(); it != participants.end();) {
+        const auto& p = *it;
+        if (p->done) {
+            it = participants.erase(it);
+            continue;
+        }
+        auto stream = p->stream.lock();
+        if (stream && stream->isActive() && p->nextSeqno <= seqno) {
+            targets.emplace_back(std::move(stream), p.get());
+        }
+        ++it;
+    }
+
+    size_t sent = 0;
+    for (auto& target : targets) {
+        // The last stream can have the item itself, the others get a copy.
+        auto copy = (sent + 1 == targets.size())
+                            ? std::move(item)
+                            : std::make_unique<Item>(*item);
+        // Only the driving backfill is running (and so has a scan buffer to
+        // account against); the others' scan buffers are only reset when
+        // their own backfills run.
+        const auto read = target.second == driver ? BackfillRead::Checked
+                                                  : BackfillRead::BufferOnly;
+        if (!target.first->backfillReceived(std::move(copy), source, read)) {
+            if (sent > 1) {
+                engine.getDcpConnMap().incrBackfillItemsShared(sent - 1);
+            }
+            return ENGINE_ENOMEM;
+        }
+        target.second->nextSeqno = seqno + 1;
+        ++sent;
+    }
+
+    if (sent > 1) {
+        engine.getDcpConnMap().incrBackfillItemsShared(sent - 1);
+    }
+    position = seqno + 1;
+    ++itemsRead;
+    return ENGINE_SUCCESS;
+}
+
+void SharedDiskScanRegistry::add(std::shared_ptr<SharedDiskScan> scan) {
+    std::lock_guard<std::mutex> lh(mutex);
+    scans.remove_if([](const auto& s) { return s.expired(); });
+    scans.push_back(scan);
+}
+
+std::shared_ptr<SharedDiskScan> SharedDiskScanRegistry::join(
+        std::shared_ptr<SharedScanParticipant> p,
+        ValueFilter filter,
+        uint64_t minEnd) {
+    std::lock_guard<std::mutex> lh(mutex);
+    for (const auto& weak : scans) {
+        auto scan = weak.lock();
+        if (scan && scan->attach(p, filter, /*newSnapshot*/ true, minEnd)) {
+            return scan;
+        }
+    }
+    return {};
+}
+
+std::shared_ptr<SharedDiskScan> SharedDiskScanRegistry::merge(
+        std::shared_ptr<SharedScanParticipant> p,
+        ValueFilter filter,
+        std::shared_ptr<SharedDiskScan> current) {
+    std::lock_guard<std::mutex> lh(mutex);
+    for (const auto& weak : scans) {
+        auto scan = weak.lock();
+        if (scan && scan != current && scan->moveFrom(*current, p, filter)) {
+            return scan;
+        }
+    }
+    return current;
+}
+
+DCPSharedBackfillDisk::DCPSharedBackfillDisk(
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<ActiveStream> s,
+        uint64_t startSeqno,
+        uint64_t endSeqno,
+        std::shared_ptr<SharedDiskScanRegistry> registry)
+    : DCPBackfill(s, startSeqno, endSeqno),
+      engine(e),
+      registry(registry),
+      valFilter(ValueFilter::VALUES_DECOMPRESSED),
+      state(backfill_state_init) {
+}
+
+backfill_status_t DCPSharedBackfillDisk::run() {
+    LockHolder lh(lock);
+    switch (state) {
+    case backfill_state_init:
+        return create();
+    case backfill_state_scanning:
+        return scan();
+    case backfill_state_completing:
+        return complete(false);
+    case backfill_state_done:
+        return backfill_finished;
+    }
+
+    throw std::logic_error(
+            "DCPSharedBackfillDisk::run: Invalid backfill state " +
+            std::to_string(state));
+}
+
+void DCPSharedBackfillDisk::cancel() {
+    LockHolder lh(lock);
+    if (state != backfill_state_done) {
+        complete(true);
+    }
+}
+
+backfill_status_t DCPSharedBackfillDisk::create() {
+    auto stream = streamPtr.lock();
+    if (!stream) {
+        LOG(EXTENSION_LOG_WARNING,
+            "DCPSharedBackfillDisk::create(): "
+            "(vb:%d) backfill create ended prematurely as the associated "
+            "stream is deleted by the producer conn ",
+            getVBucketId());
+        state = backfill_state_done;
+        return backfill_finished;
+    }
+
+    uint64_t lastPersistedSeqno =
+            engine.getKVBucket()->getLastPersistedSeqno(vbid);
+
+    if (lastPersistedSeqno < endSeqno) {
+        stream->log(EXTENSION_LOG_NOTICE,
+                    "(vb %d) Rescheduling backfill"
+                    "because backfill up to seqno %" PRIu64
+                    " is needed but only up to "
+                    "%" PRIu64 " is persisted",
+                    vbid,
+                    endSeqno,
+                    lastPersistedSeqno);
+        return backfill_snooze;
+    }
+
+    if (stream->isKeyOnly()) {
+        valFilter = ValueFilter::KEYS_ONLY;
+    } else if (stream->isCompressionEnabled()) {
+        valFilter = ValueFilter::VALUES_COMPRESSED;
+    }
+
+    participant = std::make_shared<SharedScanParticipant>(stream, startSeqno);
+    diskScan = registry->join(participant, valFilter, endSeqno);
+    if (diskScan) {
+        engine.getDcpConnMap().incrBackfillScansJoined();
+        state = backfill_state_scanning;
+        return backfill_success;
+    }
+
+    auto newScan = std::make_shared<SharedDiskScan>(engine, vbid, valFilter);
+    if (newScan->open(participant)) {
+        registry->add(newScan);
+        diskScan = std::move(newScan);
+        state = backfill_state_scanning;
+    } else {
+        auto vb = engine.getVBucket(vbid);
+        stream->log(EXTENSION_LOG_WARNING,
+                    "DCPSharedBackfillDisk::create(): "
+                    "(vb:%d) backfill create ended prematurely as the disk "
+                    "cannot be scanned. Associated stream is set to dead state"
+                    ". The vbucket state: %s",
+                    getVBucketId(),
+                    vb ? VBucket::toString(vb->getState()) : "vb not found!!");
+        stream->setDead(END_STREAM_BACKFILL_FAIL);
+        state = backfill_state_done;
+    }
+
+    return backfill_success;
+}
+
+backfill_status_t DCPSharedBackfillDisk::scan() {
+    auto stream = streamPtr.lock();
+    if (!stream || !stream->isActive()) {
+        return complete(true);
+    }
+
+    // While nobody else is reading from our scan, see if we have caught up
+    // with a scan of the same snapshot which we can read from instead.
+    if (diskScan->getNumParticipants() == 1) {
+        auto current = diskScan;
+        diskScan = registry->merge(participant, valFilter, current);
+        if (diskScan != current) {
+            engine.getDcpConnMap().incrBackfillScansJoined();
+        }
+    }
+
+    const uint64_t nextSeqno = participant->nextSeqno;
+    const auto error = diskScan->run(*participant);
+    if (error == scan_again) {
+        // If we got nothing, a participant's backfill buffer is full; give
+        // it time to drain rather than re-reading the same item. Once its
+        // buffer has drained that participant's own backfill drives the
+        // scan.
+        return participant->nextSeqno == nextSeqno ? backfill_snooze
+                                                   : backfill_success;
+    }
+
+    state = backfill_state_completing;
+    return backfill_success;
+}
+
+backfill_status_t DCPSharedBackfillDisk::complete(bool cancelled) {
+    if (diskScan) {
+        participant->done = true;
+        diskScan.reset();
+    }
+
+    auto stream = streamPtr.lock();
+    if (!stream) {
+        LOG(EXTENSION_LOG_WARNING,
+            "DCPSharedBackfillDisk::complete(): "
+            "(vb:%d) backfill create ended prematurely as the associated "
+            "stream is deleted by the producer conn; %s",
+            getVBucketId(),
+            cancelled ? "cancelled" : "finished");
+        state = backfill_state_done;
+        return backfill_finished;
+    }
+
+    stream->completeBackfill();
+
+    EXTENSION_LOG_LEVEL severity =
+            cancelled ? EXTENSION_LOG_NOTICE : EXTENSION_LOG_INFO;
+    stream->log(severity,
+                "(vb %d) Backfill task (%" PRIu64 " to %" PRIu64 ") %s",
+                vbid,
+                startSeqno,
+                endSeqno,
+                cancelled ? "cancelled" : "finished");
+
+    state = backfill_state_done;
+
+    return backfill_success;
+}
@@ -0,0 +1,273 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "dcp/backfill.h"
+#include "dcp/backfill_disk.h"
+#include "kvstore.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <vector>
+
+class EventuallyPersistentEngine;
+
+/**
+ * A stream reading its backfill from a SharedDiskScan.
+ */
+struct SharedScanParticipant {
+    SharedScanParticipant(std::shared_ptr<ActiveStream> s, uint64_t startSeqno)
+        : stream(s), nextSeqno(startSeqno), snapshotEnd(0), done(false) {
+    }
+
+    const std::weak_ptr<ActiveStream> stream;
+
+    /// Seqno of the next item the stream needs from the scan.
+    std::atomic<uint64_t> nextSeqno;
+
+    /// End of the disk snapshot which was sent to the stream.
+    std::atomic<uint64_t> snapshotEnd;
+
+    /**
+     * Set when the backfill has finished with the scan. Backfills can be
+     * cancelled with their BackfillManager's lock held, which may not be
+     * taken before SharedDiskScan::participantsMutex; the scan drops done
+     * participants itself.
+     */
+    std::atomic<bool> done;
+};
+
+/**
+ * One by-seqno scan of a vBucket's disk snapshot, whose items are sent to
+ * every attached participant.
+ *
+ * A participant may attach as long as the scan has not yet read past the
+ * participant's next seqno; items below that are simply not sent to it.
+ * Any participant's backfill may drive the scan, one at a time. Only the
+ * driving backfill's scan buffer limits how much is read per run; the other
+ * participants are only limited by their connection's backfill buffer. When
+ * a participant cannot accept an item the scan pauses and the item is read
+ * again on resume, so the participants which already took it are skipped -
+ * i.e. the scan goes at the pace of its slowest participant.
+ */
+class SharedDiskScan {
+public:
+    SharedDiskScan(EventuallyPersistentEngine& e,
+                   uint16_t vbid,
+                   ValueFilter valFilter);
+
+    ~SharedDiskScan();
+
+    /**
+     * Create the scan context, starting at owner's next seqno, and attach
+     * owner, sending it the disk snapshot marker.
+     *
+     * @return false if the disk cannot be scanned.
+     */
+    bool open(std::shared_ptr<SharedScanParticipant> owner);
+
+    /**
+     * Attach a participant to this scan, if the scan can still send it every
+     * item it needs.
+     *
+     * @param newSnapshot true if the participant has not yet been sent a disk
+     *        snapshot; it is sent one covering this scan, which must reach at
+     *        least minEnd. Otherwise the scan must cover exactly the
+     *        snapshot the participant was already sent.
+     * @return true if attached.
+     */
+    bool attach(std::shared_ptr<SharedScanParticipant> p,
+                ValueFilter filter,
+                bool newSnapshot,
+                uint64_t minEnd);
+
+    /**
+     * Move a participant from another scan onto this one, if this scan covers
+     * exactly the snapshot the participant was already sent and hasn't read
+     * past its next seqno. The participant is never attached to both scans,
+     * so it cannot be sent an item twice.
+     *
+     * @return true if moved.
+     */
+    bool moveFrom(SharedDiskScan& from,
+                  std::shared_ptr<SharedScanParticipant> p,
+                  ValueFilter filter);
+
+    /// @return the number of participants which have not finished.
+    size_t getNumParticipants();
+
+    /**
+     * Read the next batch of items, sending them to the participants. If
+     * another participant's backfill is running the scan, waits for it to
+     * finish its batch first.
+     *
+     * @param driver the participant whose backfill is running the scan; the
+     *        batch is limited by its scan buffer.
+     * @return the result of the KVStore scan.
+     */
+    scan_error_t run(const SharedScanParticipant& driver);
+
+    /* Scan callbacks */
+
+    ENGINE_ERROR_CODE lookup(CacheLookup& lookup);
+
+    ENGINE_ERROR_CODE received(std::unique_ptr<Item> item,
+                               backfill_source_t source);
+
+private:
+    /**
+     * Send an item to every participant which still needs it.
+     *
+     * @return ENGINE_ENOMEM if a participant could not take it, pausing the
+     *         scan.
+     */
+    ENGINE_ERROR_CODE deliver(std::unique_ptr<Item> item,
+                              backfill_source_t source);
+
+    /// Implementation of attach; participantsMutex must be held.
+    bool attach_UNLOCKED(std::shared_ptr<SharedScanParticipant> p,
+                         ValueFilter filter,
+                         bool newSnapshot,
+                         uint64_t minEnd);
+
+    /// Count of participants not yet done; participantsMutex must be held.
+    size_t countParticipants() const;
+
+    EventuallyPersistentEngine& engine;
+    const uint16_t vbid;
+    const ValueFilter valFilter;
+
+    /// Held by whichever backfill is running the scan.
+    std::mutex scanMutex;
+    ScanContext* scanCtx;
+    /// The participant whose backfill is running the scan (under scanMutex).
+    const SharedScanParticipant* driver;
+
+    /// Guards the participants and the progress of the scan.
+    std::mutex participantsMutex;
+    std::vector<std::shared_ptr<SharedScanParticipant>> participants;
+
+    /// All items below this seqno have been read and sent.
+    uint64_t position;
+    /// Number of items the scan has read so far, to estimate how many a late
+    /// joiner has left.
+    size_t itemsRead;
+    bool finished;
+};
+
+/**
+ * The in-progress SharedDiskScans of a vBucket, which new disk backfills
+ * look through for one to attach to.
+ */
+class SharedDiskScanRegistry {
+public:
+    void add(std::shared_ptr<SharedDiskScan> scan);
+
+    /**
+     * Attach a participant which hasn't been sent a disk snapshot yet to an
+     * in-progress scan reaching at least minEnd.
+     *
+     * @return the scan joined, or nullptr if there was none suitable.
+     */
+    std::shared_ptr<SharedDiskScan> join(
+            std::shared_ptr<SharedScanParticipant> p,
+            ValueFilter filter,
+            uint64_t minEnd);
+
+    /**
+     * Move a participant from its current scan onto another scan of the same
+     * snapshot, if there is one which hasn't got past it yet.
+     *
+     * @return the scan the participant is now attached to.
+     */
+    std::shared_ptr<SharedDiskScan> merge(
+            std::shared_ptr<SharedScanParticipant> p,
+            ValueFilter filter,
+            std::shared_ptr<SharedDiskScan> current);
+
+private:
+    std::mutex mutex;
+    std::list<std::weak_ptr<SharedDiskScan>> scans;
+};
+
+/**
+ * Disk backfill which reads from a scan shared with the other streams
+ * backfilling the same vBucket.
+ *
+ * When created it attaches to an in-progress scan which hasn't yet got past
+ * its start seqno, otherwise it starts its own scan and registers it for
+ * others to join. While it is the only participant of its scan it keeps
+ * looking for another scan of the same snapshot which it has caught up with,
+ * and moves over to that one.
+ *
+ * Limitation: a late joiner (one which found no scan to attach to) reads its
+ * whole range with its own scan unless it can merge. Merging needs the other
+ * scan to have been opened on the same snapshot (same max seqno) - reading
+ * the joiner's missing range from a different snapshot could miss versions
+ * of documents - and so does not happen once the vBucket has persisted
+ * anything between the two scans being opened. A ranged catch-up scan of an
+ * existing snapshot is not possible through the KVStore interface, which
+ * opens a new snapshot for every scan context.
+ */
+class DCPSharedBackfillDisk : public DCPBackfill {
+public:
+    DCPSharedBackfillDisk(EventuallyPersistentEngine& e,
+                          std::shared_ptr<ActiveStream> s,
+                          uint64_t startSeqno,
+                          uint64_t endSeqno,
+                          std::shared_ptr<SharedDiskScanRegistry> registry);
+
+    backfill_status_t run() override;
+
+    void cancel() override;
+
+private:
+    /**
+     * Attaches to a scan (joining or creating one). Backfill snapshot range
+     * is decided here.
+     */
+    backfill_status_t create();
+
+    /**
+     * Runs the scan, unless another stream's backfill is already doing so.
+     */
+    backfill_status_t scan();
+
+    /**
+     * Handles the completion of the backfill.
+     * Detaches from the scan, indicates the completion to the stream.
+     *
+     * @param cancelled indicates the if backfill finished fully or was
+     *                  cancelled in between; for debug
+     */
+    backfill_status_t complete(bool cancelled);
+
+    EventuallyPersistentEngine& engine;
+
+    const std::shared_ptr<SharedDiskScanRegistry> registry;
+
+    std::shared_ptr<SharedScanParticipant> participant;
+    std::shared_ptr<SharedDiskScan> diskScan;
+    ValueFilter valFilter;
+
+    backfill_state_t state;
+    std::mutex lock;
+};
@@ -95,7 +95,7 @@ backfill_status_t DCPBackfillMemory::run() {
     /* Move every item to the stream */
     for (auto& item : items) {
         stream->backfillReceived(
-                std::move(item), BACKFILL_FROM_MEMORY, /*force*/ true);
+                std::move(item), BACKFILL_FROM_MEMORY, BackfillRead::Forced);
     }
 
     /* Indicate completion to the stream */
@@ -260,8 +260,9 @@ backfill_status_t DCPBackfillMemoryBuffered::scan() {
         }
 
         int64_t seqnoDbg = item->getBySeqno();
-        if (!stream->backfillReceived(
-                    std::move(item), BACKFILL_FROM_MEMORY, /*force*/ false)) {
+        if (!stream->backfillReceived(std::move(item),
+                                      BACKFILL_FROM_MEMORY,
+                                      BackfillRead::Checked)) {
             /* Try backfill again later; here we do not snooze because we
                want to check if other backfills can be run by the
                backfillMgr */
@@ -44,6 +44,7 @@ class DcpConsumerTask : public GlobalTask {
 public:
     DcpConsumerTask(EventuallyPersistentEngine* e,
                     std::shared_ptr<DcpConsumer> c,
+                    size_t worker,
                     double sleeptime = 1,
                     bool completeBeforeShutdown = true)
         : GlobalTask(e,
@@ -51,14 +52,18 @@ public:
                      sleeptime,
                      completeBeforeShutdown),
           consumerPtr(c),
+          worker(worker),
           description("DcpConsumerTask, processing buffered items for " +
-                      c->getName()) {
+                      c->getName() +
+                      (c->getNumProcessorWorkers() > 1
+                               ? " (worker " + std::to_string(worker) + ")"
+                               : std::string())) {
     }
 
     ~DcpConsumerTask() {
         auto consumer = consumerPtr.lock();
         if (consumer) {
-            consumer->taskCancelled();
+            consumer->taskCancelled(worker, getId());
         }
     }
 
@@ -74,7 +79,8 @@ public:
         }
 
         double sleepFor = 0.0;
-        enum process_items_error_t state = consumer->processBufferedItems();
+        enum process_items_error_t state =
+                consumer->processBufferedItems(worker);
         switch (state) {
             case all_processed:
                 sleepFor = INT_MAX;
@@ -92,30 +98,30 @@ public:
         // Check if we've been notified of more work to do - if not then sleep;
         // if so then wakeup and re-run the task.
         // Note: The order of the wakeUp / snooze here is *critical* - another
-        // thread may concurrently notify us (set processorNotification=true)
+        // thread may concurrently notify us (set the worker notification=true)
         // while we are performing the checks, so we need to ensure we don't
         // loose a wakeup as that would result in this Task sleeping forever
         // (and DCP hanging).
         // To prevent this, we perform an initial check of notifiedProcessor(),
         // which if false we initially sleep, and then check a second time.
-        // We could race if the other actor sets processorNotification=true
+        // We could race if the other actor sets the worker notification=true
         // between the second `if(consumer->notifiedProcessor)` and us calling
         // `wakeUp()`; but that's essentially a benign race as it will just
         // result in wakeUp() being called twice which is benign.
-        if (consumer->notifiedProcessor(false)) {
+        if (consumer->notifiedProcessor(false, worker)) {
             wakeUp();
             state = more_to_process;
         } else {
             snooze(sleepFor);
             // Check if the processor was notified again,
             // in which case the task should wake immediately.
-            if (consumer->notifiedProcessor(false)) {
+            if (consumer->notifiedProcessor(false, worker)) {
                 wakeUp();
                 state = more_to_process;
             }
         }
 
-        consumer->setProcessorTaskState(state);
+        consumer->setProcessorTaskState(state, worker);
 
         return true;
     }
@@ -131,9 +137,12 @@ public:
     }
 
 private:
-    /* we have one task per consumer. the task only needs a reference to the
-       consumer object and does not own it. Hence std::weak_ptr should be used*/
+    /* we have one task per processor worker of the consumer. the task only
+       needs a reference to the consumer object and does not own it. Hence
+       std::weak_ptr should be used*/
     const std::weak_ptr<DcpConsumer> consumerPtr;
+    /* The index of the processor worker the task runs for */
+    const size_t worker;
     const std::string description;
 };
 
@@ -144,14 +153,11 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
       lastMessageTime(ep_current_time()),
       engine(engine),
       opaqueCounter(0),
-      processorTaskId(0),
-      processorTaskState(all_processed),
-      processorNotification(false),
       backoffs(0),
+      bufferedBytesApplied(0),
       dcpIdleTimeout(engine.getConfiguration().getDcpIdleTimeout()),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
       pendingSendStreamEndOnClientStreamClose(true),
-      processorTaskRunning(false),
       flowControl(engine, this),
       processBufferedMessagesYieldThreshold(
               engine.getConfiguration()
@@ -170,6 +176,12 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
     pendingSetPriority = true;
     pendingEnableExtMetaData = true;
     pendingSupportCursorDropping = true;
+
+    const auto numWorkers =
+            config.getDcpConsumerProcessBufferedMessagesWorkers();
+    for (size_t ii = 0; ii < numWorkers; ++ii) {
+        workers.emplace_back(std::make_unique<ProcessorWorker>());
+    }
 }
 
 DcpConsumer::~DcpConsumer() {
@@ -178,14 +190,17 @@ DcpConsumer::~DcpConsumer() {
 
 
 void DcpConsumer::cancelTask() {
-    bool exp = true;
-    if (processorTaskRunning.compare_exchange_strong(exp, false)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+    for (auto& worker : workers) {
+        const auto taskId = worker->taskId.exchange(0);
+        if (taskId != 0) {
+            ExecutorPool::get()->cancel(taskId);
+        }
     }
 }
 
-void DcpConsumer::taskCancelled() {
-    processorTaskRunning.store(false);
+void DcpConsumer::taskCancelled(size_t worker, size_t taskId) {
+    // Only forget the worker's task if it hasn't already been replaced.
+    workers.at(worker)->taskId.compare_exchange_strong(taskId, 0);
 }
 
 std::shared_ptr<PassiveStream> DcpConsumer::makePassiveStream(
@@ -263,13 +278,16 @@ ENGINE_ERROR_CODE DcpConsumer::addStream(uint32_t opaque, uint16_t vbucket,
         }
     }
 
-    /* We need 'Processor' task only when we have a stream. Hence create it
-     only once when the first stream is added */
-    bool exp = false;
-    if (processorTaskRunning.compare_exchange_strong(exp, true)) {
-        ExTask task = std::make_shared<DcpConsumerTask>(
-                &engine, shared_from_this(), 1);
-        processorTaskId = ExecutorPool::get()->schedule(task);
+    /* We need 'Processor' tasks only when we have a stream. Hence create
+     them when the first stream is added, and replace any which have since
+     been cancelled */
+    for (size_t ii = 0; ii < workers.size(); ++ii) {
+        if (workers[ii]->taskId.load() == 0) {
+            ExTask task = std::make_shared<DcpConsumerTask>(
+                    &engine, shared_from_this(), ii, 1);
+            workers[ii]->taskId = task->getId();
+            ExecutorPool::get()->schedule(task);
+        }
     }
 
     streams.insert({vbucket,
@@ -874,8 +892,26 @@ void DcpConsumer::addStats(ADD_STAT add_stat, const void *c) {
         stream->addStats(add_stat, c);
     }
 
+    size_t backlogItems = 0;
+    size_t backlogBytes = 0;
+    for (const auto& stream : valid_streams) {
+        backlogItems += stream->getNumBufferedMessages();
+        backlogBytes += stream->getBufferedBytes();
+    }
+
     addStat("total_backoffs", backoffs, add_stat, c);
     addStat("processor_task_state", getProcessorTaskStatusStr(), add_stat, c);
+    addStat("processor_workers", workers.size(), add_stat, c);
+    for (size_t ii = 0; ii < workers.size(); ++ii) {
+        addStat(("processor_worker_" + std::to_string(ii) + "_vbuckets_ready")
+                        .c_str(),
+                workers[ii]->vbReady.size(),
+                add_stat,
+                c);
+    }
+    addStat("buffered_bytes_applied", bufferedBytesApplied, add_stat, c);
+    addStat("buffered_items_backlog", backlogItems, add_stat, c);
+    addStat("buffered_bytes_backlog", backlogBytes, add_stat, c);
     flowControl.addStats(add_stat, c);
 }
 
@@ -892,12 +928,14 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
         switch (engine_.getReplicationThrottle().getStatus()) {
         case ReplicationThrottle::Status::Pause:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getWorker(stream->getVBucket()).vbReady.pushUnique(
+                    stream->getVBucket());
             return cannot_process;
 
         case ReplicationThrottle::Status::Disconnect:
             backoffs++;
-            vbReady.pushUnique(stream->getVBucket());
+            getWorker(stream->getVBucket()).vbReady.pushUnique(
+                    stream->getVBucket());
             logger.log(EXTENSION_LOG_WARNING,
                        "vb:%" PRIu16
                        " Processor task indicating disconnection as "
@@ -913,6 +951,7 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
                 backoffs++;
             }
             flowControl.incrFreedBytes(bytesProcessed);
+            bufferedBytesApplied += bytesProcessed;
 
             // Notifying memcached on clearing items for flow control
             notifyConsumerIfNecessary(false /*schedule*/);
@@ -926,7 +965,8 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
 
     // The stream may not be done yet so must go back in the ready queue
     if (bytesProcessed > 0) {
-        vbReady.pushUnique(stream->getVBucket());
+        getWorker(stream->getVBucket()).vbReady.pushUnique(
+                stream->getVBucket());
         if (rval == stop_processing) {
             return stop_processing;
         }
@@ -936,8 +976,9 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
     return rval;
 }
 
-process_items_error_t DcpConsumer::processBufferedItems() {
+process_items_error_t DcpConsumer::processBufferedItems(size_t worker) {
     process_items_error_t process_ret = all_processed;
+    auto& vbReady = workers.at(worker)->vbReady;
     uint16_t vbucket = 0;
     while (vbReady.popFront(vbucket)) {
         auto stream = findStream(vbucket);
@@ -972,23 +1013,38 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 }
 
 void DcpConsumer::notifyVbucketReady(uint16_t vbucket) {
-    if (vbReady.pushUnique(vbucket) &&
-        notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+    const auto index = getWorkerIndex(vbucket);
+    auto& worker = *workers[index];
+    if (worker.vbReady.pushUnique(vbucket) &&
+        notifiedProcessor(true, index)) {
+        ExecutorPool::get()->wake(worker.taskId);
     }
 }
 
-bool DcpConsumer::notifiedProcessor(bool to) {
+bool DcpConsumer::notifiedProcessor(bool to, size_t worker) {
     bool inverse = !to;
-    return processorNotification.compare_exchange_strong(inverse, to);
+    return workers.at(worker)->notification.compare_exchange_strong(inverse,
+                                                                    to);
 }
 
-void DcpConsumer::setProcessorTaskState(enum process_items_error_t to) {
-    processorTaskState = to;
+void DcpConsumer::setProcessorTaskState(enum process_items_error_t to,
+                                        size_t worker) {
+    workers.at(worker)->taskState = to;
 }
 
 std::string DcpConsumer::getProcessorTaskStatusStr() {
-    switch (processorTaskState.load()) {
+    // Report the "worst" state of all of the workers
+    auto state = all_processed;
+    for (const auto& worker : workers) {
+        const auto workerState = worker->taskState.load();
+        if (workerState == stop_processing ||
+            (workerState == cannot_process && state != stop_processing) ||
+            (workerState == more_to_process && state == all_processed)) {
+            state = workerState;
+        }
+    }
+
+    switch (state) {
         case all_processed:
             return "ALL_PROCESSED";
         case more_to_process:
@@ -27,6 +27,9 @@
 
 #include <relaxed_atomic.h>
 
+#include <memory>
+#include <vector>
+
 class DcpResponse;
 class StreamEndResponse;
 
@@ -174,7 +177,11 @@ public:
 
     void closeStreamDueToVbStateChange(uint16_t vbucket, vbucket_state_t state);
 
-    process_items_error_t processBufferedItems();
+    /**
+     * Apply the buffered messages for the vbuckets served by the given
+     * processor worker (called by the worker's DcpConsumerTask)
+     */
+    process_items_error_t processBufferedItems(size_t worker = 0);
 
     uint64_t incrOpaqueCounter();
 
@@ -188,11 +195,23 @@ public:
 
     void cancelTask();
 
-    void taskCancelled();
+    /**
+     * Called when the task of a processor worker is destroyed.
+     *
+     * @param worker index of the worker the task ran for
+     * @param taskId id of the destroyed task
+     */
+    void taskCancelled(size_t worker, size_t taskId);
+
+    bool notifiedProcessor(bool to, size_t worker = 0);
 
-    bool notifiedProcessor(bool to);
+    void setProcessorTaskState(enum process_items_error_t to,
+                               size_t worker = 0);
 
-    void setProcessorTaskState(enum process_items_error_t to);
+    /// The number of processor workers (DcpConsumerTasks) of the consumer
+    size_t getNumProcessorWorkers() const {
+        return workers.size();
+    }
 
     std::string getProcessorTaskStatusStr();
 
@@ -299,14 +318,34 @@ protected:
                                 uint32_t opaque,
                                 uint64_t rollbackSeqno);
 
+    /**
+     * The state of one of the 'Processor' tasks applying the buffered
+     * messages. Every vbucket is served by a single worker (see getWorker)
+     * so the messages for a vbucket are applied in order, while the
+     * messages for vbuckets served by different workers are applied
+     * concurrently.
+     */
+    struct ProcessorWorker {
+        // Id of the worker's task, 0 if it has none scheduled
+        std::atomic<size_t> taskId{0};
+        std::atomic<enum process_items_error_t> taskState{all_processed};
+        DcpReadyQueue vbReady;
+        std::atomic<bool> notification{false};
+    };
+
+    size_t getWorkerIndex(uint16_t vbucket) const {
+        return vbucket % workers.size();
+    }
+
+    ProcessorWorker& getWorker(uint16_t vbucket) {
+        return *workers[getWorkerIndex(vbucket)];
+    }
+
     /* Reference to the ep engine; need to create the 'Processor' task */
     EventuallyPersistentEngine& engine;
     uint64_t opaqueCounter;
-    size_t processorTaskId;
-    std::atomic<enum process_items_error_t> processorTaskState;
 
-    DcpReadyQueue vbReady;
-    std::atomic<bool> processorNotification;
+    std::vector<std::unique_ptr<ProcessorWorker>> workers;
 
     std::mutex readyMutex;
     std::list<uint16_t> ready;
@@ -323,6 +362,8 @@ protected:
     opaque_map opaqueMap_;
 
     Couchbase::RelaxedAtomic<uint32_t> backoffs;
+    // The number of bytes of buffered messages applied by the workers
+    Couchbase::RelaxedAtomic<uint64_t> bufferedBytesApplied;
     // The maximum interval between dcp messages before the consumer disconnects
     const std::chrono::seconds dcpIdleTimeout;
     // The interval that the consumer tells the producer to send noops
@@ -335,9 +376,6 @@ protected:
     bool pendingSupportCursorDropping;
     bool pendingSendStreamEndOnClientStreamClose;
 
-    /* Indicates if the 'Processor' task is running */
-    std::atomic<bool> processorTaskRunning;
-
     FlowControl flowControl;
 
        /**
@@ -75,6 +75,21 @@ enum class IncludeXattrs {
     No,
 };
 
+/*
+ * BackfillRead is used to state how an item read by a backfill is accounted
+ * against the BackfillManager of the stream's connection.
+ */
+enum class BackfillRead {
+    // Read only if the item fits both the scan buffer and the backfill buffer
+    Checked,
+    // Read irrespective of the scan buffer and backfill buffer usage
+    Forced,
+    // Read only if the item fits the backfill buffer. For the items a shared
+    // disk scan reads on behalf of another connection's backfill, which is
+    // what the scan buffer limits.
+    BufferOnly,
+};
+
 /**
  * DcpReadyQueue is a std::queue wrapper for managing a
  * queue of vbuckets that are ready for a DCP producer/consumer to process.
@@ -40,7 +40,9 @@ private:
 
 DcpConnMap::DcpConnMap(EventuallyPersistentEngine &e)
     : ConnMap(e),
-      aggrDcpConsumerBufferSize(0) {
+      aggrDcpConsumerBufferSize(0),
+      backfillScansJoined(0),
+      backfillItemsShared(0) {
     backfills.numActiveSnoozing = 0;
     updateMaxActiveSnoozingBackfills(engine.getEpStats().getMaxDataSize());
     minCompressionRatioForProducer.store(
@@ -437,6 +439,14 @@ void DcpConnMap::addStats(ADD_STAT add_stat, const void *c) {
     LockHolder lh(connsLock);
     add_casted_stat("ep_dcp_dead_conn_count", deadConnections.size(), add_stat,
                     c);
+    add_casted_stat("ep_dcp_backfill_scans_joined",
+                    backfillScansJoined.load(),
+                    add_stat,
+                    c);
+    add_casted_stat("ep_dcp_backfill_items_shared",
+                    backfillItemsShared.load(),
+                    add_stat,
+                    c);
 }
 
 void DcpConnMap::updateMinCompressionRatioForProducers(float value) {
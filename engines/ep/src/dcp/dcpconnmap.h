@@ -120,6 +120,24 @@ public:
         return backfills.maxActiveSnoozing;
     }
 
+    /* Records a disk backfill attaching to a scan started by another stream */
+    void incrBackfillScansJoined() {
+        backfillScansJoined++;
+    }
+
+    /* Records items read once from disk but sent to several streams */
+    void incrBackfillItemsShared(size_t by) {
+        backfillItemsShared += by;
+    }
+
+    size_t getBackfillScansJoined() const {
+        return backfillScansJoined;
+    }
+
+    size_t getBackfillItemsShared() const {
+        return backfillItemsShared;
+    }
+
     ENGINE_ERROR_CODE addPassiveStream(ConnHandler& conn, uint32_t opaque,
                                        uint16_t vbucket, uint32_t flags);
 
@@ -201,5 +219,11 @@ protected:
     /* Total memory used by all DCP consumer buffers */
     std::atomic<size_t> aggrDcpConsumerBufferSize;
 
+    /* Number of disk backfills which attached to another stream's scan */
+    std::atomic<size_t> backfillScansJoined;
+
+    /* Number of extra item deliveries made by shared backfill scans */
+    std::atomic<size_t> backfillItemsShared;
+
     class DcpConfigChangeListener;
 };
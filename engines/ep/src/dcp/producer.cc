@@ -871,12 +871,20 @@ void DcpProducer::notifyBackfillManager() {
     backfillMgr->wakeUpTask();
 }
 
-bool DcpProducer::recordBackfillManagerBytesRead(size_t bytes, bool force) {
-    if (force) {
+bool DcpProducer::recordBackfillManagerBytesRead(size_t bytes,
+                                                 BackfillRead read) {
+    switch (read) {
+    case BackfillRead::Checked:
+        return backfillMgr->bytesCheckAndRead(bytes);
+    case BackfillRead::Forced:
         backfillMgr->bytesForceRead(bytes);
         return true;
+    case BackfillRead::BufferOnly:
+        return backfillMgr->bytesCheckAndReadBuffer(bytes);
     }
-    return backfillMgr->bytesCheckAndRead(bytes);
+    throw std::invalid_argument(
+            "DcpProducer::recordBackfillManagerBytesRead: invalid read:" +
+            std::to_string(int(read)));
 }
 
 void DcpProducer::recordBackfillManagerBytesSent(size_t bytes) {
@@ -136,7 +136,7 @@ public:
     void notifyStreamReady(uint16_t vbucket);
 
     void notifyBackfillManager();
-    bool recordBackfillManagerBytesRead(size_t bytes, bool force);
+    bool recordBackfillManagerBytesRead(size_t bytes, BackfillRead read);
     void recordBackfillManagerBytesSent(size_t bytes);
     void scheduleBackfillManager(VBucket& vb,
                                  std::shared_ptr<ActiveStream> s,
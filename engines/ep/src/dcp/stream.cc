@@ -267,6 +267,7 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
       producerPtr(p),
       lastSentSnapEndSeqno(0),
       chkptItemsExtractionInProgress(false),
+      chkptDrainedVersion(std::numeric_limits<uint64_t>::max()),
       includeValue(includeVal),
       includeXattributes(includeXattrs),
       filter(filter, manifest) {
@@ -483,7 +484,7 @@ void ActiveStream::markDiskSnapshot(uint64_t startSeqno, uint64_t endSeqno) {
 
 bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
                                     backfill_source_t backfill_source,
-                                    bool force) {
+                                    BackfillRead read) {
     if (!itm) {
         return false;
     }
@@ -496,7 +497,7 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
             auto producer = producerPtr.lock();
             if (!producer ||
                 !producer->recordBackfillManagerBytesRead(
-                        resp->getApproximateSize(), force)) {
+                        resp->getApproximateSize(), read)) {
                 // Deleting resp may also delete itm (which is owned by
                 // resp)
                 resp.reset();
@@ -919,6 +920,8 @@ std::unique_ptr<DcpResponse> ActiveStream::nextQueuedItem() {
 bool ActiveStream::nextCheckpointItem() {
     VBucketPtr vbucket = engine->getVBucket(vb_);
     if (vbucket &&
+        vbucket->checkpointManager->getPublishedVersion() !=
+                chkptDrainedVersion.load() &&
         vbucket->checkpointManager->getNumItemsForCursor(name_) > 0) {
         // schedule this stream to build the next checkpoint
         auto producer = producerPtr.lock();
@@ -1011,7 +1014,9 @@ void ActiveStream::getOutstandingItems(VBucketPtr &vb,
     chkptItemsExtractionInProgress.store(true);
 
     auto _begin_ = ProcessClock::now();
+    const auto version = vb->checkpointManager->getPublishedVersion();
     vb->checkpointManager->getAllItemsForCursor(name_, items);
+    chkptDrainedVersion.store(version);
     engine->getEpStats().dcpCursorsGetItemsHisto.add(
             std::chrono::duration_cast<std::chrono::microseconds>(
                     ProcessClock::now() - _begin_));
@@ -2238,6 +2243,62 @@ process_items_error_t PassiveStream::processBufferedMessages(uint32_t& processed
 
         std::unique_ptr<DcpResponse> response = buffer.pop_front(lh);
 
+        if (response->getEvent() == DcpResponse::Event::Mutation) {
+            // Apply the run of consecutive mutations at the front of the
+            // buffer (which all belong to the same snapshot, as any marker
+            // ends the run) as a single batch
+            std::vector<std::unique_ptr<DcpResponse>> mutations;
+            mutations.push_back(std::move(response));
+            while (count + mutations.size() < batchSize &&
+                   !buffer.messages.empty() &&
+                   buffer.messages.front()->getEvent() ==
+                           DcpResponse::Event::Mutation) {
+                mutations.push_back(buffer.pop_front(lh));
+            }
+
+            // Release bufMutex whilst we attempt to process the messages
+            // a lock inversion exists with connManager if we hold this.
+            lh.unlock();
+            const auto results = processMutations(mutations);
+            lh.lock();
+
+            size_t processed = 0;
+            for (; processed < results.size(); ++processed) {
+                const auto ret = results[processed];
+                if (ret == ENGINE_TMPFAIL || ret == ENGINE_ENOMEM) {
+                    failed = true;
+                    noMem = (ret == ENGINE_ENOMEM);
+                    break;
+                }
+                count++;
+                if (ret != ENGINE_ERANGE) {
+                    total_bytes_processed +=
+                            mutations[processed]->getMessageSize();
+                }
+            }
+
+            // If we failed and the stream is not dead, stash the failed
+            // mutation (and the ones after it) at the front of the queue and
+            // break the loop.
+            if (failed && isActive()) {
+                for (auto it = mutations.rbegin();
+                     it != mutations.rend() - processed;
+                     ++it) {
+                    buffer.push_front(std::move(*it), lh);
+                }
+                break;
+            }
+
+            // The stream is dead; account for the mutations which were not
+            // processed (as they would have been if cleared from the buffer)
+            for (; processed < mutations.size(); ++processed) {
+                count++;
+                total_bytes_processed +=
+                        mutations[processed]->getMessageSize();
+            }
+            continue;
+        }
+
         // Release bufMutex whilst we attempt to process the message
         // a lock inversion exists with connManager if we hold this.
         lh.unlock();
@@ -2245,9 +2306,6 @@ process_items_error_t PassiveStream::processBufferedMessages(uint32_t& processed
         message_bytes = response->getMessageSize();
 
         switch (response->getEvent()) {
-            case DcpResponse::Event::Mutation:
-                ret = processMutation(static_cast<MutationResponse*>(response.get()));
-                break;
             case DcpResponse::Event::Deletion:
             case DcpResponse::Event::Expiration:
                 ret = processDeletion(static_cast<MutationResponse*>(response.get()));
@@ -2334,36 +2392,11 @@ ENGINE_ERROR_CODE PassiveStream::processMutation(MutationResponse* mutation) {
         return ENGINE_DISCONNECT;
     }
 
-    if (uint64_t(*mutation->getBySeqno()) < cur_snapshot_start.load() ||
-        uint64_t(*mutation->getBySeqno()) > cur_snapshot_end.load()) {
-        log(EXTENSION_LOG_WARNING,
-            "(vb %d) Erroneous mutation [sequence "
-            "number does not fall in the expected snapshot range : "
-            "{snapshot_start (%" PRIu64 ") <= seq_no (%" PRIu64
-            ") <= "
-            "snapshot_end (%" PRIu64 ")]; Dropping the mutation!",
-            vb_,
-            cur_snapshot_start.load(),
-            *mutation->getBySeqno(),
-            cur_snapshot_end.load());
-        return ENGINE_ERANGE;
-    }
-
-    // MB-17517: Check for the incoming item's CAS validity. We /shouldn't/
-    // receive anything without a valid CAS, however given that versions without
-    // this check may send us "bad" CAS values, we should regenerate them (which
-    // is better than rejecting the data entirely).
-    if (!Item::isValidCas(mutation->getItem()->getCas())) {
-        log(EXTENSION_LOG_WARNING,
-            "Invalid CAS (0x%" PRIx64 ") received for mutation {vb:%" PRIu16
-            ", seqno:%" PRId64 "}. Regenerating new CAS",
-            mutation->getItem()->getCas(),
-            vb_,
-            mutation->getItem()->getBySeqno());
-        mutation->getItem()->setCas();
+    ENGINE_ERROR_CODE ret = checkMutation(*mutation);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
     }
 
-    ENGINE_ERROR_CODE ret;
     if (vb->isBackfillPhase()) {
         ret = engine->getKVBucket()->addBackfillItem(
                 *mutation->getItem(),
@@ -2400,6 +2433,115 @@ ENGINE_ERROR_CODE PassiveStream::processMutation(MutationResponse* mutation) {
     return ret;
 }
 
+std::vector<ENGINE_ERROR_CODE> PassiveStream::processMutations(
+        const std::vector<std::unique_ptr<DcpResponse>>& mutations) {
+    std::vector<ENGINE_ERROR_CODE> results;
+    VBucketPtr vb = engine->getVBucket(vb_);
+    auto consumer = consumerPtr.lock();
+    if (!vb || !consumer || vb->isBackfillPhase()) {
+        // Backfill items are queued into the vbucket's backfill queue (and
+        // not into the checkpoint), so there's nothing to gain by batching
+        // them; process them one at a time.
+        for (const auto& response : mutations) {
+            results.push_back(processMutation(
+                    static_cast<MutationResponse*>(response.get())));
+            if (results.back() == ENGINE_TMPFAIL ||
+                results.back() == ENGINE_ENOMEM) {
+                break;
+            }
+        }
+        return results;
+    }
+
+    results.resize(mutations.size(), ENGINE_SUCCESS);
+
+    // The items to set, and the index of the mutation each one came from
+    std::vector<Item*> items;
+    std::vector<size_t> itemIndex;
+    for (size_t ii = 0; ii < mutations.size(); ++ii) {
+        auto* mutation = static_cast<MutationResponse*>(mutations[ii].get());
+        results[ii] = checkMutation(*mutation);
+        if (results[ii] == ENGINE_SUCCESS) {
+            items.push_back(mutation->getItem().get());
+            itemIndex.push_back(ii);
+        }
+    }
+
+    size_t next = 0;
+    while (next < items.size()) {
+        const std::vector<Item*> batch(items.begin() + next, items.end());
+        size_t applied = 0;
+        const auto ret = engine->getKVBucket()->setWithMetaBatch(
+                vb_,
+                batch,
+                consumer->getCookie(),
+                {vbucket_state_active,
+                 vbucket_state_replica,
+                 vbucket_state_pending},
+                applied);
+
+        for (size_t ii = 0; ii < applied; ++ii) {
+            handleSnapshotEnd(vb, batch[ii]->getBySeqno());
+        }
+        next += applied;
+        if (ret == ENGINE_SUCCESS) {
+            break;
+        }
+
+        log(EXTENSION_LOG_WARNING,
+            "vb:%" PRIu16
+            " Got error '%s' while trying to process "
+            "mutation with seqno:%" PRId64,
+            vb_,
+            cb::to_string(cb::to_engine_errc(ret)).c_str(),
+            items[next]->getBySeqno());
+
+        const auto failedIndex = itemIndex[next];
+        results[failedIndex] = ret;
+        if (ret == ENGINE_TMPFAIL || ret == ENGINE_ENOMEM) {
+            // Nothing after the failed mutation has been processed
+            results.resize(failedIndex + 1);
+            break;
+        }
+        ++next;
+    }
+
+    return results;
+}
+
+ENGINE_ERROR_CODE PassiveStream::checkMutation(MutationResponse& mutation) {
+    if (uint64_t(*mutation.getBySeqno()) < cur_snapshot_start.load() ||
+        uint64_t(*mutation.getBySeqno()) > cur_snapshot_end.load()) {
+        log(EXTENSION_LOG_WARNING,
+            "(vb %d) Erroneous mutation [sequence "
+            "number does not fall in the expected snapshot range : "
+            "{snapshot_start (%" PRIu64 ") <= seq_no (%" PRIu64
+            ") <= "
+            "snapshot_end (%" PRIu64 ")]; Dropping the mutation!",
+            vb_,
+            cur_snapshot_start.load(),
+            *mutation.getBySeqno(),
+            cur_snapshot_end.load());
+        return ENGINE_ERANGE;
+    }
+
+    // MB-17517: Check for the incoming item's CAS validity. We /shouldn't/
+    // receive anything without a valid CAS, however given that versions without
+    // this check may send us "bad" CAS values, we should regenerate them (which
+    // is better than rejecting the data entirely).
+    if (!Item::isValidCas(mutation.getItem()->getCas())) {
+        log(EXTENSION_LOG_WARNING,
+            "Invalid CAS (0x%" PRIx64 ") received for mutation {vb:%" PRIu16
+            ", seqno:%" PRId64 "}. Regenerating new CAS",
+            mutation.getItem()->getCas(),
+            vb_,
+            mutation.getItem()->getBySeqno());
+        mutation.getItem()->setCas();
+    }
+
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE PassiveStream::processDeletion(MutationResponse* deletion) {
     VBucketPtr vb = engine->getVBucket(vb_);
     if (!vb) {
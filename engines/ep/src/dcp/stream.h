@@ -259,7 +259,7 @@ public:
 
     bool backfillReceived(std::unique_ptr<Item> itm,
                           backfill_source_t backfill_source,
-                          bool force);
+                          BackfillRead read);
 
     void completeBackfill();
 
@@ -486,6 +486,12 @@ private:
        items are added to the readyQ */
     std::atomic<bool> chkptItemsExtractionInProgress;
 
+    /* The published checkpoint version (see
+       CheckpointManager::getPublishedVersion) loaded before the cursor was
+       last drained. Used to avoid the queueLock when there's nothing new to
+       read. */
+    std::atomic<uint64_t> chkptDrainedVersion;
+
     // Whether the responses sent using this stream should contain the value
     IncludeValue includeValue;
     // Whether the responses sent using the stream should contain the xattrs
@@ -691,6 +697,18 @@ public:
 
     void addStats(ADD_STAT add_stat, const void* c) override;
 
+    /// The number of messages buffered waiting to be processed
+    size_t getNumBufferedMessages() const {
+        LockHolder lh(buffer.bufMutex);
+        return buffer.messages.size();
+    }
+
+    /// The size of the messages buffered waiting to be processed
+    size_t getBufferedBytes() const {
+        LockHolder lh(buffer.bufMutex);
+        return buffer.bytes;
+    }
+
     static const size_t batchSize;
 
 protected:
@@ -699,6 +717,26 @@ protected:
 
     ENGINE_ERROR_CODE processMutation(MutationResponse* mutation);
 
+    /**
+     * Process a run of consecutive (buffered) mutations. Outside of the
+     * backfill phase the mutations are set in the vbucket as a single batch
+     * (see KVBucket::setWithMetaBatch).
+     *
+     * @param mutations the mutations to process, in the order received
+     * @return the status of each mutation processed. Processing stops after
+     *         the first mutation which failed with ENGINE_TMPFAIL or
+     *         ENGINE_ENOMEM, in which case fewer statuses than mutations are
+     *         returned.
+     */
+    std::vector<ENGINE_ERROR_CODE> processMutations(
+            const std::vector<std::unique_ptr<DcpResponse>>& mutations);
+
+    /**
+     * Check that the mutation falls in the current snapshot (returning
+     * ENGINE_ERANGE if not), and regenerate its CAS if invalid.
+     */
+    ENGINE_ERROR_CODE checkMutation(MutationResponse& mutation);
+
     ENGINE_ERROR_CODE processDeletion(MutationResponse* deletion);
 
     /**
@@ -0,0 +1,355 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dictionary_compressor.h"
+
+#include <platform/processclock.h>
+
+#include <algorithm>
+
+#ifdef EP_USE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+/*
+ * zstd's guidance is that the training set should be around 100 times the
+ * size of the dictionary; individual samples are capped so that a handful
+ * of large documents cannot dominate it.
+ */
+static const size_t samplesPerDictByte = 100;
+
+struct DictionaryCompressor::Dictionary {
+    std::string data;
+#ifdef EP_USE_ZSTD
+    ZSTD_CDict* cdict = nullptr;
+    ZSTD_DDict* ddict = nullptr;
+
+    ~Dictionary() {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+    }
+#endif
+};
+
+#ifdef EP_USE_ZSTD
+/**
+ * zstd (de)compression contexts are relatively expensive to create, so
+ * idle ones are kept here and handed out to callers.
+ */
+struct DictionaryCompressor::Contexts {
+    ~Contexts() {
+        for (auto* ctx : cctxs) {
+            ZSTD_freeCCtx(ctx);
+        }
+        for (auto* ctx : dctxs) {
+            ZSTD_freeDCtx(ctx);
+        }
+    }
+
+    template <class T>
+    static T* acquire(std::mutex& m, std::vector<T*>& pool, T* (*create)()) {
+        {
+            std::lock_guard<std::mutex> lh(m);
+            if (!pool.empty()) {
+                T* ctx = pool.back();
+                pool.pop_back();
+                return ctx;
+            }
+        }
+        return create();
+    }
+
+    template <class T>
+    static void release(std::mutex& m, std::vector<T*>& pool, T* ctx) {
+        std::lock_guard<std::mutex> lh(m);
+        pool.push_back(ctx);
+    }
+
+    std::mutex mutex;
+    std::vector<ZSTD_CCtx*> cctxs;
+    std::vector<ZSTD_DCtx*> dctxs;
+};
+#else
+struct DictionaryCompressor::Contexts {};
+#endif
+
+DictionaryCompressor::DictionaryCompressor(int level, size_t dictSize)
+    : level(level), dictSize(dictSize), contexts(new Contexts) {
+}
+
+DictionaryCompressor::~DictionaryCompressor() = default;
+
+bool DictionaryCompressor::isSupported() {
+#ifdef EP_USE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DictionaryCompressor::setTrainingScheduler(
+        std::function<void()> scheduler) {
+    std::lock_guard<std::mutex> lh(mutex);
+    trainingScheduler = std::move(scheduler);
+}
+
+bool DictionaryCompressor::addSample(cb::const_char_buffer value) {
+#ifdef EP_USE_ZSTD
+    std::function<void()> scheduler;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (current || training || value.size() == 0) {
+            return false;
+        }
+
+        const size_t size = std::min(value.size(), dictSize);
+        samples.append(value.data(), size);
+        sampleSizes.push_back(size);
+        if (samples.size() < dictSize * samplesPerDictByte) {
+            return false;
+        }
+
+        trainingSet.swap(samples);
+        trainingSizes.swap(sampleSizes);
+        training = true;
+        scheduler = trainingScheduler;
+    }
+
+    if (scheduler) {
+        scheduler();
+    }
+    return true;
+#else
+    (void)value;
+    return false;
+#endif
+}
+
+bool DictionaryCompressor::train() {
+#ifdef EP_USE_ZSTD
+    std::string set;
+    std::vector<size_t> sizes;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (!training) {
+            return false;
+        }
+        set.swap(trainingSet);
+        sizes.swap(trainingSizes);
+    }
+
+    // Train outside of the lock so compress() and decompress() are not held
+    // up. Whatever the outcome sampling starts over once training is
+    // cleared; on failure we simply retry with fresh samples.
+    const auto start = ProcessClock::now();
+    auto entry = std::make_shared<Dictionary>();
+    entry->data.resize(dictSize);
+    const size_t dictLen = ZDICT_trainFromBuffer(&entry->data[0],
+                                                 entry->data.size(),
+                                                 set.data(),
+                                                 sizes.data(),
+                                                 unsigned(sizes.size()));
+    uint32_t id = 0;
+    if (!ZDICT_isError(dictLen)) {
+        entry->data.resize(dictLen);
+        entry->cdict = ZSTD_createCDict(
+                entry->data.data(), entry->data.size(), level);
+        entry->ddict = ZSTD_createDDict(entry->data.data(),
+                                        entry->data.size());
+        id = ZDICT_getDictID(entry->data.data(), entry->data.size());
+    }
+    stats.trainHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            ProcessClock::now() - start));
+
+    std::lock_guard<std::mutex> lh(mutex);
+    training = false;
+    if (!entry->cdict || !entry->ddict || id == 0 || current) {
+        return false;
+    }
+    dictionaries[id] = entry;
+    current = entry;
+    ++stats.numDictionariesTrained;
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint32_t DictionaryCompressor::getCurrentDictionaryId() const {
+#ifdef EP_USE_ZSTD
+    std::lock_guard<std::mutex> lh(mutex);
+    if (!current) {
+        return 0;
+    }
+    return ZDICT_getDictID(current->data.data(), current->data.size());
+#else
+    return 0;
+#endif
+}
+
+std::string DictionaryCompressor::getDictionary(uint32_t id) const {
+    auto dict = findDictionary(id);
+    return dict ? dict->data : std::string();
+}
+
+bool DictionaryCompressor::hasDictionary(uint32_t id) const {
+    return findDictionary(id) != nullptr;
+}
+
+uint32_t DictionaryCompressor::addDictionary(cb::const_char_buffer dict,
+                                             bool makeCurrent) {
+#ifdef EP_USE_ZSTD
+    const uint32_t id = ZDICT_getDictID(dict.data(), dict.size());
+    if (id == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lh(mutex);
+    auto it = dictionaries.find(id);
+    if (it == dictionaries.end()) {
+        auto entry = std::make_shared<Dictionary>();
+        entry->data.assign(dict.data(), dict.size());
+        entry->cdict = ZSTD_createCDict(
+                entry->data.data(), entry->data.size(), level);
+        entry->ddict = ZSTD_createDDict(entry->data.data(),
+                                        entry->data.size());
+        if (!entry->cdict || !entry->ddict) {
+            return 0;
+        }
+        it = dictionaries.emplace(id, std::move(entry)).first;
+    }
+
+    if (makeCurrent && !current) {
+        current = it->second;
+        samples.clear();
+        sampleSizes.clear();
+    }
+    return id;
+#else
+    (void)dict;
+    (void)makeCurrent;
+    return 0;
+#endif
+}
+
+size_t DictionaryCompressor::compressBound(size_t size) {
+#ifdef EP_USE_ZSTD
+    return ZSTD_compressBound(size);
+#else
+    return size;
+#endif
+}
+
+size_t DictionaryCompressor::compress(cb::const_char_buffer in, char* out) {
+#ifdef EP_USE_ZSTD
+    std::shared_ptr<const Dictionary> dict;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        dict = current;
+    }
+    if (!dict) {
+        return 0;
+    }
+
+    auto* cctx = Contexts::acquire(
+            contexts->mutex, contexts->cctxs, &ZSTD_createCCtx);
+    if (!cctx) {
+        return 0;
+    }
+    const auto start = ProcessClock::now();
+    const size_t size = ZSTD_compress_usingCDict(cctx,
+                                                 out,
+                                                 compressBound(in.size()),
+                                                 in.data(),
+                                                 in.size(),
+                                                 dict->cdict);
+    Contexts::release(contexts->mutex, contexts->cctxs, cctx);
+    stats.compressHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            ProcessClock::now() - start));
+
+    if (ZSTD_isError(size) || size >= in.size()) {
+        ++stats.numIncompressible;
+        return 0;
+    }
+    stats.rawBytes += in.size();
+    stats.compressedBytes += size;
+    return size;
+#else
+    (void)in;
+    (void)out;
+    return 0;
+#endif
+}
+
+uint32_t DictionaryCompressor::getDictionaryId(cb::const_char_buffer frame) {
+#ifdef EP_USE_ZSTD
+    return ZSTD_getDictID_fromFrame(frame.data(), frame.size());
+#else
+    (void)frame;
+    return 0;
+#endif
+}
+
+bool DictionaryCompressor::decompress(cb::const_char_buffer frame,
+                                      std::string& out) {
+#ifdef EP_USE_ZSTD
+    auto dict = findDictionary(getDictionaryId(frame));
+    const auto size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (!dict || size == ZSTD_CONTENTSIZE_UNKNOWN ||
+        size == ZSTD_CONTENTSIZE_ERROR) {
+        ++stats.numDecompressFailures;
+        return false;
+    }
+    out.resize(size);
+
+    auto* dctx = Contexts::acquire(
+            contexts->mutex, contexts->dctxs, &ZSTD_createDCtx);
+    if (!dctx) {
+        ++stats.numDecompressFailures;
+        return false;
+    }
+    const auto start = ProcessClock::now();
+    const size_t result = ZSTD_decompress_usingDDict(
+            dctx, &out[0], out.size(), frame.data(), frame.size(), dict->ddict);
+    Contexts::release(contexts->mutex, contexts->dctxs, dctx);
+    stats.decompressHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start));
+
+    if (ZSTD_isError(result) || result != size) {
+        ++stats.numDecompressFailures;
+        return false;
+    }
+    ++stats.numDecompressed;
+    return true;
+#else
+    (void)frame;
+    (void)out;
+    return false;
+#endif
+}
+
+std::shared_ptr<const DictionaryCompressor::Dictionary>
+DictionaryCompressor::findDictionary(uint32_t id) const {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto it = dictionaries.find(id);
+    if (it == dictionaries.end()) {
+        return {};
+    }
+    return it->second;
+}
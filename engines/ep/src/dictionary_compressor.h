@@ -0,0 +1,192 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <platform/histogram.h>
+#include <platform/sized_buffer.h>
+#include <relaxed_atomic.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * zstd compression of persisted document bodies using a shared dictionary.
+ *
+ * Documents in a bucket tend to share a lot of structure (field names,
+ * common values) which per-document compressors such as snappy cannot
+ * exploit. A zstd dictionary trained from a sample of the bucket's own
+ * values captures that structure once, so each value only needs to encode
+ * what is unique to it.
+ *
+ * Life cycle:
+ *  - Until a dictionary exists, values written are offered via addSample().
+ *    Once enough sample bytes have been collected the training set is
+ *    queued and the training scheduler (see setTrainingScheduler()) is
+ *    called, so that train() runs off the flusher. When train() succeeds
+ *    the new dictionary becomes the current one; compress() uses the
+ *    current dictionary.
+ *  - Every compressed frame records the id of the dictionary it was
+ *    compressed with. The owner must persist the dictionary (see
+ *    getDictionary()) before any frame using it, and register dictionaries
+ *    read back from disk with addDictionary() so that decompress() can
+ *    find them.
+ *
+ * All methods are thread-safe. When built without zstd support
+ * (EP_USE_ZSTD undefined) isSupported() returns false and the object never
+ * produces compressed values.
+ */
+class DictionaryCompressor {
+public:
+    struct Stats {
+        /// Value bytes which were compressed, and what they compressed to.
+        Couchbase::RelaxedAtomic<size_t> rawBytes{0};
+        Couchbase::RelaxedAtomic<size_t> compressedBytes{0};
+        /// Values which did not compress (stored as-is).
+        Couchbase::RelaxedAtomic<size_t> numIncompressible{0};
+        Couchbase::RelaxedAtomic<size_t> numDecompressed{0};
+        Couchbase::RelaxedAtomic<size_t> numDecompressFailures{0};
+        Couchbase::RelaxedAtomic<size_t> numDictionariesTrained{0};
+        /// Time spent compressing / decompressing individual values.
+        MicrosecondHistogram compressHisto;
+        MicrosecondHistogram decompressHisto;
+        /// Time spent training dictionaries.
+        MicrosecondHistogram trainHisto;
+    };
+
+    /**
+     * @param level zstd compression level
+     * @param dictSize target size in bytes of the trained dictionary
+     */
+    DictionaryCompressor(int level, size_t dictSize);
+
+    ~DictionaryCompressor();
+
+    DictionaryCompressor(const DictionaryCompressor&) = delete;
+    DictionaryCompressor& operator=(const DictionaryCompressor&) = delete;
+
+    /// @return true if zstd support was compiled in.
+    static bool isSupported();
+
+    /**
+     * Set the function called when a training set has been queued; it
+     * should arrange for train() to be called (typically on a background
+     * task), as training takes far longer than a flush should wait.
+     * Must be set before samples are added.
+     */
+    void setTrainingScheduler(std::function<void()> scheduler);
+
+    /**
+     * Offer a value as training data. Ignored once a dictionary exists, or
+     * while a training set is waiting to be trained.
+     *
+     * @return true if this sample completed the training set, which has
+     *         been queued for train().
+     */
+    bool addSample(cb::const_char_buffer value);
+
+    /**
+     * Train a dictionary from the queued training set, making it the
+     * current dictionary. On failure (e.g. data too uniform or too random
+     * to learn from) sampling starts over.
+     *
+     * @return true if a new current dictionary was trained; false if it
+     *         failed or no training set was queued.
+     */
+    bool train();
+
+    /// @return id of the dictionary used by compress(), or 0 if none yet.
+    uint32_t getCurrentDictionaryId() const;
+
+    /// @return the raw bytes of the given dictionary (empty if unknown).
+    std::string getDictionary(uint32_t id) const;
+
+    /// @return true if the given dictionary is known.
+    bool hasDictionary(uint32_t id) const;
+
+    /**
+     * Register a dictionary (typically one read back from disk).
+     *
+     * @param dict raw dictionary bytes, as returned by getDictionary()
+     * @param makeCurrent if true and there is no current dictionary yet,
+     *        use this one for compression (avoids retraining after a
+     *        restart).
+     * @return the dictionary id, or 0 if dict is not a valid dictionary.
+     */
+    uint32_t addDictionary(cb::const_char_buffer dict, bool makeCurrent);
+
+    /// @return the worst case compressed size of a value of `size` bytes.
+    static size_t compressBound(size_t size);
+
+    /**
+     * Compress `in` with the current dictionary into `out`, which must have
+     * room for compressBound(in.size()) bytes.
+     *
+     * @return the compressed size, or 0 if there is no dictionary yet or the
+     *         result would not be smaller than the input.
+     */
+    size_t compress(cb::const_char_buffer in, char* out);
+
+    /// @return the dictionary id a compressed frame depends on (0 if none).
+    static uint32_t getDictionaryId(cb::const_char_buffer frame);
+
+    /**
+     * Decompress a frame produced by compress().
+     *
+     * @return false if the frame is corrupt or its dictionary is unknown.
+     */
+    bool decompress(cb::const_char_buffer frame, std::string& out);
+
+    Stats& getStats() {
+        return stats;
+    }
+
+private:
+    struct Dictionary;
+    struct Contexts;
+
+    std::shared_ptr<const Dictionary> findDictionary(uint32_t id) const;
+
+    const int level;
+    const size_t dictSize;
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint32_t, std::shared_ptr<const Dictionary>>
+            dictionaries;
+    std::shared_ptr<const Dictionary> current;
+
+    // Training data, collected until a dictionary is trained.
+    std::string samples;
+    std::vector<size_t> sampleSizes;
+    // A complete training set, queued for train().
+    std::string trainingSet;
+    std::vector<size_t> trainingSizes;
+    bool training = false;
+
+    std::function<void()> trainingScheduler;
+
+    // Pool of (de)compression contexts, reused across calls.
+    std::unique_ptr<Contexts> contexts;
+
+    Stats stats;
+};
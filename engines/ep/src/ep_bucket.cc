@@ -19,6 +19,8 @@
 
 #include "bgfetcher.h"
 #include "checkpoint.h"
+#include "collections/reclaimer.h"
+#include "dictionary_compressor.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "ep_vb.h"
@@ -28,6 +30,8 @@
 #include "replicationthrottle.h"
 #include "tasks.h"
 
+#include <algorithm>
+
 /**
  * Callback class used by EpStore, for adding relevant keys
  * to bloomfilter during compaction.
@@ -188,8 +192,27 @@ bool EPBucket::initialize() {
            "EPBucket::initialize: Failed to create and start bgFetchers");
         return false;
     }
+
+    // Train each shard's zstd dictionary on a background task rather than on
+    // the flusher which completes its training set.
+    for (const auto& shard : vbMap.shards) {
+        std::weak_ptr<DictionaryCompressor> compressor =
+                shard->getRWUnderlying()->getConfig().getValueCompressor();
+        if (auto c = compressor.lock()) {
+            auto* e = &engine;
+            c->setTrainingScheduler([e, compressor]() {
+                ExecutorPool::get()->schedule(
+                        std::make_shared<DictionaryTrainerTask>(
+                                e, compressor.lock()));
+            });
+        }
+    }
     startFlusher();
 
+    collectionsReclaimerTask =
+            std::make_shared<Collections::ReclaimerTask>(&engine, stats);
+    ExecutorPool::get()->schedule(collectionsReclaimerTask);
+
     return true;
 }
 
@@ -197,9 +220,18 @@ void EPBucket::deinitialize() {
     stopFlusher();
     stopBgFetcher();
 
+    if (collectionsReclaimerTask) {
+        collectionsReclaimerTask->stop();
+        collectionsReclaimerTask.reset();
+    }
+
     KVBucket::deinitialize();
 }
 
+void EPBucket::runCollectionsReclaimerTask() {
+    collectionsReclaimerTask->run();
+}
+
 void EPBucket::reset() {
     KVBucket::reset();
 
@@ -240,14 +272,20 @@ int EPBucket::flushVBucket(uint16_t vbid) {
         // Append any 'backfill' items (mutations added by a DCP stream).
         vb->getBackfillItems(items);
 
-        // Append all items outstanding for the persistence cursor.
+        // Append all items outstanding for the persistence cursor. If
+        // nothing was published to the checkpoints since the cursor was last
+        // drained (and there's nothing else to flush) there's no need to
+        // contend with the front end threads for the queueLock.
         snapshot_range_t range;
-        auto _begin_ = ProcessClock::now();
-        range = vb->checkpointManager->getAllItemsForCursor(
-                CheckpointManager::pCursorName, items);
-        stats.persistenceCursorGetItemsHisto.add(
-                std::chrono::duration_cast<std::chrono::microseconds>(
-                        ProcessClock::now() - _begin_));
+        if (!items.empty() ||
+            vb->checkpointManager->hasNewItemsForPersistence()) {
+            auto _begin_ = ProcessClock::now();
+            range = vb->checkpointManager->getAllItemsForCursor(
+                    CheckpointManager::pCursorName, items);
+            stats.persistenceCursorGetItemsHisto.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            ProcessClock::now() - _begin_));
+        }
 
         if (!items.empty()) {
             while (!rwUnderlying->begin(
@@ -570,22 +608,13 @@ ENGINE_ERROR_CODE EPBucket::scheduleCompaction(uint16_t vbid,
 
     LockHolder lh(compactionLock);
     ExTask task = std::make_shared<CompactTask>(*this, c, cookie);
-    compactionTasks.push_back(std::make_pair(c.db_file_id, task));
-    if (compactionTasks.size() > 1) {
-        if ((stats.diskQueueSize > compactionWriteQueueCap &&
-             compactionTasks.size() > (vbMap.getNumShards() / 2)) ||
-            engine.getWorkLoadPolicy().getWorkLoadPattern() == READ_HEAVY) {
-            // Snooze a new compaction task.
-            // We will wake it up when one of the existing compaction tasks is
-            // done.
-            task->snooze(60);
-        }
-    }
-
-    ExecutorPool::get()->schedule(task);
+    // Queue the task; it is handed to the ExecutorPool once there is a free
+    // compaction slot (which may be immediately).
+    pendingCompactionTasks.push_back(std::make_pair(c.db_file_id, task));
+    scheduleNextCompactions_UNLOCKED();
 
     LOG(EXTENSION_LOG_DEBUG,
-        "Scheduled compaction task %" PRIu64
+        "Queued compaction task %" PRIu64
         " on db %d,"
         "purge_before_ts = %" PRIu64 ", purge_before_seq = %" PRIu64
         ", dropdeletes = %d",
@@ -757,23 +786,87 @@ bool EPBucket::doCompact(compaction_ctx* ctx, const void* cookie) {
 
 void EPBucket::updateCompactionTasks(DBFileId db_file_id) {
     LockHolder lh(compactionLock);
-    bool erased = false, woke = false;
-    std::list<CompTaskEntry>::iterator it = compactionTasks.begin();
-    while (it != compactionTasks.end()) {
-        if ((*it).first == db_file_id) {
-            it = compactionTasks.erase(it);
-            erased = true;
-        } else {
-            ExTask& task = (*it).second;
-            if (task->getState() == TASK_SNOOZED) {
-                ExecutorPool::get()->wake(task->getId());
-                woke = true;
+    auto it = std::find_if(compactionTasks.begin(),
+                           compactionTasks.end(),
+                           [db_file_id](const CompTaskEntry& entry) {
+                               return entry.first == db_file_id;
+                           });
+    if (it != compactionTasks.end()) {
+        compactionTasks.erase(it);
+        --stats.runningCompactions;
+    }
+    scheduleNextCompactions_UNLOCKED();
+}
+
+void EPBucket::setCompactionMaxConcurrent(size_t to) {
+    KVBucket::setCompactionMaxConcurrent(to);
+    LockHolder lh(compactionLock);
+    scheduleNextCompactions_UNLOCKED();
+}
+
+size_t EPBucket::getCompactionConcurrency() const {
+    if (stats.diskQueueSize > compactionWriteQueueCap ||
+        engine.getWorkLoadPolicy().getWorkLoadPattern() == READ_HEAVY) {
+        return 1;
+    }
+    const size_t configured = compactionMaxConcurrent;
+    if (configured != 0) {
+        return configured;
+    }
+    return std::max(size_t(1), size_t(vbMap.getNumShards() / 2));
+}
+
+bool EPBucket::isCompactionRunning_UNLOCKED(DBFileId db_file_id) const {
+    return std::any_of(compactionTasks.begin(),
+                       compactionTasks.end(),
+                       [db_file_id](const CompTaskEntry& entry) {
+                           return entry.first == db_file_id;
+                       });
+}
+
+double EPBucket::getFragmentation(DBFileId db_file_id) {
+    DBFileInfo info;
+    try {
+        info = getRWUnderlying(db_file_id)->getCachedDbFileInfo(db_file_id);
+    } catch (std::runtime_error&) {
+        // No usable file info; treat as unfragmented.
+    }
+    if (info.fileSize == 0 || info.spaceUsed >= info.fileSize) {
+        return 0.0;
+    }
+    return double(info.fileSize - info.spaceUsed) / info.fileSize;
+}
+
+void EPBucket::scheduleNextCompactions_UNLOCKED() {
+    const size_t concurrency = getCompactionConcurrency();
+    while (compactionTasks.size() < concurrency &&
+           !pendingCompactionTasks.empty()) {
+        // Pick the most fragmented file which isn't already being compacted;
+        // ties go to the oldest request.
+        auto next = pendingCompactionTasks.end();
+        double nextFragmentation = -1.0;
+        for (auto it = pendingCompactionTasks.begin();
+             it != pendingCompactionTasks.end();
+             ++it) {
+            if (isCompactionRunning_UNLOCKED(it->first)) {
+                continue;
+            }
+            const double fragmentation = getFragmentation(it->first);
+            if (fragmentation > nextFragmentation) {
+                next = it;
+                nextFragmentation = fragmentation;
             }
-            ++it;
         }
-        if (erased && woke) {
+        if (next == pendingCompactionTasks.end()) {
+            // Everything queued is for a file already being compacted.
             break;
         }
+
+        ExTask task = next->second;
+        compactionTasks.splice(
+                compactionTasks.end(), pendingCompactionTasks, next);
+        ++stats.runningCompactions;
+        ExecutorPool::get()->schedule(task);
     }
 }
 
@@ -981,6 +1074,7 @@ public:
         // Irrespective of if the in-memory delete succeeded; the document
         // doesn't exist on disk; so decrement the item count.
         vb.decrNumTotalItems();
+        vb.collectionStats.persisted(key, -1);
     }
 
 private:
@@ -19,6 +19,10 @@
 
 #include "kv_bucket.h"
 
+namespace Collections {
+class ReclaimerTask;
+}
+
 /**
  * Eventually Persistent Bucket
  *
@@ -82,6 +86,8 @@ public:
      */
     bool doCompact(compaction_ctx* ctx, const void* cookie);
 
+    void setCompactionMaxConcurrent(size_t to) override;
+
     std::pair<uint64_t, bool> getLastPersistedCheckpointId(
             uint16_t vb) override;
 
@@ -132,6 +138,8 @@ public:
         return true;
     }
 
+    void runCollectionsReclaimerTask();
+
 protected:
     void flushOneDeleteAll();
 
@@ -146,10 +154,36 @@ protected:
     void compactInternal(compaction_ctx* ctx);
 
     /**
-     * Remove completed compaction tasks or wake snoozed tasks
+     * Remove a completed compaction task and start queued ones in its place
      *
      * @param db_file_id vbucket id for couchstore or shard id in the
      *                   case of forestdb
      */
     void updateCompactionTasks(DBFileId db_file_id);
+
+    /**
+     * @return how many compactions may currently run in parallel: the
+     *         configured limit (or half the shards if unset), dropping to one
+     *         while the disk write queue is above compaction_write_queue_cap
+     *         or the workload is read heavy.
+     */
+    size_t getCompactionConcurrency() const;
+
+    /**
+     * Move queued compactions to the ExecutorPool while there are free
+     * slots, most fragmented file first. Caller must hold compactionLock.
+     */
+    void scheduleNextCompactions_UNLOCKED();
+
+    /// @return true if a compaction of db_file_id is currently running.
+    bool isCompactionRunning_UNLOCKED(DBFileId db_file_id) const;
+
+    /**
+     * @return the fraction of db_file_id's file which is unused (and would
+     *         be reclaimed by compacting it), based on cached file info.
+     */
+    double getFragmentation(DBFileId db_file_id);
+
+    /// Reclaims the memory and disk space of dropped collections.
+    std::shared_ptr<Collections::ReclaimerTask> collectionsReclaimerTask;
 };
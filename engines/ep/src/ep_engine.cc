@@ -349,6 +349,29 @@ static cb::EngineErrorCasPair EvpStoreIf(gsl::not_null<ENGINE_HANDLE*> handle,
     return engine->store_if(cookie, item, cas, operation, predicate);
 }
 
+static cb::EngineErrorCasPair EvpSplice(gsl::not_null<ENGINE_HANDLE*> handle,
+                                        gsl::not_null<const void*> cookie,
+                                        const DocKey& key,
+                                        uint16_t vbucket,
+                                        uint64_t cas,
+                                        size_t offset,
+                                        size_t length,
+                                        cb::const_char_buffer data,
+                                        protocol_binary_datatype_t datatype,
+                                        rel_time_t exptime,
+                                        mutation_descr_t& mut_info) {
+    return acquireEngine(handle)->splice(cookie,
+                                         key,
+                                         vbucket,
+                                         cas,
+                                         offset,
+                                         length,
+                                         data,
+                                         datatype,
+                                         exptime,
+                                         mut_info);
+}
+
 static ENGINE_ERROR_CODE EvpFlush(gsl::not_null<ENGINE_HANDLE*> handle,
                                   gsl::not_null<const void*> cookie) {
     return acquireEngine(handle)->flush(cookie);
@@ -556,8 +579,27 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setDefragmenterChunkDuration(std::stoull(valz));
         } else if (strcmp(keyz, "defragmenter_run") == 0) {
             runDefragmenterTask();
+        } else if (strcmp(keyz, "item_compressor_interval") == 0) {
+            getConfiguration().setItemCompressorInterval(std::stoull(valz));
+        } else if (strcmp(keyz, "item_compressor_chunk_duration") == 0) {
+            getConfiguration().setItemCompressorChunkDuration(
+                    std::stoull(valz));
+        } else if (strcmp(keyz, "item_compressor_min_compression_ratio") ==
+                   0) {
+            getConfiguration().setItemCompressorMinCompressionRatio(
+                    std::stof(valz));
+        } else if (strcmp(keyz, "collections_reclaimer_interval") == 0) {
+            getConfiguration().setCollectionsReclaimerInterval(
+                    std::stoull(valz));
+        } else if (strcmp(keyz, "collections_reclaimer_chunk_duration") == 0) {
+            getConfiguration().setCollectionsReclaimerChunkDuration(
+                    std::stoull(valz));
         } else if (strcmp(keyz, "compaction_write_queue_cap") == 0) {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_max_concurrent") == 0) {
+            getConfiguration().setCompactionMaxConcurrent(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_max_bytes_per_sec") == 0) {
+            getConfiguration().setCompactionMaxBytesPerSec(std::stoull(valz));
         } else if (strcmp(keyz, "dcp_min_compression_ratio") == 0) {
             getConfiguration().setDcpMinCompressionRatio(std::stof(valz));
         } else if (strcmp(keyz, "dcp_noop_mandatory_for_v5_features") == 0) {
@@ -1734,6 +1776,7 @@ EventuallyPersistentEngine::EventuallyPersistentEngine(
     ENGINE_HANDLE_V1::reset_stats = EvpResetStats;
     ENGINE_HANDLE_V1::store = EvpStore;
     ENGINE_HANDLE_V1::store_if = EvpStoreIf;
+    ENGINE_HANDLE_V1::splice = EvpSplice;
     ENGINE_HANDLE_V1::flush = EvpFlush;
     ENGINE_HANDLE_V1::unknown_command = EvpUnknownCommand;
     ENGINE_HANDLE_V1::item_set_cas = EvpItemSetCas;
@@ -2414,6 +2457,100 @@ cb::EngineErrorCasPair EventuallyPersistentEngine::store_if(
     return {cb::engine_errc(status), item.getCas()};
 }
 
+cb::EngineErrorCasPair EventuallyPersistentEngine::splice(
+        const void* cookie,
+        const DocKey& key,
+        uint16_t vbucket,
+        uint64_t cas,
+        size_t offset,
+        size_t length,
+        cb::const_char_buffer data,
+        protocol_binary_datatype_t datatype,
+        rel_time_t exptime,
+        mutation_descr_t& mut_info) {
+    if (cas == 0) {
+        // The range is only meaningful for the document it was computed from
+        return {cb::engine_errc::invalid_arguments, 0};
+    }
+
+    // Fetch the current document; this copies the Item but shares its Blob
+    // (unless it has to be inflated below).
+    auto options = static_cast<get_options_t>(HONOR_STATES | DELETE_TEMP |
+                                              QUEUE_BG_FETCH);
+    GetValue gv(kvBucket->get(key, vbucket, cookie, options));
+    auto status = gv.getStatus();
+    if (status != ENGINE_SUCCESS) {
+        if ((status == ENGINE_KEY_ENOENT || status == ENGINE_NOT_MY_VBUCKET) &&
+            isDegradedMode()) {
+            status = ENGINE_TMPFAIL;
+        }
+        return {cb::engine_errc(status), 0};
+    }
+
+    auto& current = *gv.item;
+    if (current.getCas() != cas) {
+        return {cb::engine_errc::key_already_exists, 0};
+    }
+
+    if (mcbp::datatype::is_snappy(current.getDataType()) &&
+        !current.decompressValue()) {
+        return {cb::engine_errc::failed, 0};
+    }
+
+    const size_t nbytes = current.getNBytes();
+    if (offset > nbytes || length > nbytes - offset) {
+        return {cb::engine_errc::invalid_arguments, 0};
+    }
+
+    const size_t newBytes = nbytes - length + data.size();
+    const size_t suffix = nbytes - offset - length;
+    if (newBytes > maxItemSize + maxItemPrivilegedBytes) {
+        return {cb::engine_errc::too_big, 0};
+    }
+
+    if (!hasMemoryForItemAllocation(sizeof(Item) + sizeof(Blob) + key.size() +
+                                    newBytes)) {
+        return {cb::engine_errc(memoryCondition()), 0};
+    }
+
+    cb::ExpiryLimit expiryLimit;
+    std::tie(expiryLimit, exptime) = getExpiryParameters(exptime);
+    time_t expiretime =
+            (exptime == 0) ? 0 : ep_abs_time(ep_reltime(exptime, expiryLimit));
+
+    Item item(key,
+              current.getFlags(),
+              expiretime,
+              nullptr,
+              newBytes,
+              datatype,
+              cas,
+              -1 /*seq*/,
+              vbucket);
+
+    const char* src = current.getData();
+    auto* dst = const_cast<char*>(item.getData());
+    std::memcpy(dst, src, offset);
+    std::memcpy(dst + offset, data.data(), data.size());
+    std::memcpy(dst + offset + data.size(), src + offset + length, suffix);
+
+    const auto privBytes = cb::xattr::get_system_xattr_size(
+            datatype, {item.getData(), item.getNBytes()});
+    if (privBytes > maxItemPrivilegedBytes ||
+        (newBytes - privBytes) > maxItemSize) {
+        return {cb::engine_errc::too_big, 0};
+    }
+    stats.itemAllocSizeHisto.add(newBytes);
+
+    auto ret = store_if(cookie, item, cas, OPERATION_CAS, {});
+    if (ret.status == cb::engine_errc::success) {
+        const auto info = getItemInfo(item);
+        mut_info.vbucket_uuid = info.vbucket_uuid;
+        mut_info.seqno = info.seqno;
+    }
+    return ret;
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::store(
         const void* cookie,
         item* itm,
@@ -2617,6 +2754,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
 
     add_casted_stat("ep_pending_compactions", epstats.pendingCompactions,
                     add_stat, cookie);
+    add_casted_stat("ep_running_compactions", epstats.runningCompactions,
+                    add_stat, cookie);
     add_casted_stat("ep_rollback_count", epstats.rollbackCount,
                     add_stat, cookie);
 
@@ -2756,6 +2895,44 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
     add_casted_stat("ep_defragmenter_num_moved", epstats.defragNumMoved,
                     add_stat, cookie);
 
+    add_casted_stat("ep_item_compressor_num_visited",
+                    epstats.compressorNumVisited,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_num_compressed",
+                    epstats.compressorNumCompressed,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_num_incompressible",
+                    epstats.compressorNumIncompressible,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_bytes_saved",
+                    epstats.compressorBytesSaved,
+                    add_stat,
+                    cookie);
+
+    add_casted_stat("ep_collections_items_reclaimed",
+                    epstats.collectionsItemsReclaimed,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_collections_bytes_reclaimed",
+                    epstats.collectionsBytesReclaimed,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_collections_items_erased",
+                    epstats.collectionsItemsErased,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_collections_reclaim_compactions",
+                    epstats.collectionsReclaimCompactions,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_collections_pending_deletes",
+                    epstats.collectionsPendingDeletes,
+                    add_stat,
+                    cookie);
+
     add_casted_stat("ep_cursor_dropping_lower_threshold",
                     epstats.cursorDroppingLThreshold, add_stat, cookie);
     add_casted_stat("ep_cursor_dropping_upper_threshold",
@@ -2794,6 +2971,12 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
                                  KVBucketIface::KVSOption::BOTH)) {
         add_casted_stat("ep_io_compaction_write_bytes",  value, add_stat, cookie);
     }
+    if (kvBucket->getKVStoreStat("io_compaction_throttle_wait_us",
+                                 value,
+                                 KVBucketIface::KVSOption::BOTH)) {
+        add_casted_stat(
+                "ep_io_compaction_throttle_wait_us", value, add_stat, cookie);
+    }
 
     if (kvBucket->getKVStoreStat("io_bg_fetch_read_count",
                                  value,
@@ -2815,6 +2998,33 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
                 cookie);
     }
 
+    // Persistence compression (persistence_compression_mode=zstd). The
+    // compressor is shared by each shard's RW and RO store.
+    size_t rawBytes = 0;
+    size_t storedBytes = 0;
+    if (kvBucket->getKVStoreStat("io_compression_raw_bytes",
+                                 rawBytes,
+                                 KVBucketIface::KVSOption::RW) &&
+        kvBucket->getKVStoreStat("io_compression_stored_bytes",
+                                 storedBytes,
+                                 KVBucketIface::KVSOption::RW)) {
+        add_casted_stat(
+                "ep_io_compression_raw_bytes", rawBytes, add_stat, cookie);
+        add_casted_stat("ep_io_compression_stored_bytes",
+                        storedBytes,
+                        add_stat,
+                        cookie);
+        add_casted_stat("ep_io_compression_ratio",
+                        storedBytes ? double(rawBytes) / storedBytes : 0.0,
+                        add_stat,
+                        cookie);
+    }
+    if (kvBucket->getKVStoreStat("io_decompress_failures",
+                                 value,
+                                 KVBucketIface::KVSOption::RW)) {
+        add_casted_stat("ep_io_decompress_failures", value, add_stat, cookie);
+    }
+
     // Specific to ForestDB:
     if (kvBucket->getKVStoreStat("Block_cache_hits", value,
                                  KVBucketIface::KVSOption::RW)) {
@@ -3938,6 +4148,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(const void* cookie,
         }
     } else if (statKey == "collections" &&
                configuration.isCollectionsPrototypeEnabled()) {
+        kvBucket->getCollectionsManager().addStats(
+                *kvBucket.get(), cookie, add_stat);
+        rv = ENGINE_SUCCESS;
+    } else if (statKey == "collections-details" &&
+               configuration.isCollectionsPrototypeEnabled()) {
         // @todo MB-24546 For development, just log everything.
         kvBucket->getCollectionsManager().logAll(*kvBucket.get());
         rv = ENGINE_SUCCESS;
@@ -196,6 +196,22 @@ public:
                                     ENGINE_STORE_OPERATION operation,
                                     cb::StoreIfPredicate predicate);
 
+    /**
+     * Replace the byte range [offset, offset + length) of the value of an
+     * existing document with data, building the new value with a single
+     * copy of the current one. See ENGINE_HANDLE_V1::splice.
+     */
+    cb::EngineErrorCasPair splice(const void* cookie,
+                                  const DocKey& key,
+                                  uint16_t vbucket,
+                                  uint64_t cas,
+                                  size_t offset,
+                                  size_t length,
+                                  cb::const_char_buffer data,
+                                  protocol_binary_datatype_t datatype,
+                                  rel_time_t exptime,
+                                  mutation_descr_t& mut_info);
+
     ENGINE_ERROR_CODE flush(const void *cookie);
 
     ENGINE_ERROR_CODE dcpOpen(const void* cookie,
@@ -19,6 +19,7 @@
 
 #include "bgfetcher.h"
 #include "checkpoint.h"
+#include "dcp/backfill_disk_shared.h"
 #include "ep_engine.h"
 #include "executorpool.h"
 #include "failover-table.h"
@@ -71,7 +72,8 @@ EPVBucket::EPVBucket(id_type i,
                                             ->getStorageProperties()
                                             .hasEfficientGet()
                                   : false),
-      shard(kvshard) {
+      shard(kvshard),
+      backfillScans(std::make_shared<SharedDiskScanRegistry>()) {
 }
 
 EPVBucket::~EPVBucket() {
@@ -396,6 +398,19 @@ void EPVBucket::addStats(bool details, ADD_STAT add_stat, const void* c) {
     }
 }
 
+UniqueDCPBackfillPtr EPVBucket::createDCPBackfill(
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<ActiveStream> stream,
+        uint64_t startSeqno,
+        uint64_t endSeqno) {
+    /* create a disk backfill object */
+    if (e.getConfiguration().isDcpSharedBackfillScans()) {
+        return std::make_unique<DCPSharedBackfillDisk>(
+                e, stream, startSeqno, endSeqno, backfillScans);
+    }
+    return std::make_unique<DCPBackfillDisk>(e, stream, startSeqno, endSeqno);
+}
+
 protocol_binary_response_status EPVBucket::evictKey(const DocKey& key,
                                                     const char** msg) {
     auto hbl = ht.getLockedBucket(key);
@@ -22,6 +22,7 @@
 #include "vbucket_bgfetch_item.h"
 
 class BgFetcher;
+class SharedDiskScanRegistry;
 
 /**
  * Eventually Peristent VBucket (EPVBucket) is a child class of VBucket.
@@ -104,11 +105,7 @@ public:
     UniqueDCPBackfillPtr createDCPBackfill(EventuallyPersistentEngine& e,
                                            std::shared_ptr<ActiveStream> stream,
                                            uint64_t startSeqno,
-                                           uint64_t endSeqno) override {
-        /* create a disk backfill object */
-        return std::make_unique<DCPBackfillDisk>(
-                e, stream, startSeqno, endSeqno);
-    }
+                                           uint64_t endSeqno) override;
 
     uint64_t getPersistenceSeqno() const override {
         return persistenceSeqno.load();
@@ -253,5 +250,11 @@ private:
      */
     std::atomic<uint64_t> deferredDeletionFileRevision;
 
+    /**
+     * Disk scans of this vBucket which DCP backfills can share. Backfills
+     * hold a reference, as they may outlive the VBucket.
+     */
+    const std::shared_ptr<SharedDiskScanRegistry> backfillScans;
+
     friend class EPVBucketTest;
 };
@@ -17,6 +17,7 @@
 
 #include "hash_table.h"
 
+#include "collections/vbucket_stats.h"
 #include "item.h"
 #include "stats.h"
 #include "stored_value_factories.h"
@@ -64,7 +65,8 @@ std::ostream& operator<<(std::ostream& os, const HashTable::Position& pos) {
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
+                     size_t locks,
+                     Collections::VB::StatsMap* collectionStats)
     : datatypeCounts(),
       cacheSize(0),
       metaDataMemory(0),
@@ -73,6 +75,7 @@ HashTable::HashTable(EPStats& st,
       mutexes(locks),
       stats(st),
       valFact(std::move(svFactory)),
+      collectionStats(collectionStats),
       visitors(0),
       numItems(0),
       numNonResidentItems(0),
@@ -145,6 +148,9 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
     numNonResidentItems.store(0);
     memSize.store(0);
     cacheSize.store(0);
+    if (collectionStats) {
+        collectionStats->resetMemory();
+    }
 }
 
 static size_t distance(size_t a, size_t b) {
@@ -362,6 +368,8 @@ void HashTable::statsPrologue(const StoredValue& v) {
             --datatypeCounts[v.getDatatype()];
         }
     }
+
+    collectionStatsUpdate(v, -1);
 }
 
 void HashTable::statsEpilogue(const StoredValue& v) {
@@ -383,6 +391,17 @@ void HashTable::statsEpilogue(const StoredValue& v) {
             ++datatypeCounts[v.getDatatype()];
         }
     }
+
+    collectionStatsUpdate(v, 1);
+}
+
+void HashTable::collectionStatsUpdate(const StoredValue& v, int sign) {
+    if (collectionStats) {
+        // Temporary items use memory but aren't items of the collection.
+        const bool alive = !v.isTempItem() && !v.isDeleted();
+        collectionStats->updateMemory(
+                v.getKey(), sign * int64_t(v.size()), alive ? sign : 0);
+    }
 }
 
 std::pair<StoredValue*, StoredValue::UniquePtr>
@@ -707,6 +726,10 @@ bool HashTable::unlocked_ejectItem(StoredValue*& vptr,
     if (policy == VALUE_ONLY) {
         if (vptr->eligibleForEviction(policy)) {
             reduceCacheSize(vptr->valuelen());
+            if (collectionStats) {
+                collectionStats->evicted(
+                        vptr->getKey(), -int64_t(vptr->valuelen()), 0);
+            }
             vptr->ejectValue();
             ++stats.numValueEjects;
             ++numNonResidentItems;
@@ -720,6 +743,19 @@ bool HashTable::unlocked_ejectItem(StoredValue*& vptr,
         if (vptr->eligibleForEviction(policy)) {
             reduceMetaDataSize(stats, vptr->metaDataSize());
             reduceCacheSize(vptr->size());
+            if (collectionStats) {
+                // Only live documents are counted as items of the collection
+                // (see collectionStatsUpdate), and removing a temporary item
+                // isn't the eviction of a document.
+                if (vptr->isTempItem()) {
+                    collectionStats->updateMemory(
+                            vptr->getKey(), -int64_t(vptr->size()), 0);
+                } else {
+                    collectionStats->evicted(vptr->getKey(),
+                                             -int64_t(vptr->size()),
+                                             vptr->isDeleted() ? 0 : -1);
+                }
+            }
             int bucket_num = getBucketForHash(vptr->getKey().hash());
 
             // Remove the item from the hash table.
@@ -759,6 +795,26 @@ std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(int slot) {
     return nullptr;
 }
 
+bool HashTable::unlocked_compressValue(const HashBucketLock& hbl,
+                                       StoredValue& v,
+                                       float maxRatio) {
+    if (!hbl.getHTLock()) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_compressValue: htLock not held");
+    }
+
+    if (!isActive() || !v.isResident() || v.isDeleted() || v.isTempItem()) {
+        return false;
+    }
+
+    // The datatype and value size both change, so account for the value
+    // as if it were being replaced.
+    statsPrologue(v);
+    const bool compressed = v.compressValue(maxRatio);
+    statsEpilogue(v);
+    return compressed;
+}
+
 bool HashTable::unlocked_restoreValue(
         const std::unique_lock<std::mutex>& htLock,
         const Item& itm,
@@ -778,6 +834,7 @@ bool HashTable::unlocked_restoreValue(
         decrNumNonResidentItems();
     }
 
+    const bool wasTemp = v.isTempItem();
     v.restoreValue(itm);
 
     if (v.isDeleted()) {
@@ -785,6 +842,11 @@ bool HashTable::unlocked_restoreValue(
     }
 
     increaseCacheSize(v.getValue()->valueSize());
+    if (collectionStats) {
+        collectionStats->updateMemory(v.getKey(),
+                                      v.getValue()->valueSize(),
+                                      (wasTemp && !v.isDeleted()) ? 1 : 0);
+    }
     return true;
 }
 
@@ -809,6 +871,9 @@ void HashTable::unlocked_restoreMeta(const std::unique_lock<std::mutex>& htLock,
         ++numItems;
         ++numNonResidentItems;
         ++datatypeCounts[v.getDatatype()];
+        if (collectionStats) {
+            collectionStats->updateMemory(v.getKey(), 0, 1);
+        }
     }
 }
 
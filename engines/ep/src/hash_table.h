@@ -32,6 +32,12 @@ class HashTableStatVisitor;
 class HashTableVisitor;
 class HashTableDepthVisitor;
 
+namespace Collections {
+namespace VB {
+class StatsMap;
+}
+}
+
 /**
  * Mutation types as returned by store commands.
  */
@@ -182,11 +188,14 @@ public:
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
      * @param locks the number of locks in the hash table
+     * @param collectionStats optional per-collection counters to keep up to
+     *        date with the items and memory of each collection
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              Collections::VB::StatsMap* collectionStats = nullptr);
 
     ~HashTable();
 
@@ -544,6 +553,22 @@ public:
      */
     bool unlocked_ejectItem(StoredValue*& vptr, item_eviction_policy_t policy);
 
+    /**
+     * Replace the value of a resident item with a Snappy-compressed copy
+     * if it compresses to no more than `maxRatio` of its size; see
+     * StoredValue::compressValue().
+     * Assumes that HT bucket lock is grabbed.
+     *
+     * @param hbl Hash table bucket lock that must be held
+     * @param v StoredValue whose value should be compressed
+     * @param maxRatio Largest acceptable compressed / uncompressed size
+     *
+     * @return true if the value was compressed; else false
+     */
+    bool unlocked_compressValue(const HashBucketLock& hbl,
+                                StoredValue& v,
+                                float maxRatio);
+
     /**
      * Restore the value for the item.
      * Assumes that HT bucket lock is grabbed.
@@ -655,6 +680,13 @@ private:
      */
     void statsEpilogue(const StoredValue& sv);
 
+    /**
+     * Update the counters of sv's collection, if collectionStats is set.
+     *
+     * @param sv StoredValue which was added (sign 1) or removed (sign -1)
+     */
+    void collectionStatsUpdate(const StoredValue& sv, int sign);
+
     // The container for actually holding the StoredValues.
     using table_type = std::vector<StoredValue::UniquePtr>;
 
@@ -674,6 +706,7 @@ private:
     std::vector<std::mutex> mutexes;
     EPStats&             stats;
     std::unique_ptr<AbstractStoredValueFactory> valFact;
+    Collections::VB::StatsMap* const collectionStats;
     std::atomic<size_t>       visitors;
 
     /// Count of alive & deleted, in-memory non-resident and resident items.
@@ -0,0 +1,130 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "item_compressor.h"
+
+#include <phosphor/phosphor.h>
+
+#include "ep_engine.h"
+#include "executorpool.h"
+#include "item_compressor_visitor.h"
+#include "kv_bucket.h"
+#include "stored-value.h"
+
+ItemCompressorTask::ItemCompressorTask(EventuallyPersistentEngine* e,
+                                       EPStats& stats_)
+    : GlobalTask(e, TaskId::ItemCompressorTask, 0, false),
+      stats(stats_),
+      epstore_position(engine->getKVBucket()->startPosition()) {
+}
+
+bool ItemCompressorTask::run() {
+    TRACE_EVENT0("ep-engine/task", "ItemCompressorTask");
+    if (engine->getCompressionMode() == BucketCompressionMode::Active) {
+        // Get our pause/resume visitor. If we didn't finish the previous pass,
+        // then resume from where we last were, otherwise create a new visitor
+        // starting from the beginning.
+        if (!prAdapter) {
+            prAdapter = std::make_unique<PauseResumeVBAdapter>(
+                    std::make_unique<ItemCompressorVisitor>(
+                            engine->getConfiguration()
+                                    .getItemCompressorMinCompressionRatio()));
+            epstore_position = engine->getKVBucket()->startPosition();
+        }
+
+        // Prepare the underlying visitor.
+        auto& visitor = getCompressorVisitor();
+        const auto start = ProcessClock::now();
+        visitor.setDeadline(start + getChunkDuration());
+        visitor.clearStats();
+
+        // Do it - set off the visitor.
+        epstore_position = engine->getKVBucket()->pauseResumeVisit(
+                *prAdapter, epstore_position);
+        const auto end = ProcessClock::now();
+
+        // Update stats
+        stats.compressorNumVisited.fetch_add(visitor.getVisitedCount());
+        stats.compressorNumCompressed.fetch_add(visitor.getCompressedCount());
+        stats.compressorNumIncompressible.fetch_add(
+                visitor.getIncompressibleCount());
+        stats.compressorBytesSaved.fetch_add(visitor.getBytesSaved());
+
+        // Check if the visitor completed a full pass.
+        bool completed = (epstore_position ==
+                          engine->getKVBucket()->endPosition());
+
+        // Print status. This task runs far more often than the
+        // defragmenter, so keep it out of the log at the default level.
+        std::stringstream ss;
+        ss << to_string(getDescription()) << " for bucket '"
+           << engine->getName() << "'";
+        if (completed) {
+            ss << " finished pass.";
+        } else {
+            ss << " paused at position " << epstore_position << ".";
+        }
+        std::chrono::microseconds duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                      start);
+        ss << " Took " << duration.count() << " us."
+           << " compressed " << visitor.getCompressedCount() << "/"
+           << visitor.getVisitedCount() << " visited documents, saving "
+           << visitor.getBytesSaved() << " bytes.";
+        LOG(EXTENSION_LOG_DEBUG, "%s", ss.str().c_str());
+
+        // Delete(reset) visitor if it finished.
+        if (completed) {
+            prAdapter.reset();
+        }
+    }
+
+    snooze(getSleepTime());
+    if (engine->getEpStats().isShutdown) {
+        return false;
+    }
+    return true;
+}
+
+void ItemCompressorTask::stop() {
+    if (uid) {
+        ExecutorPool::get()->cancel(uid);
+    }
+}
+
+cb::const_char_buffer ItemCompressorTask::getDescription() {
+    return "Item Compressor";
+}
+
+std::chrono::microseconds ItemCompressorTask::maxExpectedDuration() {
+    // Each chunk is constrained by the chunk duration, but allow the same
+    // headroom as the defragmenter for the ProgressTracker's estimates.
+    return getChunkDuration() * 10;
+}
+
+double ItemCompressorTask::getSleepTime() const {
+    return engine->getConfiguration().getItemCompressorInterval() / 1000.0;
+}
+
+std::chrono::milliseconds ItemCompressorTask::getChunkDuration() const {
+    return std::chrono::milliseconds(
+            engine->getConfiguration().getItemCompressorChunkDuration());
+}
+
+ItemCompressorVisitor& ItemCompressorTask::getCompressorVisitor() {
+    return dynamic_cast<ItemCompressorVisitor&>(prAdapter->getHTVisitor());
+}
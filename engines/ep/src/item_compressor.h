@@ -0,0 +1,88 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "globaltask.h"
+#include "kv_bucket_iface.h"
+
+class EPStats;
+class ItemCompressorVisitor;
+class PauseResumeVBAdapter;
+
+/**
+ * Task responsible for compressing the values of items in memory.
+ *
+ * When the bucket's compression_mode is "active", values which are stored
+ * uncompressed are compressed (with Snappy) in the background, so that the
+ * bucket can keep more of its data resident without the front-end paying
+ * for compression on every mutation.
+ *
+ * Like the DefragmenterTask, the HashTables are walked in chunks of at most
+ * item_compressor_chunk_duration ms, pausing in between and resuming where
+ * the previous chunk left off. For each value:
+ *
+ * 1. Values which have been read since they were stored (NRU below its
+ *    initial value) are left alone - a compressed value must be inflated
+ *    for every client which doesn't support Snappy, so compressing hot
+ *    items would just move the CPU cost onto the read path. Once the item
+ *    pager has aged them they become candidates again.
+ *
+ * 2. The compressed copy is only kept if it is no larger than
+ *    item_compressor_min_compression_ratio of the original (the same
+ *    convention as dcp_min_compression_ratio). Otherwise the value is
+ *    flagged as incompressible so later passes don't retry it; the flag is
+ *    dropped whenever the value changes.
+ */
+class ItemCompressorTask : public GlobalTask {
+public:
+    ItemCompressorTask(EventuallyPersistentEngine* e, EPStats& stats_);
+
+    bool run() override;
+
+    void stop();
+
+    cb::const_char_buffer getDescription() override;
+
+    std::chrono::microseconds maxExpectedDuration() override;
+
+private:
+    /// Duration (in seconds) the compressor should sleep between chunks.
+    double getSleepTime() const;
+
+    // Upper limit on how long each compression chunk can run for, before
+    // being paused.
+    std::chrono::milliseconds getChunkDuration() const;
+
+    /// Returns the underlying ItemCompressorVisitor instance.
+    ItemCompressorVisitor& getCompressorVisitor();
+
+    /// Reference to EP stats, used to record progress.
+    EPStats& stats;
+
+    // Opaque marker indicating how far through the epStore we have visited.
+    KVBucketIface::Position epstore_position;
+
+    /**
+     * Visitor adapter which supports pausing & resuming (records how far
+     * though a VBucket is has got). unique_ptr as we re-create it for each
+     * complete pass.
+     */
+    std::unique_ptr<PauseResumeVBAdapter> prAdapter;
+};
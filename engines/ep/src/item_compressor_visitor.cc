@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "item_compressor_visitor.h"
+
+#include "vbucket.h"
+
+ItemCompressorVisitor::ItemCompressorVisitor(float maxCompressionRatio)
+    : maxCompressionRatio(maxCompressionRatio) {
+}
+
+void ItemCompressorVisitor::setDeadline(ProcessClock::time_point deadline) {
+    progressTracker.setDeadline(deadline);
+}
+
+void ItemCompressorVisitor::setCurrentVBucket(VBucket& vb) {
+    currentVb = &vb;
+}
+
+bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
+                                  StoredValue& v) {
+    // Only consider values which have not been read since they were
+    // written (or since the item pager last aged them); compressing hot
+    // values would just move the cost of inflating them onto every read.
+    if (v.getNRUValue() >= INITIAL_NRU_VALUE && !v.isIncompressible()) {
+        const size_t before = v.valuelen();
+        if (currentVb->ht.unlocked_compressValue(
+                    lh, v, maxCompressionRatio)) {
+            compressed_count++;
+            bytes_saved += before - v.valuelen();
+        } else if (v.isIncompressible()) {
+            incompressible_count++;
+        }
+    }
+    visited_count++;
+
+    // See if we have done enough work for this chunk. If so
+    // stop visiting (for now).
+    return progressTracker.shouldContinueVisiting(visited_count);
+}
+
+void ItemCompressorVisitor::clearStats() {
+    compressed_count = 0;
+    incompressible_count = 0;
+    visited_count = 0;
+    bytes_saved = 0;
+}
+
+size_t ItemCompressorVisitor::getCompressedCount() const {
+    return compressed_count;
+}
+
+size_t ItemCompressorVisitor::getIncompressibleCount() const {
+    return incompressible_count;
+}
+
+size_t ItemCompressorVisitor::getVisitedCount() const {
+    return visited_count;
+}
+
+size_t ItemCompressorVisitor::getBytesSaved() const {
+    return bytes_saved;
+}
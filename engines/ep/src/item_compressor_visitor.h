@@ -0,0 +1,81 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "hash_table.h"
+#include "progress_tracker.h"
+#include "vb_visitors.h"
+
+/**
+ * Item compressor visitor - visit all objects in a VBucket, and compress
+ * the values of those which are not being actively read.
+ */
+class ItemCompressorVisitor : public VBucketAwareHTVisitor {
+public:
+    /**
+     * @param maxCompressionRatio largest compressed / uncompressed size ratio
+     *        at which a compressed value is kept.
+     */
+    explicit ItemCompressorVisitor(float maxCompressionRatio);
+
+    // Set the deadline at which point the visitor will pause visiting.
+    void setDeadline(ProcessClock::time_point deadline_);
+
+    // Implementation of HashTableVisitor interface:
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
+
+    void setCurrentVBucket(VBucket& vb) override;
+
+    // Resets any held stats to zero.
+    void clearStats();
+
+    // Returns the number of documents that have been compressed.
+    size_t getCompressedCount() const;
+
+    // Returns the number of documents newly found to be incompressible.
+    size_t getIncompressibleCount() const;
+
+    // Returns the number of documents that have been visited.
+    size_t getVisitedCount() const;
+
+    // Returns the number of value bytes saved by compression.
+    size_t getBytesSaved() const;
+
+private:
+    /* Configuration parameters */
+
+    // Compressed values larger than this fraction of the original are
+    // discarded.
+    const float maxCompressionRatio;
+
+    /* Runtime state */
+
+    // The VBucket whose HashTable is being visited.
+    VBucket* currentVb = nullptr;
+
+    // Estimates how far we have got, and when we should pause.
+    ProgressTracker progressTracker;
+
+    /* Statistics */
+    size_t compressed_count = 0;
+    size_t incompressible_count = 0;
+    size_t visited_count = 0;
+    size_t bytes_saved = 0;
+};
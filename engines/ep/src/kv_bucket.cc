@@ -46,6 +46,7 @@
 #include "failover-table.h"
 #include "flusher.h"
 #include "htresizer.h"
+#include "item_compressor.h"
 #include "kv_bucket.h"
 #include "kvshard.h"
 #include "kvstore.h"
@@ -54,6 +55,7 @@
 #include "replicationthrottle.h"
 #include "statwriter.h"
 #include "tasks.h"
+#include "token_bucket.h"
 #include "trace_helpers.h"
 #include "vb_count_visitor.h"
 #include "vbucket.h"
@@ -122,6 +124,10 @@ public:
             store.setBGFetchDelay(static_cast<uint32_t>(value));
         } else if (key.compare("compaction_write_queue_cap") == 0) {
             store.setCompactionWriteQueueCap(value);
+        } else if (key.compare("compaction_max_concurrent") == 0) {
+            store.setCompactionMaxConcurrent(value);
+        } else if (key.compare("compaction_max_bytes_per_sec") == 0) {
+            store.getCompactionThrottle()->setRate(value);
         } else if (key.compare("exp_pager_stime") == 0) {
             store.setExpiryPagerSleeptime(value);
         } else if (key.compare("alog_sleep_time") == 0) {
@@ -225,8 +231,11 @@ private:
 KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     : engine(theEngine),
       stats(engine.getEpStats()),
+      compactionThrottle(std::make_shared<TokenBucket>(
+              theEngine.getConfiguration().getCompactionMaxBytesPerSec())),
       vbMap(theEngine.getConfiguration(), *this),
       defragmenterTask(NULL),
+      itemCompressorTask(nullptr),
       vb_mutexes(engine.getConfiguration().getMaxVbuckets()),
       diskDeleteAll(false),
       bgFetchDelay(0),
@@ -333,6 +342,12 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     config.addValueChangedListener("compaction_write_queue_cap",
                                    new EPStoreValueChangeListener(*this));
 
+    compactionMaxConcurrent = config.getCompactionMaxConcurrent();
+    config.addValueChangedListener("compaction_max_concurrent",
+                                   new EPStoreValueChangeListener(*this));
+    config.addValueChangedListener("compaction_max_bytes_per_sec",
+                                   new EPStoreValueChangeListener(*this));
+
     config.addValueChangedListener("dcp_min_compression_ratio",
                                    new EPStoreValueChangeListener(*this));
 
@@ -375,6 +390,9 @@ bool KVBucket::initialize() {
             std::make_shared<WorkLoadMonitor>(&engine, false);
     ExecutorPool::get()->schedule(workloadMonitorTask);
 
+    itemCompressorTask = std::make_shared<ItemCompressorTask>(&engine, stats);
+    ExecutorPool::get()->schedule(itemCompressorTask);
+
 #if HAVE_JEMALLOC
     /* Only create the defragmenter task if we have an underlying memory
      * allocator which can facilitate defragmenting memory.
@@ -403,6 +421,12 @@ void KVBucket::startWarmupTask() {
 
 void KVBucket::deinitialize() {
     stopWarmup();
+
+    if (itemCompressorTask) {
+        itemCompressorTask->stop();
+        itemCompressorTask.reset();
+    }
+
     ExecutorPool::get()->stopTaskGroup(engine.getTaskable().getGID(),
                                        NONIO_TASK_IDX, stats.forceShutdown);
 
@@ -583,7 +607,11 @@ ENGINE_ERROR_CODE KVBucket::set(Item& itm,
             return ENGINE_UNKNOWN_COLLECTION;
         } // now hold collections read access for the duration of the set
 
-        return vb->set(itm, cookie, engine, bgFetchDelay, predicate);
+        auto rv = vb->set(itm, cookie, engine, bgFetchDelay, predicate);
+        if (rv == ENGINE_SUCCESS) {
+            vb->collectionStats.stored(itm.getKey());
+        }
+        return rv;
     }
 }
 
@@ -623,7 +651,12 @@ ENGINE_ERROR_CODE KVBucket::add(Item &itm, const void *cookie)
             return ENGINE_UNKNOWN_COLLECTION;
         } // now hold collections read access for the duration of the add
 
-        return vb->add(itm, cookie, engine, bgFetchDelay, collectionsRHandle);
+        auto rv = vb->add(
+                itm, cookie, engine, bgFetchDelay, collectionsRHandle);
+        if (rv == ENGINE_SUCCESS) {
+            vb->collectionStats.stored(itm.getKey());
+        }
+        return rv;
     }
 }
 
@@ -655,12 +688,16 @@ ENGINE_ERROR_CODE KVBucket::replace(Item& itm,
             return ENGINE_UNKNOWN_COLLECTION;
         } // now hold collections read access for the duration of the set
 
-        return vb->replace(itm,
-                           cookie,
-                           engine,
-                           bgFetchDelay,
-                           predicate,
-                           collectionsRHandle);
+        auto rv = vb->replace(itm,
+                              cookie,
+                              engine,
+                              bgFetchDelay,
+                              predicate,
+                              collectionsRHandle);
+        if (rv == ENGINE_SUCCESS) {
+            vb->collectionStats.stored(itm.getKey());
+        }
+        return rv;
     }
 }
 
@@ -1286,13 +1323,17 @@ GetValue KVBucket::getInternal(const DocKey& key,
             return GetValue(NULL, ENGINE_UNKNOWN_COLLECTION);
         }
 
-        return vb->getInternal(cookie,
-                               engine,
-                               bgFetchDelay,
-                               options,
-                               diskDeleteAll,
-                               VBucket::GetKeyOnly::No,
-                               collectionsRHandle);
+        auto gv = vb->getInternal(cookie,
+                                  engine,
+                                  bgFetchDelay,
+                                  options,
+                                  diskDeleteAll,
+                                  VBucket::GetKeyOnly::No,
+                                  collectionsRHandle);
+        if (gv.getStatus() == ENGINE_SUCCESS) {
+            vb->collectionStats.read(key);
+        }
+        return gv;
     }
 }
 
@@ -1436,6 +1477,44 @@ ENGINE_ERROR_CODE KVBucket::setWithMeta(Item& itm,
     return rv;
 }
 
+ENGINE_ERROR_CODE KVBucket::setWithMetaBatch(
+        uint16_t vbid,
+        const std::vector<Item*>& items,
+        const void* cookie,
+        PermittedVBStates permittedVBStates,
+        size_t& applied) {
+    applied = 0;
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    ReaderLockHolder rlh(vb->getStateLock());
+    if (!permittedVBStates.test(vb->getState())) {
+        if (vb->getState() == vbucket_state_pending) {
+            if (vb->addPendingOp(cookie)) {
+                return ENGINE_EWOULDBLOCK;
+            }
+        } else {
+            ++stats.numNotMyVBuckets;
+            return ENGINE_NOT_MY_VBUCKET;
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        LOG(EXTENSION_LOG_DEBUG, "(vb %u) Returned TMPFAIL to a "
+            "setWithMetaBatch op, becuase takeover is lagging", vb->getId());
+        return ENGINE_TMPFAIL;
+    }
+
+    const auto rv = vb->setWithMetaBatch(
+            items, cookie, engine, bgFetchDelay, applied);
+
+    if (applied > 0) {
+        checkAndMaybeFreeMemory();
+    }
+    return rv;
+}
+
 GetValue KVBucket::getAndUpdateTtl(const DocKey& key, uint16_t vbucket,
                                    const void *cookie, time_t exptime)
 {
@@ -1632,13 +1711,17 @@ ENGINE_ERROR_CODE KVBucket::deleteItem(const DocKey& key,
             return ENGINE_UNKNOWN_COLLECTION;
         }
 
-        return vb->deleteItem(cas,
-                              cookie,
-                              engine,
-                              bgFetchDelay,
-                              itemMeta,
-                              mutInfo,
-                              collectionsRHandle);
+        auto rv = vb->deleteItem(cas,
+                                 cookie,
+                                 engine,
+                                 bgFetchDelay,
+                                 itemMeta,
+                                 mutInfo,
+                                 collectionsRHandle);
+        if (rv == ENGINE_SUCCESS) {
+            vb->collectionStats.deleted(key);
+        }
+        return rv;
     }
 }
 
@@ -2273,6 +2356,10 @@ void KVBucket::runDefragmenterTask() {
     defragmenterTask->run();
 }
 
+void KVBucket::runItemCompressorTask() {
+    itemCompressorTask->run();
+}
+
 bool KVBucket::runAccessScannerTask() {
     return ExecutorPool::get()->wake(accessScanner.task);
 }
@@ -2406,6 +2493,8 @@ bool KVBucket::collectionsEraseKey(uint16_t vbid,
             case DocNamespace::DefaultCollection:
             case DocNamespace::Collections:
                 vb->decrNumTotalItems();
+                vb->collectionStats.persisted(key, -1);
+                ++stats.collectionsItemsErased;
                 break;
             case DocNamespace::System:
                 break;
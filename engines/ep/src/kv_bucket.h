@@ -29,7 +29,9 @@
 
 #include <deque>
 
+class ItemCompressorTask;
 class ReplicationThrottle;
+class TokenBucket;
 class VBucketCountVisitor;
 namespace Collections {
 class Manager;
@@ -241,6 +243,12 @@ public:
             ExtendedMetaData* emd = NULL,
             bool isReplication = false);
 
+    ENGINE_ERROR_CODE setWithMetaBatch(uint16_t vbid,
+                                       const std::vector<Item*>& items,
+                                       const void* cookie,
+                                       PermittedVBStates permittedVBStates,
+                                       size_t& applied);
+
     /**
      * Retrieve a value, but update its TTL first
      *
@@ -737,6 +745,8 @@ public:
 
     void runDefragmenterTask();
 
+    void runItemCompressorTask();
+
     bool runAccessScannerTask();
 
     void runVbStatePersistTask(int vbid);
@@ -745,6 +755,22 @@ public:
         compactionWriteQueueCap = to;
     }
 
+    /**
+     * Set the maximum number of compactions which may run in parallel
+     * (0 = automatic, based on the number of shards).
+     */
+    virtual void setCompactionMaxConcurrent(size_t to) {
+        compactionMaxConcurrent = to;
+    }
+
+    /**
+     * @return the rate limiter shared by all compactions of this bucket.
+     *         Never null; a rate of zero means unlimited.
+     */
+    const std::shared_ptr<TokenBucket>& getCompactionThrottle() const {
+        return compactionThrottle;
+    }
+
     void setCompactionExpMemThreshold(size_t to) {
         compactionExpMemThreshold = static_cast<double>(to) / 100.0;
     }
@@ -903,14 +929,19 @@ protected:
 
     EventuallyPersistentEngine     &engine;
     EPStats                        &stats;
+    // Must be constructed before vbMap, as the shards' KVStores take a
+    // reference to it.
+    std::shared_ptr<TokenBucket> compactionThrottle;
     std::unique_ptr<Warmup> warmupTask;
     VBucketMap                      vbMap;
     ExTask itemPagerTask;
     ExTask                          chkTask;
     float                           bfilterResidencyThreshold;
     ExTask                          defragmenterTask;
+    std::shared_ptr<ItemCompressorTask> itemCompressorTask;
 
     size_t                          compactionWriteQueueCap;
+    std::atomic<size_t> compactionMaxConcurrent;
     float                           compactionExpMemThreshold;
 
     /* Vector of mutexes for each vbucket
@@ -958,7 +989,10 @@ protected:
     item_eviction_policy_t eviction_policy;
 
     std::mutex compactionLock;
+    // Compaction tasks which have been handed to the ExecutorPool.
     std::list<CompTaskEntry> compactionTasks;
+    // Compaction tasks waiting for a free slot, in arrival order.
+    std::list<CompTaskEntry> pendingCompactionTasks;
 
     std::unique_ptr<Collections::Manager> collectionsManager;
 
@@ -213,6 +213,25 @@ public:
             ExtendedMetaData* emd = NULL,
             bool isReplication = false) = 0;
 
+    /**
+     * Set a batch of items received from a replication stream, which all
+     * belong to the same vbucket and snapshot (see VBucket::setWithMetaBatch).
+     * @param vbid the vbucket to set the items in
+     * @param items the items to set (in seqno order)
+     * @param cookie the cookie representing the replication connection
+     * @param permittedVBStates set of VB states that the target VB can be in
+     * @param[out] applied the number of items which were set
+     *
+     * @return the result of the first store operation which failed, or
+     *         ENGINE_SUCCESS if all of the items were set
+     */
+    virtual ENGINE_ERROR_CODE setWithMetaBatch(
+            uint16_t vbid,
+            const std::vector<Item*>& items,
+            const void* cookie,
+            PermittedVBStates permittedVBStates,
+            size_t& applied) = 0;
+
     /**
      * Retrieve a value, but update its TTL first
      *
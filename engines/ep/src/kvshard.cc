@@ -32,6 +32,7 @@ KVShard::KVShard(uint16_t id, KVBucket& kvBucket)
     : kvConfig(kvBucket.getEPEngine().getConfiguration(), id),
       vbuckets(kvConfig.getMaxVBuckets()),
       highPriorityCount(0) {
+    kvConfig.setCompactionThrottle(kvBucket.getCompactionThrottle());
     const std::string backend = kvConfig.getBackend();
     if (backend == "couchdb") {
         auto stores = KVStoreFactory::create(kvConfig);
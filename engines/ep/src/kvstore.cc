@@ -23,6 +23,7 @@
 
 #include "common.h"
 #include "couch-kvstore/couch-kvstore.h"
+#include "dictionary_compressor.h"
 #ifdef EP_USE_FORESTDB
 #include "forest-kvstore/forest-kvstore.h"
 #endif
@@ -72,8 +73,10 @@ void FileStats::reset() {
     syncTimeHisto.reset();
     readCountHisto.reset();
     writeCountHisto.reset();
+    throttleWaitHisto.reset();
     totalBytesRead = 0;
     totalBytesWritten = 0;
+    totalThrottleWaitUs = 0;
 }
 
 KVStoreRWRO KVStoreFactory::create(KVStoreConfig& config) {
@@ -271,6 +274,13 @@ void KVStore::addStats(ADD_STAT add_stat, const void *c) {
             add_stat,
             c);
     addStat(prefix, "io_write_bytes", st.io_write_bytes, add_stat, c);
+    addStat(prefix, "io_scan_docs_read", st.io_scan_docs_read, add_stat, c);
+    addStat(prefix, "io_scan_doc_bytes", st.io_scan_doc_bytes, add_stat, c);
+    addStat(prefix,
+            "io_scan_readahead_bytes",
+            st.io_scan_readahead_bytes,
+            add_stat,
+            c);
 
     const size_t read = st.fsStats.totalBytesRead.load() +
                         st.fsStatsCompaction.totalBytesRead.load();
@@ -284,6 +294,44 @@ void KVStore::addStats(ADD_STAT add_stat, const void *c) {
             st.fsStatsCompaction.totalBytesRead, add_stat, c);
     addStat(prefix, "io_compaction_write_bytes",
             st.fsStatsCompaction.totalBytesWritten, add_stat, c);
+    addStat(prefix,
+            "io_compaction_throttle_wait_us",
+            st.fsStatsCompaction.totalThrottleWaitUs,
+            add_stat,
+            c);
+
+    // Persistence compression; the compressor is shared with the RO store
+    // so only report it once.
+    const auto& compressor = configuration.getValueCompressor();
+    if (compressor && !isReadOnly()) {
+        auto& cst = compressor->getStats();
+        addStat(prefix, "io_compression_raw_bytes", cst.rawBytes, add_stat, c);
+        addStat(prefix,
+                "io_compression_stored_bytes",
+                cst.compressedBytes,
+                add_stat,
+                c);
+        addStat(prefix,
+                "io_compression_incompressible",
+                cst.numIncompressible,
+                add_stat,
+                c);
+        addStat(prefix,
+                "io_decompress_count",
+                cst.numDecompressed,
+                add_stat,
+                c);
+        addStat(prefix,
+                "io_decompress_failures",
+                cst.numDecompressFailures,
+                add_stat,
+                c);
+        addStat(prefix,
+                "io_compression_dicts_trained",
+                cst.numDictionariesTrained,
+                add_stat,
+                c);
+    }
 
     // Specific to RocksDB. Per-shard stats.
     size_t value = 0;
@@ -336,6 +384,24 @@ void KVStore::addStats(ADD_STAT add_stat, const void *c) {
     if (getStat("rocksdb.block.cache.filter.miss", value)) {
         addStat(prefix, "rocksdb_block_cache_filter_miss", value, add_stat, c);
     }
+    // Block compression
+    if (getStat("rocksdb.number.block.compressed", value)) {
+        addStat(prefix, "rocksdb_number_block_compressed", value, add_stat, c);
+    }
+    if (getStat("rocksdb.number.block.decompressed", value)) {
+        addStat(prefix,
+                "rocksdb_number_block_decompressed",
+                value,
+                add_stat,
+                c);
+    }
+    if (getStat("rocksdb.number.block.not_compressed", value)) {
+        addStat(prefix,
+                "rocksdb_number_block_not_compressed",
+                value,
+                add_stat,
+                c);
+    }
     // Disk Usage per-CF
     if (getStat("default_kTotalSstFilesSize", value)) {
         addStat(prefix,
@@ -347,6 +413,11 @@ void KVStore::addStats(ADD_STAT add_stat, const void *c) {
     if (getStat("seqno_kTotalSstFilesSize", value)) {
         addStat(prefix, "rocksdb_seqno_kTotalSstFilesSize", value, add_stat, c);
     }
+
+    // Entries in the seqno CF
+    if (getStat("seqno_kEstimateNumKeys", value)) {
+        addStat(prefix, "rocksdb_seqno_kEstimateNumKeys", value, add_stat, c);
+    }
 }
 
 void KVStore::addTimingStats(ADD_STAT add_stat, const void *c) {
@@ -363,6 +434,8 @@ void KVStore::addTimingStats(ADD_STAT add_stat, const void *c) {
 
     addStat(prefix, "commit",      st.commitHisto,      add_stat, c);
     addStat(prefix, "compact",     st.compactHisto,     add_stat, c);
+    addStat(prefix, "compactThroughput", st.compactThroughputHisto, add_stat, c);
+    addStat(prefix, "scanThroughput", st.scanThroughputHisto, add_stat, c);
     addStat(prefix, "snapshot",    st.snapshotHisto,    add_stat, c);
     addStat(prefix, "delete",      st.delTimeHisto,     add_stat, c);
     addStat(prefix, "save_documents", st.saveDocsHisto, add_stat, c);
@@ -388,6 +461,19 @@ void KVStore::addTimingStats(ADD_STAT add_stat, const void *c) {
     addStat(prefix, "fsReadSeek",  st.fsStats.readSeekHisto,  add_stat, c);
     addStat(prefix, "fsReadCount", st.fsStats.readCountHisto, add_stat, c);
     addStat(prefix, "fsWriteCount", st.fsStats.writeCountHisto, add_stat, c);
+    addStat(prefix,
+            "fsCompactionThrottleWait",
+            st.fsStatsCompaction.throttleWaitHisto,
+            add_stat,
+            c);
+
+    const auto& compressor = configuration.getValueCompressor();
+    if (compressor && !isReadOnly()) {
+        auto& cst = compressor->getStats();
+        addStat(prefix, "compressTime", cst.compressHisto, add_stat, c);
+        addStat(prefix, "decompressTime", cst.decompressHisto, add_stat, c);
+        addStat(prefix, "dictTrainTime", cst.trainHisto, add_stat, c);
+    }
 }
 
 void KVStore::optimizeWrites(std::vector<queued_item>& items) {
@@ -256,11 +256,15 @@ struct FileStats {
     // Write count per open() / close() pair
     Histogram<uint32_t> writeCountHisto = {
             ExponentialGenerator<uint32_t>(2, 1.333), 50};
+    // Time spent waiting on the I/O rate limiter before a read / write
+    MicrosecondHistogram throttleWaitHisto;
 
     // total bytes read from disk.
     std::atomic<size_t> totalBytesRead{0};
     // Total bytes written to disk.
     std::atomic<size_t> totalBytesWritten{0};
+    // Total time (us) spent waiting on the I/O rate limiter.
+    std::atomic<size_t> totalThrottleWaitUs{0};
 
     void reset();
 };
@@ -289,8 +293,13 @@ public:
       io_num_write(0),
       io_bgfetch_doc_bytes(0),
       io_write_bytes(0),
+      io_scan_docs_read(0),
+      io_scan_doc_bytes(0),
+      io_scan_readahead_bytes(0),
       readSizeHisto(ExponentialGenerator<size_t>(1, 2), 25),
       writeSizeHisto(ExponentialGenerator<size_t>(1, 2), 25),
+      compactThroughputHisto(ExponentialGenerator<size_t>(1024, 2), 25),
+      scanThroughputHisto(ExponentialGenerator<size_t>(1024, 2), 25),
       getMultiFsReadCount(0),
       getMultiFsReadHisto(ExponentialGenerator<uint32_t>(6, 1.2), 50),
       getMultiFsReadPerDocHisto(ExponentialGenerator<uint32_t>(6, 1.2),50) {
@@ -316,6 +325,8 @@ public:
         writeSizeHisto.reset();
         delTimeHisto.reset();
         compactHisto.reset();
+        compactThroughputHisto.reset();
+        scanThroughputHisto.reset();
         snapshotHisto.reset();
         commitHisto.reset();
         saveDocsHisto.reset();
@@ -354,6 +365,12 @@ public:
     Couchbase::RelaxedAtomic<size_t> io_bgfetch_doc_bytes;
     //! Number of bytes written (key + value + application rev metadata)
     Couchbase::RelaxedAtomic<size_t> io_write_bytes;
+    //! Number of documents read from disk by scans (e.g. DCP backfills).
+    Couchbase::RelaxedAtomic<size_t> io_scan_docs_read;
+    //! Document bytes (key+meta+value) read from disk by scans.
+    Couchbase::RelaxedAtomic<size_t> io_scan_doc_bytes;
+    //! Bytes of the data file hinted to the OS ahead of a scan reading them.
+    Couchbase::RelaxedAtomic<size_t> io_scan_readahead_bytes;
 
     /* for flush and vb delete, no error handling in KVStore, such
      * failure should be tracked in MC-engine  */
@@ -372,6 +389,10 @@ public:
     MicrosecondHistogram commitHisto;
     // Time spent in compaction
     MicrosecondHistogram compactHisto;
+    // Bytes/sec (read + written) achieved by each compaction
+    Histogram<size_t> compactThroughputHisto;
+    // Document bytes/sec read by each scan() call
+    Histogram<size_t> scanThroughputHisto;
     // Time spent in saving documents to disk
     MicrosecondHistogram saveDocsHisto;
     // Batch size while saving documents
@@ -689,6 +710,15 @@ public:
      */
     virtual DBFileInfo getDbFileInfo(uint16_t dbFileId) = 0;
 
+    /**
+     * As getDbFileInfo(), but allowed to return (possibly slightly stale)
+     * cached values without touching the file. Used where a cheap estimate
+     * is sufficient, e.g. when prioritising compactions.
+     */
+    virtual DBFileInfo getCachedDbFileInfo(uint16_t dbFileId) {
+        return getDbFileInfo(dbFileId);
+    }
+
     /**
      * This method will return file size and space used for the
      * entire KV store
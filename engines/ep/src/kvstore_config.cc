@@ -17,6 +17,8 @@
 
 #include "kvstore_config.h"
 
+#include "dictionary_compressor.h"
+
 /// A listener class to update KVStore related configs at runtime.
 class KVStoreConfig::ConfigChangeListener : public ValueChangedListener {
 public:
@@ -58,6 +60,29 @@ KVStoreConfig::KVStoreConfig(Configuration& config, uint16_t shardid)
     rocksdbSeqnoCfOptimizeCompaction =
             config.getRocksdbSeqnoCfOptimizeCompaction();
     bucketQuota = config.getMaxSize();
+
+    if (config.isDcpScanReadahead()) {
+        setScanReadAhead(config.getDcpScanItemLimit(),
+                         config.getDcpScanByteLimit());
+    } else {
+        setScanReadAhead(0, 0);
+    }
+
+    persistenceCompressionMode = config.getPersistenceCompressionMode();
+    persistenceCompressionLevel = config.getPersistenceCompressionLevel();
+    persistenceCompressionDictSize =
+            config.getPersistenceCompressionDictSize();
+    // RocksDB uses its own (native) zstd support; see RocksDBKVStore.
+    if (backend == "couchdb" && DictionaryCompressor::isSupported()) {
+        valueCompressor = std::make_shared<DictionaryCompressor>(
+                int(persistenceCompressionLevel),
+                persistenceCompressionDictSize);
+    } else if (persistenceCompressionMode == "zstd" && backend == "couchdb") {
+        logger->log(EXTENSION_LOG_WARNING,
+                    "KVStoreConfig: persistence_compression_mode=zstd "
+                    "requested but zstd support is not compiled in; "
+                    "values will be persisted uncompressed");
+    }
 }
 
 KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
@@ -99,3 +124,15 @@ KVStoreConfig& KVStoreConfig::setBuffered(bool _buffered) {
     buffered = _buffered;
     return *this;
 }
+
+KVStoreConfig& KVStoreConfig::setScanReadAhead(size_t items, size_t bytes) {
+    scanReadAheadItems = items;
+    scanReadAheadBytes = bytes;
+    return *this;
+}
+
+KVStoreConfig& KVStoreConfig::setPersistenceCompressionMode(
+        const std::string& mode) {
+    persistenceCompressionMode = mode;
+    return *this;
+}
@@ -22,9 +22,12 @@
 #include "configuration.h"
 #include "logger.h"
 
+#include <memory>
 #include <string>
 
+class DictionaryCompressor;
 class Logger;
+class TokenBucket;
 
 class KVStoreConfig {
 public:
@@ -95,6 +98,12 @@ public:
      */
     KVStoreConfig& setBuffered(bool _buffered);
 
+    /**
+     * Used to override persistence_compression_mode. Values are only
+     * compressed if a compressor is also set (see setValueCompressor()).
+     */
+    KVStoreConfig& setPersistenceCompressionMode(const std::string& mode);
+
     bool shouldPersistDocNamespace() const {
         return persistDocNamespace;
     }
@@ -111,6 +120,59 @@ public:
         periodicSyncBytes = bytes;
     }
 
+    const std::shared_ptr<TokenBucket>& getCompactionThrottle() const {
+        return compactionThrottle;
+    }
+
+    void setCompactionThrottle(std::shared_ptr<TokenBucket> throttle) {
+        compactionThrottle = std::move(throttle);
+    }
+
+    /**
+     * Largest number of documents (and total on-disk bytes) a scan hints to
+     * the OS ahead of reading them; taken from dcp_scan_item_limit and
+     * dcp_scan_byte_limit so the read-ahead never runs further ahead than
+     * a backfill consumes in one run. Zero items disables read-ahead.
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getScanReadAheadItems() const {
+        return scanReadAheadItems;
+    }
+
+    size_t getScanReadAheadBytes() const {
+        return scanReadAheadBytes;
+    }
+
+    KVStoreConfig& setScanReadAhead(size_t items, size_t bytes);
+
+    /// Return the configured persistence_compression_mode ("off"/"zstd").
+    const std::string& getPersistenceCompressionMode() const {
+        return persistenceCompressionMode;
+    }
+
+    size_t getPersistenceCompressionLevel() const {
+        return persistenceCompressionLevel;
+    }
+
+    size_t getPersistenceCompressionDictSize() const {
+        return persistenceCompressionDictSize;
+    }
+
+    /**
+     * Compressor for document bodies written by CouchKVStore; shared by the
+     * RW and RO stores of the shard. Present whenever the build supports
+     * zstd (so previously compressed documents remain readable after
+     * persistence_compression_mode is turned off), null otherwise.
+     */
+    const std::shared_ptr<DictionaryCompressor>& getValueCompressor() const {
+        return valueCompressor;
+    }
+
+    void setValueCompressor(std::shared_ptr<DictionaryCompressor> compressor) {
+        valueCompressor = std::move(compressor);
+    }
+
     // Following specific to RocksDB.
     // TODO: Move into a RocksDBKVStoreConfig subclass.
 
@@ -204,6 +266,20 @@ private:
      */
     uint64_t periodicSyncBytes;
 
+    /**
+     * Rate limiter shared by all compactions of the bucket; bounds the
+     * combined bytes/sec of compaction file I/O. Null means unlimited.
+     */
+    std::shared_ptr<TokenBucket> compactionThrottle;
+
+    size_t scanReadAheadItems = 4096;
+    size_t scanReadAheadBytes = 4194304;
+
+    std::string persistenceCompressionMode = "off";
+    size_t persistenceCompressionLevel = 3;
+    size_t persistenceCompressionDictSize = 16384;
+    std::shared_ptr<DictionaryCompressor> valueCompressor;
+
     // Amount of memory reserved for the bucket.
     size_t bucketQuota = 0;
 
@@ -50,6 +50,7 @@ void PersistenceCallback::callback(TransactionContext& txCtx,
                     // Insert in value-only or full eviction mode.
                     ++vbucket.opsCreate;
                     vbucket.incrNumTotalItems();
+                    vbucket.collectionStats.persisted(queuedItem->getKey(), 1);
                     vbucket.incrMetaDataDisk(*queuedItem);
                 } else { // Update in full eviction mode.
                     ++vbucket.opsUpdate;
@@ -61,6 +62,8 @@ void PersistenceCallback::callback(TransactionContext& txCtx,
             }
         }
 
+        vbucket.collectionStats.flushed(queuedItem->getKey(),
+                                        queuedItem->size());
         vbucket.doStatsForFlushing(*queuedItem, queuedItem->size());
         --epCtx.stats.diskQueueSize;
         epCtx.stats.totalPersisted++;
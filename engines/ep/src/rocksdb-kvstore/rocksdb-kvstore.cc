@@ -33,6 +33,7 @@
 #include <gsl/gsl>
 #include <limits>
 #include <thread>
+#include <unordered_map>
 
 #include "vbucket.h"
 
@@ -118,6 +119,16 @@ public:
                 item.getBySeqno());
     }
 
+    // Record whether the document existed (and was not deleted) on disk
+    // before this request is persisted
+    void setDocExisted(bool existed) {
+        docExisted = existed;
+    }
+
+    bool getDocExisted() const {
+        return docExisted;
+    }
+
     const rockskv::MetaData& getDocMeta() {
         return docMeta;
     }
@@ -138,6 +149,7 @@ public:
 private:
     rockskv::MetaData docMeta;
     value_t docBody;
+    bool docExisted = false;
 };
 
 // RocksDB docs suggest to "Use `rocksdb::DB::DestroyColumnFamilyHandle()` to
@@ -194,6 +206,259 @@ public:
     const ColumnFamilyPtr defaultCFH;
     const ColumnFamilyPtr seqnoCFH;
     const uint16_t vbid;
+
+    // Number of alive and deleted documents persisted for the VBucket,
+    // maintained by the flusher in 'saveDocs()' and by 'compactDB()'
+    std::atomic<uint64_t> numItems{0};
+    std::atomic<uint64_t> numDeletes{0};
+    std::atomic<uint64_t> purgeSeqno{0};
+
+    // Guards the members below, which are set for the duration of a
+    // 'compactDB()' on the VBucket and used by the ExpiryCompactionFilter
+    std::mutex compactionMutex;
+    compaction_ctx* compactionCtx = nullptr;
+    int64_t compactionHighSeqno = 0;
+};
+
+/**
+ * Compaction filter for the 'default' Column Family of a VBucket, used by
+ * 'RocksDBKVStore::compactDB()'. It applies the same rules as the Couchstore
+ * compaction (see time_purge_hook):
+ *     - tombstones are purged once older than the metadata purge interval
+ *       (or unconditionally if 'drop_deletes' is set), except the one at the
+ *       high seqno;
+ *     - expired items are kept, but notified to the 'expiryCallback' so that
+ *       the engine deletes them;
+ *     - the kept documents are notified to the 'bloomFilterCallback'.
+ */
+class ExpiryCompactionFilter : public rocksdb::CompactionFilter {
+public:
+    ExpiryCompactionFilter(RocksDBKVStore& store, std::shared_ptr<VBHandle> vbh)
+        : store(store), vbh(std::move(vbh)) {
+        // The lookups are made for each expired / purged entry, don't let
+        // them evict the blocks used by the front end
+        readOptions.fill_cache = false;
+    }
+
+    bool Filter(int level,
+                const rocksdb::Slice& key,
+                const rocksdb::Slice& existingValue,
+                std::string* newValue,
+                bool* valueChanged) const override {
+        if (existingValue.size() < sizeof(rockskv::MetaData)) {
+            return false;
+        }
+        rockskv::MetaData meta;
+        std::memcpy(&meta, existingValue.data(), sizeof(meta));
+
+        std::lock_guard<std::mutex> lg(vbh->compactionMutex);
+        auto* ctx = vbh->compactionCtx;
+        if (!ctx) {
+            return false;
+        }
+        // Collections: TODO: Restore to stored namespace
+        DocKey docKey(reinterpret_cast<const uint8_t*>(key.data()),
+                      key.size(),
+                      DocNamespace::DefaultCollection);
+
+        if (meta.deleted) {
+            if (meta.bySeqno != vbh->compactionHighSeqno &&
+                (ctx->drop_deletes ||
+                 (uint64_t(meta.exptime) < ctx->purge_before_ts &&
+                  (!ctx->purge_before_seq ||
+                   uint64_t(meta.bySeqno) <= ctx->purge_before_seq)))) {
+                // A newer version of the document may have been written
+                // since this one; the old version is dropped all the same,
+                // but it is not a tombstone of the VBucket anymore.
+                if (isLatestVersion(key, meta.bySeqno)) {
+                    auto& maxPurgedSeq = ctx->max_purged_seq[vbh->vbid];
+                    maxPurgedSeq =
+                            std::max(maxPurgedSeq, uint64_t(meta.bySeqno));
+                    ctx->stats.tombstonesPurged++;
+                }
+                return true;
+            }
+        } else {
+            time_t currtime = ep_real_time();
+            if (meta.exptime && meta.exptime < currtime &&
+                ctx->expiryCallback && isLatestVersion(key, meta.bySeqno)) {
+                // As for Couchstore, the value is only needed to preserve
+                // the system xattrs when the item is deleted.
+                auto item = store.makeItem(
+                        vbh->vbid,
+                        docKey,
+                        existingValue,
+                        mcbp::datatype::is_xattr(meta.datatype)
+                                ? GetMetaOnly::No
+                                : GetMetaOnly::Yes);
+                ctx->expiryCallback->callback(*item, currtime);
+            }
+        }
+
+        if (ctx->bloomFilterCallback) {
+            bool deleted = meta.deleted;
+            uint16_t vbid = vbh->vbid;
+            ctx->bloomFilterCallback->callback(vbid, docKey, deleted);
+        }
+
+        return false;
+    }
+
+    const char* Name() const override {
+        return "ExpiryCompactionFilter";
+    }
+
+private:
+    // Returns true if the document with the given key stored in the
+    // 'default' CF is the version with the given seqno
+    bool isLatestVersion(const rocksdb::Slice& key, int64_t seqno) const {
+        std::string document;
+        const auto status = vbh->rdb.Get(
+                readOptions, vbh->defaultCFH.get(), key, &document);
+        if (!status.ok() || document.size() < sizeof(rockskv::MetaData)) {
+            return false;
+        }
+        rockskv::MetaData meta;
+        std::memcpy(&meta, document.data(), sizeof(meta));
+        return meta.bySeqno == seqno;
+    }
+
+    RocksDBKVStore& store;
+    const std::shared_ptr<VBHandle> vbh;
+    rocksdb::ReadOptions readOptions;
+};
+
+/**
+ * Creates an ExpiryCompactionFilter for the manual compactions of a 'default'
+ * Column Family started by 'RocksDBKVStore::compactDB()'. The compactions
+ * scheduled by RocksDB in background run without filter.
+ */
+class ExpiryCompactionFilterFactory : public rocksdb::CompactionFilterFactory {
+public:
+    explicit ExpiryCompactionFilterFactory(RocksDBKVStore& store)
+        : store(store) {
+    }
+
+    std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+            const rocksdb::CompactionFilter::Context& context) override {
+        if (!context.is_manual_compaction) {
+            return nullptr;
+        }
+        auto vbh = store.getVBHandleForCF(context.column_family_id);
+        if (!vbh) {
+            return nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lg(vbh->compactionMutex);
+            if (!vbh->compactionCtx) {
+                return nullptr;
+            }
+        }
+        return std::make_unique<ExpiryCompactionFilter>(store, vbh);
+    }
+
+    const char* Name() const override {
+        return "ExpiryCompactionFilterFactory";
+    }
+
+private:
+    RocksDBKVStore& store;
+};
+
+/**
+ * Compaction filter for the seqno Column Family of a VBucket, which drops
+ * the stale seqno=>key entries (i.e., the key has since been updated and
+ * the document in the 'default' CF now has a higher seqno).
+ *
+ * Without it every update leaves an entry behind in the seqno CF, which
+ * a backfill has to read (and look up in the 'default' CF) just to skip it.
+ *
+ * Note that RocksDB doesn't call the filter for entries which are still
+ * visible to a snapshot, so the entries a running scan relies on are kept.
+ */
+class StaleSeqnoCompactionFilter : public rocksdb::CompactionFilter {
+public:
+    explicit StaleSeqnoCompactionFilter(std::weak_ptr<VBHandle> vbh)
+        : vbh(std::move(vbh)) {
+        // The lookups are made for each entry being compacted, don't let
+        // them evict the blocks used by the front end
+        readOptions.fill_cache = false;
+    }
+
+    bool Filter(int level,
+                const rocksdb::Slice& key,
+                const rocksdb::Slice& existingValue,
+                std::string* newValue,
+                bool* valueChanged) const override {
+        int64_t seqno;
+        if (key.size() != sizeof(seqno)) {
+            return false;
+        }
+        std::memcpy(&seqno, key.data(), sizeof(seqno));
+        // Negative seqnos are used for local documents (e.g., the vbstate)
+        if (seqno < 0) {
+            return false;
+        }
+
+        const auto handle = vbh.lock();
+        if (!handle) {
+            // The VBucket is being deleted
+            return false;
+        }
+
+        std::string document;
+        const auto status = handle->rdb.Get(readOptions,
+                                            handle->defaultCFH.get(),
+                                            existingValue,
+                                            &document);
+        if (status.IsNotFound()) {
+            // Deletions are stored as documents too, so nothing refers to
+            // this entry anymore
+            return true;
+        }
+        if (!status.ok() || document.size() < sizeof(rockskv::MetaData)) {
+            return false;
+        }
+
+        rockskv::MetaData meta;
+        std::memcpy(&meta, document.data(), sizeof(meta));
+        return meta.bySeqno > seqno;
+    }
+
+    const char* Name() const override {
+        return "StaleSeqnoCompactionFilter";
+    }
+
+private:
+    const std::weak_ptr<VBHandle> vbh;
+    rocksdb::ReadOptions readOptions;
+};
+
+/**
+ * Creates a StaleSeqnoCompactionFilter for each compaction of a seqno
+ * Column Family, bound to the VBucket owning it.
+ */
+class SeqnoCompactionFilterFactory : public rocksdb::CompactionFilterFactory {
+public:
+    explicit SeqnoCompactionFilterFactory(RocksDBKVStore& store)
+        : store(store) {
+    }
+
+    std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+            const rocksdb::CompactionFilter::Context& context) override {
+        auto vbh = store.getVBHandleForCF(context.column_family_id);
+        if (!vbh) {
+            return nullptr;
+        }
+        return std::make_unique<StaleSeqnoCompactionFilter>(vbh);
+    }
+
+    const char* Name() const override {
+        return "SeqnoCompactionFilterFactory";
+    }
+
+private:
+    RocksDBKVStore& store;
 };
 
 RocksDBKVStore::RocksDBKVStore(KVStoreConfig& config)
@@ -287,6 +552,10 @@ RocksDBKVStore::~RocksDBKVStore() {
     //     "Before delete DB, you have to close All column families by calling
     //      DestroyColumnFamilyHandle() with all the handles."
     vbHandles.clear();
+    scanSnapshots.clear();
+    // Close the DB while the members used by the background compactions
+    // (see SeqnoCompactionFilterFactory) are still alive.
+    rdb.reset();
     in_transaction = false;
 }
 
@@ -362,6 +631,9 @@ void RocksDBKVStore::openDB() {
     // '(cfDescriptors.size() - 1) > 0') then 'cfDescriptors[i]' and
     // 'cfDescriptors[i+1]' are respectively the 'default_' and 'seqno'_ CFs
     // for a certain VBucket.
+    // Note: background compactions may already be running and looking up
+    // 'cfVBHandles' (see SeqnoCompactionFilterFactory).
+    std::lock_guard<std::mutex> lg(vbhMutex);
     for (uint16_t i = 0; i < (cfDescriptors.size() - 1); i += 2) {
         // Note: any further sanity-check is redundant as we will have always
         // 'cf = "default_<vbid>"'.
@@ -369,6 +641,7 @@ void RocksDBKVStore::openDB() {
         uint16_t vbid = std::stoi(cf.substr(8));
         vbHandles[vbid] = std::make_shared<VBHandle>(
                 *rdb, handles[i], handles[i + 1], vbid);
+        addCFVBHandles(vbHandles[vbid]);
     }
 
     // We need to release the ColumnFamilyHandle for the built-in 'default' CF
@@ -409,10 +682,37 @@ std::shared_ptr<VBHandle> RocksDBKVStore::getVBHandle(uint16_t vbid) {
 
     vbHandles[vbid] =
             std::make_shared<VBHandle>(*rdb, handles[0], handles[1], vbid);
+    addCFVBHandles(vbHandles[vbid]);
 
     return vbHandles[vbid];
 }
 
+std::shared_ptr<VBHandle> RocksDBKVStore::findVBHandle(uint16_t vbid) {
+    std::lock_guard<std::mutex> lg(vbhMutex);
+    return vbHandles[vbid];
+}
+
+std::shared_ptr<VBHandle> RocksDBKVStore::getVBHandleForCF(uint32_t cfId) {
+    std::lock_guard<std::mutex> lg(cfMutex);
+    auto it = cfVBHandles.find(cfId);
+    if (it == cfVBHandles.end()) {
+        return nullptr;
+    }
+    return it->second.lock();
+}
+
+void RocksDBKVStore::addCFVBHandles(const std::shared_ptr<VBHandle>& vbh) {
+    std::lock_guard<std::mutex> lg(cfMutex);
+    cfVBHandles[vbh->defaultCFH->GetID()] = vbh;
+    cfVBHandles[vbh->seqnoCFH->GetID()] = vbh;
+}
+
+void RocksDBKVStore::removeCFVBHandles(const VBHandle& vbh) {
+    std::lock_guard<std::mutex> lg(cfMutex);
+    cfVBHandles.erase(vbh.defaultCFH->GetID());
+    cfVBHandles.erase(vbh.seqnoCFH->GetID());
+}
+
 std::string RocksDBKVStore::getDBSubdir() {
     return configuration.getDBName() + "/rocksdb." +
            std::to_string(configuration.getShardId());
@@ -507,11 +807,8 @@ void RocksDBKVStore::commitCallback(
                 st.delTimeHisto.add(request->getDelta() / 1000);
             }
             if (rv != -1) {
-                // TODO: Should set `rv` to 1 or 0 depending on if this is a
-                // delete to an existing (1) or non-existing (0) item. However,
-                // to achieve this we would need to perform a Get to RocksDB
-                // which is costly. For now just assume that the item did exist.
-                rv = 1;
+                // Deletion is to an existing item on disk
+                rv = request->getDocExisted() ? 1 : 0;
             }
             request->getDelCallback()->callback(*transactionCtx, rv);
         } else {
@@ -521,12 +818,8 @@ void RocksDBKVStore::commitCallback(
                 st.writeTimeHisto.add(request->getDelta() / 1000);
                 st.writeSizeHisto.add(dataSize + key.size());
             }
-            // TODO: Should set `mr.second` to true or false depending on if
-            // this is an insertion (true) or an update of an existing item
-            // (false). However, to achieve this we would need to perform a Get
-            // to RocksDB which is costly. For now just assume that the item
-            // did not exist.
-            mutation_result mr = std::make_pair(1, true);
+            // An insertion is a set of an item which doesn't exist on disk
+            mutation_result mr = std::make_pair(rv, !request->getDocExisted());
             request->getSetCallback()->callback(*transactionCtx, mr);
         }
     }
@@ -581,16 +874,29 @@ GetValue RocksDBKVStore::getWithHeader(void* dbHandle,
 }
 
 void RocksDBKVStore::getMulti(uint16_t vb, vb_bgfetch_queue_t& itms) {
-    // TODO RDB: RocksDB supports a multi get which we should use here.
+    const auto vbh = getVBHandle(vb);
+
+    // Fetch the whole batch with a single MultiGet, so that RocksDB can
+    // share the lookup work (e.g. memtable and SST file lookups) across keys
+    std::vector<rocksdb::Slice> keySlices;
+    keySlices.reserve(itms.size());
+    for (const auto& it : itms) {
+        keySlices.push_back(getKeySlice(it.first));
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> cfHandles(
+            keySlices.size(), vbh->defaultCFH.get());
+    std::vector<std::string> values;
+    const auto statuses = rdb->MultiGet(
+            rocksdb::ReadOptions(), cfHandles, keySlices, &values);
+
+    // 'itms' is not modified, so the iteration order matches the order of
+    // the keys given to MultiGet
+    size_t index = 0;
     for (auto& it : itms) {
         auto& key = it.first;
-        rocksdb::Slice keySlice = getKeySlice(key);
-        std::string value;
-        const auto vbh = getVBHandle(vb);
-        rocksdb::Status s = rdb->Get(rocksdb::ReadOptions(),
-                                     vbh->defaultCFH.get(),
-                                     keySlice,
-                                     &value);
+        const auto& s = statuses[index];
+        const auto& value = values[index];
+        ++index;
         if (s.ok()) {
             it.second.value =
                     makeGetValue(vb, key, value, it.second.isMetaOnly);
@@ -617,8 +923,8 @@ void RocksDBKVStore::del(const Item& item,
                 "RocksDBKVStore::del: in_transaction must be true to perform a "
                 "delete operation.");
     }
-    // TODO: Deleted items remain as tombstones, but are not yet expired,
-    // they will accumuate forever.
+    // Deleted items remain as tombstones until they are purged by
+    // compactDB() (see ExpiryCompactionFilter).
     MutationRequestCallback callback;
     callback.delCb = &cb;
     pendingReqs.push_back(std::make_unique<RocksRequest>(item, callback));
@@ -648,6 +954,9 @@ void RocksDBKVStore::delVBucket(uint16_t vbid, uint64_t vb_version) {
     {
         std::shared_ptr<VBHandle> sharedPtr;
         std::swap(vbHandles[vbid], sharedPtr);
+        // The compaction filter factories look up the VBHandle by CF id
+        // without acquiring 'vbhMutex', so a running compactDB can complete
+        removeCFVBHandles(*sharedPtr);
         while (!sharedPtr.unique()) {
             std::this_thread::sleep_for(std::chrono::microseconds(100));
         }
@@ -766,6 +1075,18 @@ bool RocksDBKVStore::getStat(const char* name_, size_t& value) {
                                      value);
     }
 
+    // Block compression
+    else if (name == "rocksdb.number.block.compressed") {
+        return getStatFromStatistics(rocksdb::Tickers::NUMBER_BLOCK_COMPRESSED,
+                                     value);
+    } else if (name == "rocksdb.number.block.decompressed") {
+        return getStatFromStatistics(
+                rocksdb::Tickers::NUMBER_BLOCK_DECOMPRESSED, value);
+    } else if (name == "rocksdb.number.block.not_compressed") {
+        return getStatFromStatistics(
+                rocksdb::Tickers::NUMBER_BLOCK_NOT_COMPRESSED, value);
+    }
+
     // Disk Usage per Column Family
     else if (name == "default_kTotalSstFilesSize") {
         return getStatFromProperties(
@@ -779,6 +1100,15 @@ bool RocksDBKVStore::getStat(const char* name_, size_t& value) {
                 value);
     }
 
+    // Number of entries in the seqno CF, including the stale seqno=>key
+    // entries not yet compacted away. Each overwrite of the local documents
+    // is counted until it is compacted too, so only exact after compaction.
+    else if (name == "seqno_kEstimateNumKeys") {
+        return getStatFromProperties(ColumnFamily::Seqno,
+                                     rocksdb::DB::Properties::kEstimateNumKeys,
+                                     value);
+    }
+
     return false;
 }
 
@@ -786,11 +1116,8 @@ StorageProperties RocksDBKVStore::getStorageProperties(void) {
     StorageProperties rv(StorageProperties::EfficientVBDump::Yes,
                          StorageProperties::EfficientVBDeletion::Yes,
                          StorageProperties::PersistedDeletion::No,
-                         // TODO RDB: Not strictly true, multiGet
-                         // does not yet use the underlying multi get
-                         // of RocksDB
                          StorageProperties::EfficientGet::Yes,
-                         StorageProperties::ConcurrentWriteCompact::Yes);
+                         StorageProperties::ConcurrentWriteCompact::No);
     return rv;
 }
 
@@ -895,7 +1222,7 @@ GetValue RocksDBKVStore::makeGetValue(uint16_t vb,
             makeItem(vb, key, sval, getMetaOnly), ENGINE_SUCCESS, -1, 0);
 }
 
-void RocksDBKVStore::readVBState(const VBHandle& vbh) {
+void RocksDBKVStore::readVBState(VBHandle& vbh) {
     // Largely copied from CouchKVStore
     // TODO RDB: refactor out sections common to CouchKVStore
     vbucket_state_t state = vbucket_state_dead;
@@ -903,7 +1230,8 @@ void RocksDBKVStore::readVBState(const VBHandle& vbh) {
     uint64_t maxDeletedSeqno = 0;
     int64_t highSeqno = readHighSeqnoFromDisk(vbh);
     std::string failovers;
-    uint64_t purgeSeqno = 0;
+    readFileInfo(vbh);
+    uint64_t purgeSeqno = vbh.purgeSeqno;
     uint64_t lastSnapStart = 0;
     uint64_t lastSnapEnd = 0;
     uint64_t maxCas = 0;
@@ -1048,6 +1376,81 @@ rocksdb::Status RocksDBKVStore::saveVBStateToBatch(const VBHandle& vbh,
     return batch.Put(vbh.seqnoCFH.get(), keySlice, jsonState.str());
 }
 
+void RocksDBKVStore::readFileInfo(VBHandle& vbh) {
+    auto key = getFileInfoKey();
+    std::string fileInfo;
+    auto status = rdb->Get(rocksdb::ReadOptions(),
+                           vbh.seqnoCFH.get(),
+                           getSeqnoSlice(&key),
+                           &fileInfo);
+    if (status.IsNotFound()) {
+        // The DB was created before the counts were persisted. Fall back to
+        // the estimate of RocksDB, which also counts the tombstones.
+        std::string out;
+        if (rdb->GetProperty(vbh.defaultCFH.get(),
+                             rocksdb::DB::Properties::kEstimateNumKeys,
+                             &out)) {
+            vbh.numItems = std::stoull(out);
+        }
+        logger.log(EXTENSION_LOG_NOTICE,
+                   "RocksDBKVStore::readFileInfo: '_local/fileinfo.%" PRIu16
+                   "' not found, estimated item count:%" PRIu64,
+                   vbh.vbid,
+                   vbh.numItems.load());
+        return;
+    }
+    if (!status.ok()) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "RocksDBKVStore::readFileInfo: error getting fileinfo "
+                   "error:%s, vb:%" PRIu16,
+                   status.getState(),
+                   vbh.vbid);
+        return;
+    }
+
+    cJSON* jsonObj = cJSON_Parse(fileInfo.c_str());
+    if (!jsonObj) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "RocksDBKVStore::readFileInfo: Failed to parse the fileinfo "
+                   "json doc for vb:%" PRIu16 ", json:%s",
+                   vbh.vbid,
+                   fileInfo.c_str());
+        return;
+    }
+
+    const std::string itemCount =
+            getJSONObjString(cJSON_GetObjectItem(jsonObj, "item_count"));
+    const std::string deletedCount =
+            getJSONObjString(cJSON_GetObjectItem(jsonObj, "deleted_count"));
+    const std::string purgeSeqno =
+            getJSONObjString(cJSON_GetObjectItem(jsonObj, "purge_seqno"));
+    if (!itemCount.empty()) {
+        vbh.numItems = std::stoull(itemCount);
+    }
+    if (!deletedCount.empty()) {
+        vbh.numDeletes = std::stoull(deletedCount);
+    }
+    if (!purgeSeqno.empty()) {
+        vbh.purgeSeqno = std::stoull(purgeSeqno);
+    }
+    cJSON_Delete(jsonObj);
+}
+
+rocksdb::Status RocksDBKVStore::saveFileInfoToBatch(const VBHandle& vbh,
+                                                    uint64_t numItems,
+                                                    uint64_t numDeletes,
+                                                    uint64_t purgeSeqno,
+                                                    rocksdb::WriteBatch& batch) {
+    std::stringstream jsonInfo;
+    jsonInfo << "{\"item_count\": \"" << numItems << "\""
+             << ",\"deleted_count\": \"" << numDeletes << "\""
+             << ",\"purge_seqno\": \"" << purgeSeqno << "\"}";
+
+    auto key = getFileInfoKey();
+    rocksdb::Slice keySlice = getSeqnoSlice(&key);
+    return batch.Put(vbh.seqnoCFH.get(), keySlice, jsonInfo.str());
+}
+
 rocksdb::ColumnFamilyOptions RocksDBKVStore::getBaselineDefaultCFOptions() {
     rocksdb::ColumnFamilyOptions cfOptions;
 
@@ -1057,6 +1460,11 @@ rocksdb::ColumnFamilyOptions RocksDBKVStore::getBaselineDefaultCFOptions() {
     // 'rocksdb_block_cache_size'
     cfOptions.OptimizeForPointLookup(1);
 
+    // Expire items and purge tombstones in the compactions requested by
+    // 'compactDB()'
+    cfOptions.compaction_filter_factory =
+            std::make_shared<ExpiryCompactionFilterFactory>(*this);
+
     // Set the given Memory Budget as the write_buffer_size
     if (configuration.getRocksdbDefaultCfMemBudget() > 0) {
         cfOptions.write_buffer_size =
@@ -1072,6 +1480,26 @@ rocksdb::ColumnFamilyOptions RocksDBKVStore::getBaselineDefaultCFOptions() {
         cfOptions.OptimizeUniversalStyleCompaction(cfOptions.write_buffer_size);
     }
 
+    // Persistence compression: RocksDB compresses whole blocks and has
+    // native support for zstd dictionaries, trained from a sample of the
+    // data of each SST file and stored in it, so (unlike CouchKVStore) we
+    // only need to switch it on. Levels the compaction optimization left
+    // uncompressed stay that way.
+    if (configuration.getPersistenceCompressionMode() == "zstd") {
+        cfOptions.compression = rocksdb::kZSTD;
+        for (auto& type : cfOptions.compression_per_level) {
+            if (type != rocksdb::kNoCompression) {
+                type = rocksdb::kZSTD;
+            }
+        }
+        const auto dictSize = configuration.getPersistenceCompressionDictSize();
+        cfOptions.compression_opts.level =
+                int(configuration.getPersistenceCompressionLevel());
+        cfOptions.compression_opts.max_dict_bytes = uint32_t(dictSize);
+        cfOptions.compression_opts.zstd_max_train_bytes =
+                uint32_t(dictSize * 100);
+    }
+
     return cfOptions;
 }
 
@@ -1080,6 +1508,10 @@ rocksdb::ColumnFamilyOptions RocksDBKVStore::getBaselineSeqnoCFOptions() {
 
     cfOptions.comparator = &seqnoComparator;
 
+    // Drop the stale seqno=>key entries during compaction
+    cfOptions.compaction_filter_factory =
+            std::make_shared<SeqnoCompactionFilterFactory>(*this);
+
     // Set the given Memory Budget as the write_buffer_size
     if (configuration.getRocksdbSeqnoCfMemBudget() > 0) {
         cfOptions.write_buffer_size =
@@ -1173,6 +1605,74 @@ rocksdb::Status RocksDBKVStore::saveDocs(
 
     const auto vbh = getVBHandle(vbid);
 
+    // Look up the current version of all the documents in the batch, so
+    // that we know whether each request inserts, updates or deletes a
+    // document and can keep exact item counts
+    std::vector<rocksdb::Slice> keySlices;
+    keySlices.reserve(reqsSize);
+    for (const auto& request : commitBatch) {
+        keySlices.push_back(getKeySlice(request->getKey()));
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> cfHandles(
+            reqsSize, vbh->defaultCFH.get());
+    std::vector<std::string> values;
+    const auto statuses = rdb->MultiGet(
+            rocksdb::ReadOptions(), cfHandles, keySlices, &values);
+
+    enum class DocState { Missing, Alive, Deleted };
+    // The batch may contain the same key more than once, track the state
+    // each request leaves the document in
+    std::unordered_map<std::string, DocState> docStates;
+    int64_t itemsDelta = 0;
+    int64_t deletesDelta = 0;
+    for (size_t ii = 0; ii < reqsSize; ++ii) {
+        const auto& request = commitBatch[ii];
+        auto res = docStates.emplace(keySlices[ii].ToString(),
+                                     DocState::Missing);
+        auto& state = res.first->second;
+        if (res.second) {
+            if (statuses[ii].ok()) {
+                rockskv::MetaData meta;
+                if (values[ii].size() < sizeof(meta)) {
+                    throw std::logic_error(
+                            "RocksDBKVStore::saveDocs: document with invalid "
+                            "metadata size:" +
+                            std::to_string(values[ii].size()) + " for vb:" +
+                            std::to_string(vbid));
+                }
+                std::memcpy(&meta, values[ii].data(), sizeof(meta));
+                state = meta.deleted ? DocState::Deleted : DocState::Alive;
+            } else if (!statuses[ii].IsNotFound()) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "RocksDBKVStore::saveDocs: rocksdb::DB::MultiGet "
+                           "error:%d, vb:%" PRIu16,
+                           statuses[ii].code(),
+                           vbid);
+                return statuses[ii];
+            }
+        }
+
+        request->setDocExisted(state == DocState::Alive);
+        if (state == DocState::Alive) {
+            --itemsDelta;
+        } else if (state == DocState::Deleted) {
+            --deletesDelta;
+        }
+        if (request->isDelete()) {
+            ++deletesDelta;
+            state = DocState::Deleted;
+        } else {
+            ++itemsDelta;
+            state = DocState::Alive;
+        }
+    }
+    // Don't let a wrong count (e.g., estimated for a DB created before the
+    // counts were persisted) underflow
+    const uint64_t numItems =
+            std::max(int64_t(vbh->numItems) + itemsDelta, int64_t(0));
+    const uint64_t numDeletes =
+            std::max(int64_t(vbh->numDeletes) + deletesDelta, int64_t(0));
+
     for (const auto& request : commitBatch) {
         int64_t bySeqno = request->getDocMeta().bySeqno;
         maxDBSeqno = std::max(maxDBSeqno, bySeqno);
@@ -1220,6 +1720,15 @@ rocksdb::Status RocksDBKVStore::saveDocs(
         return status;
     }
 
+    status = saveFileInfoToBatch(
+            *vbh, numItems, numDeletes, vbh->purgeSeqno, batch);
+    if (!status.ok()) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "RocksDBKVStore::saveDocs: saveFileInfoToBatch error:%d",
+                   status.code());
+        return status;
+    }
+
     status = writeAndTimeBatch(batch);
     if (!status.ok()) {
         logger.log(EXTENSION_LOG_WARNING,
@@ -1233,6 +1742,9 @@ rocksdb::Status RocksDBKVStore::saveDocs(
     st.batchSize.add(reqsSize);
     st.docsCommitted = reqsSize;
 
+    vbh->numItems = numItems;
+    vbh->numDeletes = numDeletes;
+
     // Check and update last seqno
     auto lastSeqno = readHighSeqnoFromDisk(*vbh);
     if (maxDBSeqno != lastSeqno) {
@@ -1317,6 +1829,154 @@ int64_t RocksDBKVStore::getVbstateKey() {
     return -9999;
 }
 
+int64_t RocksDBKVStore::getFileInfoKey() {
+    // As for the VBState, the item counts are stored in the SeqnoCF under a
+    // reserved negative key.
+    return -9998;
+}
+
+bool RocksDBKVStore::compactDB(compaction_ctx* ctx) {
+    auto start = ProcessClock::now();
+    const uint16_t vbid = ctx->db_file_id;
+
+    const auto vbh = findVBHandle(vbid);
+    if (!vbh) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "RocksDBKVStore::compactDB: VBucket not found, vb:%" PRIu16,
+                   vbid);
+        ++st.numCompactionFailure;
+        return false;
+    }
+
+    ctx->stats.pre = getFileInfo(*vbh);
+
+    // Start from the current purge seqno, the ExpiryCompactionFilter moves
+    // it forward for each tombstone purged
+    ctx->max_purged_seq[vbid] = vbh->purgeSeqno;
+    {
+        std::lock_guard<std::mutex> lg(vbh->compactionMutex);
+        vbh->compactionCtx = ctx;
+        vbh->compactionHighSeqno = readHighSeqnoFromDisk(*vbh);
+    }
+
+    // Force the compaction of the bottommost level too, as that is where
+    // most of the expired items and tombstones are.
+    rocksdb::CompactRangeOptions options;
+    options.bottommost_level_compaction =
+            rocksdb::BottommostLevelCompaction::kForce;
+    auto status = rdb->CompactRange(
+            options, vbh->defaultCFH.get(), nullptr, nullptr);
+    {
+        std::lock_guard<std::mutex> lg(vbh->compactionMutex);
+        vbh->compactionCtx = nullptr;
+    }
+    if (status.ok()) {
+        // Now that the purged documents are gone, drop their entries from
+        // the seqno CF too (see StaleSeqnoCompactionFilter)
+        status = rdb->CompactRange(
+                options, vbh->seqnoCFH.get(), nullptr, nullptr);
+    }
+
+    // Update the counts even if the compaction failed half-way, the
+    // tombstones purged so far are gone
+    const uint64_t purged = ctx->stats.tombstonesPurged;
+    const uint64_t numDeletes = vbh->numDeletes;
+    vbh->numDeletes = numDeletes > purged ? numDeletes - purged : 0;
+    vbh->purgeSeqno = ctx->max_purged_seq[vbid];
+
+    if (status.ok()) {
+        rocksdb::WriteBatch batch;
+        status = saveFileInfoToBatch(
+                *vbh, vbh->numItems, vbh->numDeletes, vbh->purgeSeqno, batch);
+        if (status.ok()) {
+            status = rdb->Write(writeOptions, &batch);
+        }
+    }
+
+    vbucket_state* state = getVBucketState(vbid);
+    if (state) {
+        state->purgeSeqno = vbh->purgeSeqno;
+    }
+
+    if (!status.ok()) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "RocksDBKVStore::compactDB: error:%s, vb:%" PRIu16,
+                   status.getState(),
+                   vbid);
+        ++st.numCompactionFailure;
+        return false;
+    }
+
+    ctx->stats.post = getFileInfo(*vbh);
+
+    st.compactHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            ProcessClock::now() - start));
+
+    return true;
+}
+
+size_t RocksDBKVStore::getNumPersistedDeletes(uint16_t vbid) {
+    const auto vbh = findVBHandle(vbid);
+    return vbh ? vbh->numDeletes.load() : 0;
+}
+
+size_t RocksDBKVStore::getItemCount(uint16_t vbid) {
+    const auto vbh = findVBHandle(vbid);
+    return vbh ? vbh->numItems.load() : 0;
+}
+
+DBFileInfo RocksDBKVStore::getDbFileInfo(uint16_t vbid) {
+    DBFileInfo vbinfo;
+    const auto vbh = findVBHandle(vbid);
+    if (vbh) {
+        vbinfo.fileSize = getVBSizeProperty(
+                *vbh, rocksdb::DB::Properties::kTotalSstFilesSize);
+        vbinfo.spaceUsed = getVBSizeProperty(
+                *vbh, rocksdb::DB::Properties::kEstimateLiveDataSize);
+    }
+    return vbinfo;
+}
+
+DBFileInfo RocksDBKVStore::getAggrDbFileInfo() {
+    DBFileInfo kvsFileInfo;
+    std::vector<std::shared_ptr<VBHandle>> handles;
+    {
+        std::lock_guard<std::mutex> lg(vbhMutex);
+        for (const auto& vbh : vbHandles) {
+            if (vbh) {
+                handles.push_back(vbh);
+            }
+        }
+    }
+    for (const auto& vbh : handles) {
+        kvsFileInfo.fileSize += getVBSizeProperty(
+                *vbh, rocksdb::DB::Properties::kTotalSstFilesSize);
+        kvsFileInfo.spaceUsed += getVBSizeProperty(
+                *vbh, rocksdb::DB::Properties::kEstimateLiveDataSize);
+    }
+    return kvsFileInfo;
+}
+
+uint64_t RocksDBKVStore::getVBSizeProperty(const VBHandle& vbh,
+                                           const std::string& property) {
+    uint64_t size = 0;
+    for (auto* cfh : {vbh.defaultCFH.get(), vbh.seqnoCFH.get()}) {
+        uint64_t value;
+        if (rdb->GetIntProperty(cfh, property, &value)) {
+            size += value;
+        }
+    }
+    return size;
+}
+
+FileInfo RocksDBKVStore::getFileInfo(const VBHandle& vbh) {
+    return FileInfo{vbh.numItems,
+                    vbh.numDeletes,
+                    getVBSizeProperty(
+                            vbh, rocksdb::DB::Properties::kTotalSstFilesSize),
+                    vbh.purgeSeqno};
+}
+
 ScanContext* RocksDBKVStore::initScanContext(
         std::shared_ptr<StatusCallback<GetValue>> cb,
         std::shared_ptr<StatusCallback<CacheLookup>> cl,
@@ -1382,72 +2042,91 @@ scan_error_t RocksDBKVStore::scan(ScanContext* ctx) {
         return seqnoComparator.Compare(seqSlice, endSeqnoSlice) == 1;
     };
 
-    for (; it->Valid() && !isPastEnd(it->key()); it->Next()) {
-        auto seqno = getNumericSeqno(it->key());
-        rocksdb::Slice keySlice = it->value();
-        std::string valueStr;
-        auto s = rdb->Get(
-                snapshotOpts, vbh->defaultCFH.get(), keySlice, &valueStr);
-
-        if (!s.ok()) {
-            // TODO RDB: Old seqnos are never removed from the db!
-            // If the item does not exist (s.isNotFound())
-            // the seqno => key mapping could be removed; not even
-            // a tombstone remains of that item.
-            continue;
+    bool includeDeletes =
+            (ctx->docFilter == DocumentFilter::NO_DELETES) ? false : true;
+    bool onlyKeys = (ctx->valFilter == ValueFilter::KEYS_ONLY) ? true : false;
+
+    // The documents are fetched from the 'default' CF in batches of up to
+    // scanBatchSize with a single MultiGet, rather than a point lookup per
+    // seqno=>key entry.
+    std::vector<int64_t> seqnos;
+    std::vector<std::string> keys;
+    std::vector<rocksdb::Slice> keySlices;
+    std::vector<rocksdb::ColumnFamilyHandle*> cfHandles;
+    std::vector<std::string> values;
+    seqnos.reserve(scanBatchSize);
+    keys.reserve(scanBatchSize);
+
+    while (it->Valid() && !isPastEnd(it->key())) {
+        seqnos.clear();
+        keys.clear();
+        for (; it->Valid() && !isPastEnd(it->key()) &&
+               keys.size() < scanBatchSize;
+             it->Next()) {
+            seqnos.push_back(getNumericSeqno(it->key()));
+            // Copy the key, the iterator is moved on before we use it
+            keys.push_back(it->value().ToString());
         }
 
-        rocksdb::Slice valSlice(valueStr);
-
-        // TODO RDB: Deal with collections
-        DocKey key(reinterpret_cast<const uint8_t*>(keySlice.data()),
-                   keySlice.size(),
-                   DocNamespace::DefaultCollection);
-
-        std::unique_ptr<Item> itm =
-                makeItem(ctx->vbid, key, valSlice, isMetaOnly);
-
-        if (itm->getBySeqno() > seqno) {
-            // TODO RDB: Old seqnos are never removed from the db!
-            // If the item has a newer seqno now, the stale
-            // seqno => key mapping could be removed
-            continue;
-        } else if (itm->getBySeqno() < seqno) {
-            throw std::logic_error(
-                    "RocksDBKVStore::scan: index has a higher seqno"
-                    "than the document in a snapshot!");
-        }
+        keySlices.assign(keys.begin(), keys.end());
+        cfHandles.assign(keys.size(), vbh->defaultCFH.get());
+        const auto statuses =
+                rdb->MultiGet(snapshotOpts, cfHandles, keySlices, &values);
+
+        for (size_t ii = 0; ii < keys.size(); ++ii) {
+            const auto seqno = seqnos[ii];
+            if (!statuses[ii].ok()) {
+                // The item does not exist anymore; the stale seqno => key
+                // mapping is removed by the StaleSeqnoCompactionFilter.
+                continue;
+            }
 
-        bool includeDeletes =
-                (ctx->docFilter == DocumentFilter::NO_DELETES) ? false : true;
-        bool onlyKeys =
-                (ctx->valFilter == ValueFilter::KEYS_ONLY) ? true : false;
+            rocksdb::Slice valSlice(values[ii]);
 
-        if (!includeDeletes && itm->isDeleted()) {
-            continue;
-        }
-        int64_t byseqno = itm->getBySeqno();
-        CacheLookup lookup(key, byseqno, ctx->vbid);
-        ctx->lookup->callback(lookup);
+            // TODO RDB: Deal with collections
+            DocKey key(reinterpret_cast<const uint8_t*>(keys[ii].data()),
+                       keys[ii].size(),
+                       DocNamespace::DefaultCollection);
 
-        int status = ctx->lookup->getStatus();
+            std::unique_ptr<Item> itm =
+                    makeItem(ctx->vbid, key, valSlice, isMetaOnly);
 
-        if (status == ENGINE_KEY_EEXISTS) {
-            ctx->lastReadSeqno = byseqno;
-            continue;
-        } else if (status == ENGINE_ENOMEM) {
-            return scan_again;
-        }
+            if (itm->getBySeqno() > seqno) {
+                // The item has a newer seqno now; the stale seqno => key
+                // mapping is removed by the StaleSeqnoCompactionFilter.
+                continue;
+            } else if (itm->getBySeqno() < seqno) {
+                throw std::logic_error(
+                        "RocksDBKVStore::scan: index has a higher seqno"
+                        "than the document in a snapshot!");
+            }
 
-        GetValue rv(std::move(itm), ENGINE_SUCCESS, -1, onlyKeys);
-        ctx->callback->callback(rv);
-        status = ctx->callback->getStatus();
+            if (!includeDeletes && itm->isDeleted()) {
+                continue;
+            }
+            int64_t byseqno = itm->getBySeqno();
+            CacheLookup lookup(key, byseqno, ctx->vbid);
+            ctx->lookup->callback(lookup);
 
-        if (status == ENGINE_ENOMEM) {
-            return scan_again;
-        }
+            int status = ctx->lookup->getStatus();
 
-        ctx->lastReadSeqno = byseqno;
+            if (status == ENGINE_KEY_EEXISTS) {
+                ctx->lastReadSeqno = byseqno;
+                continue;
+            } else if (status == ENGINE_ENOMEM) {
+                return scan_again;
+            }
+
+            GetValue rv(std::move(itm), ENGINE_SUCCESS, -1, onlyKeys);
+            ctx->callback->callback(rv);
+            status = ctx->callback->getStatus();
+
+            if (status == ENGINE_ENOMEM) {
+                return scan_again;
+            }
+
+            ctx->lastReadSeqno = byseqno;
+        }
     }
 
     cb_assert(it->status().ok()); // Check for any errors found during the scan
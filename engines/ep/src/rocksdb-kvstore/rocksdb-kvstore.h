@@ -25,10 +25,12 @@
 
 #include <platform/dirutils.h>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <kvstore.h>
 
+#include <rocksdb/compaction_filter.h>
 #include <rocksdb/db.h>
 #include <rocksdb/listener.h>
 #include <rocksdb/utilities/memory_util.h>
@@ -102,6 +104,9 @@ public:
 
 class RocksRequest;
 class VBHandle;
+class ExpiryCompactionFilter;
+class ExpiryCompactionFilterFactory;
+class SeqnoCompactionFilterFactory;
 struct KVStatsCtx;
 
 /**
@@ -213,43 +218,31 @@ public:
         return 1024;
     }
 
-    bool compactDB(compaction_ctx*) override {
-        // Explicit compaction is not needed.
-        // Compaction is continuously occurring in separate threads
-        // under RocksDB's control
-        return true;
-    }
+    /**
+     * Compact the Column Families of the given VBucket.
+     *
+     * Compaction is continuously occurring in separate threads under
+     * RocksDB's control, but only a compaction requested here expires items
+     * and purges tombstones (see ExpiryCompactionFilter), as it needs the
+     * callbacks and the purge parameters given in 'ctx'.
+     */
+    bool compactDB(compaction_ctx* ctx) override;
 
-    uint16_t getDBFileId(const protocol_binary_request_compact_db&) override {
-        // Not needed if there is no explicit compaction
-        return 0;
+    uint16_t getDBFileId(const protocol_binary_request_compact_db& req) override {
+        return ntohs(req.message.header.request.vbucket);
     }
 
     vbucket_state* getVBucketState(uint16_t vbucketId) override {
         return cachedVBStates[vbucketId].get();
     }
 
-    size_t getNumPersistedDeletes(uint16_t vbid) override {
-        // TODO vmx 2016-10-29: implement
-        return 0;
-    }
+    size_t getNumPersistedDeletes(uint16_t vbid) override;
 
-    DBFileInfo getDbFileInfo(uint16_t vbid) override {
-        // TODO vmx 2016-10-29: implement
-        DBFileInfo vbinfo;
-        return vbinfo;
-    }
+    DBFileInfo getDbFileInfo(uint16_t vbid) override;
 
-    DBFileInfo getAggrDbFileInfo() override {
-        // TODO vmx 2016-10-29: implement
-        DBFileInfo vbinfo;
-        return vbinfo;
-    }
+    DBFileInfo getAggrDbFileInfo() override;
 
-    size_t getItemCount(uint16_t vbid) override {
-        // TODO vmx 2016-10-29: implement
-        return 0;
-    }
+    size_t getItemCount(uint16_t vbid) override;
 
     RollbackResult rollback(uint16_t vbid,
                             uint64_t rollbackSeqno,
@@ -312,6 +305,14 @@ protected:
     rocksdb::Status writeAndTimeBatch(rocksdb::WriteBatch batch);
 
 private:
+    friend class ExpiryCompactionFilter;
+    friend class ExpiryCompactionFilterFactory;
+    friend class SeqnoCompactionFilterFactory;
+
+    // The maximum number of documents a backfill fetches from the 'default'
+    // CF with a single MultiGet.
+    static const size_t scanBatchSize = 64;
+
     // Unique RocksDB instance, per-Shard.
     std::unique_ptr<rocksdb::DB> rdb;
 
@@ -331,6 +332,15 @@ private:
     // An entry is removed only in 'delVBucket(vbid)'.
     std::vector<std::shared_ptr<VBHandle>> vbHandles;
 
+    // Guards access to 'cfVBHandles'. It can be acquired while holding
+    // 'vbhMutex', never the other way round.
+    std::mutex cfMutex;
+
+    // The VBHandle owning each Column Family, by CF id. Used by the
+    // compaction filter factories, which must not acquire 'vbhMutex' as
+    // 'delVBucket()' holds it while waiting for a running compactDB.
+    std::unordered_map<uint32_t, std::weak_ptr<VBHandle>> cfVBHandles;
+
     SeqnoComparator seqnoComparator;
 
     rocksdb::DBOptions dbOptions;
@@ -365,6 +375,26 @@ private:
      */
     std::shared_ptr<VBHandle> getVBHandle(uint16_t vbid);
 
+    /*
+     * Returns the VBHandle for the given vbid if it exists. Differently from
+     * 'getVBHandle()', the Column Families of the VBucket are not created.
+     *
+     * @return the VBHandle, or nullptr if the VBucket does not exist
+     */
+    std::shared_ptr<VBHandle> findVBHandle(uint16_t vbid);
+
+    /*
+     * Find the VBHandle owning the Column Family with the given id.
+     *
+     * @return the VBHandle, or nullptr if no VBucket owns the CF (e.g.,
+     *         the VBucket is being deleted)
+     */
+    std::shared_ptr<VBHandle> getVBHandleForCF(uint32_t cfId);
+
+    // Add / remove the Column Families of 'vbh' to / from 'cfVBHandles'
+    void addCFVBHandles(const std::shared_ptr<VBHandle>& vbh);
+    void removeCFVBHandles(const VBHandle& vbh);
+
     /*
      * The DB for each Shard is created in a separated subfolder of
      * 'configuration.getDBName()'. This function returns the path of the DB
@@ -406,7 +436,26 @@ private:
                           const std::string& value,
                           GetMetaOnly getMetaOnly = GetMetaOnly::No);
 
-    void readVBState(const VBHandle& db);
+    void readVBState(VBHandle& db);
+
+    // Load the persisted item counts and purge seqno of the VBucket into
+    // 'vbh' (see saveFileInfoToBatch).
+    void readFileInfo(VBHandle& vbh);
+
+    // Serialize the item counts and the purge seqno of the VBucket and add
+    // them to the local CF in the specified batch of writes.
+    rocksdb::Status saveFileInfoToBatch(const VBHandle& vbh,
+                                        uint64_t numItems,
+                                        uint64_t numDeletes,
+                                        uint64_t purgeSeqno,
+                                        rocksdb::WriteBatch& batch);
+
+    // Returns the sum of the given size property over both the Column
+    // Families of the VBucket.
+    uint64_t getVBSizeProperty(const VBHandle& vbh,
+                               const std::string& property);
+
+    FileInfo getFileInfo(const VBHandle& vbh);
 
     // Serialize the vbucket state and add it to the local CF in the specified
     // batch of writes.
@@ -431,6 +480,8 @@ private:
 
     int64_t getVbstateKey();
 
+    int64_t getFileInfoKey();
+
     // Helper function to retrieve stats from the RocksDB MemoryUtil API.
     bool getStatFromMemUsage(const rocksdb::MemoryUtil::UsageType type,
                              size_t& value);
@@ -86,6 +86,7 @@ EPStats::EPStats()
       pendingOpsMax(0),
       pendingOpsMaxDuration(0),
       pendingCompactions(0),
+      runningCompactions(0),
       bg_fetched(0),
       bg_meta_fetched(0),
       numRemainingBgItems(0),
@@ -122,6 +123,15 @@ EPStats::EPStats()
       rollbackCount(0),
       defragNumVisited(0),
       defragNumMoved(0),
+      compressorNumVisited(0),
+      compressorNumCompressed(0),
+      compressorNumIncompressible(0),
+      compressorBytesSaved(0),
+      collectionsItemsReclaimed(0),
+      collectionsBytesReclaimed(0),
+      collectionsItemsErased(0),
+      collectionsReclaimCompactions(0),
+      collectionsPendingDeletes(0),
       dirtyAgeHisto(),
       diskCommitHisto(),
       timingLog(NULL),
@@ -217,6 +217,9 @@ public:
 
     //! Number of pending vbucket compaction requests
     Counter pendingCompactions;
+    //! Number of vbucket compactions currently scheduled to run (the rest of
+    //! pendingCompactions are queued waiting for a free slot)
+    Counter runningCompactions;
 
     //! Number of times background fetches occurred.
     Counter bg_fetched;
@@ -327,6 +330,45 @@ public:
      */
     Counter defragNumMoved;
 
+    /** The number of items that have been visited (considered for
+     * compression) by the item compressor task.
+     */
+    Counter compressorNumVisited;
+
+    /** The number of items whose value the item compressor task has
+     * compressed.
+     */
+    Counter compressorNumCompressed;
+
+    /** The number of items the item compressor task has found not to
+     * compress well enough to be worth storing compressed.
+     */
+    Counter compressorNumIncompressible;
+
+    /** The number of value bytes saved by the item compressor task. */
+    Counter compressorBytesSaved;
+
+    /** The number of items of dropped collections released from memory by
+     * the collections reclaimer task.
+     */
+    Counter collectionsItemsReclaimed;
+
+    /** The memory released by the collections reclaimer task. */
+    Counter collectionsBytesReclaimed;
+
+    /** The number of items of dropped collections erased by compaction. */
+    Counter collectionsItemsErased;
+
+    /** The number of compactions scheduled by the collections reclaimer
+     * task to erase dropped collections.
+     */
+    Counter collectionsReclaimCompactions;
+
+    /** The number of collection deletions (over all vbuckets) which are
+     * still to be completed, as of the reclaimer task's last run.
+     */
+    Counter collectionsPendingDeletes;
+
     //! Histogram of queue processing dirty age.
     MicrosecondHistogram dirtyAgeHisto;
 
@@ -436,6 +478,14 @@ public:
         accessScannerSkips.store(0),
         defragNumVisited.store(0),
         defragNumMoved.store(0);
+        compressorNumVisited.store(0);
+        compressorNumCompressed.store(0);
+        compressorNumIncompressible.store(0);
+        compressorBytesSaved.store(0);
+        collectionsItemsReclaimed.store(0);
+        collectionsBytesReclaimed.store(0);
+        collectionsItemsErased.store(0);
+        collectionsReclaimCompactions.store(0);
 
         pendingOpsHisto.reset();
         bgWaitHisto.reset();
@@ -25,6 +25,7 @@
 #include "stats.h"
 
 #include <platform/cb_malloc.h>
+#include <platform/compress.h>
 
 const int64_t StoredValue::state_pending_seqno = -2;
 const int64_t StoredValue::state_deleted_key = -3;
@@ -141,12 +142,13 @@ uint8_t StoredValue::getNRUValue() const {
 
 void StoredValue::setFreqCounterValue(uint16_t newValue) {
     auto taggedPtr = value.get();
-    taggedPtr.setTag(newValue);
+    taggedPtr.setTag((taggedPtr.getTag() & ~freqCounterMask) |
+                     (newValue & freqCounterMask));
     value.reset(taggedPtr);
 }
 
 uint16_t StoredValue::getFreqCounterValue() const {
-    return value.get().getTag();
+    return value.get().getTag() & freqCounterMask;
 }
 
 void StoredValue::restoreValue(const Item& itm) {
@@ -245,6 +247,33 @@ void StoredValue::reallocate() {
     value.reset(new_val);
 }
 
+bool StoredValue::compressValue(float maxRatio) {
+    if (!value || value->valueSize() == 0 ||
+        mcbp::datatype::is_snappy(datatype) || isIncompressible()) {
+        return false;
+    }
+
+    cb::compression::Buffer deflated;
+    if (!cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                  {value->getData(), value->valueSize()},
+                                  deflated)) {
+        return false;
+    }
+
+    auto taggedPtr = value.get();
+    if (deflated.size() > value->valueSize() * maxRatio) {
+        taggedPtr.setTag(taggedPtr.getTag() | incompressibleTag);
+        value.reset(taggedPtr);
+        return false;
+    }
+
+    // Keep the frequency counter; the new value starts with no flags.
+    value.reset(TaggedPtr<Blob>(Blob::New(deflated.data(), deflated.size()),
+                                taggedPtr.getTag() & freqCounterMask));
+    datatype |= PROTOCOL_BINARY_DATATYPE_SNAPPY;
+    return true;
+}
+
 void StoredValue::Deleter::operator()(StoredValue* val) {
     if (val->isOrdered()) {
         delete static_cast<OrderedStoredValue*>(val);
@@ -155,6 +155,15 @@ public:
     // Gets the frequency counter value
     uint16_t getFreqCounterValue() const;
 
+    /**
+     * True if the current value has been found not to compress well (see
+     * compressValue()). As the flag lives alongside the value pointer it is
+     * implicitly cleared whenever the value is replaced.
+     */
+    bool isIncompressible() const {
+        return value.get().getTag() & incompressibleTag;
+    }
+
     void referenced();
 
     /**
@@ -611,6 +620,19 @@ public:
      */
     void reallocate();
 
+    /**
+     * Replace the value with a Snappy-compressed copy, provided that the
+     * compressed size is no more than `maxRatio` times the original size.
+     * Values which miss the ratio are marked incompressible so they are not
+     * tried again. Used by the ItemCompressor task.
+     *
+     * The caller is responsible for updating HashTable statistics (see
+     * HashTable::unlocked_compressValue()).
+     *
+     * @return true if the value was replaced with a compressed copy.
+     */
+    bool compressValue(float maxRatio);
+
     /**
      * Returns pointer to the subclass OrderedStoredValue if it the object is
      * of the type, if not throws a bad_cast.
@@ -730,6 +752,14 @@ protected:
 
     friend class StoredValueFactory;
 
+    /*
+     * The 16-bit tag of the value pointer holds the frequency counter in its
+     * low byte (the counter only ever needs 8 bits), and per-value flags in
+     * the high byte.
+     */
+    static constexpr uint16_t freqCounterMask = 0x00ff;
+    static constexpr uint16_t incompressibleTag = 0x0100;
+
     value_t            value;          // 8 bytes
 
     // Serves two purposes -
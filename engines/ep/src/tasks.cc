@@ -17,6 +17,7 @@
 #include "config.h"
 
 #include "bgfetcher.h"
+#include "dictionary_compressor.h"
 #include "ep_bucket.h"
 #include "ep_engine.h"
 #include "flusher.h"
@@ -154,3 +155,20 @@ bool WorkLoadMonitor::run() {
     }
     return true;
 }
+
+DictionaryTrainerTask::DictionaryTrainerTask(
+        EventuallyPersistentEngine* e,
+        std::shared_ptr<DictionaryCompressor> compressor)
+    : GlobalTask(e, TaskId::DictionaryTrainerTask, 0, false),
+      compressor(std::move(compressor)) {
+}
+
+bool DictionaryTrainerTask::run() {
+    TRACE_EVENT0("ep-engine/task", "DictionaryTrainerTask");
+    if (compressor->train()) {
+        LOG(EXTENSION_LOG_NOTICE,
+            "DictionaryTrainerTask: trained zstd dictionary id:%" PRIu32,
+            compressor->getCurrentDictionaryId());
+    }
+    return false;
+}
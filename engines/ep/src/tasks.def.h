@@ -72,6 +72,9 @@ TASK(ClosedUnrefCheckpointRemoverVisitorTask, NONIO_TASK_IDX, 6)
 TASK(VBucketMemoryDeletionTask, NONIO_TASK_IDX, 6)
 TASK(StatCheckpointTask, NONIO_TASK_IDX, 7)
 TASK(DefragmenterTask, NONIO_TASK_IDX, 7)
+TASK(ItemCompressorTask, NONIO_TASK_IDX, 7)
+TASK(DictionaryTrainerTask, NONIO_TASK_IDX, 7)
+TASK(CollectionsReclaimerTask, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneHTCleaner, NONIO_TASK_IDX, 7)
 TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7)
 TASK(ConnManager, NONIO_TASK_IDX, 8)
@@ -24,8 +24,10 @@
 #include <platform/processclock.h>
 
 #include <array>
+#include <memory>
 #include <string>
 
+class DictionaryCompressor;
 class EPBucket;
 class EventuallyPersistentEngine;
 
@@ -276,3 +278,30 @@ private:
     size_t prevNumMutations;
     size_t prevNumGets;
 };
+
+/**
+ * A one-shot task which trains the zstd dictionary of a
+ * DictionaryCompressor from its queued training set, so the flusher which
+ * collected the samples isn't held up by the training.
+ */
+class DictionaryTrainerTask : public GlobalTask {
+public:
+    DictionaryTrainerTask(EventuallyPersistentEngine* e,
+                          std::shared_ptr<DictionaryCompressor> compressor);
+
+    bool run();
+
+    cb::const_char_buffer getDescription() {
+        return "Training zstd dictionary";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // Training is CPU bound and scales with the training set (100 times
+        // the dictionary size), so with large dictionaries it can take
+        // seconds; it only happens once per shard though.
+        return std::chrono::seconds(5);
+    }
+
+private:
+    std::shared_ptr<DictionaryCompressor> compressor;
+};
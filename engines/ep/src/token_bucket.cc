@@ -0,0 +1,62 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "token_bucket.h"
+
+#include <algorithm>
+
+TokenBucket::TokenBucket(size_t rate)
+    : rate(rate), available(rate), lastRefill(ProcessClock::now()) {
+}
+
+std::chrono::microseconds TokenBucket::consume(size_t tokens) {
+    return consume(tokens, ProcessClock::now());
+}
+
+std::chrono::microseconds TokenBucket::consume(size_t tokens,
+                                               ProcessClock::time_point now) {
+    totalConsumed.fetch_add(tokens);
+
+    const size_t currentRate = rate.load();
+    if (currentRate == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    std::lock_guard<std::mutex> lh(mutex);
+    if (now > lastRefill) {
+        const std::chrono::duration<double> elapsed = now - lastRefill;
+        available = std::min(double(currentRate),
+                             available + elapsed.count() * currentRate);
+        lastRefill = now;
+    }
+
+    available -= tokens;
+    if (available >= 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    const double waitSecs = -available / currentRate;
+    return std::chrono::microseconds(
+            static_cast<std::chrono::microseconds::rep>(waitSecs * 1000000));
+}
+
+void TokenBucket::setRate(size_t newRate) {
+    std::lock_guard<std::mutex> lh(mutex);
+    rate.store(newRate);
+    available = newRate;
+    lastRefill = ProcessClock::now();
+}
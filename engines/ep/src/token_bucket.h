@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <platform/processclock.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/**
+ * A simple token bucket rate limiter, where one token corresponds to one
+ * unit of work (e.g. one byte of I/O).
+ *
+ * The bucket refills at `rate` tokens per second and holds at most one
+ * second's worth of tokens. A consumer always gets its tokens immediately
+ * but may drive the bucket into debt; the returned duration is how long the
+ * caller should wait before performing the work so that the combined rate
+ * of all consumers sharing the bucket does not exceed `rate`.
+ *
+ * A rate of zero disables limiting - consume() then always returns zero.
+ */
+class TokenBucket {
+public:
+    explicit TokenBucket(size_t rate);
+
+    /**
+     * Take `tokens` from the bucket.
+     *
+     * @return how long the caller should wait before proceeding.
+     */
+    std::chrono::microseconds consume(size_t tokens);
+
+    /// As consume(), but with an explicit "now" (for testing).
+    std::chrono::microseconds consume(size_t tokens,
+                                      ProcessClock::time_point now);
+
+    /**
+     * Change the refill rate. Any existing debt is discarded and the bucket
+     * starts full at the new rate.
+     */
+    void setRate(size_t newRate);
+
+    size_t getRate() const {
+        return rate.load();
+    }
+
+    /// @return total number of tokens consumed since creation.
+    size_t getTotalConsumed() const {
+        return totalConsumed.load();
+    }
+
+private:
+    std::atomic<size_t> rate;
+    std::atomic<size_t> totalConsumed{0};
+
+    std::mutex mutex;
+    // Current token level; negative when consumers are in debt.
+    double available;
+    ProcessClock::time_point lastRefill;
+};
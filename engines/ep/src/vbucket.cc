@@ -151,7 +151,15 @@ VBucket::VBucket(id_type i,
                  int64_t hlcEpochSeqno,
                  bool mightContainXattrs,
                  const std::string& collectionsManifest)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+    : collectionStats(evictionPolicy == FULL_EVICTION
+                              ? Collections::VB::StatsMap::ItemCounting::Disk
+                              : Collections::VB::StatsMap::ItemCounting::
+                                        HashTable),
+      ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         &collectionStats),
       checkpointManager(std::make_unique<CheckpointManager>(st,
                                                             i,
                                                             chkConfig,
@@ -202,6 +210,7 @@ VBucket::VBucket(id_type i,
         conflictResolver.reset(new RevisionSeqnoResolution());
     }
 
+    collectionStats.setSeparator(manifest.lock().getSeparator());
     backfill.isBackfillPhase = false;
     pendingOpsStart = ProcessClock::time_point();
     stats.memOverhead->fetch_add(sizeof(VBucket)
@@ -717,7 +726,7 @@ StoredValue* VBucket::fetchValidValue(HashTable::HashBucketLock& hbl,
             // queueDirty only allowed on active VB
             if (queueExpired == QueueExpired::Yes &&
                 getState() == vbucket_state_active) {
-                incExpirationStat(ExpireBy::Access);
+                incExpirationStat(key, ExpireBy::Access);
                 handlePreExpiry(hbl.getHTLock(), *v);
                 VBNotifyCtx notifyCtx;
                 std::tie(std::ignore, v, notifyCtx) =
@@ -730,7 +739,7 @@ StoredValue* VBucket::fetchValidValue(HashTable::HashBucketLock& hbl,
     return v;
 }
 
-void VBucket::incExpirationStat(const ExpireBy source) {
+void VBucket::incExpirationStat(const DocKey& key, const ExpireBy source) {
     switch (source) {
     case ExpireBy::Pager:
         ++stats.expired_pager;
@@ -743,6 +752,7 @@ void VBucket::incExpirationStat(const ExpireBy source) {
         break;
     }
     ++numExpiredItems;
+    collectionStats.expired(key);
 }
 
 MutationStatus VBucket::setFromInternal(Item& itm) {
@@ -1048,6 +1058,85 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
         GenerateCas genCas,
         bool isReplication,
         const Collections::VB::Manifest::CachingReadHandle& readHandle) {
+    return setWithMeta(itm,
+                       cas,
+                       seqno,
+                       cookie,
+                       engine,
+                       bgFetchDelay,
+                       checkConflicts,
+                       allowExisting,
+                       genBySeqno,
+                       genCas,
+                       isReplication,
+                       readHandle,
+                       nullptr);
+}
+
+ENGINE_ERROR_CODE VBucket::setWithMetaBatch(const std::vector<Item*>& items,
+                                            const void* cookie,
+                                            EventuallyPersistentEngine& engine,
+                                            int bgFetchDelay,
+                                            size_t& applied) {
+    std::vector<queued_item> deferredItems;
+    deferredItems.reserve(items.size());
+
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    for (applied = 0; applied < items.size(); ++applied) {
+        auto& itm = *items[applied];
+        if (!Item::isValidCas(itm.getCas())) {
+            ret = ENGINE_KEY_EEXISTS;
+            break;
+        }
+        auto collectionsRHandle = lockCollections(itm.getKey());
+        if (!collectionsRHandle.valid()) {
+            ret = ENGINE_UNKNOWN_COLLECTION;
+        } else {
+            ret = setWithMeta(itm,
+                              0,
+                              nullptr,
+                              cookie,
+                              engine,
+                              bgFetchDelay,
+                              CheckConflicts::No,
+                              true,
+                              GenerateBySeqno::No,
+                              GenerateCas::No,
+                              true,
+                              collectionsRHandle,
+                              &deferredItems);
+        }
+        if (ret != ENGINE_SUCCESS) {
+            break;
+        }
+    }
+
+    if (!deferredItems.empty()) {
+        VBNotifyCtx notifyCtx;
+        notifyCtx.bySeqno = deferredItems.back()->getBySeqno();
+        notifyCtx.notifyFlusher =
+                checkpointManager->queueDirty(*this, deferredItems);
+        notifyCtx.notifyReplication = true;
+        notifyNewSeqno(notifyCtx);
+    }
+
+    return ret;
+}
+
+ENGINE_ERROR_CODE VBucket::setWithMeta(
+        Item& itm,
+        uint64_t cas,
+        uint64_t* seqno,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        int bgFetchDelay,
+        CheckConflicts checkConflicts,
+        bool allowExisting,
+        GenerateBySeqno genBySeqno,
+        GenerateCas genCas,
+        bool isReplication,
+        const Collections::VB::Manifest::CachingReadHandle& readHandle,
+        std::vector<queued_item>* deferredItems) {
     auto hbl = ht.getLockedBucket(itm.getKey());
     StoredValue* v = ht.unlocked_find(itm.getKey(),
                                       hbl.getBucketNum(),
@@ -1111,6 +1200,7 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
                                TrackCasDrift::Yes,
                                /*isBackfillItem*/ false,
                                nullptr /* No pre link step needed */);
+    queueItmCtx.deferredItems = deferredItems;
     MutationStatus status;
     boost::optional<VBNotifyCtx> notifyCtx;
     std::tie(status, notifyCtx) = processSet(hbl,
@@ -1143,7 +1233,9 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
         // we unlock ht lock here because we want to avoid potential lock
         // inversions arising from notifyNewSeqno() call
         hbl.getHTLock().unlock();
-        notifyNewSeqno(*notifyCtx);
+        if (!deferredItems) {
+            notifyNewSeqno(*notifyCtx);
+        }
     } break;
     case MutationStatus::NotFound:
         ret = ENGINE_KEY_ENOENT;
@@ -1523,7 +1615,7 @@ void VBucket::deleteExpiredItem(const Item& it,
             }
         }
     }
-    incExpirationStat(source);
+    incExpirationStat(it.getKey(), source);
 }
 
 ENGINE_ERROR_CODE VBucket::add(
@@ -2004,6 +2096,7 @@ void VBucket::deletedOnDiskCbk(const Item& queuedItem, bool deleted) {
         if (deleted) {
             // Removed an item from disk - decrement the count of total items.
             decrNumTotalItems();
+            collectionStats.persisted(queuedItem.getKey(), -1);
         }
 
         /**
@@ -2016,6 +2109,7 @@ void VBucket::deletedOnDiskCbk(const Item& queuedItem, bool deleted) {
     if (deleted) {
         ++stats.totalPersisted;
         ++opsDelete;
+        collectionStats.flushed(queuedItem.getKey(), queuedItem.size());
     }
     doStatsForFlushing(queuedItem, queuedItem.size());
     --stats.diskQueueSize;
@@ -2519,6 +2613,27 @@ VBNotifyCtx VBucket::queueDirty(StoredValue& v,
     if (queueItmCtx.trackCasDrift == TrackCasDrift::Yes) {
         setMaxCasAndTrackDrift(v.getCas());
     }
+    if (queueItmCtx.deferredItems) {
+        if (queueItmCtx.genBySeqno == GenerateBySeqno::Yes ||
+            queueItmCtx.genCas == GenerateCas::Yes ||
+            queueItmCtx.isBackfillItem) {
+            throw std::logic_error(
+                    "VBucket::queueDirty: deferred items must have their "
+                    "seqno and CAS assigned, and cannot be backfill items. "
+                    "vb:" +
+                    std::to_string(getId()));
+        }
+        queued_item qi(v.toItem(false, getId()));
+        if (!mightContainXattrs() &&
+            mcbp::datatype::is_xattr(v.getDatatype())) {
+            setMightContainXattrs();
+        }
+        queueItmCtx.deferredItems->push_back(qi);
+
+        VBNotifyCtx notifyCtx;
+        notifyCtx.bySeqno = qi->getBySeqno();
+        return notifyCtx;
+    }
     return queueDirty(v,
                       queueItmCtx.genBySeqno,
                       queueItmCtx.genCas,
@@ -22,6 +22,7 @@
 #include "bloomfilter.h"
 #include "checkpoint_config.h"
 #include "collections/vbucket_manifest.h"
+#include "collections/vbucket_stats.h"
 #include "dcp/dcp-types.h"
 #include "hash_table.h"
 #include "hlc.h"
@@ -86,6 +87,10 @@ struct VBQueueItemCtx {
     TrackCasDrift trackCasDrift;
     bool isBackfillItem;
     PreLinkDocumentContext* preLinkDocumentContext;
+    /* If set, the item is added to this batch instead of being queued in the
+       checkpoint; the caller is responsible for queueing the batch (and
+       notifying) once the whole batch has been applied */
+    std::vector<queued_item>* deferredItems = nullptr;
 };
 
 /**
@@ -665,6 +670,12 @@ public:
     static const vbucket_state_t PENDING;
     static const vbucket_state_t DEAD;
 
+    /**
+     * Per-collection counters; declared before ht as the HashTable keeps
+     * them up to date.
+     */
+    Collections::VB::StatsMap collectionStats;
+
     HashTable         ht;
 
     /// Manager of this vBucket's checkpoints. unique_ptr for pimpl.
@@ -837,6 +848,32 @@ public:
             bool isReplication,
             const Collections::VB::Manifest::CachingReadHandle& readHandle);
 
+    /**
+     * Apply a batch of mutations received from a replication stream (which
+     * all belong to the same snapshot). Each item is set as setWithMeta
+     * would (no conflict resolution, seqno and CAS taken from the item), but
+     * the items are appended to the checkpoint with a single acquisition of
+     * the checkpoint lock, and the flusher / DCP connections are notified
+     * once for the whole batch.
+     *
+     * Processing stops at the first item which could not be set; the items
+     * before it remain applied.
+     *
+     * @param items the items to set (in seqno order)
+     * @param cookie the cookie representing the replication connection
+     * @param engine Reference to ep engine
+     * @param bgFetchDelay
+     * @param[out] applied the number of items which were set
+     *
+     * @return the status of the first item which could not be set, or
+     *         ENGINE_SUCCESS if all of them were
+     */
+    ENGINE_ERROR_CODE setWithMetaBatch(const std::vector<Item*>& items,
+                                       const void* cookie,
+                                       EventuallyPersistentEngine& engine,
+                                       int bgFetchDelay,
+                                       size_t& applied);
+
     /**
      * Delete an item in the vbucket
      *
@@ -1506,6 +1543,26 @@ private:
 
     void decrDirtyQueuePendingWrites(size_t decrementBy);
 
+    /**
+     * Implementation of setWithMeta(). If deferredItems is non-null the item
+     * is added to it instead of being queued into the checkpoint (and no
+     * notification is made); see VBQueueItemCtx::deferredItems.
+     */
+    ENGINE_ERROR_CODE setWithMeta(
+            Item& itm,
+            uint64_t cas,
+            uint64_t* seqno,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            CheckConflicts checkConflicts,
+            bool allowExisting,
+            GenerateBySeqno genBySeqno,
+            GenerateCas genCas,
+            bool isReplication,
+            const Collections::VB::Manifest::CachingReadHandle& readHandle,
+            std::vector<queued_item>* deferredItems);
+
     /**
      * Updates an existing StoredValue in in-memory data structures like HT.
      * Assumes that HT bucket lock is grabbed.
@@ -1657,7 +1714,7 @@ private:
     /**
      * Increase the expiration count global stats and in the vbucket stats
      */
-    void incExpirationStat(ExpireBy source);
+    void incExpirationStat(const DocKey& key, ExpireBy source);
 
     void adjustCheckpointFlushTimeout(std::chrono::seconds wall_time);
 
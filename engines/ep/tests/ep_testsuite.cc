@@ -6024,12 +6024,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_0:failure_open",
                 "ro_0:io_compaction_read_bytes",
                 "ro_0:io_compaction_write_bytes",
+                "ro_0:io_compaction_throttle_wait_us",
                 "ro_0:io_bg_fetch_docs_read",
                 "ro_0:io_num_write",
                 "ro_0:io_bg_fetch_doc_bytes",
                 "ro_0:io_total_read_bytes",
                 "ro_0:io_total_write_bytes",
                 "ro_0:io_write_bytes",
+                "ro_0:io_scan_doc_bytes",
+                "ro_0:io_scan_docs_read",
+                "ro_0:io_scan_readahead_bytes",
                 "ro_0:numLoadedVb",
                 "ro_0:open",
                 "ro_1:backend_type",
@@ -6039,12 +6043,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_1:failure_open",
                 "ro_1:io_compaction_read_bytes",
                 "ro_1:io_compaction_write_bytes",
+                "ro_1:io_compaction_throttle_wait_us",
                 "ro_1:io_bg_fetch_docs_read",
                 "ro_1:io_num_write",
                 "ro_1:io_bg_fetch_doc_bytes",
                 "ro_1:io_total_read_bytes",
                 "ro_1:io_total_write_bytes",
                 "ro_1:io_write_bytes",
+                "ro_1:io_scan_doc_bytes",
+                "ro_1:io_scan_docs_read",
+                "ro_1:io_scan_readahead_bytes",
                 "ro_1:numLoadedVb",
                 "ro_1:open",
                 "ro_2:backend_type",
@@ -6054,12 +6062,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_2:failure_open",
                 "ro_2:io_compaction_read_bytes",
                 "ro_2:io_compaction_write_bytes",
+                "ro_2:io_compaction_throttle_wait_us",
                 "ro_2:io_bg_fetch_docs_read",
                 "ro_2:io_num_write",
                 "ro_2:io_bg_fetch_doc_bytes",
                 "ro_2:io_total_read_bytes",
                 "ro_2:io_total_write_bytes",
                 "ro_2:io_write_bytes",
+                "ro_2:io_scan_doc_bytes",
+                "ro_2:io_scan_docs_read",
+                "ro_2:io_scan_readahead_bytes",
                 "ro_2:numLoadedVb",
                 "ro_2:open",
                 "ro_3:backend_type",
@@ -6069,12 +6081,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_3:failure_open",
                 "ro_3:io_compaction_read_bytes",
                 "ro_3:io_compaction_write_bytes",
+                "ro_3:io_compaction_throttle_wait_us",
                 "ro_3:io_bg_fetch_docs_read",
                 "ro_3:io_num_write",
                 "ro_3:io_bg_fetch_doc_bytes",
                 "ro_3:io_total_read_bytes",
                 "ro_3:io_total_write_bytes",
                 "ro_3:io_write_bytes",
+                "ro_3:io_scan_doc_bytes",
+                "ro_3:io_scan_docs_read",
+                "ro_3:io_scan_readahead_bytes",
                 "ro_3:numLoadedVb",
                 "ro_3:open"
     };
@@ -6090,12 +6106,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_0:failure_vbset",
                 "rw_0:io_compaction_read_bytes",
                 "rw_0:io_compaction_write_bytes",
+                "rw_0:io_compaction_throttle_wait_us",
                 "rw_0:io_bg_fetch_docs_read",
                 "rw_0:io_num_write",
                 "rw_0:io_bg_fetch_doc_bytes",
                 "rw_0:io_total_read_bytes",
                 "rw_0:io_total_write_bytes",
                 "rw_0:io_write_bytes",
+                "rw_0:io_scan_doc_bytes",
+                "rw_0:io_scan_docs_read",
+                "rw_0:io_scan_readahead_bytes",
                 "rw_0:lastCommDocs",
                 "rw_0:numLoadedVb",
                 "rw_0:open",
@@ -6109,12 +6129,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_1:failure_vbset",
                 "rw_1:io_compaction_read_bytes",
                 "rw_1:io_compaction_write_bytes",
+                "rw_1:io_compaction_throttle_wait_us",
                 "rw_1:io_bg_fetch_docs_read",
                 "rw_1:io_num_write",
                 "rw_1:io_bg_fetch_doc_bytes",
                 "rw_1:io_total_read_bytes",
                 "rw_1:io_total_write_bytes",
                 "rw_1:io_write_bytes",
+                "rw_1:io_scan_doc_bytes",
+                "rw_1:io_scan_docs_read",
+                "rw_1:io_scan_readahead_bytes",
                 "rw_1:lastCommDocs",
                 "rw_1:numLoadedVb",
                 "rw_1:open",
@@ -6128,12 +6152,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_2:failure_vbset",
                 "rw_2:io_compaction_read_bytes",
                 "rw_2:io_compaction_write_bytes",
+                "rw_2:io_compaction_throttle_wait_us",
                 "rw_2:io_bg_fetch_docs_read",
                 "rw_2:io_num_write",
                 "rw_2:io_bg_fetch_doc_bytes",
                 "rw_2:io_total_read_bytes",
                 "rw_2:io_total_write_bytes",
                 "rw_2:io_write_bytes",
+                "rw_2:io_scan_doc_bytes",
+                "rw_2:io_scan_docs_read",
+                "rw_2:io_scan_readahead_bytes",
                 "rw_2:lastCommDocs",
                 "rw_2:numLoadedVb",
                 "rw_2:open",
@@ -6147,12 +6175,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_3:failure_vbset",
                 "rw_3:io_compaction_read_bytes",
                 "rw_3:io_compaction_write_bytes",
+                "rw_3:io_compaction_throttle_wait_us",
                 "rw_3:io_bg_fetch_docs_read",
                 "rw_3:io_num_write",
                 "rw_3:io_bg_fetch_doc_bytes",
                 "rw_3:io_total_read_bytes",
                 "rw_3:io_total_write_bytes",
                 "rw_3:io_write_bytes",
+                "rw_3:io_scan_doc_bytes",
+                "rw_3:io_scan_docs_read",
+                "rw_3:io_scan_readahead_bytes",
                 "rw_3:lastCommDocs",
                 "rw_3:numLoadedVb",
                 "rw_3:open"
@@ -6171,6 +6203,23 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                        roKVStoreStats.end());
     }
 
+#ifdef EP_USE_ZSTD
+    /* and the value compressor stats, reported by each RW store */
+    if (backend == "couchdb") {
+        for (int shard = 0; shard < 4; ++shard) {
+            const std::string prefix = "rw_" + std::to_string(shard) + ":";
+            for (const auto* stat : {"io_compression_dicts_trained",
+                                     "io_compression_incompressible",
+                                     "io_compression_raw_bytes",
+                                     "io_compression_stored_bytes",
+                                     "io_decompress_count",
+                                     "io_decompress_failures"}) {
+                kvstats.push_back(prefix + stat);
+            }
+        }
+    }
+#endif
+
     std::map<std::string, std::vector<std::string> > statsKeys{
             {"dcp-vbtakeover 0",
              {"status",
@@ -6179,7 +6228,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "chk_items",
               "estimate"}},
             {"dcp",
-             {"ep_dcp_count",
+             {"ep_dcp_backfill_items_shared",
+              "ep_dcp_backfill_scans_joined",
+              "ep_dcp_count",
               "ep_dcp_dead_conn_count",
               "ep_dcp_items_remaining",
               "ep_dcp_items_sent",
@@ -6297,7 +6348,11 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                         "ep_chk_remover_stime",
                         "ep_collections_prototype_enabled",
                         "ep_collections_max_size",
+                        "ep_collections_reclaimer_chunk_duration",
+                        "ep_collections_reclaimer_interval",
                         "ep_compaction_exp_mem_threshold",
+                        "ep_compaction_max_bytes_per_sec",
+                        "ep_compaction_max_concurrent",
                         "ep_compaction_write_queue_cap",
                         "ep_compression_mode",
                         "ep_config_file",
@@ -6327,11 +6382,16 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                         "ep_dcp_consumer_process_buffered_messages_batch_size",
                         "ep_dcp_scan_byte_limit",
                         "ep_dcp_scan_item_limit",
+                        "ep_dcp_scan_readahead",
+                        "ep_dcp_shared_backfill_scans",
                         "ep_dcp_takeover_max_time",
                         "ep_defragmenter_age_threshold",
                         "ep_defragmenter_chunk_duration",
                         "ep_defragmenter_enabled",
                         "ep_defragmenter_interval",
+                        "ep_item_compressor_chunk_duration",
+                        "ep_item_compressor_interval",
+                        "ep_item_compressor_min_compression_ratio",
                         "ep_enable_chk_merge",
                         "ep_exp_pager_enabled",
                         "ep_exp_pager_initial_run_time",
@@ -6465,7 +6525,11 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_clock_cas_drift_threshold_exceeded",
               "ep_collections_prototype_enabled",
               "ep_collections_max_size",
+              "ep_collections_reclaimer_chunk_duration",
+              "ep_collections_reclaimer_interval",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_max_bytes_per_sec",
+              "ep_compaction_max_concurrent",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
               "ep_config_file",
@@ -6500,13 +6564,27 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
+              "ep_dcp_scan_readahead",
+              "ep_dcp_shared_backfill_scans",
               "ep_dcp_takeover_max_time",
               "ep_defragmenter_age_threshold",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
               "ep_defragmenter_interval",
+              "ep_item_compressor_chunk_duration",
+              "ep_item_compressor_interval",
+              "ep_item_compressor_min_compression_ratio",
               "ep_defragmenter_num_moved",
               "ep_defragmenter_num_visited",
+              "ep_item_compressor_bytes_saved",
+              "ep_item_compressor_num_compressed",
+              "ep_item_compressor_num_incompressible",
+              "ep_item_compressor_num_visited",
+              "ep_collections_items_reclaimed",
+              "ep_collections_bytes_reclaimed",
+              "ep_collections_items_erased",
+              "ep_collections_reclaim_compactions",
+              "ep_collections_pending_deletes",
               "ep_degraded_mode",
               "ep_diskqueue_drain",
               "ep_diskqueue_fill",
@@ -6536,6 +6614,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_io_bg_fetch_read_count",
               "ep_io_compaction_read_bytes",
               "ep_io_compaction_write_bytes",
+              "ep_io_compaction_throttle_wait_us",
               "ep_io_total_read_bytes",
               "ep_io_total_write_bytes",
               "ep_item_num",
@@ -6588,6 +6667,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_pager_active_vb_pcnt",
               "ep_pager_sleep_time_ms",
               "ep_pending_compactions",
+              "ep_running_compactions",
               "ep_pending_ops",
               "ep_pending_ops_max",
               "ep_pending_ops_max_duration",
@@ -6764,7 +6844,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                           "ep_alog_resident_ratio_threshold",
                           "ep_alog_sleep_time",
                           "ep_alog_task_time",
-                          "ep_item_eviction_policy"});
+                          "ep_item_eviction_policy",
+                          "ep_persistence_compression_dict_size",
+                          "ep_persistence_compression_level",
+                          "ep_persistence_compression_mode"});
 
         // 'diskinfo and 'diskinfo detail' keys should be present now.
         statsKeys["diskinfo"] = {"ep_db_data_size", "ep_db_file_size"};
@@ -6796,7 +6879,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                              "ep_alog_resident_ratio_threshold",
                              "ep_alog_sleep_time",
                              "ep_alog_task_time",
-                             "ep_item_eviction_policy"});
+                             "ep_item_eviction_policy",
+                             "ep_persistence_compression_dict_size",
+                             "ep_persistence_compression_level",
+                             "ep_persistence_compression_mode"});
     }
 
     if (isEphemeralBucket(h, h1)) {
@@ -6864,6 +6950,18 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                  "ep_ephemeral_metadata_purge_stale_chunk_duration"});
     }
 
+#ifdef EP_USE_ZSTD
+    // couchstore keeps a value compressor whenever zstd is available.
+    if (backend == "couchdb") {
+        auto& eng_stats = statsKeys.at("");
+        eng_stats.insert(eng_stats.end(),
+                         {"ep_io_compression_raw_bytes",
+                          "ep_io_compression_stored_bytes",
+                          "ep_io_compression_ratio",
+                          "ep_io_decompress_failures"});
+    }
+#endif
+
     // In addition to the exact stat keys above, we also use regex patterns
     // for variable keys:
     std::map<std::string, std::vector<std::regex> > statsPatterns{
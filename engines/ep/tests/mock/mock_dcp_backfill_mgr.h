@@ -36,4 +36,9 @@ public:
     bool getBackfillBufferFullStatus() {
         return buffer.full;
     }
+
+    size_t getNumSnoozingBackfills() {
+        LockHolder lh(lock);
+        return snoozingBackfills.size();
+    }
 };
@@ -127,6 +127,11 @@ public:
                 ->getBackfillBufferFullStatus();
     }
 
+    size_t getNumSnoozingBackfills() {
+        return dynamic_cast<MockDcpBackfillManager*>(backfillMgr.get())
+                ->getNumSnoozingBackfills();
+    }
+
     const Collections::Filter& getFilter() {
         return filter;
     }
@@ -0,0 +1,261 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "checkpoint_queue.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+class CheckpointQueueTest : public ::testing::Test {
+protected:
+    queued_item makeQueuedItem(const std::string& key, int64_t seqno) {
+        queued_item qi(new Item(make_item(0, makeStoredDocKey(key), "value")));
+        qi->setBySeqno(seqno);
+        return qi;
+    }
+
+    /// Get the seqnos of the items in the queue (in iteration order)
+    std::vector<int64_t> getSeqnos() const {
+        std::vector<int64_t> ret;
+        for (const auto& qi : queue) {
+            ret.push_back(qi->getBySeqno());
+        }
+        return ret;
+    }
+
+    CheckpointQueue queue;
+};
+
+TEST_F(CheckpointQueueTest, PushBack) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.begin(), queue.end());
+
+    // Fill more than a single chunk
+    const int64_t count = CheckpointQueue::ChunkSize * 2 + 1;
+    for (int64_t ii = 0; ii < count; ++ii) {
+        queue.push_back(makeQueuedItem("key" + std::to_string(ii), ii));
+    }
+
+    EXPECT_EQ(size_t(count), queue.size());
+    EXPECT_EQ(count - 1, queue.back()->getBySeqno());
+    EXPECT_EQ(3 * sizeof(queued_item) * CheckpointQueue::ChunkSize,
+              queue.getMemoryOverhead());
+
+    int64_t expected = 0;
+    for (const auto& qi : queue) {
+        EXPECT_EQ(expected++, qi->getBySeqno());
+    }
+    EXPECT_EQ(count, expected);
+
+    for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+        EXPECT_EQ(--expected, (*it)->getBySeqno());
+    }
+    EXPECT_EQ(0, expected);
+}
+
+TEST_F(CheckpointQueueTest, PositionsAreStable) {
+    queue.push_back(makeQueuedItem("a", 1));
+    const auto pos = (--queue.end()).getPosition();
+
+    for (int ii = 0; ii < 1000; ++ii) {
+        queue.push_back(makeQueuedItem("b", 2));
+    }
+    EXPECT_EQ(1, (*queue.at(pos))->getBySeqno());
+}
+
+TEST_F(CheckpointQueueTest, EraseSkipsEmptySlots) {
+    for (int64_t ii = 0; ii < 5; ++ii) {
+        queue.push_back(makeQueuedItem("key" + std::to_string(ii), ii));
+    }
+
+    queue.erase(std::next(queue.begin(), 2));
+    EXPECT_EQ(4u, queue.size());
+    EXPECT_EQ(std::vector<int64_t>({0, 1, 3, 4}), getSeqnos());
+
+    auto it = queue.at(3);
+    --it;
+    EXPECT_EQ(1, (*it)->getBySeqno());
+
+    // Removing the items at the ends moves begin / end
+    queue.erase(queue.begin());
+    queue.pop_back();
+    EXPECT_EQ(std::vector<int64_t>({1, 3}), getSeqnos());
+    EXPECT_EQ(1, queue.begin().getPosition());
+    EXPECT_EQ(3, queue.back()->getBySeqno());
+
+    queue.pop_back();
+    queue.pop_back();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.begin(), queue.end());
+    EXPECT_THROW(queue.pop_back(), std::logic_error);
+}
+
+TEST_F(CheckpointQueueTest, InsertAfterHead) {
+    queue.push_back(makeQueuedItem("dummy", 0));
+    queue.push_back(makeQueuedItem("start", 1));
+    queue.push_back(makeQueuedItem("a", 10));
+    const auto pos = (--queue.end()).getPosition();
+
+    // Insert enough items to require multiple chunks at the front
+    const int64_t count = CheckpointQueue::ChunkSize + 1;
+    for (int64_t ii = 0; ii < count; ++ii) {
+        auto it = queue.insertAfterHead(2, makeQueuedItem("b", 9 - ii));
+        EXPECT_EQ(9 - ii, (*it)->getBySeqno());
+        EXPECT_EQ(it.getPosition() - 2, queue.begin().getPosition());
+    }
+
+    // The head items are still at the front (in order) and the position of
+    // the other items didn't change
+    auto seqnos = getSeqnos();
+    ASSERT_EQ(size_t(count + 3), seqnos.size());
+    EXPECT_EQ(0, seqnos[0]);
+    EXPECT_EQ(1, seqnos[1]);
+    EXPECT_EQ(9 - count + 1, seqnos[2]);
+    EXPECT_EQ(9, seqnos[count + 1]);
+    EXPECT_EQ(10, (*queue.at(pos))->getBySeqno());
+}
+
+class CheckpointIndexTest : public CheckpointQueueTest {
+protected:
+    CheckpointIndex::Entry& queue_and_index(const std::string& key,
+                                            int64_t seqno) {
+        auto qi = makeQueuedItem(key, seqno);
+        queue.push_back(qi);
+        return index.insert(qi->getKey(),
+                            {(--queue.end()).getPosition(), seqno});
+    }
+
+    CheckpointIndex index{queue};
+};
+
+TEST_F(CheckpointIndexTest, InsertFindErase) {
+    const auto key = makeStoredDocKey("key");
+    EXPECT_EQ(nullptr, index.find(key));
+    EXPECT_FALSE(index.erase(key));
+
+    queue_and_index("key", 1);
+    ASSERT_NE(nullptr, index.find(key));
+    EXPECT_EQ(1, index.find(key)->mutation_id);
+    EXPECT_EQ(1u, index.size());
+
+    // The namespace is part of the key
+    EXPECT_EQ(nullptr,
+              index.find(makeStoredDocKey("key", DocNamespace::System)));
+
+    EXPECT_TRUE(index.erase(key));
+    EXPECT_EQ(nullptr, index.find(key));
+    EXPECT_EQ(0u, index.size());
+}
+
+TEST_F(CheckpointIndexTest, GrowAndErase) {
+    const int count = 1000;
+    for (int ii = 0; ii < count; ++ii) {
+        queue_and_index("key" + std::to_string(ii), ii);
+    }
+    EXPECT_EQ(size_t(count), index.size());
+
+    // Erase every other key (to verify that the backward shift keeps the
+    // remaining entries reachable)
+    for (int ii = 0; ii < count; ii += 2) {
+        EXPECT_TRUE(
+                index.erase(makeStoredDocKey("key" + std::to_string(ii))));
+    }
+    EXPECT_EQ(size_t(count / 2), index.size());
+
+    for (int ii = 0; ii < count; ++ii) {
+        const auto* entry =
+                index.find(makeStoredDocKey("key" + std::to_string(ii)));
+        if (ii % 2 == 0) {
+            EXPECT_EQ(nullptr, entry) << "key" << ii;
+        } else {
+            ASSERT_NE(nullptr, entry) << "key" << ii;
+            EXPECT_EQ(ii, entry->mutation_id);
+            EXPECT_EQ(ii, (*queue.at(entry->position))->getBySeqno());
+        }
+    }
+}
+
+TEST_F(CheckpointIndexTest, UpdatePosition) {
+    queue_and_index("a", 1);
+    queue_and_index("b", 2);
+    auto* entry = index.find(makeStoredDocKey("a"));
+    ASSERT_NE(nullptr, entry);
+
+    // De-duplicate "a" the same way as Checkpoint::queueDirty; the entry
+    // must refer to the new item before the old one is removed
+    auto oldPos = queue.at(entry->position);
+    queue.push_back(makeQueuedItem("a", 3));
+    entry->position = (--queue.end()).getPosition();
+    entry->mutation_id = 3;
+    queue.erase(oldPos);
+
+    EXPECT_EQ(std::vector<int64_t>({2, 3}), getSeqnos());
+    entry = index.find(makeStoredDocKey("a"));
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(3, (*queue.at(entry->position))->getBySeqno());
+    EXPECT_NE(nullptr, index.find(makeStoredDocKey("b")));
+}
+
+TEST_F(CheckpointIndexTest, Compact) {
+    queue_and_index("dummy", 0);
+    // Alternate between two keys, de-duplicating them the same way as
+    // Checkpoint::queueDirty, so that every update leaves an empty slot.
+    for (int64_t seqno = 1; seqno <= 10000; ++seqno) {
+        const auto key = makeStoredDocKey(seqno % 2 ? "a" : "b");
+        auto* entry = index.find(key);
+        if (!entry) {
+            queue_and_index(seqno % 2 ? "a" : "b", seqno);
+            continue;
+        }
+        auto oldPos = queue.at(entry->position);
+        queue.push_back(makeQueuedItem(seqno % 2 ? "a" : "b", seqno));
+        entry->position = (--queue.end()).getPosition();
+        entry->mutation_id = seqno;
+        queue.erase(oldPos);
+
+        if (queue.needsCompaction()) {
+            index.updatePositions(queue.compact());
+        }
+        ASSERT_LE(queue.getMemoryOverhead(),
+                  2 * sizeof(queued_item) * CheckpointQueue::ChunkSize);
+    }
+
+    EXPECT_EQ(std::vector<int64_t>({0, 9999, 10000}), getSeqnos());
+    for (const auto& key : {"dummy", "a", "b"}) {
+        const auto* entry = index.find(makeStoredDocKey(key));
+        ASSERT_NE(nullptr, entry) << key;
+        EXPECT_EQ(entry->mutation_id,
+                  (*queue.at(entry->position))->getBySeqno());
+    }
+
+    // Compacting moves the items together, and maps the old positions
+    // (including those of empty slots and the end) to the new ones.
+    queue.erase(std::next(queue.begin()));
+    const auto oldBegin = queue.begin().getPosition();
+    const auto oldLast = (--queue.end()).getPosition();
+    const auto oldEnd = queue.end().getPosition();
+    const auto map = queue.compact();
+    EXPECT_EQ(oldBegin, map(oldBegin));
+    EXPECT_EQ(oldBegin + 1, map(oldLast));
+    EXPECT_EQ(oldBegin + 1, map(oldBegin + 1));
+    EXPECT_EQ(queue.end().getPosition(), map(oldEnd));
+    EXPECT_EQ(std::vector<int64_t>({0, 10000}), getSeqnos());
+}
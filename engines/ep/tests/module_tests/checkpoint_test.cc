@@ -1094,6 +1094,86 @@ TYPED_TEST(CheckpointTest, SeqnoAndHLCOrdering) {
     }
 }
 
+// Updating the same keys over and over must not grow the checkpoint's queue
+// without bound: de-duplication leaves empty slots behind, which are
+// compacted away (moving the cursors and index entries along).
+TYPED_TEST(CheckpointTest, DeduplicationCompactsQueue) {
+    const size_t initialOverhead = this->global_stats.memOverhead->load();
+    ASSERT_TRUE(this->queueNewItem("key1"));
+    ASSERT_TRUE(this->queueNewItem("key2"));
+
+    std::vector<queued_item> items;
+    this->manager->getAllItemsForCursor(CheckpointManager::pCursorName, items);
+    ASSERT_EQ(3, items.size());
+
+    // Alternate between the keys; updating the last item in the queue would
+    // replace it in place. Only the first update of each key (already read
+    // by the cursor) counts as a new item to persist.
+    for (int ii = 0; ii < 10000; ++ii) {
+        EXPECT_EQ(ii < 2, this->queueNewItem(ii % 2 ? "key2" : "key1"));
+        ASSERT_LE(this->global_stats.memOverhead->load(),
+                  initialOverhead + 2 * sizeof(queued_item) *
+                                            CheckpointQueue::ChunkSize);
+    }
+    EXPECT_EQ(2, this->manager->getNumOpenChkItems());
+
+    // The cursor only has the latest version of each key left to read.
+    EXPECT_EQ(2,
+              this->manager->getNumItemsForCursor(
+                      CheckpointManager::pCursorName));
+    items.clear();
+    this->manager->getAllItemsForCursor(CheckpointManager::pCursorName, items);
+    ASSERT_EQ(2, items.size());
+    EXPECT_STREQ("key1", items[0]->getKey().c_str());
+    EXPECT_STREQ("key2", items[1]->getKey().c_str());
+    EXPECT_LT(items[0]->getBySeqno(), items[1]->getBySeqno());
+}
+
+// The published version lets pollers tell (without the queueLock) whether
+// anything was made available to the cursors since they last read them.
+TYPED_TEST(CheckpointTest, PublishedVersion) {
+    std::vector<queued_item> items;
+    this->manager->getAllItemsForCursor(CheckpointManager::pCursorName, items);
+    EXPECT_FALSE(this->manager->hasNewItemsForPersistence());
+
+    auto version = this->manager->getPublishedVersion();
+    ASSERT_TRUE(this->queueNewItem("key1"));
+    EXPECT_NE(version, this->manager->getPublishedVersion());
+    EXPECT_TRUE(this->manager->hasNewItemsForPersistence());
+
+    // Draining another cursor doesn't count for the persistence cursor.
+    this->manager->registerCursorBySeqno("dcp", 0, MustSendCheckpointEnd::NO);
+    items.clear();
+    this->manager->getAllItemsForCursor("dcp", items);
+    EXPECT_TRUE(this->manager->hasNewItemsForPersistence());
+
+    items.clear();
+    this->manager->getAllItemsForCursor(CheckpointManager::pCursorName, items);
+    EXPECT_EQ(1, items.size());
+    EXPECT_FALSE(this->manager->hasNewItemsForPersistence());
+
+    // Reading doesn't publish anything.
+    version = this->manager->getPublishedVersion();
+    items.clear();
+    this->manager->getAllItemsForCursor("dcp", items);
+    EXPECT_EQ(version, this->manager->getPublishedVersion());
+
+    // The cursors can move into a new checkpoint, so creating one publishes.
+    this->manager->createNewCheckpoint();
+    EXPECT_NE(version, this->manager->getPublishedVersion());
+    EXPECT_TRUE(this->manager->hasNewItemsForPersistence());
+
+    // A cleanup pass which neither removes nor creates a checkpoint doesn't
+    // publish anything.
+    version = this->manager->getPublishedVersion();
+    bool new_open_ckpt_created;
+    EXPECT_EQ(0,
+              this->manager->removeClosedUnrefCheckpoints(
+                      *this->vbucket, new_open_ckpt_created));
+    EXPECT_FALSE(new_open_ckpt_created);
+    EXPECT_EQ(version, this->manager->getPublishedVersion());
+}
+
 // Test cursor is correctly updated when enqueuing a key which already exists
 // in the checkpoint (and needs de-duping), where the cursor points at a
 // meta-item at the head of the checkpoint:
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 
+#include "collections/reclaim_visitor.h"
 #include "tests/module_tests/evp_store_single_threaded_test.h"
 
 class CollectionsEraserTest
@@ -240,6 +241,109 @@ TEST_P(CollectionsEraserTest, default_Destroy) {
     EXPECT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
 }
 
+// The reclaimer releases a dropped collection's items from memory before the
+// eraser has run, leaving other collections and dirty items alone.
+TEST_P(CollectionsEraserTest, reclaim_before_compaction) {
+    vb->updateFromManifest({R"({"separator":":", )"
+                            R"("collections":[{"name":"$default", "uid":"0"},)"
+                            R"(               {"name":"fruit","uid":"1"},)"
+                            R"(               {"name":"dairy","uid":"1"}]})"});
+
+    flush_vbucket_to_disk(vbid, 2 /* 2 x system */);
+
+    store_item(vbid, {"dairy:milk", DocNamespace::Collections}, "nice");
+    store_item(vbid, {"dairy:butter", DocNamespace::Collections}, "lovely");
+    store_item(vbid, {"fruit:apple", DocNamespace::Collections}, "nice");
+
+    flush_vbucket_to_disk(vbid, 3);
+
+    // Dirty (not yet flushed) item of the collection being dropped
+    store_item(vbid, {"dairy:cream", DocNamespace::Collections}, "rich");
+
+    // delete the dairy collection
+    vb->updateFromManifest({R"({"separator":":",)"
+                            R"("collections":[{"name":"$default", "uid":"0"},)"
+                            R"(               {"name":"fruit","uid":"1"}]})"});
+
+    Collections::ReclaimVisitor visitor;
+    visitor.setCurrentVBucket(*vb);
+    vb->ht.visit(visitor);
+
+    EXPECT_EQ(4u, visitor.getVisitedCount());
+    EXPECT_EQ(2u, visitor.getReclaimedCount());
+    EXPECT_LT(0u, visitor.getReclaimedBytes());
+    EXPECT_EQ(2u, vb->ht.getNumInMemoryItems());
+
+    // Deleted, but still exists in the manifest
+    EXPECT_TRUE(vb->lockCollections().exists("dairy"));
+
+    flush_vbucket_to_disk(vbid, 2 /* 1 x item, 1 x system */);
+
+    // Once flushed, the remaining dairy item goes too
+    visitor.clearStats();
+    visitor.setCurrentVBucket(*vb);
+    vb->ht.visit(visitor);
+    EXPECT_EQ(1u, visitor.getReclaimedCount());
+    EXPECT_EQ(1u, vb->ht.getNumInMemoryItems());
+
+    runEraser();
+
+    EXPECT_EQ(1, vb->getNumItems());
+    EXPECT_FALSE(vb->lockCollections().exists("dairy"));
+    EXPECT_TRUE(vb->lockCollections().exists("fruit"));
+}
+
+// The reclaimer task schedules one compaction (running the eraser) per
+// collection deletion, once the deletion has been persisted.
+TEST_P(CollectionsEraserTest, reclaimer_schedules_compaction) {
+    auto& bucket = dynamic_cast<EPBucket&>(*store);
+    auto& stats = engine->getEpStats();
+
+    vb->updateFromManifest({R"({"separator":":", )"
+                            R"("collections":[{"name":"$default", "uid":"0"},)"
+                            R"(               {"name":"dairy","uid":"1"}]})"});
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+
+    store_item(vbid, {"dairy:milk", DocNamespace::Collections}, "nice");
+    store_item(vbid, {"dairy:butter", DocNamespace::Collections}, "lovely");
+    flush_vbucket_to_disk(vbid, 2 /* 2 x items */);
+
+    // Nothing being deleted, so nothing to do
+    bucket.runCollectionsReclaimerTask();
+    EXPECT_EQ(0u, stats.collectionsPendingDeletes.load());
+    EXPECT_EQ(0u, stats.collectionsReclaimCompactions.load());
+
+    // delete the collection
+    vb->updateFromManifest(
+            {R"({"separator":":",)"
+             R"("collections":[{"name":"$default", "uid":"0"}]})"});
+
+    // The deletion isn't persisted yet, so the eraser couldn't complete it
+    bucket.runCollectionsReclaimerTask();
+    EXPECT_EQ(1u, stats.collectionsPendingDeletes.load());
+    EXPECT_EQ(0u, stats.collectionsReclaimCompactions.load());
+
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+
+    bucket.runCollectionsReclaimerTask();
+    EXPECT_EQ(1u, stats.collectionsPendingDeletes.load());
+    EXPECT_EQ(1u, stats.collectionsReclaimCompactions.load());
+
+    // Still being deleted until the compaction runs, but already compacted
+    // for this deletion.
+    bucket.runCollectionsReclaimerTask();
+    EXPECT_EQ(1u, stats.collectionsReclaimCompactions.load());
+
+    runNextTask(*task_executor->getLpTaskQ()[WRITER_TASK_IDX],
+                "Compact DB file 0");
+    EXPECT_EQ(0, vb->getNumItems());
+    EXPECT_FALSE(vb->lockCollections().exists("dairy"));
+
+    bucket.runCollectionsReclaimerTask();
+    EXPECT_EQ(0u, stats.collectionsPendingDeletes.load());
+    EXPECT_EQ(1u, stats.collectionsReclaimCompactions.load());
+}
+
 struct PrintTestName {
     std::string operator()(
             const ::testing::TestParamInfo<std::string>& info) const {
@@ -323,6 +323,116 @@ TEST_F(CollectionsTest, MB_25344_get) {
     EXPECT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
 }
 
+// Check the per-collection counters follow the items of each collection
+// through the front-end, flusher and eviction.
+TEST_F(CollectionsTest, collection_stats) {
+    VBucketPtr vb = store->getVBucket(vbid);
+    // Add the meat collection
+    vb->updateFromManifest({R"({"separator":":",
+                 "collections":[{"name":"$default", "uid":"0"},
+                                {"name":"meat", "uid":"1"}]})"});
+    flush_vbucket_to_disk(vbid, 1);
+
+    store_item(vbid, {"key", DocNamespace::DefaultCollection}, "value");
+    store_item(vbid, {"meat:beef", DocNamespace::Collections}, "value");
+    store_item(vbid, {"meat:lamb", DocNamespace::Collections}, "value");
+    flush_vbucket_to_disk(vbid, 3);
+
+    auto defaultStats = vb->collectionStats.get("$default");
+    EXPECT_EQ(1, defaultStats.items);
+    EXPECT_EQ(1u, defaultStats.opsStore);
+
+    auto meatStats = vb->collectionStats.get("meat");
+    EXPECT_EQ(2, meatStats.items);
+    EXPECT_EQ(2u, meatStats.opsStore);
+    EXPECT_LT(0, meatStats.memUsed);
+    EXPECT_LT(0u, meatStats.diskBytesWritten);
+
+    get_options_t options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | DELETE_TEMP |
+            HIDE_LOCKED_CAS | TRACK_STATISTICS);
+    auto gv = store->get(
+            {"meat:beef", DocNamespace::Collections}, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(1u, vb->collectionStats.get("meat").opsGet);
+
+    uint64_t cas = 0;
+    mutation_descr_t mutation_descr;
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->deleteItem({"meat:lamb", DocNamespace::Collections},
+                                cas,
+                                vbid,
+                                cookie,
+                                nullptr,
+                                mutation_descr));
+    flush_vbucket_to_disk(vbid, 1);
+
+    auto afterDelete = vb->collectionStats.get("meat");
+    EXPECT_EQ(1, afterDelete.items);
+    EXPECT_EQ(1u, afterDelete.opsDelete);
+    EXPECT_LT(meatStats.diskBytesWritten, afterDelete.diskBytesWritten);
+
+    // Ejecting the value of the remaining item leaves it counted, but frees
+    // its value's memory.
+    evict_key(vbid, {"meat:beef", DocNamespace::Collections});
+    auto afterEvict = vb->collectionStats.get("meat");
+    EXPECT_EQ(1, afterEvict.items);
+    EXPECT_EQ(1u, afterEvict.evicted);
+    EXPECT_GT(afterDelete.memUsed, afterEvict.memUsed);
+
+    // The default collection's counters are untouched by all of the above.
+    EXPECT_EQ(defaultStats.memUsed,
+              vb->collectionStats.get("$default").memUsed);
+}
+
+class CollectionsFullEvictionTest : public CollectionsTest {
+public:
+    void SetUp() override {
+        config_string += "item_eviction_policy=full_eviction;";
+        CollectionsTest::SetUp();
+    }
+};
+
+// Under full eviction a collection's items are counted as they are created
+// and deleted on disk, so evicting them doesn't change the count.
+TEST_F(CollectionsFullEvictionTest, collection_stats_items) {
+    VBucketPtr vb = store->getVBucket(vbid);
+    vb->updateFromManifest({R"({"separator":":",
+                 "collections":[{"name":"$default", "uid":"0"},
+                                {"name":"meat", "uid":"1"}]})"});
+    flush_vbucket_to_disk(vbid, 1);
+
+    store_item(vbid, {"meat:beef", DocNamespace::Collections}, "value");
+    store_item(vbid, {"meat:lamb", DocNamespace::Collections}, "value");
+    // Not counted until persisted.
+    EXPECT_EQ(0, vb->collectionStats.get("meat").items);
+    flush_vbucket_to_disk(vbid, 2);
+    EXPECT_EQ(2, vb->collectionStats.get("meat").items);
+
+    evict_key(vbid, {"meat:beef", DocNamespace::Collections});
+    auto afterEvict = vb->collectionStats.get("meat");
+    EXPECT_EQ(2, afterEvict.items);
+    EXPECT_EQ(1u, afterEvict.evicted);
+
+    // An update of an existing item doesn't change the count.
+    store_item(vbid, {"meat:lamb", DocNamespace::Collections}, "value2");
+    flush_vbucket_to_disk(vbid, 1);
+    EXPECT_EQ(2, vb->collectionStats.get("meat").items);
+
+    uint64_t cas = 0;
+    mutation_descr_t mutation_descr;
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->deleteItem({"meat:lamb", DocNamespace::Collections},
+                                cas,
+                                vbid,
+                                cookie,
+                                nullptr,
+                                mutation_descr));
+    EXPECT_EQ(2, vb->collectionStats.get("meat").items);
+    flush_vbucket_to_disk(vbid, 1);
+    EXPECT_EQ(1, vb->collectionStats.get("meat").items);
+}
+
 class CollectionsFlushTest : public CollectionsTest {
 public:
     void SetUp() override {
@@ -19,6 +19,9 @@
 #include "src/couch-kvstore/couch-fs-stats.h"
 
 #include "kvstore.h"
+#include "token_bucket.h"
+
+#include <platform/processclock.h>
 
 class TestStatsOps : public StatsOps {
 public:
@@ -57,4 +60,115 @@ INSTANTIATE_TYPED_TEST_CASE_P(CouchstoreOpsTest,
 INSTANTIATE_TYPED_TEST_CASE_P(CouchstoreOpsTest,
     BufferedWrappedOpsTest,
     testing::Types<>
-);
\ No newline at end of file
+);
+
+/**
+ * FileOps which does no I/O; every read and write "succeeds" in full. Used to
+ * test the throttling in StatsOps without touching the disk.
+ */
+class NullOps : public FileOpsInterface {
+public:
+    couch_file_handle constructor(couchstore_error_info_t*) override {
+        return reinterpret_cast<couch_file_handle>(this);
+    }
+    couchstore_error_t open(couchstore_error_info_t*,
+                            couch_file_handle*,
+                            const char*,
+                            int) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_t close(couchstore_error_info_t*,
+                             couch_file_handle) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_t set_periodic_sync(couch_file_handle,
+                                         uint64_t) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    ssize_t pread(couchstore_error_info_t*,
+                  couch_file_handle,
+                  void*,
+                  size_t nbytes,
+                  cs_off_t) override {
+        return nbytes;
+    }
+    ssize_t pwrite(couchstore_error_info_t*,
+                   couch_file_handle,
+                   const void*,
+                   size_t nbytes,
+                   cs_off_t) override {
+        return nbytes;
+    }
+    cs_off_t goto_eof(couchstore_error_info_t*, couch_file_handle) override {
+        return 0;
+    }
+    couchstore_error_t sync(couchstore_error_info_t*,
+                            couch_file_handle) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_t advise(couchstore_error_info_t*,
+                              couch_file_handle,
+                              cs_off_t,
+                              cs_off_t,
+                              couchstore_file_advice_t) override {
+        return COUCHSTORE_SUCCESS;
+    }
+    FHStats* get_stats(couch_file_handle) override {
+        return nullptr;
+    }
+    void destructor(couch_file_handle) override {
+    }
+};
+
+// Reads and writes are both charged against the throttle, and only wait
+// (recording the wait) once its tokens have run out.
+TEST(StatsOpsThrottleTest, ChargesReadsAndWrites) {
+    NullOps base;
+    FileStats stats;
+    // 10000 bytes/s, starting with a second's worth available.
+    auto throttle = std::make_shared<TokenBucket>(10000);
+    StatsOps ops(stats, base, throttle);
+
+    couchstore_error_info_t errinfo;
+    auto handle = ops.constructor(&errinfo);
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.open(&errinfo, &handle, "file", 0));
+
+    char buf[1000] = {};
+    for (int ii = 0; ii < 10; ++ii) {
+        EXPECT_EQ(ssize_t(sizeof(buf)),
+                  ops.pwrite(&errinfo, handle, buf, sizeof(buf), 0));
+    }
+    EXPECT_EQ(0, stats.totalThrottleWaitUs);
+
+    // The bucket is empty; the next 1000 bytes take ~100ms.
+    const auto start = ProcessClock::now();
+    EXPECT_EQ(ssize_t(sizeof(buf)),
+              ops.pread(&errinfo, handle, buf, sizeof(buf), 0));
+    EXPECT_GE(ProcessClock::now() - start, std::chrono::milliseconds(50));
+
+    EXPECT_EQ(11000, throttle->getTotalConsumed());
+    EXPECT_GT(stats.totalThrottleWaitUs, 0);
+    EXPECT_EQ(1, stats.throttleWaitHisto.total());
+
+    EXPECT_EQ(COUCHSTORE_SUCCESS, ops.close(&errinfo, handle));
+    ops.destructor(handle);
+}
+
+// Without a throttle nothing waits.
+TEST(StatsOpsThrottleTest, Unthrottled) {
+    NullOps base;
+    FileStats stats;
+    StatsOps ops(stats, base);
+
+    couchstore_error_info_t errinfo;
+    auto handle = ops.constructor(&errinfo);
+    ASSERT_EQ(COUCHSTORE_SUCCESS, ops.open(&errinfo, &handle, "file", 0));
+    char buf[1000] = {};
+    for (int ii = 0; ii < 100; ++ii) {
+        ops.pwrite(&errinfo, handle, buf, sizeof(buf), 0);
+    }
+    EXPECT_EQ(0, stats.totalThrottleWaitUs);
+    EXPECT_EQ(0, stats.throttleWaitHisto.total());
+    EXPECT_EQ(COUCHSTORE_SUCCESS, ops.close(&errinfo, handle));
+    ops.destructor(handle);
+}
@@ -2858,6 +2858,70 @@ TEST_P(ConnectionTest, ReplicateJustBeforeThrottleThreshold) {
     sendConsumerMutationsNearThreshold(false);
 }
 
+/* Verify that the buffered messages of a consumer are applied by the
+   processor worker serving the vbucket (and only by that worker) */
+TEST_P(ConnectionTest, ProcessBufferedItemsPerWorker) {
+    engine->getConfiguration().setDcpConsumerProcessBufferedMessagesWorkers(2);
+
+    const void* cookie = create_mock_cookie();
+    const uint32_t opaque = 1;
+    auto consumer =
+            std::make_shared<MockDcpConsumer>(*engine, cookie, "test_consumer");
+    ASSERT_EQ(2, consumer->getNumProcessorWorkers());
+
+    std::vector<MockPassiveStream*> streams;
+    for (uint16_t vb = 0; vb < 2; ++vb) {
+        ASSERT_EQ(ENGINE_SUCCESS, set_vb_state(vb, vbucket_state_replica));
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  consumer->addStream(/*opaque*/ 0, vb, /*flags*/ 0));
+        streams.push_back(static_cast<MockPassiveStream*>(
+                consumer->getVbucketStream(vb).get()));
+        ASSERT_TRUE(streams.back()->isActive());
+
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->snapshotMarker(opaque,
+                                           vb,
+                                           /*start*/ 1,
+                                           /*end*/ 10,
+                                           /* in-memory snapshot */ 0x1));
+
+        /* Force the mutation to be buffered */
+        engine->getKVBucket()->getVBucket(vb)->setTakeoverBackedUpState(true);
+        const DocKey docKey{"mykey", DocNamespace::DefaultCollection};
+        EXPECT_EQ(ENGINE_SUCCESS,
+                  consumer->mutation(opaque,
+                                     docKey,
+                                     {}, // value
+                                     0, // priv bytes
+                                     PROTOCOL_BINARY_RAW_BYTES,
+                                     0, // cas
+                                     vb,
+                                     0, // flags
+                                     /*bySeqno*/ 1,
+                                     0, // rev seqno
+                                     0, // exptime
+                                     0, // locktime
+                                     {}, // meta
+                                     0)); // nru
+        EXPECT_EQ(1, streams.back()->getNumBufferItems());
+        engine->getKVBucket()->getVBucket(vb)->setTakeoverBackedUpState(false);
+    }
+
+    /* vb 1 is served by worker 1, so vb 0 is left untouched */
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(1));
+    EXPECT_EQ(all_processed, consumer->processBufferedItems(1));
+    EXPECT_EQ(1, streams[0]->getNumBufferItems());
+    EXPECT_EQ(0, streams[1]->getNumBufferItems());
+
+    EXPECT_EQ(more_to_process, consumer->processBufferedItems(0));
+    EXPECT_EQ(0, streams[0]->getNumBufferItems());
+
+    for (uint16_t vb = 0; vb < 2; ++vb) {
+        EXPECT_EQ(ENGINE_SUCCESS, consumer->closeStream(opaque, vb));
+    }
+    destroy_mock_cookie(cookie);
+}
+
 void ConnectionTest::processConsumerMutationsNearThreshold(
         bool beyondThreshold) {
     const void* cookie = create_mock_cookie();
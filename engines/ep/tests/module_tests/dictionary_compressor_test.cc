@@ -0,0 +1,178 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "dictionary_compressor.h"
+
+#include <random>
+#include <string>
+
+class DictionaryCompressorTest : public ::testing::Test {
+protected:
+    static const size_t dictSize = 1024;
+
+    /// A document resembling what a real bucket holds.
+    static std::string makeDoc(int i) {
+        return "{\"type\":\"user\",\"name\":\"user_" + std::to_string(i) +
+               "\",\"email\":\"user_" + std::to_string(i) +
+               "@example.com\",\"address\":{\"street\":\"" +
+               std::to_string(i * 7) +
+               " Main Street\",\"city\":\"Springfield\",\"country\":\"US\"},"
+               "\"active\":" +
+               (i % 2 ? "true" : "false") + "}";
+    }
+
+    /**
+     * Feed samples until a dictionary is trained, training each queued
+     * training set as the DictionaryTrainerTask would.
+     */
+    static void train(DictionaryCompressor& compressor) {
+        for (int i = 0; compressor.getCurrentDictionaryId() == 0; ++i) {
+            ASSERT_LT(i, 1000000) << "dictionary was never trained";
+            const auto doc = makeDoc(i);
+            if (compressor.addSample({doc.data(), doc.size()})) {
+                compressor.train();
+            }
+        }
+    }
+
+    static std::string compress(DictionaryCompressor& compressor,
+                                const std::string& in) {
+        std::string out(DictionaryCompressor::compressBound(in.size()), '\0');
+        out.resize(compressor.compress({in.data(), in.size()}, &out[0]));
+        return out;
+    }
+};
+
+TEST_F(DictionaryCompressorTest, NoDictionaryNoCompression) {
+    DictionaryCompressor compressor(3, dictSize);
+    EXPECT_EQ(0u, compressor.getCurrentDictionaryId());
+    EXPECT_TRUE(compress(compressor, makeDoc(1)).empty());
+}
+
+TEST_F(DictionaryCompressorTest, RoundTrip) {
+    if (!DictionaryCompressor::isSupported()) {
+        return;
+    }
+    DictionaryCompressor compressor(3, dictSize);
+    train(compressor);
+    const auto dictId = compressor.getCurrentDictionaryId();
+    EXPECT_NE(0u, dictId);
+    EXPECT_EQ(1u, compressor.getStats().numDictionariesTrained.load());
+
+    // Small documents sharing the dictionary's structure shrink a lot.
+    const auto doc = makeDoc(123456);
+    const auto frame = compress(compressor, doc);
+    ASSERT_FALSE(frame.empty());
+    EXPECT_LT(frame.size(), doc.size() / 2);
+    EXPECT_EQ(dictId,
+              DictionaryCompressor::getDictionaryId(
+                      {frame.data(), frame.size()}));
+    EXPECT_EQ(doc.size(), compressor.getStats().rawBytes.load());
+    EXPECT_EQ(frame.size(), compressor.getStats().compressedBytes.load());
+
+    std::string out;
+    ASSERT_TRUE(compressor.decompress({frame.data(), frame.size()}, out));
+    EXPECT_EQ(doc, out);
+    EXPECT_EQ(1u, compressor.getStats().numDecompressed.load());
+}
+
+// Completing a training set only queues it (and calls the scheduler); the
+// dictionary is trained, and compression starts, when train() runs.
+TEST_F(DictionaryCompressorTest, TrainingScheduled) {
+    if (!DictionaryCompressor::isSupported()) {
+        return;
+    }
+    DictionaryCompressor compressor(3, dictSize);
+    int scheduled = 0;
+    compressor.setTrainingScheduler([&scheduled]() { ++scheduled; });
+    EXPECT_FALSE(compressor.train());
+
+    int i = 0;
+    for (;; ++i) {
+        ASSERT_LT(i, 1000000) << "training set was never completed";
+        const auto doc = makeDoc(i);
+        if (compressor.addSample({doc.data(), doc.size()})) {
+            break;
+        }
+    }
+    EXPECT_EQ(1, scheduled);
+    EXPECT_EQ(0u, compressor.getCurrentDictionaryId());
+    EXPECT_TRUE(compress(compressor, makeDoc(i)).empty());
+
+    // Further samples are ignored while the training set is queued.
+    const auto doc = makeDoc(++i);
+    EXPECT_FALSE(compressor.addSample({doc.data(), doc.size()}));
+    EXPECT_EQ(1, scheduled);
+
+    ASSERT_TRUE(compressor.train());
+    EXPECT_NE(0u, compressor.getCurrentDictionaryId());
+    EXPECT_EQ(1u, compressor.getStats().numDictionariesTrained.load());
+    EXPECT_FALSE(compress(compressor, makeDoc(++i)).empty());
+
+    // Nothing left to train.
+    EXPECT_FALSE(compressor.train());
+}
+
+// A dictionary must be registered before frames depending on it can be
+// read - as after a restart, where it is loaded back from disk.
+TEST_F(DictionaryCompressorTest, AddDictionary) {
+    if (!DictionaryCompressor::isSupported()) {
+        return;
+    }
+    DictionaryCompressor writer(3, dictSize);
+    train(writer);
+    const auto dictId = writer.getCurrentDictionaryId();
+    const auto doc = makeDoc(42);
+    const auto frame = compress(writer, doc);
+    ASSERT_FALSE(frame.empty());
+
+    DictionaryCompressor reader(3, dictSize);
+    std::string out;
+    EXPECT_FALSE(reader.decompress({frame.data(), frame.size()}, out));
+    EXPECT_EQ(1u, reader.getStats().numDecompressFailures.load());
+
+    const auto dict = writer.getDictionary(dictId);
+    EXPECT_EQ(dictId, reader.addDictionary({dict.data(), dict.size()}, true));
+    EXPECT_TRUE(reader.hasDictionary(dictId));
+    ASSERT_TRUE(reader.decompress({frame.data(), frame.size()}, out));
+    EXPECT_EQ(doc, out);
+
+    // makeCurrent adopts the dictionary for compression too.
+    EXPECT_EQ(dictId, reader.getCurrentDictionaryId());
+
+    // Garbage is not a dictionary.
+    const std::string junk(64, 'x');
+    EXPECT_EQ(0u, reader.addDictionary({junk.data(), junk.size()}, false));
+}
+
+TEST_F(DictionaryCompressorTest, Incompressible) {
+    if (!DictionaryCompressor::isSupported()) {
+        return;
+    }
+    DictionaryCompressor compressor(3, dictSize);
+    train(compressor);
+
+    std::mt19937 gen(1);
+    std::string random(256, '\0');
+    for (auto& c : random) {
+        c = char(gen());
+    }
+    EXPECT_TRUE(compress(compressor, random).empty());
+    EXPECT_EQ(1u, compressor.getStats().numIncompressible.load());
+}
@@ -176,6 +176,85 @@ TEST_P(SetParamTest, compressionModeConfigTest) {
               engine->setFlushParam("compression_mode", "invalid", msg));
 }
 
+/**
+ * Test that splice replaces the given range of the stored value, but only
+ * if the document wasn't modified since its CAS was read.
+ */
+TEST_P(SetParamTest, Splice) {
+    const auto key = makeStoredDocKey("key");
+    store_item(vbid, "key", R"({"counter":1,"name":"value"})");
+
+    const auto options = static_cast<get_options_t>(HONOR_STATES |
+                                                    DELETE_TEMP);
+    auto gv = engine->getKVBucket()->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    const auto cas = gv.item->getCas();
+
+    // Replace the counter value (at offset 11) with a wider one
+    mutation_descr_t mutInfo;
+    auto ret = engine->splice(cookie,
+                              key,
+                              vbid,
+                              cas,
+                              11,
+                              1,
+                              {"12", 2},
+                              PROTOCOL_BINARY_DATATYPE_JSON,
+                              0,
+                              mutInfo);
+    ASSERT_EQ(cb::engine_errc::success, ret.status);
+    EXPECT_NE(cas, ret.cas);
+    EXPECT_EQ(2u, mutInfo.seqno);
+
+    gv = engine->getKVBucket()->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(ret.cas, gv.item->getCas());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, gv.item->getDataType());
+    EXPECT_EQ(R"({"counter":12,"name":"value"})",
+              std::string(gv.item->getData(), gv.item->getNBytes()));
+
+    // The document was modified since the original CAS was read
+    EXPECT_EQ(cb::engine_errc::key_already_exists,
+              engine->splice(cookie,
+                             key,
+                             vbid,
+                             cas,
+                             11,
+                             2,
+                             {"3", 1},
+                             PROTOCOL_BINARY_DATATYPE_JSON,
+                             0,
+                             mutInfo)
+                      .status);
+
+    // The range must be within the value
+    EXPECT_EQ(cb::engine_errc::invalid_arguments,
+              engine->splice(cookie,
+                             key,
+                             vbid,
+                             ret.cas,
+                             29,
+                             1,
+                             {"3", 1},
+                             PROTOCOL_BINARY_DATATYPE_JSON,
+                             0,
+                             mutInfo)
+                      .status);
+
+    EXPECT_EQ(cb::engine_errc::no_such_key,
+              engine->splice(cookie,
+                             makeStoredDocKey("missing"),
+                             vbid,
+                             ret.cas,
+                             0,
+                             0,
+                             {"3", 1},
+                             PROTOCOL_BINARY_DATATYPE_JSON,
+                             0,
+                             mutInfo)
+                      .status);
+}
+
 // Test cases which run for persistent and ephemeral buckets
 INSTANTIATE_TEST_CASE_P(EphemeralOrPersistent,
                         SetParamTest,
@@ -27,10 +27,12 @@
 #include "ep_time.h"
 #include "evp_store_test.h"
 #include "fakes/fake_executorpool.h"
+#include "kvstore.h"
 #include "programs/engine_testapp/mock_server.h"
 #include "taskqueue.h"
 #include "tests/module_tests/test_helpers.h"
 #include "tests/module_tests/test_task.h"
+#include "workload.h"
 
 #include <libcouchstore/couch_db.h>
 #include <string_utilities.h>
@@ -835,6 +837,295 @@ TEST_F(SingleThreadedEPBucketTest, test_mb22451) {
     producer->cancelCheckpointCreatorTask();
 }
 
+/*
+ * Test fixture for disk backfills sharing a scan: persists items and creates
+ * streams (one producer each) which backfill them from disk.
+ */
+class SharedBackfillScanTest : public SingleThreadedEPBucketTest {
+protected:
+    void SetUp() override {
+        SingleThreadedEPBucketTest::SetUp();
+        setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    }
+
+    void TearDown() override {
+        for (auto& producer : producers) {
+            // Required to ensure that the backfillMgr is deleted
+            producer->closeAllStreams();
+            producer->cancelCheckpointCreatorTask();
+        }
+        streams.clear();
+        producers.clear();
+        SingleThreadedEPBucketTest::TearDown();
+    }
+
+    /**
+     * Persist numItems items and remove them from the checkpoints, so that
+     * streams have to backfill them from disk.
+     */
+    void persistItems(int numItems) {
+        auto vb = store->getVBuckets().getBucket(vbid);
+        auto& ckpt_mgr = *vb->checkpointManager;
+        for (int ii = 0; ii < numItems; ii++) {
+            store_item(vbid,
+                       makeStoredDocKey("key" + std::to_string(ii)),
+                       "value");
+        }
+        ckpt_mgr.createNewCheckpoint();
+        flush_vbucket_to_disk(vbid, numItems);
+        bool new_ckpt_created;
+        ckpt_mgr.removeClosedUnrefCheckpoints(*vb, new_ckpt_created);
+    }
+
+    /**
+     * Create a producer and a stream of everything after startSeqno,
+     * scheduling its backfill.
+     */
+    MockActiveStream& createStream(uint64_t startSeqno = 0) {
+        auto vb = store->getVBuckets().getBucket(vbid);
+        producers.push_back(std::make_shared<MockDcpProducer>(
+                *engine,
+                cookie,
+                "test_producer" + std::to_string(producers.size()),
+                /*flags*/ 0,
+                cb::const_byte_buffer() /*no json*/));
+        streams.push_back(std::make_shared<MockActiveStream>(
+                static_cast<EventuallyPersistentEngine*>(engine.get()),
+                producers.back(),
+                /*flags*/ 0,
+                /*opaque*/ 0,
+                *vb,
+                startSeqno,
+                /*en_seqno*/ ~0,
+                /*vb_uuid*/ 0xabcd,
+                /*snap_start_seqno*/ startSeqno,
+                /*snap_end_seqno*/ ~0,
+                IncludeValue::Yes,
+                IncludeXattrs::Yes));
+        // Schedules the backfill.
+        streams.back()->transitionStateToBackfilling();
+        EXPECT_TRUE(streams.back()->public_isBackfillTaskRunning());
+        return *streams.back();
+    }
+
+    /// Run the given producer's backfills until its stream has backfilled.
+    void runBackfill(size_t index) {
+        auto& stream = *streams[index];
+        for (int ii = 0; ii < 1000 && stream.public_isBackfillTaskRunning();
+             ii++) {
+            producers[index]->getBFM().backfill();
+            ASSERT_EQ(0u, producers[index]->getNumSnoozingBackfills());
+        }
+        EXPECT_FALSE(stream.public_isBackfillTaskRunning());
+    }
+
+    /**
+     * Expect the stream's readyQ to hold (optionally a disk snapshot marker
+     * followed by) the mutations of key<from> to key<numItems - 1>, in order,
+     * each exactly once.
+     */
+    void expectBackfilled(MockActiveStream& stream,
+                          bool marker,
+                          int from,
+                          int numItems) {
+        ASSERT_EQ(size_t(numItems - from + (marker ? 1 : 0)),
+                  stream.public_readyQ().size());
+        if (marker) {
+            auto resp = stream.public_nextQueuedItem();
+            EXPECT_EQ(DcpResponse::Event::SnapshotMarker, resp->getEvent());
+        }
+        for (int ii = from; ii < numItems; ii++) {
+            auto resp = stream.public_nextQueuedItem();
+            ASSERT_EQ(DcpResponse::Event::Mutation, resp->getEvent());
+            EXPECT_EQ("key" + std::to_string(ii),
+                      dynamic_cast<MutationResponse*>(resp.get())
+                              ->getItem()
+                              ->getKey()
+                              .c_str());
+        }
+    }
+
+    std::vector<std::shared_ptr<MockDcpProducer>> producers;
+    std::vector<std::shared_ptr<MockActiveStream>> streams;
+};
+
+/*
+ * Two streams backfilling the same vBucket from the same seqno should be fed
+ * by a single disk scan, each receiving a snapshot marker and every item.
+ */
+TEST_F(SharedBackfillScanTest, JoinScan) {
+    const int numItems = 5;
+    persistItems(numItems);
+
+    auto& connMap = engine->getDcpConnMap();
+    const size_t joinedBefore = connMap.getBackfillScansJoined();
+    const size_t sharedBefore = connMap.getBackfillItemsShared();
+
+    createStream();
+    createStream();
+
+    // The second backfill is created before the first one starts scanning,
+    // so it joins the first one's scan. Run both to completion.
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    for (int ii = 0; ii < 20 && (streams[0]->public_isBackfillTaskRunning() ||
+                                 streams[1]->public_isBackfillTaskRunning());
+         ii++) {
+        runNextTask(lpAuxioQ, "Backfilling items for a DCP Connection");
+    }
+
+    EXPECT_EQ(1u, connMap.getBackfillScansJoined() - joinedBefore);
+    EXPECT_EQ(size_t(numItems),
+              connMap.getBackfillItemsShared() - sharedBefore);
+
+    for (auto& stream : streams) {
+        EXPECT_FALSE(stream->public_isBackfillTaskRunning());
+        expectBackfilled(*stream, true, 0, numItems);
+    }
+}
+
+/*
+ * A shared scan of more than dcp_scan_item_limit items must not stall: each
+ * run is limited by the driving backfill's scan buffer only, so neither
+ * backfill (nor manager task) should ever have to snooze.
+ */
+TEST_F(SharedBackfillScanTest, MoreThanScanItemLimit) {
+    engine->getConfiguration().setDcpScanItemLimit(10);
+    const int numItems = 55;
+    persistItems(numItems);
+
+    createStream();
+    createStream();
+
+    // runNextTask throws if no task is ready, i.e. if a manager task snoozed.
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    for (int ii = 0; ii < 100 && (streams[0]->public_isBackfillTaskRunning() ||
+                                  streams[1]->public_isBackfillTaskRunning());
+         ii++) {
+        runNextTask(lpAuxioQ, "Backfilling items for a DCP Connection");
+        for (auto& producer : producers) {
+            ASSERT_EQ(0u, producer->getNumSnoozingBackfills());
+        }
+    }
+
+    for (auto& stream : streams) {
+        EXPECT_FALSE(stream->public_isBackfillTaskRunning());
+        expectBackfilled(*stream, true, 0, numItems);
+    }
+}
+
+/*
+ * When one participant's backfill buffer is full the shared scan pauses for
+ * everyone, and resumes (driven by that participant) once it has drained,
+ * without sending anyone an item twice.
+ */
+TEST_F(SharedBackfillScanTest, PauseOnFullBuffer) {
+    const int numItems = 5;
+    persistItems(numItems);
+
+    createStream();
+    createStream();
+    // Only room for one item at a time.
+    producers[1]->setBackfillBufferSize(1);
+
+    auto& bfm0 = producers[0]->getBFM();
+    auto& bfm1 = producers[1]->getBFM();
+    bfm0.backfill(); // Opens the scan
+    bfm1.backfill(); // Joins it
+
+    // Both get key0, only the first stream gets key1.
+    bfm0.backfill();
+    EXPECT_TRUE(producers[1]->getBackfillBufferFullStatus());
+    EXPECT_EQ(3u, streams[0]->public_readyQ().size());
+    EXPECT_EQ(2u, streams[1]->public_readyQ().size());
+
+    // The second backfill cannot run with its buffer full, and the first
+    // cannot get anywhere as the scan is paused for the second stream.
+    bfm1.backfill();
+    bfm0.backfill();
+    EXPECT_EQ(1u, producers[0]->getNumSnoozingBackfills());
+    EXPECT_EQ(3u, streams[0]->public_readyQ().size());
+    EXPECT_EQ(2u, streams[1]->public_readyQ().size());
+
+    // Draining the second stream lets its backfill resume the scan, which
+    // feeds the (still snoozing) first stream too.
+    producers[1]->setBackfillBufferSize(
+            engine->getConfiguration().getDcpBackfillByteLimit());
+    streams[1]->consumeBackfillItems(/*snapshot*/ 1 + /*mutation*/ 1);
+    EXPECT_FALSE(producers[1]->getBackfillBufferFullStatus());
+    runBackfill(1);
+    expectBackfilled(*streams[1], false, 1, numItems);
+
+    TimeTraveller marty(2);
+    runBackfill(0);
+    expectBackfilled(*streams[0], true, 0, numItems);
+}
+
+/*
+ * A backfill which starts after a scan of the same snapshot has read past
+ * its start reads with its own scan, then moves onto the other scan once it
+ * has caught up with it.
+ */
+TEST_F(SharedBackfillScanTest, LateJoinerMerges) {
+    engine->getConfiguration().setDcpScanItemLimit(2);
+    const int numItems = 10;
+    persistItems(numItems);
+
+    auto& connMap = engine->getDcpConnMap();
+    const size_t joinedBefore = connMap.getBackfillScansJoined();
+
+    createStream();
+    auto& bfm0 = producers[0]->getBFM();
+    bfm0.backfill(); // Opens the scan
+    bfm0.backfill(); // key0 & key1
+
+    // Too late to join; opens its own scan of the same snapshot.
+    createStream();
+    auto& bfm1 = producers[1]->getBFM();
+    bfm1.backfill();
+    EXPECT_EQ(0u, connMap.getBackfillScansJoined() - joinedBefore);
+    bfm1.backfill(); // key0 & key1
+    bfm1.backfill(); // Merges, then key2 & key3 for both streams
+    EXPECT_EQ(1u, connMap.getBackfillScansJoined() - joinedBefore);
+    EXPECT_EQ(5u, streams[0]->public_readyQ().size());
+    EXPECT_EQ(5u, streams[1]->public_readyQ().size());
+
+    runBackfill(0);
+    runBackfill(1);
+    for (auto& stream : streams) {
+        expectBackfilled(*stream, true, 0, numItems);
+    }
+}
+
+/*
+ * A backfill joining a scan part way through is only expecting the items the
+ * scan has still to read, not the whole snapshot.
+ */
+TEST_F(SharedBackfillScanTest, JoinMidScanItemsRemaining) {
+    engine->getConfiguration().setDcpScanItemLimit(2);
+    const int numItems = 10;
+    persistItems(numItems);
+
+    auto& connMap = engine->getDcpConnMap();
+    const size_t joinedBefore = connMap.getBackfillScansJoined();
+
+    createStream();
+    auto& bfm0 = producers[0]->getBFM();
+    bfm0.backfill(); // Opens the scan
+    bfm0.backfill(); // key0 & key1
+    EXPECT_EQ(numItems, streams[0]->getNumBackfillItemsRemaining());
+
+    // Starts at the scan's position, so can join it.
+    createStream(/*startSeqno*/ 2);
+    producers[1]->getBFM().backfill();
+    EXPECT_EQ(1u, connMap.getBackfillScansJoined() - joinedBefore);
+    EXPECT_EQ(numItems - 2, streams[1]->getNumBackfillItemsRemaining());
+
+    runBackfill(0);
+    runBackfill(1);
+    expectBackfilled(*streams[0], true, 0, numItems);
+    expectBackfilled(*streams[1], true, 2, numItems);
+}
+
 /* Regression / reproducer test for MB-19815 - an exception is thrown
  * (and connection disconnected) if a couchstore file hasn't been re-created
  * yet when doDcpVbTakeoverStats() is called.
@@ -1120,6 +1411,66 @@ TEST_F(SingleThreadedEPBucketTest, MB18452_yield_dcp_processor) {
     consumer->closeStream(/*opaque*/0, vbid);
 }
 
+/*
+ * Test that a consumer with several processor workers keeps exactly one task
+ * per worker, when one worker's task goes away on its own and when all of
+ * them are cancelled.
+ */
+TEST_F(SingleThreadedEPBucketTest, dcp_consumer_processor_worker_tasks) {
+    engine->getConfiguration().setDcpConsumerProcessBufferedMessagesWorkers(2);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_replica);
+
+    auto consumer = std::make_shared<MockDcpConsumer>(*engine, cookie, "test");
+    ASSERT_EQ(2u, consumer->getNumProcessorWorkers());
+
+    // Returns the ids of the (not cancelled) processor tasks
+    auto processorTasks = [this]() {
+        std::vector<size_t> ids;
+        for (auto& entry : task_executor->getTaskLocator()) {
+            auto& task = entry.second.first;
+            if (task->getTypeId() == TaskId::DcpConsumerTask &&
+                !task->isdead()) {
+                ids.push_back(task->getId());
+            }
+        }
+        return ids;
+    };
+
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->addStream(/*opaque*/ 0, vbid, /*flags*/ 0));
+    auto tasks = processorTasks();
+    ASSERT_EQ(2u, tasks.size());
+
+    // One worker's task finishes by itself (as if its run() returned false);
+    // run it so that it is destroyed.
+    ExecutorPool::get()->cancel(tasks.front());
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    while (task_executor->getTaskLocator().count(tasks.front())) {
+        runNextTask(lpNonioQ);
+    }
+    EXPECT_EQ(1u, processorTasks().size());
+
+    // Adding a stream only replaces the missing task
+    EXPECT_EQ(ENGINE_SUCCESS, consumer->closeStream(/*opaque*/ 0, vbid));
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->addStream(/*opaque*/ 0, vbid, /*flags*/ 0));
+    EXPECT_EQ(2u, processorTasks().size());
+
+    // Cancelling stops every worker's task...
+    consumer->cancelTask();
+    EXPECT_EQ(0u, processorTasks().size());
+
+    // ... and the next stream starts exactly one task per worker again
+    EXPECT_EQ(ENGINE_SUCCESS, consumer->closeStream(/*opaque*/ 0, vbid));
+    ASSERT_EQ(ENGINE_SUCCESS,
+              consumer->addStream(/*opaque*/ 0, vbid, /*flags*/ 0));
+    EXPECT_EQ(2u, processorTasks().size());
+
+    consumer->cancelTask();
+    EXPECT_EQ(0u, processorTasks().size());
+    consumer->closeStream(/*opaque*/ 0, vbid);
+}
+
 /*
  * Background thread used by MB20054_onDeleteItem_during_bucket_deletion
  */
@@ -1860,3 +2211,116 @@ TEST_F(SingleThreadedEPBucketTest, mb25273) {
     EXPECT_EQ(3, gv.item->getCas());
     EXPECT_EQ(value.size(), gv.item->getValue()->valueSize());
 }
+
+/**
+ * Test fixture for the compaction scheduler: compaction requests are queued
+ * and started (most fragmented file first) while fewer than
+ * compaction_max_concurrent are running.
+ */
+class CompactionSchedulerTest : public SingleThreadedEPBucketTest {
+protected:
+    void SetUp() override {
+        SingleThreadedEPBucketTest::SetUp();
+        // Read heavy workloads only ever run one compaction at a time.
+        engine->getWorkLoadPolicy().setWorkLoadPattern(WRITE_HEAVY);
+    }
+
+    /// Activate vb and flush numVersions versions of one document to it.
+    void writeVersions(uint16_t vb, int numVersions) {
+        setVBucketStateAndRunPersistTask(vb, vbucket_state_active);
+        for (int ii = 0; ii < numVersions; ii++) {
+            store_item(vb, makeStoredDocKey("key"), std::string(1024, 'x'));
+            EXPECT_EQ(1, getEPBucket().flushVBucket(vb));
+        }
+    }
+
+    double getFragmentation(uint16_t vb) {
+        const auto info =
+                store->getRWUnderlying(vb)->getCachedDbFileInfo(vb);
+        return double(info.fileSize - info.spaceUsed) / info.fileSize;
+    }
+
+    /// Request a compaction of vb, as the CMD_COMPACT_DB handler does.
+    void scheduleCompaction(uint16_t vb) {
+        compaction_ctx ctx{};
+        ctx.db_file_id = vb;
+        ++engine->getEpStats().pendingCompactions;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  store->scheduleCompaction(vb, ctx, nullptr /*cookie*/));
+    }
+
+    size_t getQueuedWriterTasks() {
+        auto& lpWriterQ = *task_executor->getLpTaskQ()[WRITER_TASK_IDX];
+        return lpWriterQ.getFutureQueueSize() + lpWriterQ.getReadyQueueSize();
+    }
+
+    size_t getRunningCompactions() {
+        return engine->getEpStats().runningCompactions;
+    }
+};
+
+// Queued compactions start in order of decreasing fragmentation, not in the
+// order they were requested.
+TEST_F(CompactionSchedulerTest, MostFragmentedFirst) {
+    engine->getConfiguration().setCompactionMaxConcurrent(1);
+    writeVersions(0, 1);
+    writeVersions(1, 10);
+    writeVersions(2, 4);
+    ASSERT_LT(getFragmentation(0), getFragmentation(2));
+    ASSERT_LT(getFragmentation(2), getFragmentation(1));
+
+    // vb:0 has the only slot, the others wait.
+    scheduleCompaction(0);
+    scheduleCompaction(2);
+    scheduleCompaction(1);
+    EXPECT_EQ(1, getRunningCompactions());
+    EXPECT_EQ(3, engine->getEpStats().pendingCompactions.load());
+    EXPECT_EQ(1, getQueuedWriterTasks());
+
+    auto& lpWriterQ = *task_executor->getLpTaskQ()[WRITER_TASK_IDX];
+    runNextTask(lpWriterQ, "Compact DB file 0");
+    EXPECT_EQ(1, getRunningCompactions());
+    runNextTask(lpWriterQ, "Compact DB file 1");
+    EXPECT_EQ(1, getRunningCompactions());
+    runNextTask(lpWriterQ, "Compact DB file 2");
+    EXPECT_EQ(0, getRunningCompactions());
+    EXPECT_EQ(0, engine->getEpStats().pendingCompactions.load());
+    EXPECT_EQ(0, getQueuedWriterTasks());
+}
+
+// No more than compaction_max_concurrent compactions run at once; raising
+// the limit starts queued ones straight away.
+TEST_F(CompactionSchedulerTest, MaxConcurrent) {
+    engine->getConfiguration().setCompactionMaxConcurrent(2);
+    for (uint16_t vb = 0; vb < 5; vb++) {
+        writeVersions(vb, 1);
+        scheduleCompaction(vb);
+    }
+    EXPECT_EQ(2, getRunningCompactions());
+    EXPECT_EQ(2, getQueuedWriterTasks());
+
+    engine->getConfiguration().setCompactionMaxConcurrent(3);
+    EXPECT_EQ(3, getRunningCompactions());
+    EXPECT_EQ(3, getQueuedWriterTasks());
+
+    // A finished compaction hands its slot to a queued one.
+    auto& lpWriterQ = *task_executor->getLpTaskQ()[WRITER_TASK_IDX];
+    runNextTask(lpWriterQ);
+    EXPECT_EQ(3, getRunningCompactions());
+    EXPECT_EQ(3, getQueuedWriterTasks());
+
+    // While the workload is read heavy the limit drops to one, so the last
+    // queued compaction only starts once the running ones have finished.
+    engine->getWorkLoadPolicy().setWorkLoadPattern(READ_HEAVY);
+    runNextTask(lpWriterQ);
+    EXPECT_EQ(2, getRunningCompactions());
+    runNextTask(lpWriterQ);
+    EXPECT_EQ(1, getRunningCompactions());
+    runNextTask(lpWriterQ);
+    EXPECT_EQ(1, getRunningCompactions());
+    EXPECT_EQ(1, getQueuedWriterTasks());
+    runNextTask(lpWriterQ);
+    EXPECT_EQ(0, getRunningCompactions());
+    EXPECT_EQ(0, getQueuedWriterTasks());
+    EXPECT_EQ(0, engine->getEpStats().pendingCompactions.load());
+}
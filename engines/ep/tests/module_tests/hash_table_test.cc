@@ -17,6 +17,7 @@
 
 #include "config.h"
 
+#include "collections/vbucket_stats.h"
 #include "item.h"
 #include "kv_bucket.h"
 #include "programs/engine_testapp/mock_server.h"
@@ -31,6 +32,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <random>
 #include <signal.h>
 
 EPStats global_stats;
@@ -581,6 +583,132 @@ TEST_F(HashTableTest, ItemAge) {
     EXPECT_EQ(1, v->getValue()->getAge());
 }
 
+// Under full eviction a collection's items are counted by the flusher, so
+// the HashTable leaves them alone: ejecting a document counts as an eviction
+// and releases its memory, and removing a temporary item only releases its
+// memory.
+TEST_F(HashTableTest, CollectionStatsFullEviction) {
+    Collections::VB::StatsMap collectionStats(
+            Collections::VB::StatsMap::ItemCounting::Disk);
+    HashTable ht(global_stats, makeFactory(), 5, 1, &collectionStats);
+    StoredDocKey key = makeStoredDocKey("key");
+    Item item(key, 0, 0, "value", strlen("value"));
+    ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    ASSERT_EQ(0, collectionStats.get("$default").items);
+    ASSERT_LT(0, collectionStats.get("$default").memUsed);
+
+    // As the flusher would once the item is persisted.
+    collectionStats.persisted(key, 1);
+    ASSERT_EQ(1, collectionStats.get("$default").items);
+
+    StoredValue* v(ht.find(key, TrackReference::No, WantsDeleted::No));
+    ASSERT_NE(nullptr, v);
+    v->markClean();
+    EXPECT_TRUE(ht.unlocked_ejectItem(v, FULL_EVICTION));
+    auto stats = collectionStats.get("$default");
+    EXPECT_EQ(1, stats.items);
+    EXPECT_EQ(0, stats.memUsed);
+    EXPECT_EQ(1u, stats.evicted);
+
+    // Add a temporary item (as a background fetch would) and eject it.
+    Item tempInitItem(key,
+                      0,
+                      0,
+                      nullptr,
+                      0,
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0,
+                      StoredValue::state_temp_init);
+    {
+        auto hbl = ht.getLockedBucket(key);
+        v = ht.unlocked_addNewStoredValue(hbl, tempInitItem);
+        ASSERT_NE(nullptr, v);
+    }
+    stats = collectionStats.get("$default");
+    EXPECT_EQ(1, stats.items);
+    EXPECT_LT(0, stats.memUsed);
+
+    v->markClean();
+    EXPECT_TRUE(ht.unlocked_ejectItem(v, FULL_EVICTION));
+    stats = collectionStats.get("$default");
+    EXPECT_EQ(1, stats.items);
+    EXPECT_EQ(0, stats.memUsed);
+    EXPECT_EQ(1u, stats.evicted);
+}
+
+// Check compressing a value in place keeps the HashTable stats and the
+// item's frequency counter correct.
+TEST_F(HashTableTest, CompressValue) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    StoredDocKey key = makeStoredDocKey("key");
+    const std::string value(1000, 'a');
+    Item item(key, 0, 0, value.data(), value.size());
+    ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+
+    StoredValue* v(ht.find(key, TrackReference::No, WantsDeleted::No));
+    ASSERT_NE(nullptr, v);
+    v->setFreqCounterValue(5);
+    const size_t memBefore = ht.getItemMemory();
+    const size_t cacheBefore = ht.cacheSize.load();
+
+    auto hbl = ht.getLockedBucket(key);
+    EXPECT_TRUE(ht.unlocked_compressValue(hbl, *v, 0.85));
+    EXPECT_TRUE(mcbp::datatype::is_snappy(v->getDatatype()));
+    EXPECT_LT(v->valuelen(), value.size() * 0.85);
+    EXPECT_EQ(5, v->getFreqCounterValue());
+    EXPECT_FALSE(v->isIncompressible());
+
+    const size_t saved = value.size() - v->valuelen();
+    EXPECT_EQ(memBefore - saved, ht.getItemMemory());
+    EXPECT_EQ(cacheBefore - saved, ht.cacheSize.load());
+    EXPECT_EQ(0, ht.datatypeCounts[PROTOCOL_BINARY_RAW_BYTES]);
+    EXPECT_EQ(1, ht.datatypeCounts[PROTOCOL_BINARY_DATATYPE_SNAPPY]);
+
+    // Already compressed - nothing more to do.
+    EXPECT_FALSE(ht.unlocked_compressValue(hbl, *v, 0.85));
+
+    // The value still reads back as the original.
+    auto fetched = v->toItem(false, 0);
+    EXPECT_TRUE(fetched->decompressValue());
+    EXPECT_EQ(value, std::string(fetched->getData(), fetched->getNBytes()));
+}
+
+// Values which don't meet the ratio are left alone and flagged, until the
+// value changes.
+TEST_F(HashTableTest, CompressValueIncompressible) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    StoredDocKey key = makeStoredDocKey("key");
+    std::string value(1000, '\0');
+    std::mt19937 gen(1);
+    for (auto& c : value) {
+        c = char(gen());
+    }
+    Item item(key, 0, 0, value.data(), value.size());
+    ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+
+    StoredValue* v(ht.find(key, TrackReference::No, WantsDeleted::No));
+    ASSERT_NE(nullptr, v);
+    const size_t memBefore = ht.getItemMemory();
+
+    auto hbl = ht.getLockedBucket(key);
+    EXPECT_FALSE(ht.unlocked_compressValue(hbl, *v, 0.85));
+    EXPECT_TRUE(v->isIncompressible());
+    EXPECT_EQ(PROTOCOL_BINARY_RAW_BYTES, v->getDatatype());
+    EXPECT_EQ(value.size(), v->valuelen());
+    EXPECT_EQ(memBefore, ht.getItemMemory());
+
+    // The flag and the frequency counter share the value pointer's tag;
+    // neither may disturb the other.
+    v->setFreqCounterValue(7);
+    EXPECT_TRUE(v->isIncompressible());
+    EXPECT_EQ(7, v->getFreqCounterValue());
+
+    // A new value has not been tried yet.
+    Item item2(key, 0, 0, "value2", strlen("value2"));
+    ht.unlocked_updateStoredValue(hbl.getHTLock(), *v, item2);
+    EXPECT_FALSE(v->isIncompressible());
+}
+
 // Check not specifying results in the INITIAL_NRU_VALUE.
 TEST_F(HashTableTest, NRUDefault) {
     // Setup
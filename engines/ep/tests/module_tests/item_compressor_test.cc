@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the ItemCompressorTask and ItemCompressorVisitor.
+ */
+
+#include "ep_engine.h"
+#include "kv_bucket.h"
+#include "stats_test.h"
+#include "test_helpers.h"
+#include "vbucket.h"
+
+#include <random>
+
+class ItemCompressorTest : public StatTest {
+protected:
+    void SetUp() override {
+        StatTest::SetUp();
+        engine->setCompressionMode("active");
+    }
+
+    StoredValue* findValue(const std::string& key) {
+        return store->getVBucket(vbid)->ht.find(
+                makeStoredDocKey(key), TrackReference::No, WantsDeleted::No);
+    }
+
+    size_t getStat(const std::string& name) {
+        return std::stoull(get_stat(nullptr)[name]);
+    }
+
+    // A value which Snappy can shrink well below the default ratio.
+    const std::string compressible = std::string(1024, 'a');
+
+    // Random bytes, which Snappy can't shrink at all.
+    std::string makeIncompressible() {
+        std::mt19937 gen(1234);
+        std::uniform_int_distribution<int> dist(0, 255);
+        std::string value(1024, '\0');
+        for (auto& c : value) {
+            c = static_cast<char>(dist(gen));
+        }
+        return value;
+    }
+};
+
+// Nothing is compressed unless the bucket's compression_mode is active.
+TEST_F(ItemCompressorTest, OnlyWhenModeActive) {
+    store_item(vbid, makeStoredDocKey("key"), compressible);
+
+    for (const auto* mode : {"off", "passive"}) {
+        engine->setCompressionMode(mode);
+        store->runItemCompressorTask();
+        EXPECT_FALSE(mcbp::datatype::is_snappy(findValue("key")->getDatatype()))
+                << mode;
+        EXPECT_EQ(0, getStat("ep_item_compressor_num_visited")) << mode;
+    }
+
+    engine->setCompressionMode("active");
+    store->runItemCompressorTask();
+    auto* v = findValue("key");
+    EXPECT_TRUE(mcbp::datatype::is_snappy(v->getDatatype()));
+    EXPECT_LT(v->valuelen(), compressible.size());
+
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_visited"));
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_compressed"));
+    EXPECT_EQ(0, getStat("ep_item_compressor_num_incompressible"));
+    EXPECT_EQ(compressible.size() - v->valuelen(),
+              getStat("ep_item_compressor_bytes_saved"));
+}
+
+// Values which have been read since they were stored are left alone until
+// the item pager ages them again.
+TEST_F(ItemCompressorTest, SkipsRecentlyReferenced) {
+    store_item(vbid, makeStoredDocKey("hot"), compressible);
+    store_item(vbid, makeStoredDocKey("cold"), compressible);
+    findValue("hot")->setNRUValue(MIN_NRU_VALUE);
+
+    store->runItemCompressorTask();
+    EXPECT_FALSE(mcbp::datatype::is_snappy(findValue("hot")->getDatatype()));
+    EXPECT_TRUE(mcbp::datatype::is_snappy(findValue("cold")->getDatatype()));
+    EXPECT_EQ(2, getStat("ep_item_compressor_num_visited"));
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_compressed"));
+
+    // Once aged, the next pass picks it up.
+    findValue("hot")->setNRUValue(INITIAL_NRU_VALUE);
+    store->runItemCompressorTask();
+    EXPECT_TRUE(mcbp::datatype::is_snappy(findValue("hot")->getDatatype()));
+    EXPECT_EQ(4, getStat("ep_item_compressor_num_visited"));
+    EXPECT_EQ(2, getStat("ep_item_compressor_num_compressed"));
+}
+
+// Values which miss the ratio are tagged incompressible and not retried;
+// the tag goes away when the value is replaced.
+TEST_F(ItemCompressorTest, IncompressibleTagged) {
+    const auto value = makeIncompressible();
+    store_item(vbid, makeStoredDocKey("key"), value);
+
+    store->runItemCompressorTask();
+    auto* v = findValue("key");
+    EXPECT_FALSE(mcbp::datatype::is_snappy(v->getDatatype()));
+    EXPECT_TRUE(v->isIncompressible());
+    EXPECT_EQ(value.size(), v->valuelen());
+    EXPECT_EQ(0, getStat("ep_item_compressor_num_compressed"));
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_incompressible"));
+    EXPECT_EQ(0, getStat("ep_item_compressor_bytes_saved"));
+
+    // A second pass doesn't count (or retry) it again.
+    store->runItemCompressorTask();
+    EXPECT_EQ(2, getStat("ep_item_compressor_num_visited"));
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_incompressible"));
+
+    // A new value is a candidate again.
+    store_item(vbid, makeStoredDocKey("key"), compressible);
+    EXPECT_FALSE(findValue("key")->isIncompressible());
+    store->runItemCompressorTask();
+    EXPECT_TRUE(mcbp::datatype::is_snappy(findValue("key")->getDatatype()));
+    EXPECT_EQ(1, getStat("ep_item_compressor_num_compressed"));
+}
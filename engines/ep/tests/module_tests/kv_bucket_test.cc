@@ -653,6 +653,57 @@ TEST_P(KVBucketParamTest, SetWithMeta_Forced) {
                                  /*allowExisting*/ false));
 }
 
+// Test that setWithMetaBatch applies replicated mutations in the same way as
+// individual setWithMeta calls, but queues them with a single checkpoint
+// update.
+TEST_P(KVBucketParamTest, SetWithMetaBatch) {
+    store->setVBucketState(vbid, vbucket_state_replica, false);
+    auto vb = store->getVBucket(vbid);
+    vb->checkpointManager->createSnapshot(1, 4);
+
+    std::vector<Item> items;
+    items.push_back(make_item(vbid, makeStoredDocKey("a"), "value1"));
+    items.push_back(make_item(vbid, makeStoredDocKey("b"), "value2"));
+    items.push_back(make_item(vbid, makeStoredDocKey("a"), "value3"));
+    items.push_back(make_item(vbid, makeStoredDocKey("c"), "value4"));
+    std::vector<Item*> batch;
+    for (size_t ii = 0; ii < items.size(); ++ii) {
+        items[ii].setBySeqno(ii + 1);
+        items[ii].setCas(ii + 1);
+        batch.push_back(&items[ii]);
+    }
+    // An invalid CAS stops the batch at that item
+    items[3].setCas(0);
+
+    const auto version = vb->checkpointManager->getPublishedVersion();
+    size_t applied = 0;
+    EXPECT_EQ(ENGINE_KEY_EEXISTS,
+              store->setWithMetaBatch(
+                      vbid, batch, cookie, {vbucket_state_replica}, applied));
+    EXPECT_EQ(3u, applied);
+    EXPECT_EQ(version + 1, vb->checkpointManager->getPublishedVersion());
+    EXPECT_EQ(3, vb->getHighSeqno());
+    // "a" is de-duplicated in the checkpoint
+    EXPECT_EQ(2u, vb->checkpointManager->getNumOpenChkItems());
+
+    auto* sv = vb->ht.find(
+            makeStoredDocKey("a"), TrackReference::No, WantsDeleted::No);
+    ASSERT_NE(nullptr, sv);
+    EXPECT_EQ("value3", sv->getValue()->to_s());
+    EXPECT_EQ(3, sv->getBySeqno());
+    EXPECT_EQ(nullptr,
+              vb->ht.find(makeStoredDocKey("c"),
+                          TrackReference::No,
+                          WantsDeleted::No));
+
+    // Not permitted in the active state
+    store->setVBucketState(vbid, vbucket_state_active, false);
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET,
+              store->setWithMetaBatch(
+                      vbid, batch, cookie, {vbucket_state_replica}, applied));
+    EXPECT_EQ(0u, applied);
+}
+
 // MB and test was raised because a few commits back this was broken but no
 // existing test covered the case. I.e. run this test  against 0810540 and it
 // fails, but now fixed
@@ -21,6 +21,7 @@
 
 #include "callbacks.h"
 #include "couch-kvstore/couch-kvstore.h"
+#include "dictionary_compressor.h"
 #include "kvstore.h"
 #include "kvstore_config.h"
 #include "src/internal.h"
@@ -255,6 +256,187 @@ TEST_F(CouchKVStoreTest, CompressedTest) {
     kvstore->destroyScanContext(scanCtx);
 }
 
+// With persistence_compression_mode=zstd values are written compressed once
+// a dictionary has been trained, and read back uncompressed by get and scan
+// - including by a store which has to load the dictionary from disk.
+TEST_F(CouchKVStoreTest, PersistenceCompression) {
+    if (!DictionaryCompressor::isSupported()) {
+        return;
+    }
+
+    auto makeValue = [](int i) {
+        return "{\"name\":\"user_" + std::to_string(i) +
+               "\",\"city\":\"Springfield\",\"country\":\"US\","
+               "\"active\":true}";
+    };
+    auto storeBatch = [&makeValue](KVStore& kvstore, int first, int last) {
+        kvstore.begin({});
+        WriteCallback wc;
+        for (int i = first; i < last; ++i) {
+            const auto value = makeValue(i);
+            Item item(makeStoredDocKey("key" + std::to_string(i)),
+                      0,
+                      0,
+                      value.data(),
+                      value.size(),
+                      PROTOCOL_BINARY_DATATYPE_JSON,
+                      0,
+                      i + 1);
+            kvstore.set(item, wc);
+        }
+        kvstore.commit(nullptr /*no collections manifest*/);
+    };
+
+    KVStoreConfig config(
+            1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
+    config.setPersistenceCompressionMode("zstd");
+    config.setValueCompressor(std::make_shared<DictionaryCompressor>(3, 1024));
+    auto& compressor = *config.getValueCompressor();
+    auto kvstore = setup_kv_store(config);
+
+    // Values written before there is a dictionary only train it...
+    int first = 0;
+    while (compressor.getCurrentDictionaryId() == 0) {
+        ASSERT_LT(first, 100000) << "dictionary was never trained";
+        storeBatch(*kvstore, first, first + 1000);
+        first += 1000;
+        // No scheduler is set, so train as the DictionaryTrainerTask would.
+        compressor.train();
+    }
+    EXPECT_EQ(0u, compressor.getStats().rawBytes.load());
+    const auto dictId = compressor.getCurrentDictionaryId();
+
+    // ...after which they are compressed.
+    const int last = first + 100;
+    storeBatch(*kvstore, first, last);
+    EXPECT_LT(0u, compressor.getStats().compressedBytes.load());
+    EXPECT_LT(compressor.getStats().compressedBytes.load(),
+              compressor.getStats().rawBytes.load());
+
+    auto checkGets = [&](KVStore& store) {
+        for (int i = first; i < last; ++i) {
+            auto gv = store.get(makeStoredDocKey("key" + std::to_string(i)), 0);
+            ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+            EXPECT_EQ(makeValue(i),
+                      std::string(gv.item->getData(), gv.item->getNBytes()));
+            EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, gv.item->getDataType());
+        }
+    };
+    checkGets(*kvstore);
+
+    // Backfills asking for compressed values get them decompressed (and
+    // flagged as such) too.
+    int scanned = 0;
+    auto cb = std::make_shared<CustomCallback<GetValue>>([&](GetValue gv) {
+        const int i = int(gv.item->getBySeqno()) - 1;
+        EXPECT_EQ(makeValue(i),
+                  std::string(gv.item->getData(), gv.item->getNBytes()));
+        EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, gv.item->getDataType());
+        ++scanned;
+    });
+    auto cl = std::make_shared<KVStoreTestCacheCallback>(first + 1, last, 0);
+    ScanContext* scanCtx = kvstore->initScanContext(cb,
+                                                    cl,
+                                                    0,
+                                                    first + 1,
+                                                    DocumentFilter::ALL_ITEMS,
+                                                    ValueFilter::VALUES_COMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+    EXPECT_EQ(last - first, scanned);
+
+    // A store which has never seen the dictionary (as after a restart)
+    // loads it from the file, and keeps using it for new writes.
+    kvstore.reset();
+    KVStoreConfig config2(
+            1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
+    config2.setPersistenceCompressionMode("zstd");
+    config2.setValueCompressor(std::make_shared<DictionaryCompressor>(3, 1024));
+    auto kvstore2 = KVStoreFactory::create(config2);
+    EXPECT_EQ(dictId, config2.getValueCompressor()->getCurrentDictionaryId());
+    checkGets(*kvstore2.ro);
+}
+
+/// Scan callback recording the seqnos it sees; pauses the scan once.
+class PausingScanCallback : public StatusCallback<GetValue> {
+public:
+    explicit PausingScanCallback(size_t pauseAfter) : pauseAfter(pauseAfter) {
+    }
+
+    void callback(GetValue& gv) override {
+        seqnos.push_back(gv.item->getBySeqno());
+        setStatus(seqnos.size() == pauseAfter ? ENGINE_ENOMEM
+                                              : ENGINE_SUCCESS);
+    }
+
+    const size_t pauseAfter;
+    std::vector<int64_t> seqnos;
+};
+
+// With read-ahead a scan proceeds in windows of the read-ahead budget.
+// Documents must still be delivered in seqno order, exactly once, across
+// windows and across the scan being paused by its callback.
+TEST_F(CouchKVStoreTest, ScanReadAhead) {
+    KVStoreConfig config(
+            1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
+    config.setScanReadAhead(8, 1024 * 1024);
+    auto kvstore = setup_kv_store(config);
+
+    // Interleave the seqnos written by each commit, so file order differs
+    // from seqno order.
+    const int numItems = 100;
+    for (int batch = 0; batch < 4; ++batch) {
+        kvstore->begin({});
+        WriteCallback wc;
+        for (int i = batch; i < numItems; i += 4) {
+            Item item(makeStoredDocKey("key" + std::to_string(i)),
+                      0,
+                      0,
+                      "value",
+                      5,
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0,
+                      i + 1);
+            kvstore->set(item, wc);
+        }
+        kvstore->commit(nullptr /*no collections manifest*/);
+    }
+
+    const size_t pauseAfter = 21;
+    auto cb = std::make_shared<PausingScanCallback>(pauseAfter);
+    auto cl = std::make_shared<KVStoreTestCacheCallback>(1, numItems, 0);
+    ScanContext* scanCtx = kvstore->initScanContext(cb,
+                                                    cl,
+                                                    0,
+                                                    1,
+                                                    DocumentFilter::ALL_ITEMS,
+                                                    ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(scan_again, kvstore->scan(scanCtx));
+    EXPECT_EQ(int64_t(pauseAfter - 1), scanCtx->lastReadSeqno);
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    // The item the callback refused is read again on resume.
+    std::vector<int64_t> expected;
+    for (int64_t seqno = 1; seqno <= numItems; ++seqno) {
+        expected.push_back(seqno);
+        if (seqno == int64_t(pauseAfter)) {
+            expected.push_back(seqno);
+        }
+    }
+    EXPECT_EQ(expected, cb->seqnos);
+
+    std::map<std::string, std::string> stats;
+    kvstore->addStats(add_stat_callback, &stats);
+    EXPECT_EQ(std::to_string(numItems + 1), stats["rw_0:io_scan_docs_read"]);
+    EXPECT_LT(0u, std::stoul(stats["rw_0:io_scan_doc_bytes"]));
+#ifdef POSIX_FADV_WILLNEED
+    EXPECT_LT(0u, std::stoul(stats["rw_0:io_scan_readahead_bytes"]));
+#endif
+}
+
 // Verify the stats returned from operations are accurate.
 TEST_F(CouchKVStoreTest, StatsTest) {
     KVStoreConfig config(
@@ -478,7 +660,10 @@ public:
                                0,
                                false /*persistnamespace*/)
                          .setLogger(logger)
-                         .setBuffered(false)) {
+                         .setBuffered(false)
+                         // Read-ahead does its own index reads ahead of
+                         // the scan's; keep the expected reads exact.
+                         .setScanReadAhead(0, 0)) {
         try {
             cb::io::rmrf(data_dir.c_str());
         } catch (std::system_error& e) {
@@ -1104,7 +1289,11 @@ TEST_F(CouchKVStoreErrorInjectionTest, CompactFailedStatsTest) {
 }
 
 
-class MockCouchRequest : public CouchRequest {
+/**
+ * Handle onto an item queued in a CouchKVStore's commit batch, allowing its
+ * metadata to be altered before it is written.
+ */
+class MockCouchRequest {
 public:
     class MetaData {
     public:
@@ -1129,20 +1318,19 @@ public:
         static const size_t sizeofV2 = 19;
     };
 
-    MockCouchRequest(const Item& it,
-                     uint64_t rev,
-                     MutationRequestCallback& cb,
-                     bool del)
-        : CouchRequest(it, rev, cb, del, false /*persist namespace*/) {
+    MockCouchRequest(CouchCommitBatch& batch, size_t index)
+        : batch(batch), index(index) {
     }
 
-    ~MockCouchRequest() {}
-
     // Update what will be written as 'metadata'
     void writeMetaData(MetaData& meta, size_t size) {
-        std::memcpy(dbDocInfo.rev_meta.buf, &meta, size);
-        dbDocInfo.rev_meta.size = size;
+        std::memcpy(batch.getMetaData(index), &meta, size);
+        batch[index].metaSize = size;
     }
+
+private:
+    CouchCommitBatch& batch;
+    const size_t index;
 };
 
 class MockCouchKVStore : public CouchKVStore {
@@ -1150,8 +1338,8 @@ public:
     MockCouchKVStore(KVStoreConfig& config) : CouchKVStore(config) {
     }
 
-    // Mocks original code but returns the IORequest for fuzzing
-    MockCouchRequest* setAndReturnRequest(
+    // Mocks original code but returns the queued request for fuzzing
+    std::unique_ptr<MockCouchRequest> setAndReturnRequest(
             const Item& itm,
             Callback<TransactionContext, mutation_result>& cb) {
         if (isReadOnly()) {
@@ -1165,13 +1353,9 @@ public:
 
         bool deleteItem = false;
         MutationRequestCallback requestcb;
-        uint64_t fileRev = dbFileRevMap[itm.getVBucketId()];
-
-        // each req will be de-allocated after commit
         requestcb.setCb = &cb;
-        MockCouchRequest *req = new MockCouchRequest(itm, fileRev, requestcb, deleteItem);
-        pendingReqsQ.push_back(req);
-        return req;
+        const size_t index = pendingReqsQ.add(itm, requestcb, deleteItem);
+        return std::make_unique<MockCouchRequest>(pendingReqsQ, index);
     }
 
     bool compactDBInternal(compaction_ctx* hook_ctx,
@@ -1652,6 +1836,109 @@ TEST_F(CouchstoreTest, testV2CompactionUpgrade) {
     gc.callback(gv);
 }
 
+// Check that the commit batch lays out items correctly, and that existence
+// marking (used for insert vs update / delete results) finds every entry for
+// a key, including duplicates.
+TEST(CouchCommitBatchTest, PrepareAndMarkExisting) {
+    auto str = [](const sized_buf& buf) {
+        return std::string(buf.buf, buf.size);
+    };
+    CouchCommitBatch batch(false /*persistDocNamespace*/);
+    MutationRequestCallback requestcb;
+    requestcb.setCb = nullptr;
+
+    Item b(makeStoredDocKey("b"), 0, 0, "value", 5);
+    b.setBySeqno(1);
+    Item a(makeStoredDocKey("a"), 0, 0, "value", 5);
+    a.setBySeqno(2);
+    Item c(makeStoredDocKey("c"), 0, 0, value_t{});
+    c.setBySeqno(3);
+    c.setDeleted();
+    batch.add(b, requestcb, false);
+    batch.add(a, requestcb, false);
+    batch.add(c, requestcb, true);
+    batch.add(a, requestcb, false);
+    ASSERT_EQ(4u, batch.size());
+
+    batch.prepare();
+
+    // Doc / DocInfo point at the arena and values.
+    EXPECT_EQ("b", str(batch[0].docInfo.id));
+    EXPECT_EQ("value", str(batch[0].doc.data));
+    EXPECT_EQ(1u, batch[0].docInfo.db_seq);
+    EXPECT_EQ(MetaData::getMetaDataSize(MetaData::Version::V1),
+              batch[0].docInfo.rev_meta.size);
+    EXPECT_EQ(1, batch[2].docInfo.deleted);
+    EXPECT_EQ(nullptr, batch.getDocs()[2]);
+    EXPECT_EQ(&batch[1].docInfo, batch.getDocInfos()[1]);
+
+    // Ids are handed to couchstore sorted.
+    const auto& ids = batch.getSortedIds();
+    ASSERT_EQ(4u, ids.size());
+    EXPECT_EQ("a", str(ids[0]));
+    EXPECT_EQ("a", str(ids[1]));
+    EXPECT_EQ("b", str(ids[2]));
+    EXPECT_EQ("c", str(ids[3]));
+
+    std::string key = "a";
+    batch.markExisting({&key[0], key.size()});
+    EXPECT_FALSE(batch[0].existed);
+    EXPECT_TRUE(batch[1].existed);
+    EXPECT_FALSE(batch[2].existed);
+    EXPECT_TRUE(batch[3].existed);
+
+    // Clearing allows reuse for the next commit.
+    batch.clear();
+    EXPECT_TRUE(batch.empty());
+    batch.add(c, requestcb, true);
+    batch.prepare();
+    EXPECT_EQ("c", str(batch[0].docInfo.id));
+    EXPECT_FALSE(batch[0].existed);
+}
+
+// Check that the capacity kept after a one-off large commit is released once
+// the following commits are much smaller.
+TEST(CouchCommitBatchTest, ShrinkAfterPeak) {
+    CouchCommitBatch batch(false /*persistDocNamespace*/);
+    MutationRequestCallback requestcb;
+    requestcb.setCb = nullptr;
+
+    auto commit = [&batch, &requestcb](int items) {
+        for (int ii = 0; ii < items; ++ii) {
+            Item item(makeStoredDocKey("key" + std::to_string(ii)),
+                      0,
+                      0,
+                      "value",
+                      5);
+            item.setBySeqno(ii + 1);
+            batch.add(item, requestcb, false);
+        }
+        batch.prepare();
+        batch.clear();
+    };
+
+    commit(1);
+    const size_t small = batch.getAllocatedSize();
+    commit(10000);
+    const size_t peak = batch.getAllocatedSize();
+    ASSERT_GT(peak, small * 100);
+
+    // Capacity is kept for a while, so a store with bursts of large commits
+    // doesn't keep reallocating...
+    commit(1);
+    EXPECT_EQ(peak, batch.getAllocatedSize());
+
+    // ...but is released once a whole check interval used much less of it.
+    for (int ii = 0; ii < 128; ++ii) {
+        commit(1);
+    }
+    EXPECT_LT(batch.getAllocatedSize(), peak / 100);
+
+    // The batch remains usable.
+    commit(2);
+    EXPECT_TRUE(batch.empty());
+}
+
 class CouchKVStoreMetaData : public ::testing::Test {
 };
 
@@ -1660,6 +1947,8 @@ TEST_F(CouchKVStoreMetaData, basic) {
     EXPECT_EQ(16, MetaData::getMetaDataSize(MetaData::Version::V0));
     EXPECT_EQ(16 + 2, MetaData::getMetaDataSize(MetaData::Version::V1));
     EXPECT_EQ(16 + 2 + 1, MetaData::getMetaDataSize(MetaData::Version::V2));
+    EXPECT_EQ(16 + 2 + 1 + 1,
+              MetaData::getMetaDataSize(MetaData::Version::V3));
 }
 
 TEST_F(CouchKVStoreMetaData, overlay) {
@@ -1683,8 +1972,18 @@ TEST_F(CouchKVStoreMetaData, overlay) {
     metadata = MetaDataFactory::createMetaData(meta);
     EXPECT_EQ(MetaData::Version::V1, metadata->getVersionInitialisedFrom());
 
-    // Buffers too large and small
+    // A 20 byte (v3) meta carries the body compression
     data.resize(16 + 2 + 1 + 1);
+    data[19] = 1;
+    meta.buf = data.data();
+    meta.size = data.size();
+    metadata = MetaDataFactory::createMetaData(meta);
+    EXPECT_EQ(MetaData::Version::V3, metadata->getVersionInitialisedFrom());
+    EXPECT_EQ(MetaData::Compression::ZstdDictionary,
+              metadata->getCompression());
+
+    // Buffers too large and small
+    data.resize(16 + 2 + 1 + 1 + 1);
     meta.buf = data.data();
     meta.size = data.size();
     EXPECT_THROW(MetaDataFactory::createMetaData(meta), std::logic_error);
@@ -1780,6 +2079,35 @@ TEST_F(CouchKVStoreMetaData, writeToOverlay) {
     delete [] out.buf;
 }
 
+// Compressed documents are written with V3 metadata; all V1 fields must
+// survive alongside the compression.
+TEST_F(CouchKVStoreMetaData, writeV3) {
+    auto metadata = MetaDataFactory::createMetaData();
+    metadata->setCas(0xf00f00ull);
+    metadata->setExptime(0xcafe1234);
+    metadata->setFlags(0xc0115511);
+    metadata->setDataType(PROTOCOL_BINARY_DATATYPE_JSON);
+    metadata->setCompression(MetaData::Compression::ZstdDictionary);
+
+    std::vector<char> data(MetaData::getMetaDataSize(MetaData::Version::V3));
+    sized_buf out{data.data(), data.size()};
+    metadata->copyToBuf(out);
+    EXPECT_EQ(0, data[MetaData::getMetaDataSize(MetaData::Version::V1)]);
+
+    metadata = MetaDataFactory::createMetaData(out);
+    EXPECT_EQ(MetaData::Version::V3, metadata->getVersionInitialisedFrom());
+    EXPECT_EQ(0xf00f00ull, metadata->getCas());
+    EXPECT_EQ(0xcafe1234, metadata->getExptime());
+    EXPECT_EQ(0xc0115511, metadata->getFlags());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, metadata->getDataType());
+    EXPECT_EQ(MetaData::Compression::ZstdDictionary,
+              metadata->getCompression());
+
+    // V2 (or any other size) is not a valid output format.
+    out.size = MetaData::getMetaDataSize(MetaData::Version::V2);
+    EXPECT_THROW(metadata->copyToBuf(out), std::invalid_argument);
+}
+
 //
 // Test that assignment operates as expected (we use this in edit_docinfo_hook)
 //
@@ -2016,6 +2344,86 @@ TEST_P(KVStoreParamTest, DelVBucketConcurrentOperationsTest) {
     t3.join();
 }
 
+// Test that a getMulti returns all of the items in the batch, and
+// ENOENT for the keys which don't exist
+TEST_P(KVStoreParamTest, GetMulti) {
+    WriteCallback wc;
+    kvstore->begin({});
+    for (int ii = 0; ii < 3; ++ii) {
+        Item item(makeStoredDocKey("key" + std::to_string(ii)),
+                  0 /*flags*/,
+                  0 /*exptime*/,
+                  "value",
+                  5 /*nb*/,
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0 /*cas*/,
+                  ii + 1 /*bySeqno*/);
+        kvstore->set(item, wc);
+    }
+    ASSERT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    vb_bgfetch_queue_t itms;
+    for (const auto& key : {"key0", "key2", "missing"}) {
+        vb_bgfetch_item_ctx_t ctx;
+        ctx.isMetaOnly = GetMetaOnly::No;
+        itms[makeStoredDocKey(key)] = std::move(ctx);
+    }
+    kvstore->getMulti(0 /*vbid*/, itms);
+
+    checkGetValue(itms[makeStoredDocKey("key0")].value);
+    checkGetValue(itms[makeStoredDocKey("key2")].value);
+    checkGetValue(itms[makeStoredDocKey("missing")].value, ENGINE_KEY_ENOENT);
+}
+
+// Test that a scan only returns the latest version of items which were
+// updated after they were first persisted, when the scan spans multiple
+// batches of documents.
+TEST_P(KVStoreParamTest, ScanSkipsUpdatedItems) {
+    WriteCallback wc;
+    const int numKeys = 150;
+    int64_t seqno = 1;
+    for (int round = 0; round < 2; ++round) {
+        kvstore->begin({});
+        for (int ii = 0; ii < numKeys; ++ii) {
+            Item item(makeStoredDocKey("key" + std::to_string(ii)),
+                      0 /*flags*/,
+                      0 /*exptime*/,
+                      "value",
+                      5 /*nb*/,
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0 /*cas*/,
+                      seqno++);
+            kvstore->set(item, wc);
+        }
+        ASSERT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+
+    std::map<std::string, int64_t> scanned;
+    auto cb = std::make_shared<CustomCallback<GetValue>>(
+            [&scanned](GetValue gv) {
+                const auto& key = gv.item->getKey();
+                const std::string name(
+                        reinterpret_cast<const char*>(key.data()), key.size());
+                EXPECT_EQ(0, scanned.count(name)) << name;
+                scanned[name] = gv.item->getBySeqno();
+            });
+    auto cl = std::make_shared<CustomCallback<CacheLookup>>();
+    auto* scanCtx = kvstore->initScanContext(cb,
+                                             cl,
+                                             0 /*vbid*/,
+                                             1 /*startSeqno*/,
+                                             DocumentFilter::ALL_ITEMS,
+                                             ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    ASSERT_EQ(size_t(numKeys), scanned.size());
+    for (int ii = 0; ii < numKeys; ++ii) {
+        EXPECT_EQ(numKeys + ii + 1, scanned["key" + std::to_string(ii)]);
+    }
+}
+
 std::string kvstoreTestParams[] = {
 #ifdef EP_USE_FORESTDB
         "forestdb",
@@ -2086,6 +2494,9 @@ TEST_F(RocksDBKVStoreTest, StatsTest) {
     // Disk Usage per-CF
     EXPECT_TRUE(kvstore->getStat("default_kTotalSstFilesSize", value));
     EXPECT_TRUE(kvstore->getStat("seqno_kTotalSstFilesSize", value));
+
+    // Entries in the seqno CF
+    EXPECT_TRUE(kvstore->getStat("seqno_kEstimateNumKeys", value));
 }
 
 // Verify that a wrong value of 'rocksdb_statistics_option' is caught
@@ -2111,4 +2522,215 @@ TEST_F(RocksDBKVStoreTest, StatisticsOptionWrongValueTest) {
     // Re-open with the new configuration
     kvstore = setup_kv_store(*kvstoreConfig);
 }
+
+// Counts the items passed to the expiry callback during compaction.
+class CountingExpiryCallback : public Callback<Item&, time_t&> {
+public:
+    void callback(Item& item, time_t&) override {
+        const auto& key = item.getKey();
+        expired.emplace_back(reinterpret_cast<const char*>(key.data()),
+                             key.size());
+    }
+
+    std::vector<std::string> expired;
+};
+
+// Persist a mutation (or a deletion) of the given key with the given seqno.
+static void storeItem(KVStore& kvstore,
+                      PersistenceCallbacks& cb,
+                      const std::string& key,
+                      int64_t bySeqno,
+                      bool deleted = false,
+                      time_t exptime = 0) {
+    Item item(makeStoredDocKey(key),
+              0 /*flags*/,
+              exptime,
+              "value",
+              5 /*nb*/,
+              PROTOCOL_BINARY_RAW_BYTES,
+              0 /*cas*/,
+              bySeqno);
+    kvstore.begin({});
+    if (deleted) {
+        item.setDeleted();
+        kvstore.del(item, cb);
+    } else {
+        kvstore.set(item, cb);
+    }
+    ASSERT_TRUE(kvstore.commit(nullptr /*no collections manifest*/));
+}
+
+// Verify that the item and deleted counts are exact, that the persistence
+// callbacks distinguish inserts from updates, and that the counts survive a
+// restart.
+TEST_F(RocksDBKVStoreTest, ItemCountTest) {
+    NiceMock<MockPersistenceCallbacks> mpc;
+
+    mutation_result insertion = std::make_pair(1, true);
+    mutation_result update = std::make_pair(1, false);
+    EXPECT_CALL(mpc, callback(_, insertion)).Times(2);
+    storeItem(*kvstore, mpc, "key0", 1);
+    storeItem(*kvstore, mpc, "key1", 2);
+    EXPECT_EQ(2, kvstore->getItemCount(0));
+    EXPECT_EQ(0, kvstore->getNumPersistedDeletes(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    EXPECT_CALL(mpc, callback(_, update)).Times(1);
+    storeItem(*kvstore, mpc, "key0", 3);
+    EXPECT_EQ(2, kvstore->getItemCount(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    // Deletion of an existing item
+    int delCount = 1;
+    EXPECT_CALL(mpc, callback(_, delCount)).Times(1);
+    storeItem(*kvstore, mpc, "key1", 4, true /*deleted*/);
+    EXPECT_EQ(1, kvstore->getItemCount(0));
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    // Deletion of an item which doesn't exist
+    delCount = 0;
+    EXPECT_CALL(mpc, callback(_, delCount)).Times(1);
+    storeItem(*kvstore, mpc, "key2", 5, true /*deleted*/);
+    EXPECT_EQ(1, kvstore->getItemCount(0));
+    EXPECT_EQ(2, kvstore->getNumPersistedDeletes(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    // Re-creating a deleted item is an insertion
+    EXPECT_CALL(mpc, callback(_, insertion)).Times(1);
+    storeItem(*kvstore, mpc, "key1", 6);
+    EXPECT_EQ(2, kvstore->getItemCount(0));
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    // The same key stored more than once in a batch
+    EXPECT_CALL(mpc, callback(_, insertion)).Times(1);
+    EXPECT_CALL(mpc, callback(_, update)).Times(2);
+    kvstore->begin({});
+    for (int64_t seqno = 7; seqno <= 9; ++seqno) {
+        Item item(makeStoredDocKey("key3"),
+                  0 /*flags*/,
+                  0 /*exptime*/,
+                  "value",
+                  5 /*nb*/,
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0 /*cas*/,
+                  seqno);
+        kvstore->set(item, mpc);
+    }
+    ASSERT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    EXPECT_EQ(3, kvstore->getItemCount(0));
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+    testing::Mock::VerifyAndClearExpectations(&mpc);
+
+    // Close and re-open the DB
+    kvstore.reset();
+    kvstore = setup_kv_store(*kvstoreConfig);
+    EXPECT_EQ(3, kvstore->getItemCount(0));
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+    EXPECT_EQ(kvstore->getDbFileInfo(0).fileSize,
+              kvstore->getAggrDbFileInfo().fileSize);
+}
+
+// Verify that compactDB expires items and purges tombstones, but keeps the
+// tombstone at the high seqno.
+TEST_F(RocksDBKVStoreTest, CompactionExpiresAndPurges) {
+    NiceMock<MockPersistenceCallbacks> mpc;
+    storeItem(*kvstore, mpc, "expired", 1, false, 1 /*exptime*/);
+    storeItem(*kvstore, mpc, "deleted", 2);
+    storeItem(*kvstore, mpc, "deleted", 3, true /*deleted*/);
+    storeItem(*kvstore, mpc, "live", 4);
+    storeItem(*kvstore, mpc, "last", 5);
+    storeItem(*kvstore, mpc, "last", 6, true /*deleted*/);
+    ASSERT_EQ(2, kvstore->getItemCount(0));
+    ASSERT_EQ(2, kvstore->getNumPersistedDeletes(0));
+
+    auto expiry = std::make_shared<CountingExpiryCallback>();
+    compaction_ctx cctx;
+    cctx.purge_before_seq = 0;
+    cctx.purge_before_ts = 0;
+    cctx.curr_time = 0;
+    cctx.drop_deletes = true;
+    cctx.db_file_id = 0;
+    cctx.expiryCallback = expiry;
+
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+
+    ASSERT_EQ(1, expiry->expired.size());
+    EXPECT_EQ("expired", expiry->expired[0]);
+    EXPECT_EQ(1, cctx.stats.tombstonesPurged);
+    EXPECT_EQ(3, cctx.max_purged_seq[0]);
+    EXPECT_EQ(2, cctx.stats.post.items);
+    EXPECT_EQ(1, cctx.stats.post.deletedItems);
+    EXPECT_EQ(3, cctx.stats.post.purgeSeqno);
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+    EXPECT_EQ(3, kvstore->getVBucketState(0)->purgeSeqno);
+
+    // The expired item is only deleted by the engine
+    auto gv = kvstore->get(makeStoredDocKey("expired"), 0);
+    checkGetValue(gv);
+    gv = kvstore->get(makeStoredDocKey("deleted"), 0, true /*fetchDelete*/);
+    checkGetValue(gv, ENGINE_KEY_ENOENT);
+    gv = kvstore->get(makeStoredDocKey("last"), 0, true /*fetchDelete*/);
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+
+    // The purge seqno is persisted
+    kvstore.reset();
+    kvstore = setup_kv_store(*kvstoreConfig);
+    EXPECT_EQ(3, kvstore->getVBucketState(0)->purgeSeqno);
+    EXPECT_EQ(1, kvstore->getNumPersistedDeletes(0));
+}
+
+// Verify that compaction drops the seqno CF entries of overwritten documents
+// (see StaleSeqnoCompactionFilter) and keeps the current ones.
+TEST_F(RocksDBKVStoreTest, CompactionDropsStaleSeqnos) {
+    NiceMock<MockPersistenceCallbacks> mpc;
+    compaction_ctx cctx;
+    cctx.purge_before_seq = 0;
+    cctx.purge_before_ts = 0;
+    cctx.curr_time = 0;
+    cctx.drop_deletes = false;
+    cctx.db_file_id = 0;
+    cctx.expiryCallback = std::make_shared<CountingExpiryCallback>();
+
+    // The entry count is only exact once the local documents' overwrites
+    // are compacted too, so compare two compacted states.
+    storeItem(*kvstore, mpc, "key0", 1);
+    storeItem(*kvstore, mpc, "key1", 2);
+    ASSERT_TRUE(kvstore->compactDB(&cctx));
+    size_t entriesBefore;
+    ASSERT_TRUE(kvstore->getStat("seqno_kEstimateNumKeys", entriesBefore));
+
+    // Overwrite key0 twice; seqnos 1 and 3 become stale.
+    storeItem(*kvstore, mpc, "key0", 3);
+    storeItem(*kvstore, mpc, "key0", 4);
+    ASSERT_TRUE(kvstore->compactDB(&cctx));
+    size_t entriesAfter;
+    ASSERT_TRUE(kvstore->getStat("seqno_kEstimateNumKeys", entriesAfter));
+    EXPECT_EQ(entriesBefore, entriesAfter);
+
+    // The current entries still lead to their documents.
+    std::map<std::string, int64_t> scanned;
+    auto cb = std::make_shared<CustomCallback<GetValue>>(
+            [&scanned](GetValue gv) {
+                const auto& key = gv.item->getKey();
+                const std::string name(
+                        reinterpret_cast<const char*>(key.data()), key.size());
+                scanned[name] = gv.item->getBySeqno();
+            });
+    auto cl = std::make_shared<CustomCallback<CacheLookup>>();
+    auto* scanCtx = kvstore->initScanContext(cb,
+                                             cl,
+                                             0 /*vbid*/,
+                                             1 /*startSeqno*/,
+                                             DocumentFilter::ALL_ITEMS,
+                                             ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    ASSERT_EQ(2, scanned.size());
+    EXPECT_EQ(4, scanned["key0"]);
+    EXPECT_EQ(2, scanned["key1"]);
+}
 #endif
@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "token_bucket.h"
+
+using namespace std::chrono;
+
+// A rate of zero never throttles.
+TEST(TokenBucketTest, Unlimited) {
+    TokenBucket tb(0);
+    EXPECT_EQ(microseconds(0), tb.consume(1 << 30));
+    EXPECT_EQ(microseconds(0), tb.consume(1 << 30));
+    EXPECT_EQ(size_t(1) << 31, tb.getTotalConsumed());
+}
+
+// The bucket starts full, so one second's worth can be taken immediately;
+// anything beyond that must wait in proportion to the overshoot.
+TEST(TokenBucketTest, BurstThenDebt) {
+    TokenBucket tb(1000);
+    const auto now = ProcessClock::now();
+    EXPECT_EQ(microseconds(0), tb.consume(1000, now));
+    EXPECT_EQ(microseconds(500000), tb.consume(500, now));
+    EXPECT_EQ(microseconds(1000000), tb.consume(500, now));
+}
+
+// Tokens refill at the configured rate, capped at one second's worth.
+TEST(TokenBucketTest, Refill) {
+    TokenBucket tb(1000);
+    const auto start = ProcessClock::now();
+    EXPECT_EQ(microseconds(0), tb.consume(1000, start));
+
+    // Half a second later half the tokens are back.
+    EXPECT_EQ(microseconds(0), tb.consume(500, start + milliseconds(500)));
+    EXPECT_EQ(microseconds(100000), tb.consume(100, start + milliseconds(500)));
+
+    // A long idle period does not accumulate more than the burst size.
+    const auto later = start + seconds(60);
+    EXPECT_EQ(microseconds(0), tb.consume(1000, later));
+    EXPECT_EQ(microseconds(1000), tb.consume(1, later));
+}
+
+TEST(TokenBucketTest, SetRate) {
+    TokenBucket tb(100);
+    const auto now = ProcessClock::now();
+    EXPECT_LT(microseconds(0), tb.consume(200, now));
+
+    // Changing the rate forgives existing debt.
+    tb.setRate(1000);
+    EXPECT_EQ(1000u, tb.getRate());
+    EXPECT_EQ(microseconds(0), tb.consume(1000));
+
+    // ...and disabling it stops throttling altogether.
+    tb.setRate(0);
+    EXPECT_EQ(microseconds(0), tb.consume(1 << 20));
+}
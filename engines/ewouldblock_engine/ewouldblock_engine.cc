@@ -545,6 +545,38 @@ public:
         }
     }
 
+    static cb::EngineErrorCasPair splice(gsl::not_null<ENGINE_HANDLE*> handle,
+                                         gsl::not_null<const void*> cookie,
+                                         const DocKey& key,
+                                         uint16_t vbucket,
+                                         uint64_t cas,
+                                         size_t offset,
+                                         size_t length,
+                                         cb::const_char_buffer data,
+                                         protocol_binary_datatype_t datatype,
+                                         rel_time_t exptime,
+                                         mutation_descr_t& mut_info) {
+        EWB_Engine* ewb = to_engine(handle);
+        ENGINE_ERROR_CODE err = ENGINE_SUCCESS;
+        if (ewb->should_inject_error(Cmd::CAS, cookie, err)) {
+            return {cb::engine_errc(err), 0};
+        } else if (ewb->real_engine->splice == nullptr) {
+            return {cb::engine_errc::not_supported, 0};
+        } else {
+            return ewb->real_engine->splice(ewb->real_handle,
+                                            cookie,
+                                            key,
+                                            vbucket,
+                                            cas,
+                                            offset,
+                                            length,
+                                            data,
+                                            datatype,
+                                            exptime,
+                                            mut_info);
+        }
+    }
+
     static ENGINE_ERROR_CODE flush(gsl::not_null<ENGINE_HANDLE*> handle,
                                    gsl::not_null<const void*> cookie) {
         // Flush is a little different - it often returns EWOULDBLOCK, and
@@ -1318,6 +1350,7 @@ EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
     ENGINE_HANDLE_V1::unlock = unlock;
     ENGINE_HANDLE_V1::store = store;
     ENGINE_HANDLE_V1::store_if = store_if;
+    ENGINE_HANDLE_V1::splice = splice;
     ENGINE_HANDLE_V1::flush = flush;
     ENGINE_HANDLE_V1::get_stats = get_stats;
     ENGINE_HANDLE_V1::reset_stats = reset_stats;
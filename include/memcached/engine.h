@@ -501,6 +501,47 @@ typedef struct engine_interface_v1 {
                                        cb::StoreIfPredicate predicate,
                                        DocumentState document_state);
 
+    /**
+     * Replace a byte range of the value of an existing document, without
+     * the caller having to allocate (and copy) the complete new value.
+     *
+     * The new value consists of the first `offset` bytes of the current
+     * value, followed by `data`, followed by the current value from
+     * `offset + length`. The document keeps its flags; the expiry time and
+     * datatype are replaced with the ones given.
+     *
+     * This method is optional; engines which don't support it leave it
+     * set to nullptr (and callers should then store the full document).
+     *
+     * @param handle the engine handle
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document to modify
+     * @param vbucket the virtual bucket id
+     * @param cas the CAS value of the document the splice was computed
+     *            from; the splice fails with key_already_exists if the
+     *            document was modified since
+     * @param offset the offset in the (uncompressed) value to replace from
+     * @param length the number of bytes to replace
+     * @param data the bytes to insert in place of the replaced range
+     * @param datatype the datatype of the new value
+     * @param exptime the expiry time of the new document
+     * @param mut_info On a successful splice write the mutation details to
+     *                 this address.
+     *
+     * @return a std::pair containing the engine_error code and new CAS
+     */
+    cb::EngineErrorCasPair (*splice)(gsl::not_null<ENGINE_HANDLE*> handle,
+                                     gsl::not_null<const void*> cookie,
+                                     const DocKey& key,
+                                     uint16_t vbucket,
+                                     uint64_t cas,
+                                     size_t offset,
+                                     size_t length,
+                                     cb::const_char_buffer data,
+                                     protocol_binary_datatype_t datatype,
+                                     rel_time_t exptime,
+                                     mutation_descr_t& mut_info);
+
     /**
      * Flush the cache.
      *
@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <memory>
 #include <platform/sized_buffer.h>
+#include <vector>
 #include <xattr/visibility.h>
 
 namespace cb {
@@ -28,6 +29,14 @@ namespace xattr {
 /**
  * The cb::xattr::Blob is a class that provides easy access to the
  * binary format of the blob.
+ *
+ * The kv-pairs in the encoded blob are unordered, so locating a key means
+ * scanning the blob. Once the lookups have scanned past more than
+ * IndexThreshold kv-pairs the Blob builds an index (the offsets of the
+ * kv-pairs sorted by key) which it keeps up to date as the blob is
+ * modified, so that later lookups are a binary search. The index is built
+ * from const methods, so a Blob must not be used from multiple threads
+ * at the same time.
  */
 class XATTR_PUBLIC_API Blob {
 public:
@@ -79,6 +88,12 @@ public:
      */
     Blob(const Blob& other);
 
+    /**
+     * The number of kv-pairs lookups may scan past before the Blob builds
+     * an index of the keys.
+     */
+    static const size_t IndexThreshold = 16;
+
     /**
      * Get the value for a given key located in the blob
      *
@@ -111,6 +126,10 @@ public:
     /**
      * Set (add or replace) the given key with the specified value.
      *
+     * An existing key is replaced where it is in the blob (moving the
+     * kv-pairs which follow it if the size of the value changed); new keys
+     * are appended to the blob.
+     *
      * @param key The key to set
      * @param value The new value for the key
      */
@@ -271,8 +290,39 @@ protected:
     void remove_segment(const size_t offset, const size_t size);
 
 private:
+    /**
+     * Locate the kv-pair for the given key
+     *
+     * @return the offset of the kv-pair, or 0 if the key isn't present
+     */
+    size_t find(const cb::const_byte_buffer& key) const;
+
+    /// Get the key of the kv-pair at the given offset
+    cb::const_byte_buffer key_at(size_t offset) const;
+
+    /// Build the index of all of the kv-pairs in the blob
+    void build_index() const;
+
+    /**
+     * Update the index after the kv-pair at offset changed its size from
+     * old_size to new_size (0 if it was removed), which moved all of the
+     * kv-pairs following it.
+     */
+    void update_index(size_t offset, size_t old_size, size_t new_size);
+
+    /// Add the (new) kv-pair at offset to the index
+    void index_kvpair(size_t offset);
+
     cb::byte_buffer blob;
 
+    // The offsets of all of the kv-pairs in the blob, sorted by their key.
+    // Only valid if indexed is set.
+    mutable std::vector<uint32_t> index;
+    mutable bool indexed = false;
+
+    // The number of kv-pairs scanned past by lookups without the index
+    mutable size_t scanned = 0;
+
     std::unique_ptr<uint8_t[]>& allocator;
     std::unique_ptr<uint8_t[]> default_allocator;
     size_t alloc_size;
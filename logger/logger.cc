@@ -58,6 +58,23 @@ Config::Config(const cJSON& json) {
         sleeptime = static_cast<unsigned int>(obj->valueint);
     }
 
+    obj = cJSON_GetObjectItem(root, "overflow_policy");
+    if (obj != nullptr) {
+        if (obj->type != cJSON_String) {
+            throw std::invalid_argument(
+                    R"(cb::logger::Config: "overflow_policy" must be a string)");
+        }
+        const std::string policy{obj->valuestring};
+        if (policy == "block") {
+            overflow_policy = OverflowPolicy::Block;
+        } else if (policy == "drop") {
+            overflow_policy = OverflowPolicy::Drop;
+        } else {
+            throw std::invalid_argument(
+                    R"(cb::logger::Config: "overflow_policy" must be "block" or "drop")");
+        }
+    }
+
     obj = cJSON_GetObjectItem(root, "unit_test");
     unit_test = false;
     if (obj != nullptr) {
@@ -75,6 +92,7 @@ bool Config::operator==(const Config& other) const {
            (this->buffersize == other.buffersize) &&
            (this->sleeptime == other.sleeptime) &&
            (this->cyclesize == other.cyclesize) &&
+           (this->overflow_policy == other.overflow_policy) &&
            (this->unit_test == other.unit_test);
 }
 
@@ -23,11 +23,23 @@
 #include <cJSON.h>
 #include <memcached/server_api.h>
 
+#include <cstdint>
 #include <string>
 
 namespace cb {
 namespace logger {
 
+/**
+ * What to do with a log message when the queue of messages waiting to be
+ * written by the background thread is full
+ */
+enum class OverflowPolicy {
+    /// Wait (on the thread logging the message) for room in the queue
+    Block,
+    /// Drop the message (and count it in Stats::dropped)
+    Drop
+};
+
 struct LOGGER_PUBLIC_API Config {
     Config() = default;
     explicit Config(const cJSON& json);
@@ -44,10 +56,24 @@ struct LOGGER_PUBLIC_API Config {
     size_t cyclesize = 100 * 1024 * 1024;
     /// time between forced flushes of the buffer
     size_t sleeptime = 60;
+    /// what to do with messages logged while the logging queue is full
+    OverflowPolicy overflow_policy = OverflowPolicy::Block;
     /// if running in a unit test or not
     bool unit_test = false;
 };
 
+/**
+ * Statistics of the file logger
+ */
+struct LOGGER_PUBLIC_API Stats {
+    /// Messages waiting to be written by the background thread
+    uint64_t queued = 0;
+    /// Messages written by the background thread
+    uint64_t written = 0;
+    /// Messages dropped as the queue was full
+    uint64_t dropped = 0;
+};
+
 /**
  * Initialize the logger
  *
@@ -59,5 +85,11 @@ LOGGER_PUBLIC_API
 boost::optional<std::string> initialize(const Config& logger_settings,
                                         GET_SERVER_API get_server_api);
 
+/**
+ * Get the statistics of the file logger (all zero if it isn't initialized)
+ */
+LOGGER_PUBLIC_API
+Stats getStats();
+
 } // namespace logger
 } // namespace cb
\ No newline at end of file
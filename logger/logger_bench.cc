@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmark of the file logger throughput when multiple threads log at the
+ * same time (like a burst of warnings from the front end threads), with
+ * the overflow policies for when the logging queue is full.
+ */
+
+#include "logger.h"
+
+#include <benchmark/benchmark.h>
+#include <memcached/extension.h>
+#include <platform/dirutils.h>
+
+#include <string>
+
+static EXTENSION_LOGGER_DESCRIPTOR* logger;
+
+static EXTENSION_LOG_LEVEL get_log_level(void) {
+    return EXTENSION_LOG_DEBUG;
+}
+
+static bool register_extension(extension_type_t type, void* extension) {
+    logger = reinterpret_cast<EXTENSION_LOGGER_DESCRIPTOR*>(extension);
+    return true;
+}
+
+static void register_callback(ENGINE_HANDLE* eh,
+                              ENGINE_EVENT_TYPE type,
+                              EVENT_CALLBACK cb,
+                              const void* cb_data) {
+}
+
+static SERVER_HANDLE_V1* get_server_api(void) {
+    static bool init = false;
+    static SERVER_CORE_API core_api = {};
+    static SERVER_COOKIE_API server_cookie_api = {};
+    static SERVER_STAT_API server_stat_api = {};
+    static SERVER_LOG_API server_log_api = {};
+    static SERVER_EXTENSION_API extension_api = {};
+    static SERVER_CALLBACK_API callback_api = {};
+    static ALLOCATOR_HOOKS_API hooks_api = {};
+    static SERVER_HANDLE_V1 rv;
+
+    if (!init) {
+        init = true;
+
+        server_log_api.get_level = get_log_level;
+        extension_api.register_extension = register_extension;
+        callback_api.register_callback = register_callback;
+
+        rv.interface = 1;
+        rv.core = &core_api;
+        rv.stat = &server_stat_api;
+        rv.extension = &extension_api;
+        rv.callback = &callback_api;
+        rv.log = &server_log_api;
+        rv.cookie = &server_cookie_api;
+        rv.alloc_hooks = &hooks_api;
+    }
+
+    return &rv;
+}
+
+static const std::string filename{"logger_bench"};
+
+static void removeFiles() {
+    for (const auto& file : cb::io::findFilesWithPrefix(filename)) {
+        cb::io::rmrf(file);
+    }
+}
+
+/*
+ * Log a typical warning from state.threads threads; the queue is kept
+ * small so the background writer can't keep up.
+ */
+static void LogContended(benchmark::State& state,
+                         cb::logger::OverflowPolicy policy) {
+    uint64_t dropped = 0;
+    if (state.thread_index == 0) {
+        removeFiles();
+        cb::logger::Config config;
+        config.filename = filename;
+        config.buffersize = 8192;
+        config.cyclesize = 100 * 1024 * 1024;
+        config.overflow_policy = policy;
+        config.unit_test = true;
+        const auto ret = cb::logger::initialize(config, get_server_api);
+        if (ret) {
+            state.SkipWithError(ret.get().c_str());
+        }
+        dropped = cb::logger::getStats().dropped;
+    }
+
+    while (state.KeepRunning()) {
+        logger->log(EXTENSION_LOG_WARNING,
+                    nullptr,
+                    "%u: DCP (Producer) eq_dcpq:replication:ns_1@127.0.0.1->"
+                    "ns_1@127.0.0.2:default - (vb %d) Stream closing, "
+                    "sent until seqno %lu",
+                    state.thread_index,
+                    42,
+                    1234567ul);
+    }
+
+    if (state.thread_index == 0) {
+        logger->shutdown(false);
+        dropped = cb::logger::getStats().dropped - dropped;
+        state.SetLabel("dropped:" + std::to_string(dropped));
+        removeFiles();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_CAPTURE(LogContended, Block, cb::logger::OverflowPolicy::Block)
+        ->ThreadRange(1, 16)
+        ->UseRealTime();
+BENCHMARK_CAPTURE(LogContended, Drop, cb::logger::OverflowPolicy::Drop)
+        ->ThreadRange(1, 16)
+        ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -17,6 +17,7 @@
 
 #include "logger.h"
 
+#include <cJSON_utils.h>
 #include <extensions/protocol_extension.h>
 #include <gtest/gtest.h>
 #include <memcached/extension.h>
@@ -226,6 +227,47 @@ TEST_F(SpdloggerTest, MultipleFilesTest) {
     }
 }
 
+/**
+ * Test that the stats count the messages written by the background thread
+ * (the counters are process wide, so look at the change)
+ */
+TEST_F(SpdloggerTest, StatsTest) {
+    const auto before = cb::logger::getStats();
+    for (auto ii = 0; ii < 10; ii++) {
+        logger->log(EXTENSION_LOG_DEBUG, nullptr, "Counted message");
+    }
+    // Shutting down the logger drains the queue
+    logger->shutdown(false);
+
+    const auto after = cb::logger::getStats();
+    EXPECT_EQ(before.written + 10, after.written);
+    EXPECT_EQ(0u, after.queued);
+    EXPECT_EQ(before.dropped, after.dropped);
+}
+
+TEST(SpdloggerConfigTest, OverflowPolicy) {
+    unique_cJSON_ptr json(cJSON_Parse(R"({"filename":"foo"})"));
+    EXPECT_EQ(cb::logger::OverflowPolicy::Block,
+              cb::logger::Config(*json).overflow_policy);
+
+    cJSON_AddStringToObject(json.get(), "overflow_policy", "drop");
+    EXPECT_EQ(cb::logger::OverflowPolicy::Drop,
+              cb::logger::Config(*json).overflow_policy);
+
+    cJSON_ReplaceItemInObject(
+            json.get(), "overflow_policy", cJSON_CreateString("block"));
+    EXPECT_EQ(cb::logger::OverflowPolicy::Block,
+              cb::logger::Config(*json).overflow_policy);
+
+    cJSON_ReplaceItemInObject(
+            json.get(), "overflow_policy", cJSON_CreateString("wait"));
+    EXPECT_THROW(cb::logger::Config{*json}, std::invalid_argument);
+
+    cJSON_ReplaceItemInObject(
+            json.get(), "overflow_policy", cJSON_CreateNumber(1));
+    EXPECT_THROW(cb::logger::Config{*json}, std::invalid_argument);
+}
+
 #ifndef WIN32
 /**
  * Test that it works as expected when running out of file
@@ -28,6 +28,7 @@
 #include <spdlog/sinks/dist_sink.h>
 #include <spdlog/sinks/stdout_sinks.h>
 #include <spdlog/spdlog.h>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 
@@ -71,6 +72,38 @@ static const spdlog::level::level_enum convertToSpdSeverity(
  */
 static std::shared_ptr<spdlog::logger> file_logger;
 
+/// What to do with messages logged while the queue is full
+static cb::logger::OverflowPolicy overflow_policy;
+
+/// The number of messages the async logger's queue may hold
+static size_t queue_size;
+
+/**
+ * Counters for the messages passed to the async logger. The front end
+ * threads count the messages they queue (or drop), and the background
+ * thread counts the ones it has written through the accounting_sink.
+ */
+static struct {
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+} message_stats;
+
+/**
+ * Sink added last to the distribution sink so that the background thread
+ * can tell the front end threads how many messages are left in the queue
+ */
+class accounting_sink : public spdlog::sinks::sink {
+public:
+    void log(const spdlog::details::log_msg&) override {
+        message_stats.queued--;
+        message_stats.written++;
+    }
+
+    void flush() override {
+    }
+};
+
 /** Returns the name of the file logger */
 static const char* get_name() {
     return file_logger->name().c_str();
@@ -85,6 +118,23 @@ static void log(EXTENSION_LOG_LEVEL mcd_severity,
                 const char* fmt,
                 ...) {
     const auto severity = convertToSpdSeverity(mcd_severity);
+    if (!file_logger->should_log(severity)) {
+        return;
+    }
+
+    // Reserve room for the message in the queue before formatting it. The
+    // background thread releases the slot once the message is written, so
+    // (apart from flush requests) spdlog itself never finds the queue full
+    // and has to discard a message we counted as queued.
+    if (overflow_policy == cb::logger::OverflowPolicy::Drop) {
+        if (message_stats.queued.fetch_add(1) >= queue_size) {
+            message_stats.queued--;
+            message_stats.dropped++;
+            return;
+        }
+    } else {
+        message_stats.queued++;
+    }
 
     // Retrieve formatted log message
     char msg[2048];
@@ -96,6 +146,7 @@ static void log(EXTENSION_LOG_LEVEL mcd_severity,
 
     // Something went wrong during formatting, so return
     if (len < 0) {
+        message_stats.queued--;
         return;
     }
     // len does not include '\0', hence >= and not >
@@ -173,14 +224,22 @@ boost::optional<std::string> cb::logger::initialize(
         auto stderrsink = std::make_shared<spdlog::sinks::stderr_sink_mt>();
         stderrsink->set_level(spdlog::level::warn);
         sink->add_sink(stderrsink);
+        sink->add_sink(std::make_shared<accounting_sink>());
 
-        file_logger =
-                spdlog::create_async("spdlog_file_logger",
-                                     sink,
-                                     buffersz,
-                                     spdlog::async_overflow_policy::block_retry,
-                                     nullptr,
-                                     std::chrono::seconds(sleeptime));
+        overflow_policy = logger_settings.overflow_policy;
+        queue_size = buffersz;
+        // With the drop policy threads racing for the last slots of a full
+        // queue must not block either.
+        const auto policy =
+                overflow_policy == cb::logger::OverflowPolicy::Drop
+                        ? spdlog::async_overflow_policy::discard_log_msg
+                        : spdlog::async_overflow_policy::block_retry;
+        file_logger = spdlog::create_async("spdlog_file_logger",
+                                           sink,
+                                           buffersz,
+                                           policy,
+                                           nullptr,
+                                           std::chrono::seconds(sleeptime));
     } catch (const spdlog::spdlog_ex& ex) {
         std::string msg =
                 std::string{"Log initialization failed: "} + ex.what();
@@ -202,3 +261,11 @@ boost::optional<std::string> cb::logger::initialize(
             nullptr, ON_LOG_LEVEL, on_log_level, nullptr);
     return {};
 }
+
+cb::logger::Stats cb::logger::getStats() {
+    Stats stats;
+    stats.queued = message_stats.queued;
+    stats.written = message_stats.written;
+    stats.dropped = message_stats.dropped;
+    return stats;
+}
@@ -29,13 +29,16 @@
  * @param sock socket connected to the server
  * @param key the name of the stat to receive (empty == ALL)
  * @param json if true print as json otherwise print old-style
+ * @param snapshot if true request the stats as a single JSON document
  */
 static void request_stat(MemcachedConnection& connection,
                          const std::string& key,
                          bool json,
-                         bool format) {
+                         bool format,
+                         bool snapshot) {
     try {
-        auto stats = connection.stats(key);
+        auto stats = snapshot ? connection.statsSnapshot(key)
+                              : connection.stats(key);
         if (json) {
             std::cout << to_string(stats, format) << std::endl;
         } else {
@@ -98,6 +101,8 @@ static void usage() {
               << std::endl
               << "  -J           Print result in JSON (formatted)"
               << std::endl
+              << "  -x           Fetch the stats as a single JSON document"
+              << std::endl
               << "  -4           Use IPv4 (default)" << std::endl
               << "  -6           Use IPv6" << std::endl
               << "  -C certfile  Use certfile as a client certificate"
@@ -119,11 +124,12 @@ int main(int argc, char** argv) {
     bool secure = false;
     bool json = false;
     bool format = false;
+    bool snapshot = false;
 
     /* Initialize the socket subsystem */
     cb_initialize_sockets();
 
-    while ((cmd = getopt(argc, argv, "46h:p:u:b:P:SsjJC:K:")) != EOF) {
+    while ((cmd = getopt(argc, argv, "46h:p:u:b:P:SsjJxC:K:")) != EOF) {
         switch (cmd) {
         case '6' :
             family = AF_INET6;
@@ -158,6 +164,9 @@ int main(int argc, char** argv) {
         case 'j':
             json = true;
             break;
+        case 'x':
+            snapshot = true;
+            break;
         case 'C':
             ssl_cert.assign(optarg);
             break;
@@ -200,6 +209,10 @@ int main(int argc, char** argv) {
             std::cerr << e.what() << std::endl;
         }
 
+        if (snapshot) {
+            connection.setDatatypeJson(true);
+        }
+
         if (!user.empty()) {
             connection.authenticate(user, password,
                                     connection.getSaslMechanisms());
@@ -210,10 +223,10 @@ int main(int argc, char** argv) {
         }
 
         if (optind == argc) {
-            request_stat(connection, "", json, format);
+            request_stat(connection, "", json, format, snapshot);
         } else {
             for (int ii = optind; ii < argc; ++ii) {
-                request_stat(connection, argv[ii], json, format);
+                request_stat(connection, argv[ii], json, format, snapshot);
             }
         }
     } catch (const ConnectionError& ex) {
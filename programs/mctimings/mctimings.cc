@@ -25,9 +25,12 @@
 #include <protocol/connection/client_connection.h>
 #include <protocol/connection/client_mcbp_commands.h>
 #include <array>
+#include <cinttypes>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 static uint32_t getValue(cJSON *root, const char *key) {
     cJSON *obj = cJSON_GetObjectItem(root, key);
@@ -109,6 +112,14 @@ public:
             dump("s ", 80, 0, wayout[4]);
         }
         std::cout << "Total: " << total << " operations" << std::endl;
+
+        if (!percentiles.empty()) {
+            std::cout << "Percentiles:";
+            for (const auto& p : percentiles) {
+                std::cout << " p" << p.first << "=" << formatDuration(p.second);
+            }
+            std::cout << std::endl;
+        }
     }
 
 private:
@@ -181,6 +192,19 @@ private:
             oldwayout = true;
         }
 
+        // Newer servers also include the log-linear histogram with
+        // (accurate) precomputed percentiles
+        auto* hdr = cJSON_GetObjectItem(root, "hdr");
+        if (hdr != nullptr) {
+            auto* pct = cJSON_GetObjectItem(hdr, "percentiles");
+            if (pct != nullptr) {
+                for (i = pct->child; i != nullptr; i = i->next) {
+                    percentiles.emplace_back(i->string,
+                                             uint64_t(i->valuedouble));
+                }
+            }
+        }
+
         // Calculate total and cumulative counts, and find the highest value.
         max = total = 0;
 
@@ -199,6 +223,20 @@ private:
         }
     }
 
+    static std::string formatDuration(uint64_t ns) {
+        char buffer[32];
+        if (ns < 10000) {
+            snprintf(buffer, sizeof(buffer), "%" PRIu64 "ns", ns);
+        } else if (ns < 10000000) {
+            snprintf(buffer, sizeof(buffer), "%.2fus", double(ns) / 1000.0);
+        } else if (ns < 10000000000ULL) {
+            snprintf(buffer, sizeof(buffer), "%.2fms", double(ns) / 1000000.0);
+        } else {
+            snprintf(buffer, sizeof(buffer), "%.2fs", double(ns) / 1000000000.0);
+        }
+        return buffer;
+    }
+
     void dump(const char *timeunit, uint32_t low, uint32_t high,
               const Bin& value)
     {
@@ -251,6 +289,9 @@ private:
     bool oldwayout;
 
     uint64_t total;
+
+    /// The percentiles (and their value in ns) reported by the server
+    std::vector<std::pair<std::string, uint64_t>> percentiles;
 };
 
 std::string opcode2string(uint8_t opcode) {
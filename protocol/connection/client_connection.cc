@@ -26,6 +26,7 @@
 #include <platform/strerror.h>
 
 #include <cerrno>
+#include <cstddef>
 #include <iostream>
 #include <limits>
 #include <sstream>
@@ -178,6 +179,11 @@ void MemcachedConnection::connect() {
             BIO_free_all(bio);
             throw std::runtime_error("Failed to create openssl client contex");
         }
+#ifdef SSL_OP_NO_TLSv1_3
+        if (ssl_max_tls12) {
+            SSL_CTX_set_options(context, SSL_OP_NO_TLSv1_3);
+        }
+#endif
         if (!ssl_cert_file.empty() && !ssl_key_file.empty()) {
             if (!SSL_CTX_use_certificate_file(
                         context, ssl_cert_file.c_str(), SSL_FILETYPE_PEM) ||
@@ -432,6 +438,7 @@ std::unique_ptr<MemcachedConnection> MemcachedConnection::clone() {
             this->host, this->port, this->family, this->ssl);
     result->setSslCertFile(this->ssl_cert_file);
     result->setSslKeyFile(this->ssl_key_file);
+    result->setSslMaxTls12(this->ssl_max_tls12);
     result->connect();
     return std::unique_ptr<MemcachedConnection>{result};
 }
@@ -789,6 +796,40 @@ std::map<std::string, std::string> MemcachedConnection::statsMap(
     return ret;
 }
 
+unique_cJSON_ptr MemcachedConnection::statsSnapshot(
+        const std::string& subcommand) {
+    BinprotGenericCommand command(PROTOCOL_BINARY_CMD_STAT, subcommand);
+    Frame frame;
+    command.encode(frame.payload);
+    // The JSON datatype tells the server to send the stats as a single
+    // JSON document
+    frame.payload[offsetof(cb::mcbp::Request, datatype)] =
+            PROTOCOL_BINARY_DATATYPE_JSON;
+    sendFrame(frame);
+
+    BinprotResponse response;
+    recvResponse(response);
+    if (!response.isSuccess()) {
+        throw ConnectionError("Stats snapshot failed", response);
+    }
+
+    const auto json = response.getDataString();
+    unique_cJSON_ptr ret(cJSON_Parse(json.c_str()));
+    if (!ret) {
+        throw std::runtime_error(
+                "MemcachedConnection::statsSnapshot: Invalid JSON returned: " +
+                json);
+    }
+
+    // Consume the empty packet terminating the stats
+    recvResponse(response);
+    if (!response.isSuccess() || response.getBodylen() != 0) {
+        throw ConnectionError("Stats snapshot: missing terminator", response);
+    }
+
+    return ret;
+}
+
 void MemcachedConnection::configureEwouldBlockEngine(const EWBEngineMode& mode,
                                                      ENGINE_ERROR_CODE err_code,
                                                      uint32_t value,
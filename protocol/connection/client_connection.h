@@ -291,6 +291,14 @@ public:
      */
     void setSslKeyFile(const std::string& file);
 
+    /**
+     * Don't let the SSL handshake negotiate a protocol newer than TLS 1.2
+     * (takes effect the next time we connect)
+     */
+    void setSslMaxTls12(bool enable) {
+        ssl_max_tls12 = enable;
+    }
+
     /**
      * Try to establish a connection to the server.
      *
@@ -447,6 +455,16 @@ public:
 
     unique_cJSON_ptr stats(const std::string& subcommand);
 
+    /**
+     * Get stats as a single JSON document built by the server (requires
+     * the JSON datatype to be enabled on the connection). Numbers and
+     * booleans are returned as such, everything else as strings.
+     *
+     * @param subcommand the stat group to request
+     * @return the JSON document returned by the server
+     */
+    unique_cJSON_ptr statsSnapshot(const std::string& subcommand);
+
     /**
      * Instruct the audit daemon to reload the configuration
      */
@@ -744,6 +762,7 @@ protected:
     bool ssl;
     std::string ssl_cert_file;
     std::string ssl_key_file;
+    bool ssl_max_tls12 = false;
     SSL_CTX* context;
     BIO* bio;
     SOCKET sock;
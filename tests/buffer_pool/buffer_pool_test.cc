@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/buffer_pool.h>
+#include <gtest/gtest.h>
+
+TEST(BufferPoolTest, AllocationSize) {
+    EXPECT_EQ(BufferPool::MinimumSize, BufferPool::getAllocationSize(0));
+    EXPECT_EQ(BufferPool::MinimumSize, BufferPool::getAllocationSize(1));
+    EXPECT_EQ(BufferPool::MinimumSize,
+              BufferPool::getAllocationSize(BufferPool::MinimumSize));
+    EXPECT_EQ(BufferPool::MinimumSize * 2,
+              BufferPool::getAllocationSize(BufferPool::MinimumSize + 1));
+    EXPECT_EQ(BufferPool::MaximumSize,
+              BufferPool::getAllocationSize(BufferPool::MaximumSize));
+    // Bigger than the largest size class should be allocated as is
+    EXPECT_EQ(BufferPool::MaximumSize + 1,
+              BufferPool::getAllocationSize(BufferPool::MaximumSize + 1));
+}
+
+TEST(BufferPoolTest, ReuseBuffer) {
+    BufferPool pool;
+    EXPECT_EQ(nullptr, pool.tryAllocate(100));
+
+    auto buffer = pool.allocate(100);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_LE(100u, buffer->capacity());
+    EXPECT_EQ(0u, pool.getStats().hits.load());
+    EXPECT_EQ(1u, pool.getStats().misses.load());
+
+    auto* ptr = buffer.get();
+    pool.release(std::move(buffer));
+    EXPECT_EQ(BufferPool::MinimumSize, pool.getStats().cachedBytes.load());
+
+    buffer = pool.allocate(200);
+    EXPECT_EQ(ptr, buffer.get());
+    EXPECT_EQ(1u, pool.getStats().hits.load());
+    EXPECT_EQ(0u, pool.getStats().cachedBytes.load());
+}
+
+TEST(BufferPoolTest, ReleasedBufferIsCleared) {
+    BufferPool pool;
+    auto buffer = pool.allocate(100);
+    buffer->produce([](cb::byte_buffer) -> ssize_t { return 10; });
+    pool.release(std::move(buffer));
+    buffer = pool.allocate(100);
+    EXPECT_TRUE(buffer->empty());
+}
+
+TEST(BufferPoolTest, GrownBufferServeLargerSizeClass) {
+    BufferPool pool;
+    auto buffer = pool.allocate(64 * 1024);
+    EXPECT_EQ(64u * 1024, buffer->capacity());
+    pool.release(std::move(buffer));
+
+    // We shouldn't hand out the big buffer for small requests
+    EXPECT_EQ(nullptr, pool.tryAllocate(100));
+    // But it may be used for a slightly smaller request
+    EXPECT_NE(nullptr, pool.tryAllocate(20 * 1024));
+}
+
+TEST(BufferPoolTest, HugeBuffersAreNotCached) {
+    BufferPool pool;
+    auto buffer = pool.allocate(BufferPool::MaximumSize + 1);
+    pool.release(std::move(buffer));
+    EXPECT_EQ(0u, pool.getStats().cachedBytes.load());
+}
+
+TEST(BufferPoolTest, CachedBytesIsLimited) {
+    BufferPool pool(BufferPool::MinimumSize * 2);
+    auto b1 = pool.allocate(1);
+    auto b2 = pool.allocate(1);
+    auto b3 = pool.allocate(1);
+    pool.release(std::move(b1));
+    pool.release(std::move(b2));
+    pool.release(std::move(b3));
+    EXPECT_EQ(BufferPool::MinimumSize * 2, pool.getStats().cachedBytes.load());
+}
+
+TEST(BufferPoolTest, IdleConnectionBytes) {
+    BufferPool pool;
+    pool.addIdleConnectionBytes(4096);
+    pool.addIdleConnectionBytes(2048);
+    EXPECT_EQ(6144u, pool.getStats().idleConnectionBytes.load());
+    pool.removeIdleConnectionBytes(4096);
+    EXPECT_EQ(2048u, pool.getStats().idleConnectionBytes.load());
+}
@@ -883,6 +883,76 @@ TEST_F(SettingsTest, TracingEnabled) {
     }
 }
 
+TEST_F(SettingsTest, SslKernelTls) {
+    nonBooleanValuesShouldFail("ssl_kernel_tls");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddTrueToObject(obj.get(), "ssl_kernel_tls");
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isSslKernelTls());
+        EXPECT_TRUE(settings.has.ssl_kernel_tls);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddFalseToObject(obj.get(), "ssl_kernel_tls");
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isSslKernelTls());
+        EXPECT_TRUE(settings.has.ssl_kernel_tls);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, TopkeysSampleRate) {
+    nonNumericValuesShouldFail("topkeys_sample_rate");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "topkeys_sample_rate", 16);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(16u, settings.getTopkeysSampleRate());
+        EXPECT_TRUE(settings.has.topkeys_sample_rate);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "topkeys_sample_rate", 0);
+    EXPECT_THROW(Settings settings(obj), std::invalid_argument);
+}
+
+TEST_F(SettingsTest, NetworkBackend) {
+    nonStringValuesShouldFail("network_backend");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "network_backend", "io_uring");
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(NetworkBackend::IoUring, settings.getNetworkBackend());
+        EXPECT_TRUE(settings.has.network_backend);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "network_backend", "libevent");
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(NetworkBackend::Libevent, settings.getNetworkBackend());
+        EXPECT_TRUE(settings.has.network_backend);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddStringToObject(obj.get(), "network_backend", "epoll");
+    expectFail(obj);
+}
+
 TEST(SettingsUpdateTest, EmptySettingsShouldWork) {
     Settings updated;
     Settings settings;
@@ -949,6 +1019,42 @@ TEST(SettingsUpdateTest, AuditFileIsNotDynamic) {
                  std::invalid_argument);
 }
 
+TEST(SettingsUpdateTest, SslKernelTlsIsDynamic) {
+    Settings updated;
+    Settings settings;
+    settings.setSslKernelTls(false);
+    updated.setSslKernelTls(true);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_FALSE(settings.isSslKernelTls());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_TRUE(settings.isSslKernelTls());
+}
+
+TEST(SettingsUpdateTest, TopkeysSampleRateIsDynamic) {
+    Settings updated;
+    Settings settings;
+    settings.setTopkeysSampleRate(1);
+    updated.setTopkeysSampleRate(32);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(1u, settings.getTopkeysSampleRate());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(32u, settings.getTopkeysSampleRate());
+}
+
+TEST(SettingsUpdateTest, NetworkBackendIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setNetworkBackend(NetworkBackend::Libevent);
+    updated.setNetworkBackend(settings.getNetworkBackend());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should fail
+    updated.setNetworkBackend(NetworkBackend::IoUring);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, ThreadsIsNotDynamic) {
     Settings updated;
     Settings settings;
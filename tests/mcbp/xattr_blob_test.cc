@@ -21,6 +21,8 @@
 
 #include "utilities/string_utilities.h"
 
+#include <map>
+
 void validate(cb::byte_buffer buffer) {
     EXPECT_TRUE(cb::xattr::validate(
             {reinterpret_cast<const char*>(buffer.buf), buffer.len}));
@@ -107,9 +109,8 @@ TEST(XattrBlob, TestPruneUser) {
     blob.set(to_const_byte_buffer("meta"),
              to_const_byte_buffer("{\"content-type\":\"text\"}"));
 
-    // And I know that when I change something that won't fit in the
-    // current place it'll be moved to the end. Let's modify one of
-    // the keys..
+    // Modify one of the keys with a value of a different size (which moves
+    // the keys following it)..
     blob.set(to_const_byte_buffer("_rbac"),
              to_const_byte_buffer("{\"auth\":\"needed\"}"));
     // and then set it back so that the size should be the same..
@@ -243,3 +244,94 @@ TEST(XattrBlob, iterator_insert) {
         }
     }
 }
+
+/**
+ * Setting an existing key to a value of a different size should keep the
+ * key where it was in the blob
+ */
+TEST(XattrBlob, SetKeepsPosition) {
+    cb::xattr::Blob blob;
+    std::vector<std::string> keys = {"key1", "key2", "key3"};
+    for (auto& k : keys) {
+        blob.set(k, k + ".value");
+    }
+
+    blob.set("key2", "a much longer value than before");
+    validate(blob.finalize());
+    blob.set("key1", "1");
+    validate(blob.finalize());
+
+    auto kItr = keys.begin();
+    for (auto kv : blob) {
+        EXPECT_EQ(*kItr, to_string(kv.first));
+        kItr++;
+    }
+    EXPECT_TRUE(kItr == keys.end());
+
+    EXPECT_EQ("1", to_string(blob.get("key1")));
+    EXPECT_EQ("a much longer value than before", to_string(blob.get("key2")));
+    EXPECT_EQ("key3.value", to_string(blob.get("key3")));
+}
+
+/**
+ * Verify that lookups return the right values once the blob has indexed
+ * its keys, while keys are added, resized and removed
+ */
+TEST(XattrBlob, IndexedLookups) {
+    cb::xattr::Blob blob;
+    std::map<std::string, std::string> expected;
+    const size_t numKeys = cb::xattr::Blob::IndexThreshold * 4;
+    for (size_t ii = 0; ii < numKeys; ++ii) {
+        const auto key = (ii % 2 ? "_key" : "key") + std::to_string(ii);
+        expected[key] = "\"value" + std::to_string(ii) + "\"";
+        blob.set(key, expected[key]);
+    }
+
+    auto verify = [&blob, &expected]() {
+        validate(blob.finalize());
+        for (const auto& kv : expected) {
+            EXPECT_EQ(kv.second, to_string(blob.get(kv.first))) << kv.first;
+        }
+        // Substrings and extensions of keys must not match
+        EXPECT_TRUE(blob.get("key").empty());
+        EXPECT_TRUE(blob.get("key10a").empty());
+        size_t count = 0;
+        for (auto kv : blob) {
+            (void)kv;
+            ++count;
+        }
+        EXPECT_EQ(expected.size(), count);
+    };
+
+    // Looking up all of the keys builds the index
+    verify();
+
+    // Resize some of the values (both shrinking and growing them)
+    for (size_t ii = 0; ii < numKeys; ii += 3) {
+        const auto key = (ii % 2 ? "_key" : "key") + std::to_string(ii);
+        expected[key] = (ii % 2) ? "1" : "\"" + std::string(100, 'x') + "\"";
+        blob.set(key, expected[key]);
+    }
+    verify();
+
+    // Remove some, and add some new keys
+    for (size_t ii = 0; ii < numKeys; ii += 5) {
+        const auto key = (ii % 2 ? "_key" : "key") + std::to_string(ii);
+        expected.erase(key);
+        blob.remove(key);
+        blob.set("new" + std::to_string(ii), "true");
+        expected["new" + std::to_string(ii)] = "true";
+    }
+    verify();
+
+    // Pruning the user keys leaves the system keys
+    blob.prune_user_keys();
+    for (auto iter = expected.begin(); iter != expected.end();) {
+        if (iter->first[0] != '_') {
+            iter = expected.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    verify();
+}
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the cost of a stats call with state.range(0) stats, when
+ * the stats are returned as one response packet per stat (and converted
+ * to JSON by the client, like MemcachedConnection::stats() does) versus
+ * as a single JSON snapshot built by the server.
+ */
+
+#include "daemon/dynamic_buffer.h"
+#include "daemon/stats_snapshot.h"
+
+#include <benchmark/benchmark.h>
+#include <cJSON_utils.h>
+#include <mcbp/protocol/framebuilder.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using Stats = std::vector<std::pair<std::string, std::string>>;
+
+/// A mix of counters and strings, like the stats of a bucket
+static Stats makeStats(int count) {
+    Stats stats;
+    for (int ii = 0; ii < count; ++ii) {
+        auto key = "ep_stat_number_" + std::to_string(ii);
+        if (ii % 10 == 0) {
+            stats.emplace_back(std::move(key), "some_string_value");
+        } else {
+            stats.emplace_back(std::move(key), std::to_string(ii * 7919));
+        }
+    }
+    return stats;
+}
+
+static void addPacket(DynamicBuffer& dbuf,
+                      const std::string& key,
+                      const std::string& value) {
+    dbuf.grow(sizeof(cb::mcbp::Response) + key.size() + value.size());
+    cb::mcbp::ResponseBuilder builder(cb::byte_buffer(
+            reinterpret_cast<uint8_t*>(dbuf.getCurrent()),
+            dbuf.getSize() - dbuf.getOffset()));
+    builder.setMagic(cb::mcbp::Magic::ClientResponse);
+    builder.setOpcode(cb::mcbp::ClientOpcode::Stat);
+    builder.setDatatype(cb::mcbp::Datatype::Raw);
+    builder.setStatus(cb::mcbp::Status::Success);
+    builder.setKey({reinterpret_cast<const uint8_t*>(key.data()), key.size()});
+    builder.setValue(
+            {reinterpret_cast<const uint8_t*>(value.data()), value.size()});
+    dbuf.moveOffset(sizeof(cb::mcbp::Response) +
+                    builder.getFrame()->getBodylen());
+}
+
+/*
+ * Build one packet per stat, then walk the packets and build the JSON
+ * object the client wants from them.
+ */
+static void StatsPackets(benchmark::State& state) {
+    const auto stats = makeStats(state.range(0));
+    size_t bytes = 0;
+
+    while (state.KeepRunning()) {
+        DynamicBuffer dbuf;
+        for (const auto& stat : stats) {
+            addPacket(dbuf, stat.first, stat.second);
+        }
+        addPacket(dbuf, {}, {});
+        bytes = dbuf.getOffset();
+
+        unique_cJSON_ptr json(cJSON_CreateObject());
+        const char* ptr = dbuf.getRoot();
+        while (true) {
+            const auto* rsp = reinterpret_cast<const cb::mcbp::Response*>(ptr);
+            if (rsp->getBodylen() == 0) {
+                break;
+            }
+            const auto* payload = ptr + sizeof(cb::mcbp::Response);
+            const std::string key(payload, rsp->getKeylen());
+            const std::string value(payload + rsp->getKeylen(),
+                                    rsp->getValuelen());
+            try {
+                cJSON_AddNumberToObject(
+                        json.get(), key.c_str(), std::stoll(value));
+            } catch (...) {
+                cJSON_AddStringToObject(json.get(), key.c_str(), value.c_str());
+            }
+            ptr += sizeof(cb::mcbp::Response) + rsp->getBodylen();
+        }
+        benchmark::DoNotOptimize(json.get());
+    }
+    state.SetLabel("bytes:" + std::to_string(bytes));
+    state.SetItemsProcessed(state.iterations() * stats.size());
+}
+
+/*
+ * Build the JSON snapshot, then parse it like the client does.
+ */
+static void StatsSnapshot(benchmark::State& state) {
+    const auto stats = makeStats(state.range(0));
+    size_t bytes = 0;
+
+    while (state.KeepRunning()) {
+        DynamicBuffer dbuf;
+        dbuf.grow(sizeof(cb::mcbp::Response));
+        dbuf.moveOffset(sizeof(cb::mcbp::Response));
+        cb::stats::startSnapshot(dbuf);
+        for (const auto& stat : stats) {
+            cb::stats::addToSnapshot(dbuf,
+                                     {stat.first.data(), stat.first.size()},
+                                     {stat.second.data(), stat.second.size()});
+        }
+        cb::stats::endSnapshot(dbuf);
+        // Nul-terminate the document for cJSON_Parse
+        dbuf.grow(1);
+        *dbuf.getCurrent() = '\0';
+        bytes = dbuf.getOffset() + sizeof(cb::mcbp::Response);
+
+        unique_cJSON_ptr json(
+                cJSON_Parse(dbuf.getRoot() + sizeof(cb::mcbp::Response)));
+        benchmark::DoNotOptimize(json.get());
+    }
+    state.SetLabel("bytes:" + std::to_string(bytes));
+    state.SetItemsProcessed(state.iterations() * stats.size());
+}
+
+BENCHMARK(StatsPackets)->RangeMultiplier(4)->Range(32, 2048);
+BENCHMARK(StatsSnapshot)->RangeMultiplier(4)->Range(32, 2048);
+
+BENCHMARK_MAIN();
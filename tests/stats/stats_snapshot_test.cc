@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "daemon/dynamic_buffer.h"
+#include "daemon/stats_snapshot.h"
+
+#include <cJSON_utils.h>
+#include <gtest/gtest.h>
+#include <string>
+
+class StatsSnapshotTest : public ::testing::Test {
+protected:
+    void add(const std::string& key, const std::string& value) {
+        ASSERT_TRUE(cb::stats::addToSnapshot(
+                buffer, {key.data(), key.size()}, {value.data(), value.size()}));
+    }
+
+    /// Terminate the snapshot and return it as a string
+    std::string finish() {
+        EXPECT_TRUE(cb::stats::endSnapshot(buffer));
+        return {buffer.getRoot(), buffer.getOffset()};
+    }
+
+    DynamicBuffer buffer;
+};
+
+TEST_F(StatsSnapshotTest, Empty) {
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    EXPECT_EQ("{}", finish());
+}
+
+TEST_F(StatsSnapshotTest, Types) {
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    add("pid", "1234");
+    add("negative", "-5");
+    add("zero", "0");
+    add("enabled", "true");
+    add("disabled", "false");
+    add("version", "5.5.0-1234");
+    add("octal", "0755");
+    add("ratio", "0.5");
+    add("empty", "");
+    EXPECT_EQ(
+            R"({"pid":1234,"negative":-5,"zero":0,"enabled":true,)"
+            R"("disabled":false,"version":"5.5.0-1234","octal":"0755",)"
+            R"("ratio":"0.5","empty":""})",
+            finish());
+}
+
+TEST_F(StatsSnapshotTest, LargeNumbersAreStrings) {
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    add("max", "9223372036854775807");
+    add("huge", "18446744073709551615");
+    add("above_max", "9223372036854775808");
+    add("min", "-9223372036854775808");
+    add("below_min", "-9223372036854775809");
+    EXPECT_EQ(R"({"max":9223372036854775807,"huge":"18446744073709551615",)"
+              R"("above_max":"9223372036854775808",)"
+              R"("min":-9223372036854775808,)"
+              R"("below_min":"-9223372036854775809"})",
+              finish());
+}
+
+TEST_F(StatsSnapshotTest, Escaping) {
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    add("quote\"", "back\\slash");
+    add("tab", "a\tb\nc\rd");
+    add("ctrl", std::string("\x01\x1f", 2));
+    const auto json = finish();
+    EXPECT_EQ(R"({"quote\"":"back\\slash","tab":"a\tb\nc\rd",)"
+              R"("ctrl":"\u0001\u001f"})",
+              json);
+
+    unique_cJSON_ptr parsed(cJSON_Parse(json.c_str()));
+    ASSERT_TRUE(parsed);
+    auto* obj = cJSON_GetObjectItem(parsed.get(), "tab");
+    ASSERT_NE(nullptr, obj);
+    EXPECT_EQ(std::string("a\tb\nc\rd"), obj->valuestring);
+}
+
+TEST_F(StatsSnapshotTest, AppendsToExistingData) {
+    // The daemon reserves room for the response header in front of
+    // the document
+    ASSERT_TRUE(buffer.grow(24));
+    buffer.moveOffset(24);
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    add("a", "1");
+    add("b", "2");
+    ASSERT_TRUE(cb::stats::endSnapshot(buffer));
+    EXPECT_EQ(R"({"a":1,"b":2})",
+              std::string(buffer.getRoot() + 24, buffer.getOffset() - 24));
+}
+
+TEST_F(StatsSnapshotTest, ManyStats) {
+    ASSERT_TRUE(cb::stats::startSnapshot(buffer));
+    for (int ii = 0; ii < 10000; ++ii) {
+        add("stat_" + std::to_string(ii), std::to_string(ii));
+    }
+    unique_cJSON_ptr parsed(cJSON_Parse(finish().c_str()));
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(10000, cJSON_GetArraySize(parsed.get()));
+    auto* obj = cJSON_GetObjectItem(parsed.get(), "stat_9999");
+    ASSERT_NE(nullptr, obj);
+    EXPECT_EQ(9999, obj->valueint);
+}
@@ -0,0 +1,96 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of multi-path subdoc lookups; reports the number of paths
+ * looked up per second for different document sizes.
+ */
+
+#include "daemon/subdocument_container_index.h"
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+static const int numPaths = 16;
+
+/**
+ * Create a JSON document of (approximately) the given size, where the
+ * object the paths are looked up in is the last member of the document.
+ */
+static std::string makeDocument(size_t size) {
+    std::string doc = "{";
+    for (int ii = 0; doc.size() < size; ++ii) {
+        doc += "\"filler" + std::to_string(ii) +
+               R"(":{"name":"some name","values":[1,2,3,4,5,6,7,8]},)";
+    }
+    doc += R"("target":{)";
+    for (int ii = 0; ii < numPaths; ++ii) {
+        if (ii != 0) {
+            doc += ",";
+        }
+        doc += "\"field" + std::to_string(ii) + "\":" + std::to_string(ii);
+    }
+    doc += "}}";
+    return doc;
+}
+
+/*
+ * Look up numPaths sibling paths in a document of state.range(0) bytes,
+ * with or without narrowing the lookups with a SubdocContainerIndex (like
+ * a multi-path lookup command does).
+ */
+static void MultiPathLookup(benchmark::State& state, bool useIndex) {
+    const auto document = makeDocument(state.range(0));
+    std::vector<std::string> paths;
+    for (int ii = 0; ii < numPaths; ++ii) {
+        paths.push_back("target.field" + std::to_string(ii));
+    }
+
+    Subdoc::Operation op;
+    Subdoc::Result result;
+    SubdocContainerIndex index;
+    while (state.KeepRunning()) {
+        index.reset();
+        for (const auto& p : paths) {
+            cb::const_char_buffer doc{document.data(), document.size()};
+            cb::const_char_buffer path{p.data(), p.size()};
+            if (useIndex) {
+                index.narrow(op, doc, path);
+            }
+            op.clear();
+            op.set_result_buf(&result);
+            op.set_code(Subdoc::Command::GET);
+            op.set_doc(doc.buf, doc.len);
+            if (op.op_exec(path.buf, path.len) != Subdoc::Error::SUCCESS) {
+                state.SkipWithError("Lookup failed");
+                return;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numPaths);
+    state.SetBytesProcessed(state.iterations() * document.size());
+}
+
+BENCHMARK_CAPTURE(MultiPathLookup, FullScan, false)
+        ->RangeMultiplier(10)
+        ->Range(1000, 100000);
+BENCHMARK_CAPTURE(MultiPathLookup, ContainerIndex, true)
+        ->RangeMultiplier(10)
+        ->Range(1000, 100000);
+
+BENCHMARK_MAIN();
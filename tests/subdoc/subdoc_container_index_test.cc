@@ -0,0 +1,203 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "daemon/subdocument_container_index.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+
+class SubdocContainerIndexTest : public ::testing::Test {
+protected:
+    /// Look up path in doc, returning the error code and the matched value
+    std::pair<int, std::string> lookup(cb::const_char_buffer doc,
+                                       cb::const_char_buffer path) {
+        Subdoc::Result result;
+        op.clear();
+        op.set_result_buf(&result);
+        op.set_code(Subdoc::Command::GET);
+        op.set_doc(doc.buf, doc.len);
+        const auto error = op.op_exec(path.buf, path.len);
+        std::string value;
+        if (error == Subdoc::Error::SUCCESS) {
+            value.assign(result.matchloc().at, result.matchloc().length);
+        }
+        return {static_cast<int>(error), value};
+    }
+
+    /// Look up path in doc after narrowing it with the index
+    std::pair<int, std::string> narrowedLookup(const std::string& path) {
+        cb::const_char_buffer doc{document.data(), document.size()};
+        cb::const_char_buffer narrowed{path.data(), path.size()};
+        index.narrow(op, doc, narrowed);
+        return lookup(doc, narrowed);
+    }
+
+    std::pair<int, std::string> fullLookup(const std::string& path) {
+        return lookup({document.data(), document.size()},
+                      {path.data(), path.size()});
+    }
+
+    std::string document{
+            R"({"user":{"name":"joe","email":"joe@example.com",)"
+            R"("address":{"city":"Oslo","zip":[0,1,5,0]}},)"
+            R"("list":[1,2,[3,4]],"str":"value","a.b":{"c":true}})"};
+    Subdoc::Operation op;
+    SubdocContainerIndex index;
+};
+
+TEST_F(SubdocContainerIndexTest, SplitPath) {
+    auto split = [](const std::string& path) {
+        cb::const_char_buffer parent;
+        cb::const_char_buffer child;
+        if (!SubdocContainerIndex::splitPath({path.data(), path.size()},
+                                             parent,
+                                             child)) {
+            return std::make_pair(std::string{}, std::string{});
+        }
+        return std::make_pair(std::string{parent.buf, parent.len},
+                              std::string{child.buf, child.len});
+    };
+
+    using Split = std::pair<std::string, std::string>;
+    EXPECT_EQ(Split("", ""), split("a"));
+    EXPECT_EQ(Split("", ""), split("[0]"));
+    EXPECT_EQ(Split("", ""), split("`a.b`"));
+    EXPECT_EQ(Split("a", "b"), split("a.b"));
+    EXPECT_EQ(Split("a.b", "c"), split("a.b.c"));
+    EXPECT_EQ(Split("a", "[2]"), split("a[2]"));
+    EXPECT_EQ(Split("a[2]", "[-1]"), split("a[2][-1]"));
+    EXPECT_EQ(Split("[0]", "a"), split("[0].a"));
+    EXPECT_EQ(Split("a", "`b.c`"), split("a.`b.c`"));
+    EXPECT_EQ(Split("`a.b`", "c"), split("`a.b`.c"));
+    EXPECT_EQ(Split("a", "`b``[c`"), split("a.`b``[c`"));
+}
+
+TEST_F(SubdocContainerIndexTest, NarrowedLookupsMatchFullLookups) {
+    for (const std::string path : {"user.name",
+                                   "user.email",
+                                   "user.address.city",
+                                   "user.address.zip[2]",
+                                   "user.address.zip[-1]",
+                                   "user.missing",
+                                   "user[0]",
+                                   "list[0]",
+                                   "list[-1]",
+                                   "list[2][1]",
+                                   "list.x",
+                                   "str.x",
+                                   "missing.x",
+                                   "`a.b`.c",
+                                   "user.address"}) {
+        EXPECT_EQ(fullLookup(path), narrowedLookup(path)) << path;
+    }
+}
+
+TEST_F(SubdocContainerIndexTest, AncestorsAreIndexedOnce) {
+    EXPECT_EQ(fullLookup("user.address.city"),
+              narrowedLookup("user.address.city"));
+    // "user" and "user.address"
+    EXPECT_EQ(2u, index.size());
+
+    EXPECT_EQ(fullLookup("user.address.zip"),
+              narrowedLookup("user.address.zip"));
+    EXPECT_EQ(fullLookup("user.name"), narrowedLookup("user.name"));
+    EXPECT_EQ(2u, index.size());
+
+    // Misses are indexed as well
+    EXPECT_EQ(fullLookup("missing.x"), narrowedLookup("missing.x"));
+    EXPECT_EQ(fullLookup("missing.y"), narrowedLookup("missing.y"));
+    EXPECT_EQ(3u, index.size());
+
+    index.reset();
+    EXPECT_EQ(0u, index.size());
+}
+
+TEST_F(SubdocContainerIndexTest, CountComponents) {
+    auto count = [](const std::string& path) {
+        return SubdocContainerIndex::countComponents(
+                {path.data(), path.size()});
+    };
+    EXPECT_EQ(1u, count("a"));
+    EXPECT_EQ(1u, count("[0]"));
+    EXPECT_EQ(1u, count("`a.b[0]`"));
+    EXPECT_EQ(3u, count("a.b[2]"));
+    EXPECT_EQ(4u, count("[0].a[1][-1]"));
+    EXPECT_EQ(2u, count("a.`b``[c`"));
+}
+
+TEST_F(SubdocContainerIndexTest, NestingDepth) {
+    auto depth = [](const std::string& value) {
+        return SubdocContainerIndex::nestingDepth(
+                {value.data(), value.size()});
+    };
+    EXPECT_EQ(0u, depth("1"));
+    EXPECT_EQ(1u, depth("{}"));
+    EXPECT_EQ(2u, depth(R"({"a":[1,2],"b":{}})"));
+    // Brackets within strings don't count
+    EXPECT_EQ(1u, depth(R"({"a":"[[{\"[","b":"]]"})"));
+}
+
+/// @return a document of nested objects with the keys "1", "2", ...
+static std::string makeNestedDict(int levels) {
+    std::string doc;
+    for (int ii = 1; ii < levels; ++ii) {
+        doc += R"({")" + std::to_string(ii) + R"(":)";
+    }
+    doc += "{}";
+    doc.append(levels - 1, '}');
+    return doc;
+}
+
+/// @return the path "1.2. ... .components"
+static std::string makeNestedPath(int components) {
+    std::string path = "1";
+    for (int ii = 2; ii <= components; ++ii) {
+        path += "." + std::to_string(ii);
+    }
+    return path;
+}
+
+// A path longer than subjson allows must fail with PATH_E2BIG, even though
+// its last component would be found within its (indexed) parent.
+TEST_F(SubdocContainerIndexTest, PathTooBig) {
+    document = makeNestedDict(SubdocContainerIndex::MaxDepth + 1);
+    const auto path = makeNestedPath(SubdocContainerIndex::MaxDepth);
+    const auto full = fullLookup(path);
+    EXPECT_EQ(int(Subdoc::Error::PATH_E2BIG), full.first);
+    EXPECT_EQ(full, narrowedLookup(path));
+
+    // The longest valid path still succeeds
+    index.reset();
+    document = makeNestedDict(SubdocContainerIndex::MaxDepth);
+    const auto longest = makeNestedPath(SubdocContainerIndex::MaxDepth - 1);
+    EXPECT_EQ(int(Subdoc::Error::SUCCESS), fullLookup(longest).first);
+    EXPECT_EQ(fullLookup(longest), narrowedLookup(longest));
+}
+
+// A document nested deeper than subjson allows must fail with DOC_ETOODEEP,
+// even though the nesting within the (indexed) parent is within the limit.
+TEST_F(SubdocContainerIndexTest, DocTooDeep) {
+    const std::string deep =
+            std::string(SubdocContainerIndex::MaxDepth - 1, '[') +
+            std::string(SubdocContainerIndex::MaxDepth - 1, ']');
+    document = R"({"x":{"a":{"deep":)" + deep + R"(,"c":1}}})";
+    for (const std::string path : {"x.a.c", "x.a.deep", "x.a.deep[0]"}) {
+        const auto full = fullLookup(path);
+        EXPECT_EQ(int(Subdoc::Error::DOC_ETOODEEP), full.first) << path;
+        EXPECT_EQ(full, narrowedLookup(path)) << path;
+    }
+}
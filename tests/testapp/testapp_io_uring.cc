@@ -0,0 +1,152 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Tests for memcached configured to use the io_uring network backend. If
+ * the kernel (or the build) doesn't support io_uring the worker threads
+ * fall back to libevent, so the tests should pass in both cases.
+ */
+
+#include "testapp.h"
+#include "testapp_client_test.h"
+
+#include "daemon/io_uring_backend.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+class IoUringTest : public TestappClientTest {
+public:
+    static void SetUpTestCase() {
+        token = 0xdeadbeef;
+        memcached_cfg.reset(generate_config(0));
+        cJSON_AddStringToObject(
+                memcached_cfg.get(), "network_backend", "io_uring");
+        start_memcached_server(memcached_cfg.get());
+
+        if (HasFailure()) {
+            server_pid = reinterpret_cast<pid_t>(-1);
+        } else {
+            CreateTestBucket();
+        }
+    }
+};
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        IoUringTest,
+                        ::testing::Values(TransportProtocols::McbpPlain,
+                                          TransportProtocols::McbpIpv6Plain,
+                                          TransportProtocols::McbpSsl,
+                                          TransportProtocols::McbpIpv6Ssl),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(IoUringTest, SettingsStat) {
+    auto& conn = getConnection();
+    auto stats = conn.stats("settings");
+    auto* backend = cJSON_GetObjectItem(stats.get(), "network_backend");
+    ASSERT_NE(nullptr, backend);
+    // The stat reports the backend in use, which is libevent only if we had
+    // to fall back (i.e. built without io_uring, or the kernel lacks it)
+    EXPECT_STREQ(IoUringBackend::isSupported() ? "io_uring" : "libevent",
+                 backend->valuestring);
+}
+
+/**
+ * Store and fetch documents of different sizes to make sure that we
+ * handle values spanning multiple of the backends receive buffers
+ * (and responses requiring multiple send operations).
+ */
+TEST_P(IoUringTest, SetGetDifferentSizes) {
+    auto& conn = getConnection();
+    for (const size_t size : {size_t(0), size_t(1), size_t(4096),
+                              size_t(16384), size_t(65537),
+                              size_t(1024 * 1024)}) {
+        Document doc;
+        doc.info.cas = mcbp::cas::Wildcard;
+        doc.info.datatype = cb::mcbp::Datatype::Raw;
+        doc.info.id = name + std::to_string(size);
+        doc.value.resize(size);
+        for (size_t ii = 0; ii < size; ++ii) {
+            doc.value[ii] = char('a' + (ii % 26));
+        }
+        conn.mutate(doc, 0, MutationType::Set);
+
+        const auto stored = conn.get(doc.info.id, 0);
+        EXPECT_EQ(doc.value, stored.value) << "Size: " << size;
+    }
+}
+
+/**
+ * Store and fetch values larger than the share of the receive buffers a
+ * connection may hold, from more connections than there are shares at the
+ * same time. Every connection must keep making progress (and receive its
+ * own data intact) while the buffers are exhausted.
+ */
+TEST_P(IoUringTest, ConcurrentLargeValues) {
+    auto& conn = getConnection();
+    const int numConnections = 16;
+    std::vector<std::unique_ptr<MemcachedConnection>> connections;
+    for (int ii = 0; ii < numConnections; ++ii) {
+        connections.push_back(conn.clone());
+    }
+
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < numConnections; ++ii) {
+        threads.emplace_back([this, &connections, ii]() {
+            Document doc;
+            doc.info.cas = mcbp::cas::Wildcard;
+            doc.info.datatype = cb::mcbp::Datatype::Raw;
+            doc.info.id = name + std::to_string(ii);
+            doc.value = std::string(2 * 1024 * 1024, char('a' + ii));
+
+            auto& c = *connections[ii];
+            for (int jj = 0; jj < 5; ++jj) {
+                c.mutate(doc, 0, MutationType::Set);
+                EXPECT_EQ(doc.value, c.get(doc.info.id, 0).value)
+                        << "Connection: " << ii;
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Make the engine block (and notify the connection from another thread) the
+ * first time each command calls it, so every command is completed through
+ * notify_io_complete while the backend may hold received data for the
+ * connection.
+ */
+TEST_P(IoUringTest, EWouldBlockLargeValues) {
+    auto& conn = getConnection();
+    conn.configureEwouldBlockEngine(EWBEngineMode::First);
+
+    Document doc;
+    doc.info.cas = mcbp::cas::Wildcard;
+    doc.info.datatype = cb::mcbp::Datatype::Raw;
+    for (int ii = 0; ii < 10; ++ii) {
+        doc.info.id = name + std::to_string(ii);
+        doc.value = std::string(512 * 1024 + ii, char('a' + ii));
+        conn.mutate(doc, 0, MutationType::Set);
+        EXPECT_EQ(doc.value, conn.get(doc.info.id, 0).value) << ii;
+    }
+
+    conn.disableEwouldBlockEngine();
+}
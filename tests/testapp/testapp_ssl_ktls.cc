@@ -0,0 +1,232 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Verify that SSL connections are offloaded to the kernel (kTLS) when
+ * "ssl_kernel_tls" is enabled, that data still flows correctly through an
+ * offloaded connection, and compare the throughput over the loopback
+ * interface with the offload enabled and disabled. Only TLS 1.2 is
+ * offloaded, so the test client doesn't negotiate anything newer. The
+ * offload assertions are skipped if the kernel doesn't support TLS offload.
+ */
+
+#include "testapp.h"
+#include "testapp_client_test.h"
+
+#include <chrono>
+#include <iostream>
+
+#ifdef HAVE_KTLS
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+
+/**
+ * Check if the kernel supports TLS offload by trying to enable the "tls"
+ * upper layer protocol on a connected loopback socket (which also loads
+ * the tls module if needed)
+ */
+static bool kernelSupportsTls() {
+#ifdef HAVE_KTLS
+    bool supported = false;
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    auto* sa = reinterpret_cast<sockaddr*>(&addr);
+    if (listener != -1 && client != -1 && bind(listener, sa, len) == 0 &&
+        listen(listener, 1) == 0 && getsockname(listener, sa, &len) == 0 &&
+        connect(client, sa, len) == 0) {
+        supported = setsockopt(client,
+                               IPPROTO_TCP,
+                               TCP_ULP,
+                               "tls",
+                               sizeof("tls")) == 0;
+    }
+    if (client != -1) {
+        close(client);
+    }
+    if (listener != -1) {
+        close(listener);
+    }
+    return supported;
+#else
+    return false;
+#endif
+}
+
+class SslKernelTlsTest : public TestappClientTest {
+protected:
+    void TearDown() override {
+        setKernelTls(false);
+        TestappClientTest::TearDown();
+    }
+
+    void setKernelTls(bool enable) {
+        cJSON_DeleteItemFromObject(memcached_cfg.get(), "ssl_kernel_tls");
+        cJSON_AddItemToObject(memcached_cfg.get(),
+                              "ssl_kernel_tls",
+                              enable ? cJSON_CreateTrue() : cJSON_CreateFalse());
+        reconfigure();
+    }
+
+    /**
+     * Get a new (TLS 1.2) connection with a unique agent name, and run a
+     * set / get loop with a 32k value on it
+     *
+     * @param iterations the number of set / get pairs to run
+     * @return the connection, and the microseconds the loop took
+     */
+    std::pair<MemcachedConnection*, int64_t> runSetGetLoop(int iterations) {
+        auto& conn = getConnection();
+        conn.setSslMaxTls12(true);
+        prepare(conn);
+        agentName = "ktls" + std::to_string(++connectionCount);
+        conn.hello(agentName, "1.0", "kTLS test");
+        Document doc;
+        doc.info.cas = mcbp::cas::Wildcard;
+        doc.info.datatype = cb::mcbp::Datatype::Raw;
+        doc.info.id = name;
+        doc.value = std::string(32 * 1024, 'x');
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int ii = 0; ii < iterations; ++ii) {
+            conn.mutate(doc, 0, MutationType::Set);
+            const auto fetched = conn.get(doc.info.id, 0);
+            EXPECT_EQ(doc.value, fetched.value);
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+        return {&conn,
+                std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                        .count()};
+    }
+
+    /**
+     * Get the "ssl" object from the connection stats of the connection
+     * created by runSetGetLoop()
+     */
+    unique_cJSON_ptr getSslStats(MemcachedConnection& conn) {
+        const auto agent = agentName + " 1.0";
+        auto stats = conn.stats("connections");
+        for (auto* c = stats.get()->child; c != nullptr; c = c->next) {
+            unique_cJSON_ptr json(cJSON_Parse(c->valuestring));
+            if (!json) {
+                continue;
+            }
+            auto* ptr = cJSON_GetObjectItem(json.get(), "agent_name");
+            if (ptr != nullptr && agent == ptr->valuestring) {
+                return unique_cJSON_ptr(
+                        cJSON_DetachItemFromObject(json.get(), "ssl"));
+            }
+        }
+        return {};
+    }
+
+    /**
+     * Check that the connection negotiated TLS 1.2 and that the offload
+     * state of both directions is as expected
+     */
+    void expectOffloaded(MemcachedConnection& conn, bool offloaded) {
+        auto ssl = getSslStats(conn);
+        ASSERT_NE(nullptr, ssl.get());
+        auto* protocol = cJSON_GetObjectItem(ssl.get(), "protocol");
+        ASSERT_NE(nullptr, protocol);
+        EXPECT_STREQ("TLSv1.2", protocol->valuestring);
+        const auto expected = offloaded ? cJSON_True : cJSON_False;
+        EXPECT_EQ(expected, cJSON_GetObjectItem(ssl.get(), "ktls_rx")->type);
+        EXPECT_EQ(expected, cJSON_GetObjectItem(ssl.get(), "ktls_tx")->type);
+    }
+
+    /**
+     * Check if the kernel supports TLS offload; printing a note that the
+     * test is skipped if it doesn't
+     */
+    bool canOffload() {
+        if (kernelSupportsTls()) {
+            return true;
+        }
+        std::cout << "Note: skipping test '"
+                  << ::testing::UnitTest::GetInstance()
+                             ->current_test_info()
+                             ->name()
+                  << "' as the kernel doesn't support TLS offload.\n";
+        return false;
+    }
+
+    std::string agentName;
+    static int connectionCount;
+};
+
+int SslKernelTlsTest::connectionCount = 0;
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        SslKernelTlsTest,
+                        ::testing::Values(TransportProtocols::McbpSsl,
+                                          TransportProtocols::McbpIpv6Ssl),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(SslKernelTlsTest, SettingsStat) {
+    setKernelTls(true);
+    auto stats = getConnection().stats("settings");
+    auto* value = cJSON_GetObjectItem(stats.get(), "ssl_kernel_tls");
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(cJSON_True, value->type);
+}
+
+TEST_P(SslKernelTlsTest, Disabled) {
+    setKernelTls(false);
+    expectOffloaded(*runSetGetLoop(100).first, false);
+}
+
+TEST_P(SslKernelTlsTest, Offloaded) {
+    if (!canOffload()) {
+        return;
+    }
+    setKernelTls(true);
+    expectOffloaded(*runSetGetLoop(100).first, true);
+}
+
+/**
+ * Compare the time of a set / get loop over the loopback interface with
+ * the offload disabled and enabled. The times are recorded as properties of
+ * the test (in its XML output) rather than asserted, as they depend on the
+ * machine running the test.
+ */
+TEST_P(SslKernelTlsTest, CompareThroughput) {
+    const int iterations = 2000;
+
+    setKernelTls(false);
+    const auto openssl = runSetGetLoop(iterations);
+    expectOffloaded(*openssl.first, false);
+    RecordProperty("openssl_us", int(openssl.second));
+
+    if (!canOffload()) {
+        return;
+    }
+    setKernelTls(true);
+    const auto ktls = runSetGetLoop(iterations);
+    expectOffloaded(*ktls.first, true);
+    RecordProperty("ktls_us", int(ktls.second));
+}
@@ -200,6 +200,40 @@ TEST_P(StatsTest, TestSettings) {
     // Skip audit.. it is "optional" and we don't pass it to the config
 }
 
+TEST_P(StatsTest, TestSnapshotRequiresJson) {
+    MemcachedConnection& conn = getConnection();
+    conn.setDatatypeJson(false);
+    try {
+        conn.statsSnapshot("settings");
+        FAIL() << "stats snapshot should fail without the JSON datatype";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+}
+
+TEST_P(StatsTest, TestSnapshot) {
+    MemcachedConnection& conn = getConnection();
+    conn.setDatatypeJson(true);
+
+    unique_cJSON_ptr stats;
+    ASSERT_NO_THROW(stats = conn.statsSnapshot("settings"));
+    ASSERT_NE(nullptr, stats.get());
+    auto* maxconns = cJSON_GetObjectItem(stats.get(), "maxconns");
+    ASSERT_NE(nullptr, maxconns);
+    EXPECT_EQ(cJSON_Number, maxconns->type);
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "auth_sasl_engine"));
+
+    // The snapshot should hold (at least) the same stats as the packet
+    // per stat version (which drops duplicate keys)
+    auto packets = conn.stats("settings");
+    EXPECT_LE(cJSON_GetArraySize(packets.get()),
+              cJSON_GetArraySize(stats.get()));
+
+    // and the connection should be usable for the next request
+    ASSERT_NO_THROW(stats = conn.statsSnapshot(""));
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "curr_connections"));
+}
+
 TEST_P(StatsTest, TestAuditNoAccess) {
     MemcachedConnection& conn = getConnection();
 
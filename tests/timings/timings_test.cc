@@ -0,0 +1,183 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <cJSON_utils.h>
+#include <daemon/timings.h>
+#include <gtest/gtest.h>
+#include <memcached/protocol_binary.h>
+
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(HdrBucketLayoutTest, SmallValuesHaveTheirOwnBucket) {
+    for (uint64_t ii = 0; ii < HdrBucketLayout::SubBuckets; ++ii) {
+        EXPECT_EQ(ii, HdrBucketLayout::getIndex(ii));
+        EXPECT_EQ(ii, HdrBucketLayout::getLowestValue(ii));
+        EXPECT_EQ(ii, HdrBucketLayout::getHighestValue(ii));
+    }
+}
+
+TEST(HdrBucketLayoutTest, IndexRoundTrip) {
+    for (size_t ii = 0; ii < HdrBucketLayout::NumBuckets - 1; ++ii) {
+        const auto low = HdrBucketLayout::getLowestValue(ii);
+        const auto high = HdrBucketLayout::getHighestValue(ii);
+        ASSERT_LE(low, high);
+        EXPECT_EQ(ii, HdrBucketLayout::getIndex(low));
+        EXPECT_EQ(ii, HdrBucketLayout::getIndex(high));
+        EXPECT_EQ(high + 1, HdrBucketLayout::getLowestValue(ii + 1));
+        // The bucket width is at most 1/32 of the value
+        EXPECT_LE((high - low) * HdrBucketLayout::SubBuckets, low + 1);
+    }
+}
+
+TEST(HdrBucketLayoutTest, HugeValuesGoInTheLastBucket) {
+    EXPECT_EQ(HdrBucketLayout::NumBuckets - 1,
+              HdrBucketLayout::getIndex(uint64_t(1) << 50));
+    EXPECT_EQ(HdrBucketLayout::NumBuckets - 1,
+              HdrBucketLayout::getIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(HdrTimingHistogramTest, Percentiles) {
+    HdrTimingHistogram histogram;
+    EXPECT_EQ(0ns, histogram.getValueAtPercentile(99.9));
+
+    // 10000 values of 1-10000us
+    for (int ii = 1; ii <= 10000; ++ii) {
+        histogram.add(std::chrono::microseconds(ii));
+    }
+    EXPECT_EQ(10000u, histogram.getTotal());
+
+    auto within = [](std::chrono::nanoseconds value,
+                     std::chrono::nanoseconds expected) {
+        return value >= expected && value <= expected + expected / 32;
+    };
+    EXPECT_TRUE(within(histogram.getValueAtPercentile(50), 5000us));
+    EXPECT_TRUE(within(histogram.getValueAtPercentile(99), 9900us));
+    EXPECT_TRUE(within(histogram.getValueAtPercentile(99.9), 9990us));
+    EXPECT_TRUE(within(histogram.getValueAtPercentile(99.99), 9999us));
+    EXPECT_TRUE(within(histogram.getValueAtPercentile(100), 10000us));
+}
+
+TEST(HdrTimingHistogramTest, Merge) {
+    HdrTimingHistogram a;
+    HdrTimingHistogram b;
+    a.add(10us);
+    b.add(10us);
+    b.add(1s);
+    a += b;
+    EXPECT_EQ(3u, a.getTotal());
+    EXPECT_EQ(2u, a.getCount(HdrBucketLayout::getIndex(10000)));
+    EXPECT_EQ(1u, a.getCount(HdrBucketLayout::getIndex(1000000000)));
+}
+
+TEST(HdrTimingHistogramTest, LegacyFormat) {
+    HdrTimingHistogram histogram;
+    histogram.add(100ns);
+    histogram.add(15us);
+    histogram.add(2500us);
+    histogram.add(700ms);
+    histogram.add(100s);
+
+    unique_cJSON_ptr json(cJSON_Parse(histogram.to_string().c_str()));
+    ASSERT_NE(nullptr, json.get());
+
+    EXPECT_EQ(1, cJSON_GetObjectItem(json.get(), "ns")->valueint);
+    auto* us = cJSON_GetObjectItem(json.get(), "us");
+    ASSERT_NE(nullptr, us);
+    EXPECT_EQ(100, cJSON_GetArraySize(us));
+    EXPECT_EQ(1, cJSON_GetArrayItem(us, 1)->valueint);
+    auto* ms = cJSON_GetObjectItem(json.get(), "ms");
+    ASSERT_NE(nullptr, ms);
+    EXPECT_EQ(49, cJSON_GetArraySize(ms));
+    EXPECT_EQ(1, cJSON_GetArrayItem(ms, 1)->valueint);
+    auto* halfsec = cJSON_GetObjectItem(json.get(), "500ms");
+    ASSERT_NE(nullptr, halfsec);
+    EXPECT_EQ(1, cJSON_GetArrayItem(halfsec, 1)->valueint);
+    EXPECT_EQ(1, cJSON_GetObjectItem(json.get(), "80s-inf")->valueint);
+    EXPECT_EQ(1, cJSON_GetObjectItem(json.get(), "wayout")->valueint);
+
+    auto* hdr = cJSON_GetObjectItem(json.get(), "hdr");
+    ASSERT_NE(nullptr, hdr);
+    EXPECT_EQ(5, cJSON_GetObjectItem(hdr, "total")->valueint);
+    EXPECT_EQ(5, cJSON_GetArraySize(cJSON_GetObjectItem(hdr, "buckets")));
+    auto* percentiles = cJSON_GetObjectItem(hdr, "percentiles");
+    ASSERT_NE(nullptr, percentiles);
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(percentiles, "99.99"));
+}
+
+TEST(TimingsTest, CollectFromMultipleThreads) {
+    Timings timings;
+    const int numThreads = 8;
+    const int numOps = 10000;
+
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < numThreads; ++ii) {
+        threads.emplace_back([&timings]() {
+            for (int op = 0; op < numOps; ++op) {
+                timings.collect(PROTOCOL_BINARY_CMD_GET, 10us);
+                timings.collect(PROTOCOL_BINARY_CMD_SET, 20us);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(uint64_t(numThreads * numOps),
+              timings.get_aggregated_retrival_stats());
+    EXPECT_EQ(uint64_t(numThreads * numOps),
+              timings.get_aggregated_mutation_stats());
+
+    unique_cJSON_ptr json(
+            cJSON_Parse(timings.generate(PROTOCOL_BINARY_CMD_GET).c_str()));
+    ASSERT_NE(nullptr, json.get());
+    auto* hdr = cJSON_GetObjectItem(json.get(), "hdr");
+    ASSERT_NE(nullptr, hdr);
+    EXPECT_EQ(numThreads * numOps, cJSON_GetObjectItem(hdr, "total")->valueint);
+}
+
+TEST(TimingsTest, SampleUsesDelta) {
+    Timings timings;
+    timings.collect(PROTOCOL_BINARY_CMD_GET, 10us);
+    timings.sample(std::chrono::seconds(1));
+    timings.collect(PROTOCOL_BINARY_CMD_GET, 10us);
+    timings.sample(std::chrono::seconds(1));
+
+    // Each sample should contain a single op (and not 1 and 2)
+    auto interval = timings.get_interval_lookup_latency();
+    EXPECT_EQ(2u, interval.count.load());
+    EXPECT_EQ(20000u, interval.duration_ns.load());
+}
+
+TEST(TimingsTest, Reset) {
+    Timings timings;
+    timings.collect(PROTOCOL_BINARY_CMD_SET, 10us);
+    EXPECT_EQ(1u, timings.get_aggregated_mutation_stats());
+    timings.reset();
+    EXPECT_EQ(0u, timings.get_aggregated_mutation_stats());
+}
+
+TEST(TimingsTest, Assign) {
+    Timings timings;
+    timings.collect(PROTOCOL_BINARY_CMD_SET, 10us);
+    Timings copy;
+    copy.collect(PROTOCOL_BINARY_CMD_GET, 10us);
+    copy = timings;
+    EXPECT_EQ(1u, copy.get_aggregated_mutation_stats());
+    EXPECT_EQ(0u, copy.get_aggregated_retrival_stats());
+}
@@ -16,7 +16,9 @@
  */
 #include "daemon/topkeys.h"
 
+#include <cJSON_utils.h>
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 
 
@@ -24,9 +26,32 @@ class TopKeysTest : public ::testing::Test {
 protected:
     void SetUp() {
         settings.setTopkeysEnabled(true);
+        settings.setTopkeysSampleRate(1);
         topkeys.reset(new TopKeys(10));
     }
 
+    struct Entry {
+        uint64_t count;
+        uint64_t error;
+    };
+
+    /// Get the reported keys (and their count / error) from json_stats
+    std::map<std::string, Entry> getTopKeys() {
+        unique_cJSON_ptr json(cJSON_CreateObject());
+        EXPECT_EQ(ENGINE_SUCCESS, topkeys->json_stats(json.get(), 0));
+        std::map<std::string, Entry> ret;
+        auto* array = cJSON_GetObjectItem(json.get(), "topkeys");
+        for (auto* it = array->child; it != nullptr; it = it->next) {
+            Entry entry;
+            entry.count = uint64_t(
+                    cJSON_GetObjectItem(it, "access_count")->valuedouble);
+            entry.error =
+                    uint64_t(cJSON_GetObjectItem(it, "max_error")->valuedouble);
+            ret[cJSON_GetObjectItem(it, "key")->valuestring] = entry;
+        }
+        return ret;
+    }
+
     std::unique_ptr<TopKeys> topkeys;
 };
 
@@ -58,3 +83,100 @@ TEST_F(TopKeysTest, Basic) {
     topkeys->stats(&count, 0, dump_key);
     EXPECT_EQ(80, count);
 }
+
+TEST_F(TopKeysTest, HeavyHittersAreTracked) {
+    std::vector<std::string> hot;
+    for (int ii = 0; ii < 5; ii++) {
+        hot.emplace_back("hot_" + std::to_string(ii));
+    }
+
+    // Interleave the hot keys with a lot of keys only accessed once
+    for (int jj = 0; jj < 2000; jj++) {
+        const auto cold = "cold_" + std::to_string(jj);
+        topkeys->updateKey(cold.c_str(), cold.size(), jj);
+        if ((jj % 10) == 0) {
+            for (auto& key : hot) {
+                topkeys->updateKey(key.c_str(), key.size(), jj);
+            }
+        }
+    }
+
+    const auto keys = getTopKeys();
+    for (auto& key : hot) {
+        auto iter = keys.find(key);
+        ASSERT_NE(keys.end(), iter) << key << " should be tracked";
+        // The true count (200) is within [count, count + error]
+        EXPECT_LE(iter->second.count, 200u);
+        EXPECT_GE(iter->second.count + iter->second.error, 200u);
+    }
+}
+
+TEST_F(TopKeysTest, ExactCountWhenTrackedFromStart) {
+    const std::string key("exact");
+    for (int ii = 0; ii < 100; ii++) {
+        topkeys->updateKey(key.c_str(), key.size(), ii);
+    }
+
+    const auto keys = getTopKeys();
+    auto iter = keys.find(key);
+    ASSERT_NE(keys.end(), iter);
+    EXPECT_EQ(100u, iter->second.count);
+    EXPECT_EQ(0u, iter->second.error);
+}
+
+TEST_F(TopKeysTest, Sampling) {
+    settings.setTopkeysSampleRate(8);
+    const std::string key("sampled");
+    for (int ii = 0; ii < 8000; ii++) {
+        topkeys->updateKey(key.c_str(), key.size(), ii);
+    }
+    settings.setTopkeysSampleRate(1);
+
+    // Every 8th operation from this thread is recorded with a weight of 8
+    const auto keys = getTopKeys();
+    auto iter = keys.find(key);
+    ASSERT_NE(keys.end(), iter);
+    EXPECT_EQ(8000u, iter->second.count);
+}
+
+/// Exposes the sampling decision of TopKeys to the tests
+class SamplingTopKeys : public TopKeys {
+public:
+    SamplingTopKeys() : TopKeys(10) {
+    }
+
+    using TopKeys::shouldSample;
+};
+
+TEST_F(TopKeysTest, SampleFraction) {
+    // A single thread always uses the same counter, so exactly every
+    // rate'th call is sampled
+    for (uint32_t rate : {2, 5, 64}) {
+        SamplingTopKeys sampler;
+        int sampled = 0;
+        for (uint32_t ii = 1; ii <= rate * 100; ii++) {
+            const bool expected = (ii % rate) == 0;
+            EXPECT_EQ(expected, sampler.shouldSample(rate))
+                    << "rate:" << rate << " call:" << ii;
+            sampled += expected ? 1 : 0;
+        }
+        EXPECT_EQ(100, sampled);
+    }
+}
+
+TEST_F(TopKeysTest, SampleWeight) {
+    settings.setTopkeysSampleRate(8);
+    const std::string key("weighted");
+    // The last 7 operations don't reach the next sample
+    for (int ii = 0; ii < 807; ii++) {
+        topkeys->updateKey(key.c_str(), key.size(), ii);
+    }
+    settings.setTopkeysSampleRate(1);
+
+    // 100 sampled operations, each recorded with a weight of 8
+    const auto keys = getTopKeys();
+    auto iter = keys.find(key);
+    ASSERT_NE(keys.end(), iter);
+    EXPECT_EQ(800u, iter->second.count);
+    EXPECT_EQ(0u, iter->second.error);
+}
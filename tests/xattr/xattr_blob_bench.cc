@@ -0,0 +1,118 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of cb::xattr::Blob for xattr heavy documents; a large "_sync"
+ * xattr (like the one Sync Gateway maintains) plus state.range(0) other
+ * system and user xattrs.
+ */
+
+#include <benchmark/benchmark.h>
+#include <xattr/blob.h>
+
+#include <string>
+#include <vector>
+
+static std::string makeSyncValue(size_t size) {
+    std::string value = R"({"rev":"1-abc","sequence":1,"history":[)";
+    while (value.size() < size) {
+        value += R"("1-0123456789abcdef",)";
+    }
+    value.back() = ']';
+    value += "}";
+    return value;
+}
+
+static std::vector<std::string> makeKeys(int count) {
+    std::vector<std::string> keys;
+    for (int ii = 0; ii < count; ++ii) {
+        keys.push_back((ii % 2 ? "_sys" : "user") + std::to_string(ii));
+    }
+    return keys;
+}
+
+/**
+ * Encode a blob with a 4k "_sync" xattr first, followed by the given keys
+ */
+static std::vector<uint8_t> makeBlob(const std::vector<std::string>& keys) {
+    cb::xattr::Blob blob;
+    blob.set("_sync", makeSyncValue(4096));
+    for (const auto& key : keys) {
+        blob.set(key, R"({"field":"value"})");
+    }
+    const auto encoded = blob.finalize();
+    return {encoded.buf, encoded.buf + encoded.len};
+}
+
+/*
+ * Look up every key of the blob, like a multi-path xattr lookup does on
+ * a Blob created for the command.
+ */
+static void XattrGet(benchmark::State& state) {
+    const auto keys = makeKeys(state.range(0));
+    auto encoded = makeBlob(keys);
+
+    while (state.KeepRunning()) {
+        cb::xattr::Blob blob({encoded.data(), encoded.size()});
+        for (const auto& key : keys) {
+            benchmark::DoNotOptimize(blob.get(key));
+        }
+        benchmark::DoNotOptimize(blob.get("_sync"));
+    }
+    state.SetItemsProcessed(state.iterations() * (keys.size() + 1));
+}
+
+/*
+ * Update "_sync" (the first xattr) in a copy of the blob, with a value of
+ * the same size (arg 1 == 0) or a larger one (arg 1 == 1).
+ */
+static void XattrSetSync(benchmark::State& state) {
+    const auto keys = makeKeys(state.range(0));
+    auto encoded = makeBlob(keys);
+    const cb::xattr::Blob original({encoded.data(), encoded.size()});
+    const auto value = makeSyncValue(state.range(1) ? 4200 : 4096);
+
+    while (state.KeepRunning()) {
+        cb::xattr::Blob blob(original);
+        blob.set("_sync", value);
+        benchmark::DoNotOptimize(blob.finalize());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/*
+ * Strip the user xattrs from a copy of the blob, like DCP does for
+ * consumers which don't want them.
+ */
+static void XattrPruneUserKeys(benchmark::State& state) {
+    const auto keys = makeKeys(state.range(0));
+    auto encoded = makeBlob(keys);
+    const cb::xattr::Blob original({encoded.data(), encoded.size()});
+
+    while (state.KeepRunning()) {
+        cb::xattr::Blob blob(original);
+        blob.prune_user_keys();
+        benchmark::DoNotOptimize(blob.finalize());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(XattrGet)->RangeMultiplier(4)->Range(4, 256);
+BENCHMARK(XattrSetSync)->Ranges({{4, 256}, {0, 1}});
+BENCHMARK(XattrPruneUserKeys)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_MAIN();
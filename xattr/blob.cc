@@ -17,6 +17,7 @@
 #include "config.h"
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <xattr/blob.h>
 
@@ -32,35 +33,133 @@ Blob::Blob(const Blob& other)
 }
 
 cb::byte_buffer Blob::get(const cb::const_byte_buffer& key) const {
+    const auto offset = find(key);
+    if (offset == 0) {
+        // Not found!
+        return {nullptr, 0};
+    }
+
+    auto* value = blob.buf + offset + 4 + key.len + 1;
+    return {value, strlen(reinterpret_cast<char*>(value))};
+}
+
+/**
+ * Compare two keys the way std::string::compare() does
+ */
+static int compare_keys(const cb::const_byte_buffer& a,
+                        const cb::const_byte_buffer& b) {
+    const auto ret = std::memcmp(a.buf, b.buf, std::min(a.len, b.len));
+    if (ret != 0) {
+        return ret;
+    }
+    return (a.len < b.len) ? -1 : (a.len > b.len) ? 1 : 0;
+}
+
+size_t Blob::find(const cb::const_byte_buffer& key) const {
+    auto less = [this](uint32_t offset, const cb::const_byte_buffer& k) {
+        return compare_keys(key_at(offset), k) < 0;
+    };
+
+    if (indexed) {
+        auto iter = std::lower_bound(index.begin(), index.end(), key, less);
+        if (iter != index.end() && compare_keys(key_at(*iter), key) == 0) {
+            return *iter;
+        }
+        return 0;
+    }
+
     try {
         size_t current = 4;
         while (current < blob.len) {
             // Get the length of the next kv-pair
             const auto size = read_length(current);
-            current += 4;
-            if (size > key.len) {
-                // This may be the next key
-                if (blob.buf[current + key.len] == '\0' &&
-                    std::memcmp(blob.buf + current, key.buf, key.len) == 0) {
-                    // Yay this is the key!!!
-                    auto* value = blob.buf + current + key.len + 1;
-                    return {value, strlen(reinterpret_cast<char*>(value))};
-                } else {
-                    // jump to the next key!!
-                    current += size;
-                }
-            } else {
-                current += size;
+            if (size > key.len &&
+                blob.buf[current + 4 + key.len] == '\0' &&
+                std::memcmp(blob.buf + current + 4, key.buf, key.len) == 0) {
+                // Yay this is the key!!!
+                return current;
+            }
+
+            // jump to the next key!!
+            current += 4 + size;
+            if (++scanned > IndexThreshold) {
+                // Scanning has become expensive; index the keys and look it
+                // up in the index instead
+                build_index();
+                return find(key);
             }
         }
     } catch (const std::out_of_range& ex) {
     }
 
-    // Not found!
-    return {nullptr, 0};
+    return 0;
+}
+
+cb::const_byte_buffer Blob::key_at(size_t offset) const {
+    const auto* key = blob.buf + offset + 4;
+    return {key, strlen(reinterpret_cast<const char*>(key))};
+}
+
+void Blob::build_index() const {
+    index.clear();
+    try {
+        size_t current = 4;
+        while (current < blob.len) {
+            const auto size = read_length(current);
+            index.push_back(uint32_t(current));
+            current += 4 + size;
+        }
+    } catch (const std::out_of_range& ex) {
+        // Like the scans, ignore anything following a corrupt length
+    }
+
+    std::sort(index.begin(), index.end(), [this](uint32_t a, uint32_t b) {
+        return compare_keys(key_at(a), key_at(b)) < 0;
+    });
+    indexed = true;
+}
+
+void Blob::update_index(size_t offset, size_t old_size, size_t new_size) {
+    if (!indexed) {
+        return;
+    }
+
+    if (new_size == 0) {
+        index.erase(std::remove(index.begin(), index.end(), uint32_t(offset)),
+                    index.end());
+    }
+
+    // The keys are unchanged, so the order of the index is too
+    for (auto& entry : index) {
+        if (entry > offset) {
+            entry = uint32_t(entry - old_size + new_size);
+        }
+    }
+}
+
+void Blob::index_kvpair(size_t offset) {
+    if (!indexed) {
+        return;
+    }
+
+    const auto key = key_at(offset);
+    auto iter = std::lower_bound(
+            index.begin(),
+            index.end(),
+            key,
+            [this](uint32_t entry, const cb::const_byte_buffer& k) {
+                return compare_keys(key_at(entry), k) < 0;
+            });
+    index.insert(iter, uint32_t(offset));
 }
 
 void Blob::prune_user_keys() {
+    // Removing the keys one by one would update the index for every key;
+    // just build a new one if it's needed again.
+    indexed = false;
+    index.clear();
+    scanned = 0;
+
     try {
         size_t current = 4;
         while (current < blob.len) {
@@ -79,17 +178,14 @@ void Blob::prune_user_keys() {
 
 void Blob::remove(const cb::const_byte_buffer& key) {
     // Locate the old value
-    const auto old = get(key);
-    if (old.len == 0) {
+    const auto offset = find(key);
+    if (offset == 0) {
         // it's not there
         return;
     }
 
     // there is no need to reallocate as we can just pack the buffer
-    const auto offset = old.buf - blob.buf - 1 - key.len - 4;
-    const auto size = 4 + key.len + 1 + old.len + 1;
-
-    remove_segment(offset, size);
+    remove_segment(offset, 4 + read_length(offset));
 }
 
 void Blob::set(const cb::const_byte_buffer& key,
@@ -100,38 +196,46 @@ void Blob::set(const cb::const_byte_buffer& key,
     }
 
     // Locate the old value
-    const auto old = get(key);
-    if (old.len == value.len) {
-        // lets do an in-place replacement
-        std::copy(value.buf, value.buf + value.len, old.buf);
-        return;
-    } else if (old.len == 0) {
+    const auto offset = find(key);
+    if (offset == 0) {
         // The old one didn't exist
         append_kvpair(key, value);
-    } else {
-        // we need to reorganize the buffer. Determine the size of
-        // the resulting document
-        const size_t newsize = blob.len + value.len - old.len;
-        const auto old_offset = old.buf - blob.buf - 1 - key.len - 4;
-        const auto old_kv_size = 4 + key.len + 1 + old.len + 1;
-
-        if (newsize < alloc_size) {
-            // we can do an in-place removement
-            remove_segment(old_offset, old_kv_size);
-        } else {
-            std::unique_ptr<uint8_t[]> temp(new uint8_t[newsize]);
-            // copy everything up to the old one
-            std::copy(blob.buf, blob.buf + old_offset, temp.get());
-            // Skip the old value and copy the rest
-            std::copy(blob.buf + old_offset + old_kv_size,
-                      blob.buf + blob.len, temp.get() + old_offset);
-            allocator.swap(temp);
-            blob = {allocator.get(), newsize - 4 - key.len - 1 - value.len - 1};
-            alloc_size = newsize;
-        }
+        return;
+    }
 
-        append_kvpair(key, value);
+    const size_t old_size = 4 + read_length(offset);
+    const size_t new_size = 4 + key.len + 1 + value.len + 1;
+    if (old_size == new_size) {
+        // lets do an in-place replacement
+        std::copy(value.buf,
+                  value.buf + value.len,
+                  blob.buf + offset + 4 + key.len + 1);
+        return;
+    }
+
+    // Replace the kv-pair where it is, moving the rest of the blob
+    const size_t tail = offset + old_size;
+    const size_t newsize = blob.len - old_size + new_size;
+    if (new_size < old_size || newsize <= alloc_size) {
+        // It fits in the current buffer
+        std::memmove(blob.buf + offset + new_size,
+                     blob.buf + tail,
+                     blob.len - tail);
+        blob.len = newsize;
+    } else {
+        std::unique_ptr<uint8_t[]> temp(new uint8_t[newsize]);
+        // copy everything up to the old one, and everything following it
+        std::copy(blob.buf, blob.buf + offset, temp.get());
+        std::copy(blob.buf + tail,
+                  blob.buf + blob.len,
+                  temp.get() + offset + new_size);
+        allocator.swap(temp);
+        blob = {allocator.get(), newsize};
+        alloc_size = newsize;
     }
+
+    write_kvpair(offset, key, value);
+    update_index(offset, old_size, new_size);
 }
 
 void Blob::grow_buffer(uint32_t size) {
@@ -177,6 +281,7 @@ void Blob::append_kvpair(const cb::const_byte_buffer& key,
 
     grow_buffer(needed);
     write_kvpair(offset, key, value);
+    index_kvpair(offset);
 }
 
 void Blob::remove_segment(const size_t offset, const size_t size) {
@@ -198,6 +303,8 @@ void Blob::remove_segment(const size_t offset, const size_t size) {
     if (blob.len > 0) {
         write_length(0, blob.len - 4);
     }
+
+    update_index(offset, size, 0);
 }
 
 void Blob::write_length(size_t offset, uint32_t value) {